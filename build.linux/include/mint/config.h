@@ -13,14 +13,23 @@
 #define HAVE_MALLOC_H 1
 /* #undef HAVE_MALLOC_MALLOC_H */
 #define HAVE_POLL_H 1
+#define HAVE_PTHREAD_H 1
 #define HAVE_STDBOOL_H 1
 #define HAVE_STDDEF_H 1
 #define HAVE_STDIO_H 1
 #define HAVE_STDLIB_H 1
 #define HAVE_STRING_H 1
 #define HAVE_SIGNAL_H 1
+#define HAVE_SPAWN_H 1
 #define HAVE_TIME_H 1
 #define HAVE_UNISTD_H 1
+#define HAVE_LINUX_FS_H 1
+#define HAVE_ZLIB_H 1
+#define HAVE_SYS_IOCTL_H 1
+#define HAVE_SYS_MMAN_H 1
+#define HAVE_SYS_RESOURCE_H 1
+#define HAVE_SYS_SENDFILE_H 1
+#define HAVE_SYS_SOCKET_H 1
 #define HAVE_SYS_STAT_H 1
 #define HAVE_SYS_TIME_H 1
 #define HAVE_SYS_WAIT_H 1
@@ -47,12 +56,27 @@
 // Whether access() is available.
 #define HAVE_ACCESS 1
 
+// Whether posix_spawn_file_actions_addchdir_np() is available.
+#define HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP 1
+
 // Whether malloc_size() is available.
 /* #undef HAVE_MALLOC_SIZE */
 
 // Whether malloc_usable_size() is available.
 #define HAVE_MALLOC_USABLE_SIZE 1
 
+// Whether copy_file_range() is available.
+#define HAVE_COPY_FILE_RANGE 1
+
+// Whether futimens() is available.
+#define HAVE_FUTIMENS 1
+
+// Whether wait4() is available.
+#define HAVE_WAIT4 1
+
+// Whether unlinkat() is available.
+#define HAVE_UNLINKAT 1
+
 // Whether the 'struct dirent' type defined in <dirent.h> has the 'd_type' member.
 #define DIRENT_HAS_D_TYPE 1
 
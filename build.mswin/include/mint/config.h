@@ -12,6 +12,7 @@
 #define HAVE_IO_H 1
 #define HAVE_LIMITS_H 1
 #define HAVE_POLL_H 0
+#define HAVE_PTHREAD_H 0
 #define HAVE_STDBOOL_H 1
 #define HAVE_STDDEF_H 1
 #define HAVE_STDIO_H 1
@@ -19,9 +20,17 @@
 #define HAVE_STDLIB_H 1
 #define HAVE_STRING_H 1
 #define HAVE_SIGNAL_H 1
+#define HAVE_SPAWN_H 0
 #define HAVE_TIME_H 1
 #define HAVE_UNISTD_H 0
+#define HAVE_LINUX_FS_H 0
+#define HAVE_ZLIB_H 0
 #define HAVE_MALLOC_MALLOC_H 0
+#define HAVE_SYS_IOCTL_H 0
+#define HAVE_SYS_MMAN_H 0
+#define HAVE_SYS_RESOURCE_H 0
+#define HAVE_SYS_SENDFILE_H 0
+#define HAVE_SYS_SOCKET_H 0
 #define HAVE_SYS_STAT_H 1
 #define HAVE_SYS_TIME_H 1
 #define HAVE_SYS_WAIT_H 0
@@ -49,6 +58,9 @@
 // Whether access() is available.
 #define HAVE_ACCESS 1
 
+// Whether posix_spawn_file_actions_addchdir_np() is available.
+#define HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP 0
+
 // Whether malloc_size() is available.
 #define HAVE_MALLOC_SIZE 0
 
@@ -64,6 +76,18 @@
 // Whether malloc_usable_size() is available.
 /* #undef HAVE_MALLOC_USABLE_SIZE */
 
+// Whether copy_file_range() is available.
+#define HAVE_COPY_FILE_RANGE 0
+
+// Whether futimens() is available.
+#define HAVE_FUTIMENS 0
+
+// Whether wait4() is available.
+#define HAVE_WAIT4 0
+
+// Whether unlinkat() is available.
+#define HAVE_UNLINKAT 0
+
 // Whether the 'struct dirent' type defined in <dirent.h> has the 'd_type' member.
 #define DIRENT_HAS_D_TYPE 1
 
@@ -0,0 +1,146 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#ifndef MINT_BUILD_BUILDGRAPH_H
+#define MINT_BUILD_BUILDGRAPH_H
+
+#ifndef MINT_BUILD_TARGET_H
+#include "mint/build/Target.h"
+#endif
+
+#ifndef MINT_COLLECTIONS_ARRAYREF_H
+#include "mint/collections/ArrayRef.h"
+#endif
+
+#ifndef MINT_SUPPORT_TIMESTAMP_H
+#include "mint/support/TimeStamp.h"
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    A compact copy of part of the target graph, for passes that visit every
+    target in it. Targets and files are numbered densely, with each target
+    numbered after its prerequisites; the edges of the graph are stored as
+    ranges of one shared index array per kind of edge (compressed sparse
+    rows), and the properties of targets and files are kept in parallel
+    arrays. A pass over the graph thus reads memory in order, instead of
+    following pointers from one collectable object to the next, and the graph
+    holds nothing that the collector has to trace. It refers back to the
+    targets and files it was built from, which have to outlive it.
+ */
+class BuildGraph {
+public:
+  typedef unsigned Index;
+
+  /// Per-target flags.
+  enum TargetBits {
+    /// The target contains only source files.
+    SOURCE_ONLY = (1<<0),
+
+    /// The target's state was known before the graph was built; it isn't recomputed.
+    CHECKED = (1<<1),
+
+    /// The target needs rebuilding on its own account, not just because of its
+    /// prerequisites.
+    OUT_OF_DATE = (1<<2),
+  };
+
+  /// Per-file flags.
+  enum FileBits {
+    /// The status of the file was read without error.
+    STATUS_VALID = (1<<0),
+
+    /// The file exists.
+    EXISTS = (1<<1),
+
+    /// Some target produces the file.
+    GENERATED = (1<<2),
+  };
+
+  /// Constructor
+  BuildGraph() {}
+
+  /// Build the graph from 'targets', whose prerequisites have been gathered, and
+  /// which are listed so that each comes after every one of its prerequisites that is
+  /// also in the list, apart from those it forms a cycle with. Prerequisites that
+  /// aren't in the list are added to the graph as already CHECKED.
+  void lower(ArrayRef<Target *> targets);
+
+  /// Number of targets in the graph.
+  size_t targetCount() const { return _targets.size(); }
+
+  /// Number of files in the graph.
+  size_t fileCount() const { return _files.size(); }
+
+  /// The target or file with the given index.
+  Target * target(Index id) const { return _targets[id]; }
+  File * file(Index id) const { return _files[id]; }
+
+  /// The edges out of the target 'id'.
+  ArrayRef<Index> prerequisites(Index id) const { return row(_prereqStart, _prereqs, id); }
+  ArrayRef<Index> sources(Index id) const { return row(_sourceStart, _sources, id); }
+  ArrayRef<Index> outputs(Index id) const { return row(_outputStart, _outputs, id); }
+
+  /// The targets that are waiting for target 'id', filled in by 'computeStates'.
+  ArrayRef<Index> waiters(Index id) const { return row(_waiterStart, _waiters, id); }
+
+  /// Properties of the target 'id'.
+  unsigned targetFlags(Index id) const { return _targetFlags[id]; }
+  Target::TargetState state(Index id) const { return Target::TargetState(_states[id]); }
+  unsigned pendingCount(Index id) const { return _pendingCounts[id]; }
+  const TimeStamp & inputStamp(Index id) const { return _inputStamps[id]; }
+
+  /// Properties of the file 'id'.
+  unsigned fileFlags(Index id) const { return _fileFlags[id]; }
+  const TimeStamp & lastModified(Index id) const { return _lastModified[id]; }
+
+  /// Read the status of every file in the graph that hasn't been read yet, all in one
+  /// batch, and copy the status of each file into the graph.
+  void readFileStatus();
+
+  /// Work out the state of each target that isn't CHECKED from the status of its files
+  /// and the states of its prerequisites, in a single pass in index order.
+  void computeStates();
+
+  /// Store the computed states, pending counts and waiters back into the targets.
+  void storeStates() const;
+
+private:
+  typedef SmallVector<Index, 0> IndexArray;
+
+  static ArrayRef<Index> row(const IndexArray & start, const IndexArray & edges, Index id) {
+    return ArrayRef<Index>(edges.begin() + start[id], start[id + 1] - start[id]);
+  }
+
+  /// Return the index of 'target', adding it as CHECKED if it isn't in the graph yet.
+  Index targetIndex(Target * target, unsigned generation);
+
+  /// Return the index of 'file', adding it if it isn't in the graph yet.
+  Index fileIndex(File * file, unsigned generation);
+
+  /// Targets, and their properties and edges.
+  SmallVector<Target *, 0> _targets;
+  SmallVector<unsigned char, 0> _targetFlags;
+  SmallVector<unsigned char, 0> _states;
+  SmallVector<unsigned, 0> _pendingCounts;
+  SmallVector<TimeStamp, 0> _inputStamps;
+  IndexArray _prereqStart;
+  IndexArray _prereqs;
+  IndexArray _sourceStart;
+  IndexArray _sources;
+  IndexArray _outputStart;
+  IndexArray _outputs;
+  IndexArray _waiterStart;
+  IndexArray _waiters;
+
+  /// Files, and their properties.
+  SmallVector<File *, 0> _files;
+  SmallVector<unsigned char, 0> _fileFlags;
+  SmallVector<TimeStamp, 0> _lastModified;
+};
+
+}
+
+#endif // MINT_BUILD_BUILDGRAPH_H
@@ -0,0 +1,70 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#ifndef MINT_BUILD_BUILDSTATS_H
+#define MINT_BUILD_BUILDSTATS_H
+
+#ifndef MINT_SUPPORT_PATHRECORDS_H
+#include "mint/support/PathRecords.h"
+#endif
+
+#ifndef MINT_SUPPORT_PROCESS_H
+#include "mint/support/Process.h"
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    The resources used by the most recent successful build of each target,
+    keyed by the target's path. These are kept in the build root from one
+    build to the next, both for 'mint stats' and so that the job manager can
+    tell how big a job is likely to be before it starts it.
+ */
+class BuildStats {
+public:
+  /// Constructor
+  BuildStats();
+
+  /// Load the statistics from the file at 'path'. Returns false if there is no file
+  /// there, or it can't be parsed, in which case no statistics are loaded.
+  bool read(StringRef path) { return _records.read(path); }
+
+  /// Write the statistics to the file at 'path', if any have changed since they were
+  /// read.
+  bool write(StringRef path) { return _records.write(path); }
+
+  /// Number of targets that have statistics.
+  size_t size() { return _records.size(); }
+
+  /// The path of the target at 'index', in order of target path.
+  StringRef targetPath(size_t index) { return _records.path(index); }
+
+  /// The usage of the target at 'index', in order of target path.
+  const ResourceUsage & usage(size_t index) { return _records.value(index); }
+
+  /// Return the recorded usage of the target with the given path, or NULL if there is
+  /// none.
+  const ResourceUsage * find(StringRef targetPath) {
+    _records.sort();
+    return _records.find(targetPath);
+  }
+
+  /// Record the usage of the target with the given path, replacing any previous record.
+  void record(StringRef targetPath, const ResourceUsage & usage) {
+    _records.set(targetPath, usage);
+  }
+
+private:
+  /// Reads and writes the fields of a record.
+  struct Format {
+    static bool parse(const char * line, ResourceUsage & usage, int & pathStart);
+    static void format(const ResourceUsage & usage, SmallVectorImpl<char> & out);
+  };
+
+  PathRecords<ResourceUsage, Format> _records;
+};
+
+}
+
+#endif // MINT_BUILD_BUILDSTATS_H
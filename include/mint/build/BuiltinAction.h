@@ -0,0 +1,32 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#ifndef MINT_BUILD_BUILTINACTION_H
+#define MINT_BUILD_BUILTINACTION_H
+
+#ifndef MINT_COLLECTIONS_SMALLVECTOR_H
+#include "mint/collections/SmallVector.h"
+#endif
+
+#ifndef MINT_COLLECTIONS_STRINGREF_H
+#include "mint/collections/StringRef.h"
+#endif
+
+namespace mint {
+
+class Oper;
+
+/// Perform one of the actions that mint does itself rather than by running a command,
+/// such as copying a file or creating a directory. Relative paths are relative to
+/// 'workingDir', the same as for commands. Returns false if the action failed, after
+/// reporting the error.
+bool runBuiltinAction(Oper * action, StringRef workingDir);
+
+/// Append a shell command that is equivalent to the builtin 'action' to 'result'. This
+/// is what gets written to makefiles, and shown in previews and failure reports.
+void formatBuiltinAction(Oper * action, SmallVectorImpl<char> & result);
+
+}
+
+#endif // MINT_BUILD_BUILTINACTION_H
@@ -55,6 +55,9 @@ public:
   /// Create this directory.
   bool create();
 
+  /// Delete this directory, if it is empty. Returns true if it was deleted.
+  bool remove();
+
   /// Return the last-modified time of the file.
   const TimeStamp & lastModified() const { return _status.lastModified; }
 
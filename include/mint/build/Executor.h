@@ -0,0 +1,101 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#ifndef MINT_BUILD_EXECUTOR_H
+#define MINT_BUILD_EXECUTOR_H
+
+#ifndef MINT_BUILD_WORKERPROTOCOL_H
+#include "mint/build/WorkerProtocol.h"
+#endif
+
+#ifndef MINT_COLLECTIONS_ARRAYREF_H
+#include "mint/collections/ArrayRef.h"
+#endif
+
+namespace mint {
+
+class Job;
+class String;
+class TargetMgr;
+
+/** -------------------------------------------------------------------------
+    Runs the commands of build jobs. When a command completes, the executor
+    appends its output to the job's output buffers and calls
+    Job::commandFinished().
+ */
+class Executor {
+public:
+  virtual ~Executor() {}
+
+  /// The number of commands that can run at once, or 0 to let the JobMgr decide.
+  virtual unsigned slotCount() const = 0;
+
+  /// Start running a command on behalf of 'job'. Returns false if the command
+  /// could not be started.
+  virtual bool runCommand(
+      Job * job, StringRef program, ArrayRef<StringRef> args, StringRef workingDir) = 0;
+
+  /// Wait until something happens to a running command. Returns false on error.
+  virtual bool waitForEvent() = 0;
+};
+
+/** -------------------------------------------------------------------------
+    Executor that runs commands as child processes of this one.
+ */
+class LocalExecutor : public Executor {
+public:
+  unsigned slotCount() const { return 0; }
+  bool runCommand(Job * job, StringRef program, ArrayRef<StringRef> args, StringRef workingDir);
+  bool waitForEvent();
+};
+
+/** -------------------------------------------------------------------------
+    Executor that sends commands to 'mint worker' processes over sockets.
+    Workers share the client's file system, and read everything but the
+    target's sources in place. Each command ships with the content hashes of
+    the sources, whose contents the worker fetches only if it doesn't see them
+    itself, and the list of outputs to send back.
+ */
+class RemoteExecutor : public Executor {
+public:
+  /// Constructor. Input files are hashed through the content hash cache of 'targets'.
+  RemoteExecutor(TargetMgr * targets) : _targets(targets), _nextId(1) {}
+  ~RemoteExecutor();
+
+  /// Connect to each of the workers in 'addresses', a comma-separated list of
+  /// "host:port" entries, wait for their greetings and present 'token' to them.
+  /// Returns false on error.
+  bool connect(StringRef addresses, StringRef token);
+
+  unsigned slotCount() const;
+  bool runCommand(Job * job, StringRef program, ArrayRef<StringRef> args, StringRef workingDir);
+  bool waitForEvent();
+
+private:
+  struct WorkerInfo;
+  struct Request;
+
+  /// Handle one message from a worker. Returns false if it was malformed.
+  bool handleMessage(WorkerInfo * worker, WorkerMessageType type, StringRef body);
+
+  /// Send the contents of the requested inputs.
+  bool sendInputs(WorkerInfo * worker, Request * request, StringRef body);
+
+  /// Write back the output files, and finish the job.
+  bool finishRequest(WorkerInfo * worker, Request * request, StringRef body);
+
+  /// Fail all of the requests running on a worker that went away.
+  void workerLost(WorkerInfo * worker);
+
+  Request * findRequest(uint32_t id);
+
+  TargetMgr * _targets;
+  SmallVector<WorkerInfo *, 8> _workers;
+  SmallVector<Request *, 32> _requests;
+  uint32_t _nextId;
+};
+
+}
+
+#endif // MINT_BUILD_EXECUTOR_H
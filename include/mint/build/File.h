@@ -5,6 +5,14 @@
 #ifndef MINT_BUILD_FILE_H
 #define MINT_BUILD_FILE_H
 
+#ifndef MINT_COLLECTIONS_ARRAYREF_H
+#include "mint/collections/ArrayRef.h"
+#endif
+
+#ifndef MINT_SUPPORT_CONTENTHASHER_H
+#include "mint/support/ContentHasher.h"
+#endif
+
 #ifndef MINT_SUPPORT_GC_H
 #include "mint/support/GC.h"
 #endif
@@ -38,6 +46,9 @@ public:
     , _name(name)
     , _statusChecked(false)
     , _statusValid(false)
+    , _hasContentHash(false)
+    , _graphId(0)
+    , _graphGeneration(0)
   {}
 
   /// Destructor
@@ -58,6 +69,11 @@ public:
   /// Query the file system and update the status of this file.
   bool updateFileStatus();
 
+  /// Update the status of each of 'files', querying the file system from several
+  /// threads at once when there are enough of them. Returns false if any status
+  /// couldn't be read.
+  static bool updateFileStatus(ArrayRef<File *> files);
+
   /// Return true if this file exists.
   bool exists() const { return _status.exists; }
 
@@ -67,9 +83,26 @@ public:
   /// Return the size of the file.
   size_t size() const { return _status.size; }
 
+  /// True if the contents of the file have been hashed.
+  bool hasContentHash() const { return _hasContentHash; }
+
+  /// The hash of the contents of the file, as computed by TargetMgr::hashFiles.
+  const ContentDigest & contentHash() const { return _contentHash; }
+  void setContentHash(const ContentDigest & digest) {
+    _contentHash = digest;
+    _hasContentHash = true;
+  }
+  void clearContentHash() { _hasContentHash = false; }
+
   /// Delete this file, if it exists.
   bool remove();
 
+  /// Delete each of 'files' that exists. Where the system allows, the files are grouped
+  /// by directory, and each directory is opened once and its files unlinked relative
+  /// to it, with several directories being worked on at once when there are enough
+  /// files. Returns false if any file couldn't be deleted.
+  static bool removeFiles(ArrayRef<File *> files);
+
   /// Return the list of targets that need this file to be up to date
   const TargetList & sourceFor() const { return _sourceFor; }
   void addSourceFor(Target * target) {
@@ -91,8 +124,14 @@ private:
   TargetList _sourceFor;
   TargetList _outputOf;
   path::FileStatus _status;
+  ContentDigest _contentHash;
   bool _statusChecked;
   bool _statusValid;
+  bool _hasContentHash;
+  unsigned _graphId;
+  unsigned _graphGeneration;
+
+  friend class BuildGraph;
 };
 
 /// Stream operator for Files.
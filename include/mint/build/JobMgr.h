@@ -9,6 +9,10 @@
 #include "mint/build/TargetMgr.h"
 #endif
 
+#ifndef MINT_BUILD_EXECUTOR_H
+#include "mint/build/Executor.h"
+#endif
+
 #ifndef MINT_SUPPORT_PROCESS_H
 #include "mint/support/Process.h"
 #endif
@@ -25,6 +29,7 @@
 namespace mint {
 
 class Object;
+class Oper;
 class JobMgr;
 
 /** -------------------------------------------------------------------------
@@ -57,14 +62,36 @@ public:
 
   typedef SmallVector<Node *, 4> Actions;
 
+  /// The state of an output file before the job ran, for RESTAT targets.
+  struct OutputSnapshot {
+    bool exists;
+    TimeStamp lastModified;
+    ContentDigest contentHash;
+  };
+
   /// Constructor
-  Job(JobMgr * mgr, Target * target)
-    : _mgr(mgr), _target(target), _status(RUNNING), _process(this)
+  Job(JobMgr * mgr, Target * target, unsigned slots, uint64_t memoryEstimate,
+      uint64_t memoryRecorded)
+    : _mgr(mgr), _target(target), _status(RUNNING), _process(this), _command(NULL)
+    , _slots(slots), _memoryEstimate(memoryEstimate), _memoryRecorded(memoryRecorded)
+    , _startTime(0)
   {}
 
   /// Target that this job is building
   Target * target() const { return _target; }
 
+  /// Number of job slots this job takes up: the target's weight, limited to the
+  /// number of slots there are.
+  unsigned slots() const { return _slots; }
+
+  /// The peak memory, in kilobytes, that this job was expected to use when it was
+  /// started, or 0 if there is no memory budget.
+  uint64_t memoryEstimate() const { return _memoryEstimate; }
+
+  /// The peak memory, in kilobytes, that the target used the last time it was built,
+  /// or 0 if that isn't known.
+  uint64_t memoryRecorded() const { return _memoryRecorded; }
+
   /// Start this job
   void begin();
 
@@ -74,6 +101,22 @@ public:
   /// Status of this job
   Status status() const { return _status; }
 
+  /// Resources used by this job's commands so far. The wall time is only filled in
+  /// once the job has finished, and covers the whole job rather than just its commands.
+  const ResourceUsage & usage() const { return _usage; }
+
+  /// The process used to run this job's commands locally.
+  Process & process() { return _process; }
+
+  /// Captured standard output of this job's commands.
+  StreamBuffer & output() { return _process.output(); }
+
+  /// Captured standard error of this job's commands.
+  StreamBuffer & errors() { return _process.errors(); }
+
+  /// Called by the executor when the current command has completed.
+  void commandFinished(bool success, int exitStatus, bool signaled);
+
   // Overrides
 
   void trace() const;
@@ -82,12 +125,40 @@ public:
 private:
   void runNextAction();
 
+  /// Mark this job as failed, and record the current command in the build's list of
+  /// failures. The command's text is returned in 'commandLine'.
+  void recordFailure(SmallVectorImpl<char> & commandLine);
+
+  /// Append the text of the current command to 'result'.
+  void formatCommandLine(SmallVectorImpl<char> & result) const;
+
+  /// Write out the output captured from this job's commands.
+  void writeOutput();
+
+  /// Record the state of the target's outputs before running any actions, and the
+  /// modification time of its newest source.
+  void snapshotOutputs();
+
+  /// Return true if the target's outputs are identical to the snapshot. If so, their
+  /// previous modification times are restored, so that later builds don't consider
+  /// dependents out of date either, and the target's input stamp is recorded, so that
+  /// they don't consider the target itself out of date.
+  bool outputsUnchanged();
+
   JobMgr * _mgr;
   Target * _target;
   Status _status;
   Process _process;
+  Oper * _command;
   Actions _actions;
   StringRef _outputDir;
+  SmallVector<OutputSnapshot, 4> _snapshots;
+  TimeStamp _inputStamp;
+  unsigned _slots;
+  uint64_t _memoryEstimate;
+  uint64_t _memoryRecorded;
+  ResourceUsage _usage;
+  uint64_t _startTime;
 };
 
 typedef SmallVector<Job *, 16> JobList;
@@ -98,17 +169,36 @@ typedef SmallVector<Job *, 16> JobList;
 class JobMgr : public GC {
 public:
   /// Constructor
-  JobMgr(TargetMgr * targets) : _targets(targets), _maxJobCount(4), _error(false) {}
+  JobMgr(TargetMgr * targets)
+    : _targets(targets)
+    , _executor(NULL)
+    , _maxJobCount(4)
+    , _slotsUsed(0)
+    , _memoryBudget(0)
+    , _memoryReserved(0)
+    , _memoryScale(1.0)
+    , _error(false)
+    , _failureCount(0)
+  {}
 
   /// The maximum number of jobs to run simultaneously.
   unsigned maxJobCount() const { return _maxJobCount; }
   void setMaxJobCount(unsigned count) { _maxJobCount = count; }
 
+  /// The peak memory, in kilobytes, that locally run jobs are expected to use between
+  /// them, or 0 for no limit. A job is only started if the memory it is expected to
+  /// need fits in what the running jobs leave over, unless nothing else is running.
+  uint64_t memoryBudget() const { return _memoryBudget; }
+  void setMemoryBudget(uint64_t kilobytes) { _memoryBudget = kilobytes; }
+
   /// Return the target manager.
   TargetMgr * targets() const { return _targets; }
 
-  /// Add a target to the list of ready targets. Note that this will add the target in
-  /// order.
+  /// The executor that runs job commands.
+  Executor * executor() const { return _executor; }
+
+  /// Add a target to the list of ready targets, or if it is waiting on other targets,
+  /// add the ones it's waiting for. Note that this will add the target in order.
   void addReady(Target * target);
 
   /// Add all targets that are currently ready.
@@ -123,18 +213,89 @@ public:
   /// Used by jobs to signal that they are done.
   void jobFinished(Job * job);
 
+  /// Called when 'target' is finished; queue any targets waiting for it that are now
+  /// ready.
+  void releaseDependents(Target * target);
+
+  /// Used by jobs to record a command that failed, along with its output, for
+  /// the summary printed at the end of the build.
+  void commandFailed(Target * target, StringRef commandLine, StreamBuffer & output,
+      StreamBuffer & errors);
+
   /// Start running jobs
   void run();
 
+  /// True if a job for 'target' using 'slots' slots can start without going over the
+  /// limit of the target's pool.
+  bool poolHasRoom(Target * target, unsigned slots);
+
+  /// Add 'slots' (which may be negative) to the slots used by 'target's pool.
+  void updatePoolUsage(Target * target, int slots);
+
+  /// Hold 'target' back until a job finishes that makes room for it. If 'poolFull' it
+  /// waits for a job from its own pool, otherwise for any job to free slots or memory.
+  void parkTarget(Target * target, bool poolFull);
+
+  /// Called when a job for 'target' has finished: put the targets waiting for slots or
+  /// memory, and those waiting for room in 'target's pool, back in the ready queue.
+  void releaseParked(Target * target);
+
+  /// The peak memory, in kilobytes, that a job for 'target' is expected to use: what it
+  /// used the last time it was built (which is returned in 'recorded'), scaled by how far
+  /// off this build's estimates have been so far. Targets that haven't been built before
+  /// get a fair share of the budget.
+  uint64_t memoryEstimate(Target * target, unsigned maxJobCount, uint64_t & recorded);
+
+  /// Compare the peak memory a finished job used, 'actual', with what it used last time,
+  /// 'recorded', and adjust the estimates for the jobs that follow.
+  void updateMemoryScale(uint64_t recorded, uint64_t actual);
+
+  /// The factor by which recorded memory use is scaled to estimate it for this build.
+  double memoryScale() const { return _memoryScale; }
+
+  /// Parse a memory size such as '512M' into kilobytes. A number with no suffix is in
+  /// bytes. Returns false if 'text' isn't a size.
+  static bool parseMemorySize(StringRef text, uint64_t & kilobytes);
+
   /// Garbage collection trace function.
   void trace() const;
 
 private:
+  /// The number of slots of a pool in use by running jobs, and the ready targets
+  /// waiting for some of them to be freed.
+  struct PoolUsage {
+    Object * pool;
+    unsigned used;
+    TargetList waiting;
+  };
+
+  /// Add 'target' or the targets it's waiting for, skipping any already visited in the
+  /// walk numbered 'generation'. The targets must already have had their states checked.
+  void addReady(Target * target, unsigned generation);
+
+  /// Print the failed commands recorded during the build.
+  void reportFailures();
+
+  /// Return the usage record for the pool 'pool', creating it if needed.
+  PoolUsage & poolUsage(Object * pool);
+
+  /// Create the executor: remote workers if any were requested, otherwise local processes.
+  bool createExecutor();
+
   TargetMgr * _targets;
+  Executor * _executor;
   TargetQueue _ready;
   JobList _jobs;
+  SmallVector<PoolUsage, 4> _pools;
+  TargetList _waitingForRoom;
   unsigned _maxJobCount;
+  unsigned _slotsUsed;
+  uint64_t _memoryBudget;
+  uint64_t _memoryReserved;
+  double _memoryScale;
   bool _error;
+  unsigned _failureCount;
+  SmallString<0> _failureLog;
 };
 
 }
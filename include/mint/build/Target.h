@@ -17,6 +17,10 @@
 #include "mint/support/OStream.h"
 #endif
 
+#ifndef MINT_SUPPORT_TIMESTAMP_H
+#include "mint/support/TimeStamp.h"
+#endif
+
 namespace mint {
 
 class Object;
@@ -78,6 +82,10 @@ public:
 
     /// Don't show this target in the list of targets to be built
     INTERNAL = (1<<2),
+
+    /// After rebuilding, compare the outputs with their previous contents, and
+    /// don't rebuild dependents on this target's account if nothing changed.
+    RESTAT = (1<<3),
   };
 
   /// Constructor
@@ -86,7 +94,15 @@ public:
     , _definition(definition)
     , _sortKey(NULL)
     , _cycleCheck(false)
+    , _outOfDate(false)
+    , _outputsChanged(false)
     , _flags(0)
+    , _pool(NULL)
+    , _poolDepth(0)
+    , _weight(1)
+    , _pendingCount(0)
+    , _visitGeneration(0)
+    , _graphId(0)
   {}
 
   /// Destructor
@@ -103,6 +119,11 @@ public:
   TargetState state() const { return _state; }
   void setState(TargetState state) { _state = state; }
 
+  /// True if this target is going to be built, but hasn't finished yet.
+  bool isPending() const {
+    return _state == READY || _state == READY_IN_QUEUE || _state == WAITING || _state == BUILDING;
+  }
+
   /// Target flags
   void setFlag(TargetFlags flag, bool enabled = true) {
     if (enabled) { _flags |= flag; } else { _flags &= ~flag; }
@@ -113,10 +134,36 @@ public:
   bool isExcludeFromAll() const { return getFlag(EXCLUDE_FROM_ALL); }
   bool isSourceOnly() const { return getFlag(SOURCE_ONLY); }
   bool isInternal() const { return getFlag(INTERNAL); }
+  bool isRestat() const { return getFlag(RESTAT); }
+
+  /// True if building this target changed its output files. This is false for targets
+  /// that were already up to date, and for RESTAT targets whose outputs came out the same.
+  bool outputsChanged() const { return _outputsChanged; }
+  void setOutputsChanged(bool changed) { _outputsChanged = changed; }
+
+  /// For a RESTAT target, the modification time of the newest source it was built
+  /// against the last time its outputs came out the same. Those outputs kept their
+  /// older times, so sources no newer than this don't make the target out of date.
+  const TimeStamp & inputStamp() const { return _inputStamp; }
+  void setInputStamp(const TimeStamp & stamp) { _inputStamp = stamp; }
 
   /// Object that defines this target.
   Object * definition() const { return _definition; }
 
+  /// The pool which limits how many targets like this one are built at once, or NULL.
+  /// 'poolDepth' is the pool's limit.
+  Object * pool() const { return _pool; }
+  unsigned poolDepth() const { return _poolDepth; }
+  void setPool(Object * pool, unsigned depth) {
+    _pool = pool;
+    _poolDepth = depth;
+  }
+
+  /// How many job slots building this target uses up, both of the overall job limit
+  /// and of its pool.
+  unsigned weight() const { return _weight; }
+  void setWeight(unsigned weight) { _weight = weight; }
+
   /// The source location defining this target
   Location location() const;
 
@@ -144,9 +191,42 @@ public:
   /// Return the string representing the sort key of this target
   String * sortKey();
 
-  /// Check whether this target is up to date
+  /// Check whether this target is up to date, along with every target it depends on
+  /// that hasn't been checked yet. The graph is walked without recursion, so that deep
+  /// chains of dependencies don't run out of stack, and the targets found are lowered
+  /// into a BuildGraph, which reads the status of all of their files in one batch and
+  /// works out their states.
   void checkState();
-  void recheckState();
+
+  /// The targets that have to be finished before this one can be built: the targets it
+  /// depends on, and the ones that produce its source files. Each appears once. This is
+  /// filled in by 'checkState'.
+  const TargetList & prerequisites() const { return _prerequisites; }
+
+  /// Targets that were WAITING on this one when their state was checked.
+  const TargetList & waiters() const { return _waiters; }
+
+  /// Number of prerequisites that a WAITING target is still waiting for.
+  unsigned pendingCount() const { return _pendingCount; }
+
+  /// Called when one of the prerequisites that this WAITING target is waiting for has
+  /// finished. Once they all have, the state becomes READY, or FINISHED if the only
+  /// reason to rebuild was prerequisites whose outputs didn't change. Returns true if
+  /// that was the last one.
+  bool prerequisiteFinished();
+
+  /// Return a number that no target has been visited with yet, for walking the graph.
+  static unsigned newGeneration();
+
+  /// Mark this target as visited in the walk numbered 'generation'. Returns false if it
+  /// already was.
+  bool markVisited(unsigned generation) {
+    if (_visitGeneration == generation) {
+      return false;
+    }
+    _visitGeneration = generation;
+    return true;
+  }
 
   /// Garbage collection trace function.
   void trace() const;
@@ -155,15 +235,34 @@ public:
   void print(OStream & strm) const;
 
 private:
+  /// Fill in the list of prerequisites.
+  void gatherPrerequisites();
+
+  /// True if any prerequisite changed its outputs.
+  bool dependencyChanged() const;
+
   TargetState _state;
   Object * _definition;
   String * _sortKey;
   TargetList _depends;
   TargetList _dependents;
+  TargetList _prerequisites;
+  TargetList _waiters;
   FileList _sources;
   FileList _outputs;
+  TimeStamp _inputStamp;
   bool _cycleCheck;
+  bool _outOfDate;
+  bool _outputsChanged;
   unsigned _flags;
+  Object * _pool;
+  unsigned _poolDepth;
+  unsigned _weight;
+  unsigned _pendingCount;
+  unsigned _visitGeneration;
+  unsigned _graphId;
+
+  friend class BuildGraph;
 };
 
 /** -------------------------------------------------------------------------
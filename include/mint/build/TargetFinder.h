@@ -28,8 +28,10 @@ class Target;
 class TargetFinder : public GraphVisitor<void> {
 public:
 
-  /// Constructor
-  TargetFinder(TargetMgr * targetMgr, Project * project);
+  /// Constructor. If 'configure' is true, each target object is configured as it is
+  /// found; this is for when only part of the graph is gathered, and the project has
+  /// not been configured as a whole.
+  TargetFinder(TargetMgr * targetMgr, Project * project, bool configure = false);
 
   // overrides
 
@@ -39,11 +41,12 @@ private:
   void addDependenciesToTarget(Target * target, Oper * list);
   void addSourcesToTarget(Target * target, Oper * list, StringRef baseDir);
   void addOutputsToTarget(Target * target, Oper * list, StringRef baseDir);
-  String * makeAbsolute(String * filepath, StringRef baseDir);
+  File * getFile(String * filepath, StringRef baseDir);
 
   TargetMgr * _targetMgr;
   Project * _project;
   Object * _targetProto;
+  bool _configure;
 };
 
 }
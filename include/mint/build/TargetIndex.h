@@ -0,0 +1,149 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#ifndef MINT_BUILD_TARGETINDEX_H
+#define MINT_BUILD_TARGETINDEX_H
+
+#ifndef MINT_COLLECTIONS_ARRAYREF_H
+#include "mint/collections/ArrayRef.h"
+#endif
+
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
+#endif
+
+namespace mint {
+
+class Target;
+class TargetMap;
+
+/** -------------------------------------------------------------------------
+    A snapshot of the target graph that can be saved in the build directory
+    and loaded again without evaluating the project, for answering questions
+    about it: what a target depends on, what depends on a target or file,
+    what a target produces, and which target a file belongs to.
+
+    Targets are numbered in order of name, and files in order of path, so
+    that either can be looked up by binary search. The edges from each target
+    to its dependencies, sources and outputs are kept as ranges of shared
+    index arrays, and the reverse edges are derived from them when the index
+    is built or loaded.
+ */
+class TargetIndex {
+public:
+  typedef unsigned Index;
+
+  /// Returned by the 'find' functions when there is no match.
+  static const Index NOT_FOUND = ~0u;
+
+  /// Constructor
+  TargetIndex() {}
+
+  /// Fill in the index from every target in 'targets'. A target's dependencies are the
+  /// targets it depends on directly, and those that produce its source files.
+  void build(const TargetMap & targets);
+
+  /// Load the index from the file at 'path'. Returns false if there is no file there,
+  /// or it can't be parsed, in which case the index is left empty.
+  bool read(StringRef path);
+
+  /// Append the contents of the index, in the form that 'read' expects, to 'out'.
+  void write(SmallVectorImpl<char> & out) const;
+
+  /// Number of targets in the index.
+  size_t targetCount() const { return _targetNames.size(); }
+
+  /// Number of files in the index.
+  size_t fileCount() const { return _filePaths.size(); }
+
+  /// The name of the target, or the path of the file, with the given index.
+  StringRef targetName(Index id) const { return text(_targetNames[id]); }
+  StringRef filePath(Index id) const { return text(_filePaths[id]); }
+
+  /// Look up a target by name, or a file by absolute path.
+  Index findTarget(StringRef name) const;
+  Index findFile(StringRef path) const;
+
+  /// The direct edges out of target 'id'.
+  ArrayRef<Index> depends(Index id) const { return row(_depends, id); }
+  ArrayRef<Index> sources(Index id) const { return row(_sources, id); }
+  ArrayRef<Index> outputs(Index id) const { return row(_outputs, id); }
+
+  /// The targets that depend directly on target 'id'.
+  ArrayRef<Index> dependents(Index id) const { return row(_dependents, id); }
+
+  /// The targets that produce, or that use as a source, the file 'id'.
+  ArrayRef<Index> producers(Index id) const { return row(_producers, id); }
+  ArrayRef<Index> consumers(Index id) const { return row(_consumers, id); }
+
+  /// Set 'result' to every target that the 'roots' depend on, directly or indirectly,
+  /// in order of index. The roots themselves are only included if they are part of a
+  /// cycle.
+  void dependencyClosure(ArrayRef<Index> roots, SmallVectorImpl<Index> & result) const;
+
+  /// Set 'result' to every target that depends on the 'roots', directly or indirectly,
+  /// in the same way.
+  void dependentClosure(ArrayRef<Index> roots, SmallVectorImpl<Index> & result) const;
+
+private:
+  typedef SmallVector<Index, 0> IndexArray;
+
+  /// A string, as an offset and length in '_text'.
+  struct TextRef {
+    unsigned offset;
+    unsigned length;
+  };
+
+  /// One kind of edge, in compressed sparse rows: the edges out of node 'i' are
+  /// 'edges[start[i]]' up to 'edges[start[i + 1]]'.
+  struct Rows {
+    IndexArray start;
+    IndexArray edges;
+
+    void clear() {
+      start.clear();
+      edges.clear();
+    }
+  };
+
+  struct TextLess;
+
+  StringRef text(const TextRef & ref) const {
+    return StringRef(_text.data() + ref.offset, ref.length);
+  }
+  static ArrayRef<Index> row(const Rows & rows, Index id) {
+    return ArrayRef<Index>(rows.edges.begin() + rows.start[id],
+        rows.start[id + 1] - rows.start[id]);
+  }
+
+  TextRef addText(StringRef str);
+  Index find(const SmallVectorImpl<TextRef> & names, StringRef name) const;
+  bool isSorted(const SmallVectorImpl<TextRef> & names) const;
+  void clear();
+
+  /// Fill in the reverse edges from the forward ones.
+  void buildReverseRows();
+
+  /// Set 'result' to every node reachable from 'roots' along 'rows'.
+  static void closure(const Rows & rows, size_t count, ArrayRef<Index> roots,
+      SmallVectorImpl<Index> & result);
+
+  /// Set 'reverse' to the edges of 'forward' reversed. 'count' is the number of nodes
+  /// that the edges of 'forward' lead to.
+  static void reverseRows(const Rows & forward, size_t count, Rows & reverse);
+
+  SmallString<0> _text;
+  SmallVector<TextRef, 0> _targetNames;
+  SmallVector<TextRef, 0> _filePaths;
+  Rows _depends;
+  Rows _sources;
+  Rows _outputs;
+  Rows _dependents;
+  Rows _producers;
+  Rows _consumers;
+};
+
+}
+
+#endif // MINT_BUILD_TARGETINDEX_H
@@ -17,6 +17,10 @@
 #include "mint/build/Directory.h"
 #endif
 
+#ifndef MINT_BUILD_BUILDSTATS_H
+#include "mint/build/BuildStats.h"
+#endif
+
 #ifndef MINT_GRAPH_OBJECT_H
 #include "mint/graph/Object.h"
 #endif
@@ -55,7 +59,7 @@ public:
   typedef StringDict<Directory> DirectoryMap;
 
   /// Constructor
-  TargetMgr() : _buildRoot(NULL) {}
+  TargetMgr();
 
   /// Map of all named targets.
   const TargetMap & targets() const { return _targets; }
@@ -65,6 +69,7 @@ public:
 
   /// Given an absolute path to a file, return the File object, creating it if needed.
   File * getFile(String * filePath);
+  File * getFile(StringRef filePath);
 
   /// Given an absolute path to a directory, return the Directory object, creating it if needed.
   Directory * getDirectory(String * dirPath);
@@ -80,17 +85,69 @@ public:
   Directory * setBuildRoot(StringRef buildRoot);
   Directory * buildRoot() const { return _buildRoot; }
 
-  /// Delete output files
+  /// Delete the output files of every target, and then any directories in the build
+  /// root that are left empty. Output files outside of the build root are left alone.
   void deleteOutputFiles();
 
+  /// Delete the output files of 'roots' and of everything they depend on, in the same
+  /// way.
+  void deleteOutputFiles(ArrayRef<Target *> roots);
+
+  /// Compute the content hash of each of 'files', reading them in parallel. Hashes are
+  /// cached in the build root, so files which haven't changed since they were last
+  /// hashed aren't read again. Files which don't exist, or can't be read, are left
+  /// without a hash.
+  bool hashFiles(const FileList & files);
+
+  /// Save the cache of content hashes, if it has changed.
+  void saveContentHashes();
+
+  /// The resources used by the last successful build of each target, loaded from the
+  /// build root the first time they are needed.
+  BuildStats & buildStats();
+
+  /// Save the build statistics, if they have changed.
+  void saveBuildStats();
+
+  /// The input stamp recorded for the RESTAT target that produces 'output', loaded
+  /// from the build root the first time it is needed; zero if there is none.
+  TimeStamp restatStamp(File * output);
+
+  /// Record the input stamp of the RESTAT target that produces 'output'.
+  void recordRestatStamp(File * output, const TimeStamp & stamp);
+
+  /// Save the RESTAT input stamps, if they have changed.
+  void saveRestatStamps();
+
   /// Garbage collection trace function.
   void trace() const;
 
 private:
+  /// Delete the outputs of 'targets', and prune the directories they were in.
+  void removeOutputs(ArrayRef<Target *> targets);
+
+  /// True if 'dir' is the build root or inside it.
+  bool inBuildRoot(Directory * dir) const;
+
+  /// Load the RESTAT input stamps, if they haven't been yet.
+  void loadRestatStamps();
+
+  /// Reads and writes an input stamp, in nanoseconds since the epoch.
+  struct StampFormat {
+    static bool parse(const char * line, int64_t & stamp, int & pathStart);
+    static void format(const int64_t & stamp, SmallVectorImpl<char> & out);
+  };
+
   TargetMap _targets;
   FileMap _files;
   DirectoryMap _dirs;
   Directory * _buildRoot;
+  ContentHasher _hasher;
+  BuildStats _stats;
+  PathRecords<int64_t, StampFormat> _restatStamps;
+  bool _hashesLoaded;
+  bool _statsLoaded;
+  bool _stampsLoaded;
 };
 
 }
@@ -0,0 +1,90 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#ifndef MINT_BUILD_WORKER_H
+#define MINT_BUILD_WORKER_H
+
+#ifndef MINT_BUILD_WORKERPROTOCOL_H
+#include "mint/build/WorkerProtocol.h"
+#endif
+
+#ifndef MINT_SUPPORT_PROCESS_H
+#include "mint/support/Process.h"
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    The 'mint worker' server. Accepts connections from build clients and runs
+    the commands they send, no more than its number of slots at once, however
+    many clients there are. A client has to present the worker's token before
+    it can send commands.
+
+    Workers need a file system shared with their clients: commands run in the
+    client's working directory, read their tools, headers and any other files
+    in place, and write their outputs where the client expects them. Only the
+    target's sources are checked by content hash. Any source that the worker
+    doesn't see with the client's contents comes from the blob cache or from
+    the client, and is written under a directory of the cache that belongs to
+    that client; command arguments naming that source are pointed at the copy.
+    When a command finishes, its output and the contents of its output files
+    are sent back.
+ */
+class Worker {
+public:
+  /// Constructor
+  Worker();
+
+  /// Destructor
+  ~Worker();
+
+  /// Parse the worker options in [first, last), listen on the requested address and
+  /// serve clients. Only returns if there was an error.
+  int run(char ** first, char ** last);
+
+private:
+  struct Client;
+  class Task;
+
+  /// Accept any pending connections.
+  void acceptClients();
+
+  /// Read and handle the messages from a client. Returns false if it disconnected.
+  bool serviceClient(Client * client);
+
+  /// Handle a RUN message.
+  bool runRequest(Client * client, StringRef body);
+
+  /// Handle a BLOB message.
+  bool receiveBlob(Client * client, StringRef body);
+
+  /// Write an input file from the blob cache, if the cache has it.
+  bool materializeInput(StringRef path, const ContentDigest & hash);
+
+  /// Start the tasks whose inputs are all present, oldest first, for as long as
+  /// fewer than '_slots' are running.
+  void startReadyTasks();
+
+  /// Start the command for a task whose inputs are all present.
+  void startTask(Task * task);
+
+  /// Send the output and results of a finished task.
+  void sendResult(Task * task);
+
+  /// Compute the blob cache path for a content hash.
+  void blobPath(const ContentDigest & hash, SmallVectorImpl<char> & result) const;
+
+  int _listenFd;
+  unsigned _slots;
+  unsigned _nextClientId;
+  SmallString<64> _token;
+  SmallString<128> _cacheDir;
+  ContentHasher _hasher;
+  SmallVector<Client *, 8> _clients;
+  SmallVector<Task *, 32> _tasks;
+};
+
+}
+
+#endif // MINT_BUILD_WORKER_H
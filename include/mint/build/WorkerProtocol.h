@@ -0,0 +1,181 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#ifndef MINT_BUILD_WORKERPROTOCOL_H
+#define MINT_BUILD_WORKERPROTOCOL_H
+
+#ifndef MINT_CONFIG_H
+#include "mint/config.h"
+#endif
+
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
+#endif
+
+#ifndef MINT_SUPPORT_CONTENTHASHER_H
+#include "mint/support/ContentHasher.h"
+#endif
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    Messages exchanged between a JobMgr (the client) and a 'mint worker'.
+
+    Every message is framed as a 4-byte big-endian length, followed by that
+    many bytes: a one-byte message type and then the message fields. Integer
+    fields are big-endian; strings are a 4-byte length followed by the bytes.
+    Content hashes are the raw 32 bytes of a file's BLAKE3 digest.
+
+    A session goes like this: on connect the worker sends HELLO, and the client
+    answers with AUTH, carrying the token shared by the worker and its clients.
+    The worker drops a client that sends anything else first, or the wrong token.
+    The client then sends RUN for each command. If the worker doesn't see the
+    same contents for some of the target's sources (matched by content hash) it
+    replies with NEED, and the client sends a BLOB for each one. The command's
+    output comes back as OUTPUT messages, and then a RESULT carrying the exit
+    status and the contents of the output files.
+ */
+enum WorkerMessageType {
+  /// worker -> client: protocol version, number of slots
+  WORKER_HELLO = 1,
+
+  /// client -> worker: request id, working dir, program, [args], [(input path, hash)],
+  /// [output path]
+  WORKER_RUN,
+
+  /// worker -> client: request id, [hashes of inputs the worker doesn't have]
+  WORKER_NEED,
+
+  /// client -> worker: content hash, contents
+  WORKER_BLOB,
+
+  /// worker -> client: request id, stream (1 = stdout, 2 = stderr), text
+  WORKER_OUTPUT,
+
+  /// worker -> client: request id, exit status, signaled,
+  /// [(output path, exists, mode, contents)]
+  WORKER_RESULT,
+
+  /// client -> worker: token
+  WORKER_AUTH
+};
+
+/// Version number sent in the handshake, so that mismatched peers can refuse each other.
+const unsigned WORKER_PROTOCOL_VERSION = 3;
+
+/// The largest frame length that a peer will accept. This bounds how much a peer can
+/// make the other buffer, and is enough for the output files of any sensible command.
+const size_t WORKER_MAX_FRAME_SIZE = 256 * 1024 * 1024;
+
+/** -------------------------------------------------------------------------
+    Encodes a single message.
+ */
+class MessageWriter {
+public:
+  MessageWriter(WorkerMessageType type);
+
+  void putInt(uint32_t value);
+  void putInt64(uint64_t value);
+  void putString(StringRef value);
+  void putDigest(const ContentDigest & value);
+
+  /// Fill in the frame length and return the encoded message.
+  StringRef finish();
+
+private:
+  SmallString<256> _buffer;
+};
+
+/** -------------------------------------------------------------------------
+    Decodes the fields of a single message body. Once a read fails (because the
+    message was truncated) all further reads fail as well.
+ */
+class MessageReader {
+public:
+  MessageReader(StringRef body) : _pos(body.begin()), _end(body.end()), _ok(true) {}
+
+  bool getInt(uint32_t & value);
+  bool getInt64(uint64_t & value);
+  bool getString(StringRef & value);
+  bool getDigest(ContentDigest & value);
+
+  /// True if no read has failed so far.
+  bool ok() const { return _ok; }
+
+private:
+  bool require(size_t size);
+
+  const char * _pos;
+  const char * _end;
+  bool _ok;
+};
+
+/** -------------------------------------------------------------------------
+    A non-blocking socket with message framing on top. Outgoing messages are
+    queued, and written as the socket accepts them.
+ */
+class MessageConnection {
+public:
+  MessageConnection(int fd);
+
+  /// The socket.
+  int fd() const { return _fd; }
+
+  /// True if the socket is still open.
+  bool isOpen() const { return _fd >= 0; }
+
+  /// Queue a message for sending.
+  void send(MessageWriter & msg);
+
+  /// True if there is queued output that hasn't been written yet.
+  bool hasOutput() const { return _outPos < _out.size(); }
+
+  /// Write queued output. If 'wait' is true, block until all of it is written.
+  /// Returns false if the connection failed.
+  bool flushOutput(bool wait);
+
+  /// Read whatever input is available. Returns false on end of input or error.
+  bool readInput();
+
+  /// Extract the next complete message from the input. The body remains valid
+  /// until the next call to readInput(). Returns false if no complete message
+  /// is available, or if the input is not a valid frame, in which case failed()
+  /// becomes true.
+  bool nextMessage(WorkerMessageType & type, StringRef & body);
+
+  /// True if the peer sent a frame that is empty or larger than WORKER_MAX_FRAME_SIZE.
+  /// This is a protocol error, and the connection should be closed.
+  bool failed() const { return _failed; }
+
+  /// Close the socket.
+  void close();
+
+private:
+  int _fd;
+  SmallString<0> _in;
+  size_t _inPos;
+  SmallString<0> _out;
+  size_t _outPos;
+  bool _failed;
+};
+
+/// The token that workers and their clients authenticate with: 'option' if it isn't
+/// empty, and otherwise the value of the MINT_WORKER_TOKEN environment variable.
+StringRef workerToken(StringRef option);
+
+/// Open a socket listening on 'address', which is of the form "host:port". Returns -1
+/// and reports an error on failure.
+int listenOnAddress(StringRef address);
+
+/// Connect to the worker at 'address', which is of the form "host:port". Returns -1
+/// and reports an error on failure.
+int connectToAddress(StringRef address);
+
+}
+
+#endif // MINT_BUILD_WORKERPROTOCOL_H
@@ -17,6 +17,10 @@
 #include <stdlib.h>
 #endif
 
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
 #if HAVE_CPLUS_ITERATOR
 #include <iterator>
 #endif
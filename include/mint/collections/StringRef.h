@@ -105,6 +105,12 @@ public:
     return (_size >= rhs._size && compareMemory(_data, rhs._data, rhs._size) == 0);
   }
 
+  /// Check for string suffix.
+  bool endsWith(StringRef rhs) const {
+    return (_size >= rhs._size &&
+        compareMemory(_data + _size - rhs._size, rhs._data, rhs._size) == 0);
+  }
+
   /// Find the first occurrence of character 'ch'
   size_t find(char ch, size_t from = 0) {
     from = std::min(from, _size);
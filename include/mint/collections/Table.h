@@ -13,10 +13,20 @@
 #include <stddef.h>
 #endif
 
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
 #if HAVE_UTILITY
 #include <utility>
 #endif
 
+#include <iterator>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace mint {
 
 /** -------------------------------------------------------------------------
@@ -32,13 +42,73 @@ struct DefaultKeyTraits {
 };
 
 /** -------------------------------------------------------------------------
-    A probed hash table that holds references to garbage-collectable objects.
+    Operations on a group of table control bytes. Each slot in a Table has one
+    control byte: EMPTY, or a 7-bit fragment of the hash of the key stored in
+    the slot. A group of GROUP_SIZE control bytes can be compared against a
+    hash fragment at once, which yields a bit mask of candidate slots; only
+    those slots need a full key comparison.
+ */
+struct TableGroup {
+  enum {
+    GROUP_SIZE = 16,
+  };
+
+  static const signed char EMPTY = -128;
+
+  /// Bit mask of the slots in the group whose control byte equals 'h2'.
+  static inline unsigned match(const signed char * ctrl, signed char h2) {
+  #if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+    return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), group)));
+  #else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < GROUP_SIZE; ++i) {
+      mask |= unsigned(ctrl[i] == h2) << i;
+    }
+    return mask;
+  #endif
+  }
+
+  /// Bit mask of the empty slots in the group.
+  static inline unsigned matchEmpty(const signed char * ctrl) {
+    return match(ctrl, EMPTY);
+  }
+
+  /// Index of the lowest set bit in a non-zero mask.
+  static inline unsigned lowestBit(unsigned mask) {
+  #if defined(__GNUC__)
+    return unsigned(__builtin_ctz(mask));
+  #else
+    unsigned index = 0;
+    while ((mask & 1) == 0) {
+      mask >>= 1;
+      ++index;
+    }
+    return index;
+  #endif
+  }
+
+  /// The 7-bit hash fragment stored in the control byte. This is taken from the high bits
+  /// of a multiplicative hash so that it is independent of the bits used to pick a group.
+  static inline signed char fragment(unsigned hash) {
+    return static_cast<signed char>((hash * 0x9E3779B1u) >> 25);
+  }
+};
+
+/** -------------------------------------------------------------------------
+    A hash table that holds references to garbage-collectable objects. Slots
+    are arranged in groups of TableGroup::GROUP_SIZE, with a separate array
+    of control bytes that lets a whole group be probed with a few vector
+    instructions. Groups are probed in triangular order, which visits every
+    group when the number of groups is a power of two.
  */
 template<typename Key, typename Value, typename KeyTraits = DefaultKeyTraits<Key> >
 class Table {
 public:
   typedef std::pair<Key *, Value *> value_type;
 
+  class const_iterator;
+
   /// Iterator class
 
   class iterator {
@@ -50,13 +120,13 @@ public:
     typedef std::forward_iterator_tag iterator_category;
 
     /// Copy constructor
-    iterator(const iterator & src) : _ptr(src._ptr), _end(src._end) {}
+    iterator(const iterator & src) : _ptr(src._ptr), _end(src._end), _ctrl(src._ctrl) {}
 
     /// Assignment
     const iterator & operator=(const iterator & src) {
       _ptr = src._ptr;
       _end = src._end;
-      skipOverEmptyEntries();
+      _ctrl = src._ctrl;
       return *this;
     }
 
@@ -83,6 +153,7 @@ public:
     /// Pre-increment
     iterator operator++() {
       _ptr += 1;
+      _ctrl += 1;
       skipOverEmptyEntries();
       return *this;
     }
@@ -96,20 +167,23 @@ public:
 
   private:
     friend class Table;
-    //friend class Table::const_iterator;
-    iterator(value_type * ptr, value_type * end) : _ptr(ptr), _end(end) {
+    friend class const_iterator;
+    iterator(value_type * ptr, const value_type * end, const signed char * ctrl)
+      : _ptr(ptr), _end(end), _ctrl(ctrl)
+    {
       skipOverEmptyEntries();
     }
 
     void skipOverEmptyEntries() {
-      Key * tombstoneKey = reinterpret_cast<Key *>(-1);
-      while (_ptr < _end && (_ptr->first == NULL || _ptr->first == tombstoneKey)) {
+      while (_ptr < _end && *_ctrl < 0) {
         ++_ptr;
+        ++_ctrl;
       }
     }
 
     value_type * _ptr;
     const value_type * _end;
+    const signed char * _ctrl;
   };
 
   /// Constant Iterator class
@@ -123,21 +197,22 @@ public:
     typedef std::forward_iterator_tag iterator_category;
 
     /// Copy constructor
-    const_iterator(const const_iterator & src) : _ptr(src._ptr), _end(src._end) {}
-    const_iterator(const iterator & src) : _ptr(src._ptr), _end(src._end) {}
+    const_iterator(const const_iterator & src)
+      : _ptr(src._ptr), _end(src._end), _ctrl(src._ctrl) {}
+    const_iterator(const iterator & src) : _ptr(src._ptr), _end(src._end), _ctrl(src._ctrl) {}
 
     /// Assignment
     const const_iterator & operator=(const const_iterator & src) {
       _ptr = src._ptr;
       _end = src._end;
-      skipOverEmptyEntries();
+      _ctrl = src._ctrl;
       return *this;
     }
 
     const const_iterator & operator=(const iterator & src) {
       _ptr = src._ptr;
       _end = src._end;
-      skipOverEmptyEntries();
+      _ctrl = src._ctrl;
       return *this;
     }
 
@@ -164,6 +239,7 @@ public:
     /// Pre-increment
     const_iterator operator++() {
       _ptr += 1;
+      _ctrl += 1;
       skipOverEmptyEntries();
       return *this;
     }
@@ -177,35 +253,37 @@ public:
 
   private:
     friend class Table;
-    const_iterator(const value_type * ptr, const value_type * end) : _ptr(ptr), _end(end) {
+    const_iterator(const value_type * ptr, const value_type * end, const signed char * ctrl)
+      : _ptr(ptr), _end(end), _ctrl(ctrl)
+    {
       skipOverEmptyEntries();
     }
 
     void skipOverEmptyEntries() {
-      Key * tombstoneKey = reinterpret_cast<Key *>(-1);
-      while (_ptr < _end && (_ptr->first == NULL || _ptr->first == tombstoneKey)) {
+      while (_ptr < _end && *_ctrl < 0) {
         ++_ptr;
+        ++_ctrl;
       }
     }
 
     const value_type * _ptr;
     const value_type * _end;
+    const signed char * _ctrl;
   };
 
-  Table(size_t initialSize = 0) : _data(NULL), _dataSize(0), _size(0) {
+  Table(size_t initialSize = 0) : _data(NULL), _ctrl(NULL), _dataSize(0), _size(0) {
     if (initialSize != 0) {
-      size_t powerOfTwoSize = 16;   // Minimum size
+      size_t powerOfTwoSize = TableGroup::GROUP_SIZE;   // Minimum size
       while (powerOfTwoSize < initialSize) {
         powerOfTwoSize <<= 1;
       }
-      _data = new value_type[powerOfTwoSize]();
-      _dataSize = powerOfTwoSize;
-      ::memset(_data, 0, _dataSize * sizeof(value_type));
+      allocate(powerOfTwoSize);
     }
   }
 
   ~Table() {
-    delete _data;
+    delete[] _data;
+    delete[] _ctrl;
   }
 
   /// Number of entries currently stored in the map.
@@ -214,26 +292,20 @@ public:
 
   // Iterators
 
-  iterator begin() { return iterator(dataBegin(), dataEnd()); }
-  const_iterator begin() const { return const_iterator(dataBegin(), dataEnd()); }
-  iterator end() { return iterator(dataEnd(), dataEnd()); }
-  const_iterator end() const { return const_iterator(dataEnd(), dataEnd()); }
+  iterator begin() { return iterator(dataBegin(), dataEnd(), _ctrl); }
+  const_iterator begin() const { return const_iterator(dataBegin(), dataEnd(), _ctrl); }
+  iterator end() { return iterator(dataEnd(), dataEnd(), ctrlEnd()); }
+  const_iterator end() const { return const_iterator(dataEnd(), dataEnd(), ctrlEnd()); }
 
   // Map operations
 
   iterator find(Key * key) {
-    value_type * entry;
-    if (lookup(key, entry)) {
-      return iterator(entry, dataEnd());
-    }
-    return end();
+    value_type * entry = lookup(key, KeyTraits::hash(key));
+    return entry != NULL ? makeIterator(entry) : end();
   }
   const_iterator find(Key * key) const {
-    value_type * entry;
-    if (lookup(key, entry)) {
-      return const_iterator(entry, dataEnd());
-    }
-    return end();
+    value_type * entry = lookup(key, KeyTraits::hash(key));
+    return entry != NULL ? makeConstIterator(entry) : end();
   }
 
   /// An alternate form of 'find' which can accept a different type of key
@@ -242,170 +314,147 @@ public:
   /// be much less expensive to create.
   template<class AltKey>
   const_iterator find_as(const AltKey & key) const {
-    value_type * entry;
-    if (lookup_as(key, entry)) {
-      return const_iterator(entry, dataEnd());
-    }
-    return end();
+    value_type * entry = lookup(key, KeyTraits::hash(key));
+    return entry != NULL ? makeConstIterator(entry) : end();
   }
 
   /// Inserts the key and value into the map if it's not already in the map.
   /// If it is, it returns false and doesn't update the value.
   std::pair<iterator, bool> insert(const value_type & value) {
-    value_type * entry;
-    if (!lookup(value.first, entry)) {
-      put(value.first, value.second, entry);
-      return std::make_pair(iterator(entry, dataEnd()), true);
+    unsigned hash = KeyTraits::hash(value.first);
+    value_type * entry = lookup(value.first, hash);
+    if (entry == NULL) {
+      entry = put(value.first, value.second, hash);
+      return std::make_pair(makeIterator(entry), true);
     }
-    return std::make_pair(iterator(entry, dataEnd()), false);
+    return std::make_pair(makeIterator(entry), false);
   }
 
   /// Insert a range of elements
   template <typename InIter>
   void insert(InIter first, InIter last) {
-    while (first < last) {
-      insert(*first);
+    while (first != last) {
+      insert(*first++);
     }
   }
 
   /// Element access operator
   Value *& operator[](Key * key) {
-    value_type * entry;
-    if (lookup(key, entry)) {
-      return entry->second;
+    unsigned hash = KeyTraits::hash(key);
+    value_type * entry = lookup(key, hash);
+    if (entry == NULL) {
+      entry = put(key, NULL, hash);
     }
-    put(key, NULL, entry);
     return entry->second;
   }
 
+  /// Remove all entries from the map (but not the keys or values themselves).
+  void clear() {
+    delete[] _data;
+    delete[] _ctrl;
+    _data = NULL;
+    _ctrl = NULL;
+    _dataSize = 0;
+    _size = 0;
+  }
+
 private:
   value_type * dataBegin() const { return &_data[0]; }
   value_type * dataEnd() const { return &_data[_dataSize]; }
+  const signed char * ctrlEnd() const { return &_ctrl[_dataSize]; }
 
-  /// Attempt to find an existing entry that matches 'key'. If found, return true, along with
-  /// a pointer to that entry. If not found, return false along with an unoccupied slot which
-  /// can hold the new entry. If an unoccupied slot cannot be found, then return dataEnd().
-  bool lookup(Key * key, value_type *& slot) const {
-    if (_dataSize > 0) {
-      unsigned index = KeyTraits::hash(key) & (_dataSize - 1);
-      unsigned increment = 7;
-      value_type * tombstone = NULL;
-      Key * tombstoneKey = reinterpret_cast<Key *>(-1);
-      for (;;) {
-        value_type * e = &_data[index];
-        if (e->first == NULL) {
-          // Empty slot
-          slot = e;
-          return false;
-        } else if (e->first == tombstoneKey) {
-          // Tombstone slot - save for later
-          if (!tombstone) {
-            tombstone = e;
-          }
-        } else if (KeyTraits::equals(e->first, key)) {
-          // Matching slot - return true
-          slot = e;
-          return true;
-        }
-        index = (index + increment) & (_dataSize - 1);
-      }
-
-      if (tombstone) {
-        slot = tombstone;
-        return false;
-      };
-    }
+  iterator makeIterator(value_type * entry) {
+    return iterator(entry, dataEnd(), &_ctrl[entry - _data]);
+  }
 
-    slot = dataEnd();
-    return false;
+  const_iterator makeConstIterator(const value_type * entry) const {
+    return const_iterator(entry, dataEnd(), &_ctrl[entry - _data]);
   }
 
-  /// Similar to lookup(), except that it accepts keys of a different type, which can
-  /// be compared with the normal type keys.
+  size_t groupMask() const { return (_dataSize / TableGroup::GROUP_SIZE) - 1; }
+
+  /// Find the entry matching 'key', which may be of the regular key type or of any type
+  /// that KeyTraits knows how to compare with it. Returns NULL if there is no such entry.
   template<class AltKey>
-  bool lookup_as(const AltKey & key, value_type *& slot) const {
-    if (_dataSize > 0) {
-      unsigned index = KeyTraits::hash(key) & (_dataSize - 1);
-      unsigned increment = 7;
-      value_type * tombstone = NULL;
-      Key * tombstoneKey = reinterpret_cast<Key *>(-1);
-      for (;;) {
-        value_type * e = &_data[index];
-        if (e->first == NULL) {
-          // Empty slot
-          slot = e;
-          return false;
-        } else if (e->first == tombstoneKey) {
-          // Tombstone slot - save for later
-          if (!tombstone) {
-            tombstone = e;
-          }
-        } else if (KeyTraits::equals(e->first, key)) {
-          // Matching slot - return true
-          slot = e;
-          return true;
+  value_type * lookup(const AltKey & key, unsigned hash) const {
+    if (_dataSize == 0) {
+      return NULL;
+    }
+    signed char h2 = TableGroup::fragment(hash);
+    size_t mask = groupMask();
+    size_t group = hash & mask;
+    for (size_t step = 1;; ++step) {
+      const signed char * ctrl = &_ctrl[group * TableGroup::GROUP_SIZE];
+      for (unsigned m = TableGroup::match(ctrl, h2); m != 0; m &= m - 1) {
+        value_type * e = &_data[group * TableGroup::GROUP_SIZE + TableGroup::lowestBit(m)];
+        if (KeyTraits::equals(e->first, key)) {
+          return e;
         }
-        index = (index + increment) & (_dataSize - 1);
       }
-
-      if (tombstone) {
-        slot = tombstone;
-        return false;
-      };
+      if (TableGroup::matchEmpty(ctrl) != 0) {
+        return NULL;
+      }
+      group = (group + step) & mask;
     }
+  }
 
-    slot = dataEnd();
-    return false;
+  /// Return the first empty slot in the probe sequence for 'hash'.
+  size_t findEmptySlot(unsigned hash) const {
+    size_t mask = groupMask();
+    size_t group = hash & mask;
+    for (size_t step = 1;; ++step) {
+      unsigned m = TableGroup::matchEmpty(&_ctrl[group * TableGroup::GROUP_SIZE]);
+      if (m != 0) {
+        return group * TableGroup::GROUP_SIZE + TableGroup::lowestBit(m);
+      }
+      group = (group + step) & mask;
+    }
   }
 
-  /// Insert the key and value into the specified table entry. If the entry == dataEnd()
-  /// it means we couldn't find an empty slot within the limit of probing, in which case
-  /// it's time to grow the table.
-  void put(Key * key, Value * value, value_type *& slot) {
-    if ((_size + 1) * 3 > _dataSize * 2) {
+  /// Insert a key known not to be in the table, growing the table if needed so that
+  /// it is at most 7/8 full.
+  value_type * put(Key * key, Value * value, unsigned hash) {
+    if ((_size + 1) * 8 > _dataSize * 7) {
       grow();
-      lookup(key, slot);
     }
-    M_ASSERT_BASE(slot != dataEnd());
+    size_t index = findEmptySlot(hash);
+    _ctrl[index] = TableGroup::fragment(hash);
+    value_type * slot = &_data[index];
     slot->first = key;
     slot->second = value;
     ++_size;
+    return slot;
   }
 
-  /// Double the size of the table.
-  void grow() {
-    const value_type * s = &_data[0];
-    const value_type * e = &_data[_dataSize];
-    for (;;) {
-      _dataSize = _dataSize == 0 ? 16 : _dataSize * 2;
-      _data = new value_type[_dataSize]();
-      ::memset(_data, 0, _dataSize * sizeof(value_type));
-      // Insert all the old entries
-      if (rehash(s, e)) {
-        break;
-      }
-    }
+  void allocate(size_t dataSize) {
+    _dataSize = dataSize;
+    _data = new value_type[_dataSize]();
+    _ctrl = new signed char[_dataSize];
+    ::memset(_ctrl, TableGroup::EMPTY, _dataSize);
   }
 
-  /// Insert all of the occupied entries from s through e into the table. Returns false
-  /// if any entry required too many probings.
-  bool rehash(const value_type * s, const value_type * e) {
-    while (s < e) {
-      if (s->first != NULL && s->first != reinterpret_cast<Key *>(-1)) {
-        value_type * slot;
-        lookup(s->first, slot);
-        if (slot == dataEnd()) {
-          return false;
-        }
-
-        *slot = *s;
+  /// Double the size of the table.
+  void grow() {
+    value_type * oldData = _data;
+    const signed char * oldCtrl = _ctrl;
+    size_t oldSize = _dataSize;
+    allocate(_dataSize == 0 ? size_t(TableGroup::GROUP_SIZE) : _dataSize * 2);
+    // Insert all the old entries; they are known to be distinct, so there is no need
+    // to compare keys.
+    for (size_t i = 0; i < oldSize; ++i) {
+      if (oldCtrl[i] >= 0) {
+        unsigned hash = KeyTraits::hash(oldData[i].first);
+        size_t index = findEmptySlot(hash);
+        _ctrl[index] = oldCtrl[i];
+        _data[index] = oldData[i];
       }
-      ++s;
     }
-    return true;
+    delete[] oldData;
+    delete[] oldCtrl;
   }
 
   value_type * _data;
+  signed char * _ctrl;
   size_t _dataSize;
   size_t _size;
 };
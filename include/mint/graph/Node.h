@@ -137,6 +137,9 @@ public:
   /// Return true if this node kind represents a constant.
   static bool isConstant(NodeKind nk);
 
+  /// Return true if this node kind is an action that mint performs itself.
+  static bool isBuiltinAction(NodeKind nk);
+
   /// Return the boolean value 'true' as a Node.
   static Node * boolTrue();
 
@@ -123,10 +123,9 @@ public:
   const Attributes & attrs() const { return _attrs; }
   Attributes & attrs() { return _attrs; }
 
-  /// Simple function to set the value of an attribute
-  void setAttribute(String * attrName, Node * attrValue) {
-    _attrs[attrName] = attrValue;
-  }
+  /// Simple function to set the value of an attribute. Identifier names are
+  /// interned so that later lookups can compare keys by pointer.
+  void setAttribute(String * attrName, Node * attrValue);
 
   /// The parse tree for this object - unevaluated
   Node * definition() const { return _definition; }
@@ -31,6 +31,10 @@ public:
   static Oper * createList(Location location, Type * type, Node * arg0);
   static Oper * createList(Location location, Type * type, Node * arg0, Node * arg1);
 
+  /// The name of the method in the 'action' namespace that creates a builtin action
+  /// of the given kind, such as 'copy' for NK_ACTION_COPY.
+  static const char * builtinActionName(NodeKind nk);
+
   /// Number of arguments to the operation.
   unsigned size() const { return _size; }
 
@@ -56,8 +56,12 @@ public:
   iterator begin() const { return &_data[0]; }
   iterator end() const { return &_data[_size]; }
 
-  /// Compute a hash value for this string
-  unsigned hash() const;
+  /// The hash value for this string, computed once at construction.
+  unsigned hash() const { return _hash; }
+
+  /// True if this is the canonical instance held by the StringRegistry. Two interned
+  /// strings are equal if and only if they are the same object.
+  bool isInterned() const { return _interned; }
 
   /// Print a readable version of this node to the stream.
   void print(OStream & strm) const;
@@ -69,8 +73,12 @@ public:
   static String * strFalse();
 
 private:
+  friend class StringRegistry;
+
   String(NodeKind nt, Location location, Type * ty, StringRef value);
 
+  unsigned _hash;
+  bool _interned;
   unsigned _size;
   char _data[1];
 };
@@ -15,6 +15,19 @@
 
 namespace mint {
 
+/** -------------------------------------------------------------------------
+    A string reference together with its hash value. Used as a lookup key
+    when the same name is going to be probed against several tables, such as
+    when walking an object's prototype chain.
+ */
+struct HashedStringRef {
+  HashedStringRef(StringRef v) : value(v), hash(v.hash()) {}
+  HashedStringRef(const String * s) : value(s->value()), hash(s->hash()) {}
+
+  StringRef value;
+  unsigned hash;
+};
+
 /** -------------------------------------------------------------------------
     TableKeyTraits for Strings.
  */
@@ -24,7 +37,12 @@ struct StringKeyTraits {
   }
 
   static inline unsigned equals(const String * sl, const String * sr) {
-    return sl == sr || sl->value() == sr->value();
+    if (sl == sr) {
+      return true;
+    } else if (sl->hash() != sr->hash() || (sl->isInterned() && sr->isInterned())) {
+      return false;
+    }
+    return sl->value() == sr->value();
   }
 
   static inline unsigned hash(StringRef key) {
@@ -34,6 +52,14 @@ struct StringKeyTraits {
   static inline unsigned equals(const String * sl, StringRef sr) {
     return sl->value() == sr;
   }
+
+  static inline unsigned hash(const HashedStringRef & key) {
+    return key.hash;
+  }
+
+  static inline unsigned equals(const String * sl, const HashedStringRef & sr) {
+    return sl->hash() == sr.hash && sl->value() == sr.value;
+  }
 };
 
 /** -------------------------------------------------------------------------
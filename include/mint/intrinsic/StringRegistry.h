@@ -22,6 +22,14 @@ public:
     return get().makestr(in);
   }
 
+  /// Return the canonical instance of an identifier. Identifiers produced by the
+  /// parser carry a source location, so they are not interned when created;
+  /// this is called when they are used as attribute names. Quoted strings are
+  /// returned unchanged.
+  static String * intern(String * in) {
+    return in->isInterned() || in->nodeKind() != Node::NK_IDENT ? in : get().makestr(in);
+  }
+
   /// Return the StringRegistry singleton.
   static StringRegistry & get();
 
@@ -32,6 +40,7 @@ public:
 private:
   /// Intern string function
   String * makestr(StringRef in);
+  String * makestr(String * in);
 
   StringDict<Node> _strings;
 };
@@ -25,6 +25,8 @@ class Oper;
 class JobMgr;
 class TargetMgr;
 class Directory;
+class GeneratorStamp;
+class TargetIndex;
 
 typedef ArrayRef<char *> CStringArray;
 
@@ -101,15 +103,24 @@ public:
   /// Show all targets
   void showTargets(CStringArray cmdLineArgs);
 
+  /// Show the targets that took the most time, memory and I/O in previous builds
+  void showStats(CStringArray cmdLineArgs);
+
   /// Dump debug info for targets
   void dumpTargets(CStringArray cmdLineArgs);
 
+  /// Answer a question about the target graph, from the index saved in the build
+  /// directory if nothing the graph was evaluated from has changed since it was saved.
+  void query(CStringArray cmdLineArgs);
+
   /// Trace roots
   void trace() const;
 
 private:
   bool readProjects(StringRef file, SmallVectorImpl<Node *> & projects, bool required);
   void createSubdirs(Directory * dir);
+  void addGeneratorInputs(GeneratorStamp & stamp);
+  bool loadTargetIndex(TargetIndex & index);
 
   SmallString<0> _buildRoot;
   Fundamentals * _fundamentals;
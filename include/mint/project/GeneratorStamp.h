@@ -0,0 +1,100 @@
+/* ================================================================== *
+ * Mint: A refreshing approach to build configuration.
+ * ================================================================== */
+
+#ifndef MINT_PROJECT_GENERATORSTAMP_H
+#define MINT_PROJECT_GENERATORSTAMP_H
+
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
+#endif
+
+#ifndef MINT_SUPPORT_CONTENTHASHER_H
+#include "mint/support/ContentHasher.h"
+#endif
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+namespace mint {
+
+class DirectoryListing;
+
+/** -------------------------------------------------------------------------
+    A record of the inputs and outputs of a previous run of a build file
+    generator, kept in the build directory. If none of the inputs has changed
+    since then, and none of the outputs has been touched, the generator can
+    skip evaluating the project entirely.
+
+    The inputs are the project's option and configuration files, the source
+    of every module that was loaded, and every directory that was listed while
+    evaluating (for 'glob'). Each is recorded by the BLAKE3 digest of its
+    contents. Outputs are recorded by the digest of what was written to them,
+    along with their size and modification time in nanoseconds, so that an
+    output can be checked without reading it.
+ */
+class GeneratorStamp {
+public:
+  /// Constructor
+  GeneratorStamp() {}
+
+  /// Read a stamp from the file at 'path'. Returns false if there is no stamp,
+  /// or it can't be parsed.
+  bool read(StringRef path);
+
+  /// Write the stamp to the file at 'path'.
+  bool write(StringRef path);
+
+  /// True if there is at least one output, every input still has the recorded
+  /// contents, and every output still has the recorded size and modification time.
+  bool isUpToDate() const;
+
+  /// Record an input file with the given contents.
+  void addInput(StringRef path, StringRef contents);
+
+  /// Record an input file, reading its contents.
+  void addInput(StringRef path);
+
+  /// Record a directory that was listed.
+  void addDirectory(const DirectoryListing * listing);
+
+  /// Write 'contents' to the file at 'path' and record it as an output, unless
+  /// 'previous' shows that the file was written with the same contents last time
+  /// and hasn't been modified since. Returns false if the file couldn't be written.
+  bool writeOutput(StringRef path, StringRef contents, const GeneratorStamp & previous);
+
+private:
+  enum Kind {
+    INPUT,
+    DIRECTORY,
+    OUTPUT
+  };
+
+  struct Record {
+    Kind kind;
+    ContentDigest digest;
+    uint64_t size;
+    int64_t lastModified;
+    unsigned pathOffset;
+    unsigned pathLength;
+  };
+
+  struct RecordLess;
+
+  void add(Kind kind, StringRef path, const ContentDigest & digest, uint64_t size = 0,
+      int64_t lastModified = 0);
+  StringRef recordPath(const Record & rec) const {
+    return StringRef(_paths.data() + rec.pathOffset, rec.pathLength);
+  }
+  const Record * findOutput(StringRef path) const;
+  static ContentDigest contentDigest(StringRef contents);
+  static ContentDigest listingDigest(const DirectoryListing * listing);
+
+  SmallVector<Record, 0> _records;
+  SmallString<0> _paths;
+};
+
+}
+
+#endif // MINT_PROJECT_GENERATORSTAMP_H
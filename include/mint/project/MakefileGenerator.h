@@ -32,6 +32,9 @@ public:
   /// Return the stream that this writes to.
   OStream & strm() { return _strm; }
 
+  /// Return the text of the generated makefile.
+  StringRef contents() { return _strm.str(); }
+
 protected:
   void writeTarget(Target * target);
   void writeExternalTarget(Target * target);
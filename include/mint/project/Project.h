@@ -21,6 +21,7 @@ namespace mint {
 
 class Object;
 class BuildConfiguration;
+class GeneratorStamp;
 class GraphWriter;
 class String;
 
@@ -99,6 +100,11 @@ public:
   /// Collect targets into the target manager.
   void gatherTargets();
 
+  /// Collect only the targets in 'roots' and the targets they transitively depend on,
+  /// configuring each as it is found. This does not require configure() to have been
+  /// called, so the cost is proportional to the size of the selected subgraph.
+  void gatherTargets(ArrayRef<Object *> roots);
+
   /// Garbage collection
   void trace() const;
 
@@ -111,8 +117,9 @@ public:
   /// Return the list of project options (names and values) sorted in name order.
   void getProjectOptions(SmallVectorImpl<StringDict<Object>::value_type> & options) const;
 
-  /// Write out makefiles for this project
-  void writeMakefiles() const;
+  /// Write out makefiles for this project, recording each one in 'stamp'. Makefiles
+  /// that 'previous' shows are already up to date are not rewritten.
+  void writeMakefiles(const GeneratorStamp & previous, GeneratorStamp & stamp) const;
 
 private:
   bool setConfigVars(Node * n);
@@ -0,0 +1,71 @@
+/* ================================================================ *
+   BLAKE3 cryptographic hash function.
+ * ================================================================ */
+
+#ifndef MINT_SUPPORT_BLAKE3_H
+#define MINT_SUPPORT_BLAKE3_H
+
+#ifndef MINT_CONFIG_H
+#include "mint/config.h"
+#endif
+
+#if HAVE_STDDEF_H
+#include <stddef.h>
+#endif
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    Incremental BLAKE3 hasher, producing the standard 32-byte digest.
+
+    BLAKE3 splits the input into 1KB chunks which are hashed independently
+    and then combined as a binary tree. This implementation hashes four
+    chunks at a time using SSE2 when it's available, and one at a time
+    otherwise; the result is the same either way.
+ */
+class Blake3 {
+public:
+  enum {
+    DIGEST_SIZE = 32,
+    BLOCK_SIZE = 64,
+    CHUNK_SIZE = 1024
+  };
+
+  /// Constructor
+  Blake3();
+
+  /// Add 'size' bytes at 'data' to the input.
+  void update(const char * data, size_t size);
+
+  /// Write the digest of all the input so far to 'out'. More input can still be added
+  /// afterwards.
+  void finalize(uint8_t out[DIGEST_SIZE]) const;
+
+  /// Hash 'size' bytes at 'data' in one step.
+  static void hash(const char * data, size_t size, uint8_t out[DIGEST_SIZE]);
+
+private:
+  /// Enough chaining values for 2^54 chunks, which is more than a 64-bit size allows.
+  enum { MAX_DEPTH = 54 };
+
+  unsigned chunkLength() const { return _blocksCompressed * BLOCK_SIZE + _blockLength; }
+  void updateChunk(const char * data, size_t size);
+  void finishChunk();
+  void pushChunkValue(const uint32_t cv[8], uint64_t totalChunks);
+
+  uint32_t _chunkValue[8];
+  uint64_t _chunkCounter;
+  uint8_t _block[BLOCK_SIZE];
+  unsigned _blockLength;
+  unsigned _blocksCompressed;
+  uint32_t _stack[MAX_DEPTH][8];
+  unsigned _stackSize;
+};
+
+}
+
+#endif // MINT_SUPPORT_BLAKE3_H
@@ -0,0 +1,142 @@
+/* ================================================================ *
+   Parallel, cached hashing of file contents.
+ * ================================================================ */
+
+#ifndef MINT_SUPPORT_CONTENTHASHER_H
+#define MINT_SUPPORT_CONTENTHASHER_H
+
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
+#endif
+
+#ifndef MINT_SUPPORT_BLAKE3_H
+#include "mint/support/Blake3.h"
+#endif
+
+#ifndef MINT_SUPPORT_PATHRECORDS_H
+#include "mint/support/PathRecords.h"
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    The BLAKE3 digest of the contents of a file.
+ */
+struct ContentDigest {
+  uint8_t bytes[Blake3::DIGEST_SIZE];
+
+  ContentDigest() {
+    for (unsigned i = 0; i < Blake3::DIGEST_SIZE; ++i) {
+      bytes[i] = 0;
+    }
+  }
+
+  bool operator==(const ContentDigest & other) const {
+    for (unsigned i = 0; i < Blake3::DIGEST_SIZE; ++i) {
+      if (bytes[i] != other.bytes[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const ContentDigest & other) const {
+    return !(*this == other);
+  }
+
+  /// Append the digest to 'out' as hexadecimal.
+  void toHex(SmallVectorImpl<char> & out) const;
+
+  /// Parse a digest written by 'toHex'. Returns false if 'hex' isn't one.
+  bool fromHex(StringRef hex);
+};
+
+/** -------------------------------------------------------------------------
+    Computes the content hashes of files, spreading a batch of files across
+    worker threads. Files that are large enough are mapped into memory rather
+    than read.
+
+    Hashes are remembered in a cache keyed by each file's path, size,
+    modification time (in nanoseconds) and inode, which can be saved to and
+    loaded from disk, so that files which haven't changed since a previous run
+    are never read again. A file modified within the last second isn't added
+    to the cache, since it could change again without its modification time
+    changing if the file system's clock is coarse.
+ */
+class ContentHasher {
+public:
+  /// The result of hashing one file.
+  struct Result {
+    ContentDigest digest;
+    bool exists;
+    bool valid;
+
+    Result() : exists(false), valid(false) {}
+  };
+
+  /// Constructor
+  ContentHasher();
+
+  /// Number of threads to hash with. The default is the number of processors.
+  unsigned threadCount() const { return _threadCount; }
+  void setThreadCount(unsigned count) { _threadCount = count > 0 ? count : 1; }
+
+  /// Load cached hashes from the file at 'path'. Returns false if there is no cache
+  /// there, or it can't be parsed, in which case the cache is left empty.
+  bool readCache(StringRef path);
+
+  /// Write the cached hashes to the file at 'path', if any have changed since the
+  /// cache was read.
+  bool writeCache(StringRef path);
+
+  /// Number of files which were actually read by the most recent 'hashFiles', rather
+  /// than found in the cache.
+  unsigned filesRead() const { return _filesRead; }
+
+  /// Hash each file in 'paths', setting 'results' to the corresponding hashes. A file
+  /// which doesn't exist is not an error, but has a result with 'exists' false. Returns
+  /// false if any existing file could not be read.
+  bool hashFiles(const SmallVectorImpl<StringRef> & paths, SmallVectorImpl<Result> & results);
+
+  /// Hash the file at 'path' without using the cache.
+  static bool hashFile(StringRef path, ContentDigest & digest);
+
+  /// The identity of a version of a file, as recorded by 'stat'.
+  struct FileKey {
+    uint64_t size;
+    int64_t lastModified;
+    uint64_t inode;
+
+    FileKey() : size(0), lastModified(0), inode(0) {}
+
+    bool operator==(const FileKey & other) const {
+      return size == other.size && lastModified == other.lastModified && inode == other.inode;
+    }
+  };
+
+private:
+  /// What the cache remembers about a file.
+  struct Entry {
+    FileKey key;
+    ContentDigest digest;
+  };
+
+  /// Reads and writes the fields of a cache entry.
+  struct Format {
+    static bool parse(const char * line, Entry & entry, int & pathStart);
+    static void format(const Entry & entry, SmallVectorImpl<char> & out);
+  };
+
+  struct Batch;
+
+  static void hashRange(size_t start, size_t end, void * batch);
+  static void hashOne(Batch * batch, size_t index);
+
+  PathRecords<Entry, Format> _cache;
+  unsigned _threadCount;
+  unsigned _filesRead;
+};
+
+}
+
+#endif // MINT_SUPPORT_CONTENTHASHER_H
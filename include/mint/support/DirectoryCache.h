@@ -0,0 +1,132 @@
+/* ================================================================ *
+   Cache of directory listings.
+ * ================================================================ */
+
+#ifndef MINT_SUPPORT_DIRECTORYCACHE_H
+#define MINT_SUPPORT_DIRECTORYCACHE_H
+
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
+#endif
+
+#ifndef MINT_COLLECTIONS_TABLE_H
+#include "mint/collections/Table.h"
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    The entries of one directory, sorted by name.
+ */
+class DirectoryListing {
+public:
+  /// Constructor
+  DirectoryListing(StringRef path) : _path(path), _exists(false) {}
+
+  /// Path to the directory.
+  StringRef path() const { return _path; }
+
+  /// False if the directory could not be read.
+  bool exists() const { return _exists; }
+
+  /// Number of entries, not counting '.' and '..'.
+  size_t size() const { return _entries.size(); }
+
+  /// Name of the entry at 'index'.
+  StringRef name(size_t index) const {
+    const Entry & e = _entries[index];
+    return StringRef(_names.data() + e.offset, e.length);
+  }
+
+  /// True if the entry at 'index' is a directory (or a link to one).
+  bool isDirectory(size_t index) const { return _entries[index].isDirectory; }
+
+  /// True if the entry at 'index' is a symbolic link.
+  bool isLink(size_t index) const { return _entries[index].isLink; }
+
+  /// Return the index of the entry called 'name', or -1 if there is none.
+  int find(StringRef name) const;
+
+  /// Read the directory.
+  void read();
+
+private:
+  struct Entry {
+    unsigned offset;
+    unsigned length;
+    bool isDirectory;
+    bool isLink;
+  };
+
+  struct EntryLess;
+
+  SmallString<64> _path;
+  SmallString<0> _names;
+  SmallVector<Entry, 0> _entries;
+  bool _exists;
+};
+
+/** -------------------------------------------------------------------------
+    TableKeyTraits for directory listings.
+ */
+struct DirectoryListingKeyTraits {
+  static inline unsigned hash(const DirectoryListing * key) {
+    return key->path().hash();
+  }
+
+  static inline unsigned equals(const DirectoryListing * sl, const DirectoryListing * sr) {
+    return sl == sr || sl->path() == sr->path();
+  }
+
+  static inline unsigned hash(StringRef key) {
+    return key.hash();
+  }
+
+  static inline unsigned equals(const DirectoryListing * sl, StringRef sr) {
+    return sl->path() == sr;
+  }
+};
+
+/** -------------------------------------------------------------------------
+    Remembers the contents of each directory that has been listed, so that
+    repeated searches of the same tree (such as several calls to 'glob' over
+    one source directory) only read each directory once. Entry types come from
+    the directory entries themselves where possible, so listing a directory
+    does not require a 'stat' for every file in it.
+
+    The cache assumes that the directories don't change while it is in use,
+    so it only lasts for one evaluation pass: gathering the targets of a
+    project, or working out the actions of one job. Building changes the
+    files, so the cache is cleared once gathering is finished, and again
+    before each job's actions are evaluated.
+ */
+class DirectoryCache {
+public:
+  /// Constructor
+  DirectoryCache() {}
+
+  /// Destructor
+  ~DirectoryCache() { clear(); }
+
+  /// Return the listing for 'dirPath', reading the directory if it hasn't been
+  /// read already. The result is owned by the cache.
+  const DirectoryListing * list(StringRef dirPath);
+
+  /// Append every listing in the cache to 'out'.
+  void getListings(SmallVectorImpl<const DirectoryListing *> & out) const;
+
+  /// Forget all listings.
+  void clear();
+
+  /// The cache used by the build.
+  static DirectoryCache & get();
+
+private:
+  typedef Table<DirectoryListing, char, DirectoryListingKeyTraits> ListingTable;
+
+  ListingTable _listings;
+};
+
+}
+
+#endif // MINT_SUPPORT_DIRECTORYCACHE_H
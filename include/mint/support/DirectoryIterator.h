@@ -38,10 +38,10 @@ public:
 
   /// Begin a new iteration, for the directory located at 'dirPath'.
   /// Returns false if there was an error (and prints appropriate
-  /// error messages to stderr.)
+  /// error messages to stderr, unless 'quiet' is true.)
   /// You should call 'next' after calling this method to get the
   /// first filesystem entry.
-  bool begin(StringRef dirPath);
+  bool begin(StringRef dirPath, bool quiet = false);
 
   /// The name of the current directory entry. This will only be valid
   /// until the next call to 'next'.
@@ -51,6 +51,11 @@ public:
   /// This will only be valid until the next call to 'next'.
   bool isDirectory() const;
 
+  /// Returns false if the directory entry didn't say what kind of entry it is, or if
+  /// it's a symbolic link; in that case isDirectory() is false, and the caller will
+  /// need to stat the entry to find out.
+  bool isTypeKnown() const;
+
   /// Advance to the next entry. Returns false if there is no next entry.
   bool next();
 
@@ -62,6 +67,7 @@ private:
     DIR * _dirp;
     const char * _entryName;
     bool _isDirectory;
+    bool _isTypeKnown;
   #endif
   #if _WIN32
     HANDLE _dirp;
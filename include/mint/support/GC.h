@@ -49,6 +49,9 @@ public:
   /// Set the verbosity level.
   static void setDebugLevel(unsigned level);
 
+  /// Total number of objects allocated so far.
+  static unsigned long allocationCount() { return _allocCount; }
+
   /// A version of mark which handles null pointers.
   template <class T>
   static void safeMark(T const * const ptr) {
@@ -99,6 +102,7 @@ private:
   static unsigned _debugLevel;
   static unsigned char _cycleIndex;
   static GC * _allocList;
+  static unsigned long _allocCount;
   static GCRootBase * _roots;
 };
 
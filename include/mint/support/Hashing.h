@@ -1,5 +1,5 @@
 /* ================================================================== *
- * Hashing - basic hash algorithm (FNV-1).
+ * Hashing - basic hash algorithm (word-at-a-time, wyhash family).
  * ================================================================== */
 
 #ifndef MINT_SUPPORT_HASHING_H
@@ -9,10 +9,20 @@
 #include "mint/config.h"
 #endif
 
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
 namespace mint {
 
+/// Hash all of the bytes in the range [first, last). The result is not stable across
+/// platforms of different byte order, so it must not be written to persistent storage.
 unsigned hash(const char * first, const char * last);
 
+/// A 64-bit version of 'hash', for when a collision must be vanishingly unlikely, such as
+/// when deciding whether the contents of a file have changed.
+uint64_t hash64(const char * first, const char * last);
+
 } // namespace mint
 
 #endif // MINT_SUPPORT_HASHING_H
@@ -0,0 +1,33 @@
+/* ================================================================ *
+   Running a loop over a range of items on several threads.
+ * ================================================================ */
+
+#ifndef MINT_SUPPORT_PARALLELFOR_H
+#define MINT_SUPPORT_PARALLELFOR_H
+
+#ifndef MINT_CONFIG_H
+#include "mint/config.h"
+#endif
+
+#if HAVE_STDDEF_H
+#include <stddef.h>
+#endif
+
+namespace mint {
+
+/// Called by parallelFor for each chunk of items [start, end), with the 'arg' that was
+/// passed to parallelFor. Chunks may run at the same time on different threads.
+typedef void (*ParallelForFn)(size_t start, size_t end, void * arg);
+
+/// Number of processors online, or 'fallback' if that can't be determined.
+unsigned processorCount(unsigned fallback = 1);
+
+/// Split the items [0, count) into chunks of 'chunk' items and call 'fn' on each one.
+/// The chunks are shared out between up to 'threads' threads, one of which is the
+/// calling thread; 0 means one thread per processor. Returns when every chunk is done.
+/// If no more threads can be started the calling thread does the rest of the work.
+void parallelFor(size_t count, size_t chunk, ParallelForFn fn, void * arg, unsigned threads = 0);
+
+}
+
+#endif // MINT_SUPPORT_PARALLELFOR_H
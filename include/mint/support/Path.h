@@ -182,6 +182,10 @@ struct FileStatus {
 /// provided FileStatus structure.
 bool fileStatus(StringRef path, FileStatus & status);
 
+/// Like 'fileStatus', but instead of printing an error message, sets 'error' to the
+/// system error code. This one is safe to call from several threads at once.
+bool fileStatus(StringRef path, FileStatus & status, int & error);
+
 /// Read the contents of a file located at 'path' into 'buffer'.
 /// Return false if there was an error.
 bool readFileContents(StringRef path, SmallVectorImpl<char> & buffer);
@@ -190,8 +194,16 @@ bool readFileContents(StringRef path, SmallVectorImpl<char> & buffer);
 /// creates parent directories if needed. Return false if there was an error.
 bool writeFileContents(StringRef path, StringRef content);
 
-/// Copy the contents of the file at 'sourcePath' to the file at 'outputPath'.
-bool copyFile(StringRef sourcePath, StringRef outputPath);
+enum CopyFlags {
+  COPY_PRESERVE_TIME = (1<<0),  // Give the copy the same modification time as the source
+  COPY_HARDLINK = (1<<1),       // Make the copy a hard link to the source, if possible
+};
+
+/// Copy the contents of the file at 'sourcePath' to the file at 'outputPath'. Where the
+/// file system supports it, the copy shares storage with the source (a reflink), or is
+/// done entirely within the kernel; otherwise it is copied through a large buffer.
+/// Return false if there was an error.
+bool copyFile(StringRef sourcePath, StringRef outputPath, unsigned flags = 0);
 
 /// Read the contents of a file located at 'path' into 'buffer', and check if it is
 /// different from the text in 'newContent'. If it is, then overwrite the contents
@@ -204,6 +216,15 @@ bool makeDirectoryPath(StringRef path);
 /// Delete a file from the file system.
 bool remove(StringRef path);
 
+/// Delete the directory at 'path' if it is empty. Returns false if it wasn't deleted;
+/// an error is only reported if that was for some other reason than the directory
+/// not being empty, or not existing.
+bool removeDirectory(StringRef path);
+
+/// Set the last-modified (and last-accessed) time of the file at 'path'. Where the
+/// system allows, this keeps the fraction of a second.
+bool setLastModified(StringRef path, const TimeStamp & time);
+
 }
 }
 
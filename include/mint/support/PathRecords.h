@@ -0,0 +1,251 @@
+/* ================================================================ *
+   A table of records keyed by path, which can be saved to a file.
+ * ================================================================ */
+
+#ifndef MINT_SUPPORT_PATHRECORDS_H
+#define MINT_SUPPORT_PATHRECORDS_H
+
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
+#endif
+
+#ifndef MINT_SUPPORT_ASSERT_H
+#include "mint/support/Assert.h"
+#endif
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    The parts of PathRecords that don't depend on the type of record: reading
+    and writing the file.
+ */
+class PathRecordFile {
+public:
+  /// Read the file at 'path' into 'content', and check that its first line is
+  /// 'header'. Sets 'bodyStart' to the offset of the line after it. Returns false if
+  /// the file doesn't exist, can't be read, or has the wrong header.
+  static bool read(StringRef path, StringRef header, SmallVectorImpl<char> & content,
+      size_t & bodyStart);
+
+  /// Write 'content' to the file at 'path'.
+  static bool write(StringRef path, StringRef content);
+};
+
+/** -------------------------------------------------------------------------
+    A table of records keyed by absolute path, kept in order of path so that
+    records can be found by binary search. Records can be added in any order;
+    the table is sorted again the next time it's searched, and if a path was
+    added more than once, the record added last is kept.
+
+    The table is saved as text: a header line, and then a line for each
+    record, which is the record's fields followed by its path. 'Format'
+    converts the fields, with two static functions:
+
+      // Parse the fields at the start of 'line', setting 'pathStart' to the
+      // offset of the path which follows them.
+      bool parse(const char * line, Value & value, int & pathStart);
+
+      // Append the fields of 'value' to 'out', followed by a space.
+      void format(const Value & value, SmallVectorImpl<char> & out);
+ */
+template <class Value, class Format>
+class PathRecords {
+public:
+  /// Constructor. 'header' is the first line of the file; a file with a different
+  /// first line isn't loaded.
+  PathRecords(const char * header) : _header(header), _sorted(true), _modified(false) {}
+
+  /// Load the records from the file at 'path'. Returns false if there is no file
+  /// there, or it can't be parsed, in which case the table is left empty.
+  bool read(StringRef path);
+
+  /// Write the records to the file at 'path', if any have changed since they were
+  /// read.
+  bool write(StringRef path);
+
+  /// Remove all records.
+  void clear() {
+    _entries.clear();
+    _paths.clear();
+    _sorted = true;
+    _modified = false;
+  }
+
+  /// Number of records.
+  size_t size() {
+    sort();
+    return _entries.size();
+  }
+
+  /// The path and value of the record at 'index', in order of path.
+  StringRef path(size_t index) {
+    sort();
+    return entryPath(_entries[index]);
+  }
+  const Value & value(size_t index) {
+    sort();
+    return _entries[index].value;
+  }
+
+  /// Put the records in order, if they aren't already. This has to be done before
+  /// 'find' can be used.
+  void sort();
+
+  /// Return the record for 'path', or NULL if there is none. This doesn't change the
+  /// table, so any number of threads can call it at once, once it has been sorted.
+  const Value * find(StringRef path) const;
+
+  /// Set the record for 'path', replacing any record it already had.
+  void set(StringRef path, const Value & value);
+
+  /// True if the table has changed since it was read or written.
+  bool modified() const { return _modified; }
+
+private:
+  struct Entry {
+    Value value;
+    unsigned pathOffset;
+    unsigned pathLength;
+  };
+
+  /// Orders entries by path.
+  struct EntryLess {
+    EntryLess(const char * paths) : _paths(paths) {}
+
+    bool operator()(const Entry & lhs, const Entry & rhs) const {
+      return StringRef(_paths + lhs.pathOffset, lhs.pathLength).compare(
+          StringRef(_paths + rhs.pathOffset, rhs.pathLength)) < 0;
+    }
+
+    bool operator()(const Entry & lhs, StringRef rhs) const {
+      return StringRef(_paths + lhs.pathOffset, lhs.pathLength).compare(rhs) < 0;
+    }
+
+    const char * _paths;
+  };
+
+  StringRef entryPath(const Entry & entry) const {
+    return StringRef(_paths.data() + entry.pathOffset, entry.pathLength);
+  }
+
+  void append(StringRef path, const Value & value) {
+    Entry entry;
+    entry.value = value;
+    entry.pathOffset = _paths.size();
+    entry.pathLength = path.size();
+    _paths.append(path);
+    _entries.push_back(entry);
+  }
+
+  const char * _header;
+  SmallVector<Entry, 0> _entries;
+  SmallString<0> _paths;
+  bool _sorted;
+  bool _modified;
+};
+
+template <class Value, class Format>
+bool PathRecords<Value, Format>::read(StringRef path) {
+  clear();
+  SmallString<0> content;
+  size_t pos;
+  if (!PathRecordFile::read(path, _header, content, pos)) {
+    return false;
+  }
+  StringRef text(content);
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if (end == StringRef::npos) {
+      end = text.size();
+    }
+    SmallString<256> line(text.substr(pos, end - pos));
+    pos = end + 1;
+
+    Value value;
+    int pathStart = 0;
+    if (!Format::parse(line.cstr(), value, pathStart) || pathStart <= 0 ||
+        unsigned(pathStart) > line.size()) {
+      clear();
+      return false;
+    }
+    append(line.substr(pathStart), value);
+  }
+  _sorted = false;
+  sort();
+  _modified = false;
+  return true;
+}
+
+template <class Value, class Format>
+bool PathRecords<Value, Format>::write(StringRef path) {
+  if (!_modified) {
+    return true;
+  }
+  sort();
+  SmallString<0> content(_header);
+  content.push_back('\n');
+  for (const Entry * e = _entries.begin(); e != _entries.end(); ++e) {
+    Format::format(e->value, content);
+    content.append(entryPath(*e));
+    content.push_back('\n');
+  }
+  if (!PathRecordFile::write(path, content)) {
+    return false;
+  }
+  _modified = false;
+  return true;
+}
+
+template <class Value, class Format>
+void PathRecords<Value, Format>::sort() {
+  if (_sorted) {
+    return;
+  }
+  // Sort stably so that when a path appears more than once, the last one added wins.
+  std::stable_sort(_entries.begin(), _entries.end(), EntryLess(_paths.data()));
+  Entry * out = _entries.begin();
+  for (Entry * it = _entries.begin(); it != _entries.end(); ++it) {
+    if (out != _entries.begin() && entryPath(out[-1]) == entryPath(*it)) {
+      out[-1] = *it;
+    } else {
+      *out++ = *it;
+    }
+  }
+  _entries.resize(out - _entries.begin());
+  _sorted = true;
+}
+
+template <class Value, class Format>
+const Value * PathRecords<Value, Format>::find(StringRef path) const {
+  M_ASSERT(_sorted);
+  const Entry * it = std::lower_bound(
+      _entries.begin(), _entries.end(), path, EntryLess(_paths.data()));
+  if (it != _entries.end() && entryPath(*it) == path) {
+    return &it->value;
+  }
+  return NULL;
+}
+
+template <class Value, class Format>
+void PathRecords<Value, Format>::set(StringRef path, const Value & value) {
+  _modified = true;
+  if (_sorted) {
+    Entry * it = std::lower_bound(
+        _entries.begin(), _entries.end(), path, EntryLess(_paths.data()));
+    if (it != _entries.end() && entryPath(*it) == path) {
+      it->value = value;
+      return;
+    }
+    // A path after all of the others keeps the table in order.
+    _sorted = it == _entries.end();
+  }
+  append(path, value);
+}
+
+}
+
+#endif // MINT_SUPPORT_PATHRECORDS_H
@@ -5,6 +5,10 @@
 #ifndef MINT_SUPPORT_PROCESS_H
 #define MINT_SUPPORT_PROCESS_H
 
+#ifndef MINT_CONFIG_H
+#include "mint/config.h"
+#endif
+
 #ifndef MINT_COLLECTIONS_SMALLSTRING_H
 #include "mint/collections/SmallString.h"
 #endif
@@ -17,6 +21,14 @@
 #include "mint/support/Path.h"
 #endif
 
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
 #if defined(_WIN32)
 #include <Windows.h>
 #endif
@@ -27,9 +39,11 @@ class ProcessListener;
 class OStream;
 
 /** -------------------------------------------------------------------------
-    Used to buffer the output of a stream from a child process. This makes
-    sure that the output isn't garbled by insuring that only complete lines
-    get written.
+    Captures the output of a stream from a child process. Output is
+    accumulated in a buffer that grows as the child produces more data, and
+    is spilled to a temporary file once it passes a size threshold. The
+    captured text is written out in one piece when the owner asks for it, so
+    that the output of concurrent processes never gets interleaved.
  */
 class StreamBuffer {
 public:
@@ -39,7 +53,12 @@ public:
     typedef int StreamID;
   #endif
 
-  StreamBuffer(OStream & out);
+  enum {
+    INITIAL_CAPACITY = 4096,        // Size of the first read buffer
+    SPILL_THRESHOLD = 1024 * 1024   // Captured bytes kept in memory before spilling
+  };
+
+  StreamBuffer();
 
   /// Return the identifier of the input pipe.
   StreamID source() const { return _source; }
@@ -48,32 +67,72 @@ public:
   /// to be non-blocking.
   void setSource(StreamID source);
 
-  /// Process as many lines as possible, until there is no more data available
-  /// on the input source at this time. Returns true if we've reached the end of
-  /// the input.
-  bool processLines();
+  /// Read as much data as is available on the input source at this time.
+  /// Returns true if we've reached the end of the input.
+  bool readAvailable();
 
-  bool flush();
+  /// Append text that was captured by some other means, such as from a remote worker.
+  void append(const char * text, size_t length);
 
+  /// Total number of bytes captured so far.
+  size_t size() const { return _spillSize + _size; }
+
+  /// True if nothing has been captured.
+  bool empty() const { return size() == 0; }
+
+  /// Append up to 'maxSize' bytes from the start of the captured output to 'result'.
+  /// Returns the number of bytes copied.
+  size_t copyTo(SmallVectorImpl<char> & result, size_t maxSize) const;
+
+  /// Write all of the captured output to 'out', and then discard it.
+  void writeTo(OStream & out);
+
+  /// Discard the captured output and release any memory or temporary file used to hold it.
+  void clear();
+
+  /// Read whatever input remains and close the source.
   void close();
 
 private:
-  /// Fill the buffer from the source. Return true if the buffer is actually
-  /// full, return false if we couldn't fill the buffer for any reason (generally
-  /// meaning that there's no more data available at this moment.)
-  bool fillBuffer();
+  /// Make room in the buffer for more input, spilling to the temporary file
+  /// if the buffer has reached the threshold.
+  void grow();
 
-  /// Return the offset of the last line break, or end of buffer if there
-  /// was no line break.
-  unsigned lastLineBreak();
+  /// Move the contents of the buffer to the temporary file.
+  bool spill();
 
   StreamID _source;
-  OStream & _out;
-  unsigned _size;
-  SmallString<0> _buffer;
+  char * _data;
+  size_t _size;
+  size_t _capacity;
+  FILE * _spillFile;
+  size_t _spillSize;
   bool _finished;
 };
 
+/** -------------------------------------------------------------------------
+    The resources used by one or more commands. Times are in microseconds,
+    and memory in kilobytes. I/O is counted in the file system blocks that
+    the operating system reports as actually read or written, so reads served
+    from the page cache don't count.
+ */
+struct ResourceUsage {
+  uint64_t wallTime;
+  uint64_t userTime;
+  uint64_t systemTime;
+  uint64_t maxResident;
+  uint64_t inputBlocks;
+  uint64_t outputBlocks;
+
+  ResourceUsage()
+    : wallTime(0), userTime(0), systemTime(0), maxResident(0), inputBlocks(0), outputBlocks(0)
+  {}
+
+  /// Add the usage of a command that ran after the ones already counted. Peak memory
+  /// is the largest of the two, since the commands didn't run at the same time.
+  void add(const ResourceUsage & other);
+};
+
 /** -------------------------------------------------------------------------
     A class which can be used to spawn processes that run commands.
  */
@@ -83,17 +142,48 @@ public:
   /// Constructor
   Process(ProcessListener * listener);
 
+  /// Destructor
+  ~Process();
+
   /// Run a command as a subprocess.
   bool begin(StringRef programName, ArrayRef<StringRef> args, StringRef workingDir);
 
   /// Process I/O from the child process.
   bool processChildIO();
 
+  /// Captured standard output of the child process.
+  StreamBuffer & output() { return _stdout; }
+
+  /// Captured standard error of the child process.
+  StreamBuffer & errors() { return _stderr; }
+
+  /// Exit code of the most recent command, or the signal number that terminated it.
+  int exitStatus() const { return _exitStatus; }
+
+  /// True if the most recent command was terminated by a signal.
+  bool signaled() const { return _signaled; }
+
+  /// Resources used by the most recent command. Only the wall time is known if the
+  /// system can't report the rest.
+  const ResourceUsage & usage() const { return _usage; }
+
+  /// Append the text of the most recent command line to 'result'.
+  void formatCommandLine(SmallVectorImpl<char> & result) const;
+
+  /// Microseconds since some fixed point in the past, for measuring how long things take.
+  static uint64_t monotonicTime();
+
   /// Wait for a process to exit.
   static bool waitForProcessEvent();
 
+  /// Wait for a process to exit, for one of the descriptors in 'wakeFds' to become
+  /// readable, or for one of those in 'writeFds' to become writable. The caller is
+  /// responsible for checking its own descriptors afterwards.
+  static bool waitForProcessEvent(ArrayRef<int> wakeFds,
+      ArrayRef<int> writeFds = ArrayRef<int>());
+
 private:
-  bool cleanup(int status, bool signaled);
+  bool cleanup(int status, bool signaled, const ResourceUsage & usage);
   native_char_t * appendCommandArg(StringRef arg);
 
   static Process * _processList;
@@ -106,6 +196,10 @@ private:
 
   StreamBuffer _stdout;
   StreamBuffer _stderr;
+  int _exitStatus;
+  bool _signaled;
+  ResourceUsage _usage;
+  uint64_t _startTime;
 
   #if HAVE_UNISTD_H
     pid_t _pid;
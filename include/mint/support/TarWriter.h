@@ -0,0 +1,78 @@
+/* ================================================================ *
+   Writer for tar archives
+ * ================================================================ */
+
+#ifndef MINT_SUPPORT_TARWRITER_H
+#define MINT_SUPPORT_TARWRITER_H
+
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
+#endif
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+namespace mint {
+
+/** -------------------------------------------------------------------------
+    Writes a tar archive (POSIX ustar format, with pax headers for names and
+    sizes that don't fit), optionally gzip-compressed. File data is streamed
+    from the source files into the archive without an intermediate copy.
+
+    Every entry gets the same owner (root), the same modification time, and a
+    mode of either 0644 or 0755, so that archiving the same files always
+    produces the same bytes.
+ */
+class TarWriter {
+public:
+  enum Compression {
+    NONE,
+    GZIP
+  };
+
+  /// Constructor
+  TarWriter();
+
+  /// Destructor - closes the archive if it's still open.
+  ~TarWriter();
+
+  /// Choose the compression based on the extension of 'path': '.tar' is uncompressed,
+  /// '.tar.gz' and '.tgz' are gzip-compressed. Returns false for any other extension,
+  /// or if the compression isn't available in this build.
+  static bool compressionForPath(StringRef path, Compression & result);
+
+  /// Create the archive file at 'path'. 'mtime' is the modification time given to
+  /// every entry.
+  bool open(StringRef path, Compression compression, int64_t mtime);
+
+  /// Add a directory entry. 'name' should not have a trailing separator.
+  bool addDirectory(StringRef name);
+
+  /// Add the contents of the file at 'sourcePath' as 'name'.
+  bool addFile(StringRef name, StringRef sourcePath);
+
+  /// Write the end-of-archive marker and close the file.
+  bool close();
+
+private:
+  bool writeHeader(StringRef name, char type, uint64_t size, unsigned mode);
+  bool writeUstarHeader(StringRef name, char type, uint64_t size, unsigned mode);
+  bool writeFileData(int fd, StringRef sourcePath, uint64_t size);
+  bool writePadding(uint64_t size);
+  bool write(const char * data, size_t size);
+  bool writeRaw(const char * data, size_t size);
+  bool deflate(const char * data, size_t size, bool finish);
+
+  SmallString<128> _path;
+  int _fd;
+  Compression _compression;
+  int64_t _mtime;
+  uint64_t _written;
+  void * _zstream;
+  SmallVector<char, 0> _buffer;
+};
+
+}
+
+#endif // MINT_SUPPORT_TARWRITER_H
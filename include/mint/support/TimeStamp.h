@@ -69,6 +69,12 @@ public:
     }
   }
 
+  /// Whole seconds since the epoch.
+  time_t seconds() const { return _value.tv_sec; }
+
+  /// Nanoseconds past the whole second.
+  long nanoseconds() const { return _value.tv_nsec; }
+
   bool operator<=(const TimeStamp  & ts) {
     if (_value.tv_sec < ts._value.tv_sec) {
       return true;
@@ -122,6 +128,12 @@ public:
     return _value <= ts._value;
   }
 
+  /// Whole seconds since the epoch.
+  time_t seconds() const { return _value; }
+
+  /// Nanoseconds past the whole second.
+  long nanoseconds() const { return 0; }
+
 private:
   time_t _value;
 };
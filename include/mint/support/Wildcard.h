@@ -5,31 +5,93 @@
 #ifndef MINT_SUPPORT_WILDCARD_H
 #define MINT_SUPPORT_WILDCARD_H
 
-#ifndef MINT_COLLECTIONS_STRINGREF_H
-#include "mint/collections/StringRef.h"
+#ifndef MINT_COLLECTIONS_SMALLSTRING_H
+#include "mint/collections/SmallString.h"
 #endif
 
 namespace mint {
 
 /** -------------------------------------------------------------------------
     Class to perform wildcard matching on strings.
+
+    The pattern is compiled when the matcher is constructed. The pattern syntax is:
+
+      *         Matches any sequence of characters, including an empty one.
+      ?         Matches any single character.
+      [abc]     Matches any one of the listed characters. A range such as [a-z]
+                matches any character in the range; [!abc] or [^abc] matches any
+                character not listed.
+      {a,b}     Matches either of the comma-separated alternatives, which may
+                themselves contain wildcards or further braces.
+      \c        Matches the character 'c' literally.
+
+    A '[' or '{' with no closing bracket is taken literally.
+
+    Matching never backtracks: the text between stars has a fixed length, so each
+    piece is matched at the leftmost position where it fits, which makes a match
+    linear in the length of the input for a given pattern.
  */
 class WildcardMatcher {
 public:
   /// Constructor
   WildcardMatcher(StringRef pattern);
 
+  /// Add a pattern whose matches are rejected, even if they match the main pattern.
+  void exclude(StringRef pattern);
+
   /// Returns true if 'str' matches the wildcard pattern.
-  bool match(StringRef str);
+  bool match(StringRef str) const;
 
   /// Returns true if 'pattern' contains wildcard characters.
   static bool hasWildcardChars(StringRef pattern);
 
 private:
-  bool matchImpl(StringRef str, unsigned patternIndex, unsigned strIndex);
-  unsigned countNonStarChars(unsigned startIndex);
+  enum AtomKind {
+    LITERAL,
+    ANY,
+    CLASS
+  };
+
+  /// Matches a single character.
+  struct Atom {
+    unsigned char kind;
+    unsigned char ch;
+    unsigned short charClass;
+  };
+
+  /// A set of characters.
+  struct CharClass {
+    unsigned bits[256 / 32];
+  };
+
+  /// A run of atoms with no star in it.
+  struct Segment {
+    unsigned atomBegin;
+    unsigned atomEnd;
+    unsigned literalOffset;
+    bool isLiteral;
+  };
+
+  /// One way of matching the pattern, after braces have been expanded.
+  struct Alternative {
+    unsigned segmentBegin;
+    unsigned segmentEnd;
+    bool hasStar;
+    bool isExclude;
+  };
+
+  void expandBraces(StringRef prefix, StringRef pattern, bool isExclude);
+  void compileAlternative(StringRef pattern, bool isExclude);
+  size_t compileCharClass(StringRef pattern, size_t pos);
+  void endSegment(Segment & seg);
+  bool matchAlternative(const Alternative & alt, StringRef str) const;
+  bool matchSegment(const Segment & seg, const char * str) const;
 
-  StringRef _pattern;
+  SmallVector<Alternative, 2> _alternatives;
+  SmallVector<Segment, 4> _segments;
+  SmallVector<Atom, 32> _atoms;
+  SmallVector<CharClass, 0> _classes;
+  SmallString<32> _literals;
 };
 
 }
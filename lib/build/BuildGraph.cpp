@@ -0,0 +1,277 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#include "mint/build/BuildGraph.h"
+#include "mint/build/File.h"
+#include "mint/build/Target.h"
+
+#include "mint/support/Diagnostics.h"
+
+#define VERBOSE 0
+
+namespace mint {
+
+namespace {
+  /// True if a target in 'state' is going to be built, but hasn't finished yet.
+  inline bool isPending(unsigned char state) {
+    return state == Target::READY || state == Target::READY_IN_QUEUE ||
+        state == Target::WAITING || state == Target::BUILDING;
+  }
+}
+
+void BuildGraph::lower(ArrayRef<Target *> targets) {
+  _targets.clear();
+  _targetFlags.clear();
+  _states.clear();
+  _pendingCounts.clear();
+  _inputStamps.clear();
+  _prereqStart.clear();
+  _prereqs.clear();
+  _sourceStart.clear();
+  _sources.clear();
+  _outputStart.clear();
+  _outputs.clear();
+  _waiterStart.clear();
+  _waiters.clear();
+  _files.clear();
+  _fileFlags.clear();
+  _lastModified.clear();
+
+  // Number the listed targets first, so that they keep their order.
+  unsigned generation = Target::newGeneration();
+  for (ArrayRef<Target *>::const_iterator it = targets.begin(), itEnd = targets.end();
+      it != itEnd; ++it) {
+    Target * target = *it;
+    target->markVisited(generation);
+    target->_graphId = _targets.size();
+    _targets.push_back(target);
+    _targetFlags.push_back(target->isSourceOnly() ? SOURCE_ONLY : 0);
+    _states.push_back(target->state());
+    _inputStamps.push_back(target->inputStamp());
+  }
+
+  // Then the edges. Prerequisites outside the list get numbers as they are found; their
+  // own edges are left empty.
+  _prereqStart.push_back(0);
+  _sourceStart.push_back(0);
+  _outputStart.push_back(0);
+  for (size_t i = 0; i < targets.size(); ++i) {
+    Target * target = targets[i];
+    for (TargetList::const_iterator ti = target->prerequisites().begin(),
+        tiEnd = target->prerequisites().end(); ti != tiEnd; ++ti) {
+      _prereqs.push_back(targetIndex(*ti, generation));
+    }
+    for (FileList::const_iterator fi = target->sources().begin(),
+        fiEnd = target->sources().end(); fi != fiEnd; ++fi) {
+      _sources.push_back(fileIndex(*fi, generation));
+    }
+    for (FileList::const_iterator fi = target->outputs().begin(),
+        fiEnd = target->outputs().end(); fi != fiEnd; ++fi) {
+      _outputs.push_back(fileIndex(*fi, generation));
+    }
+    _prereqStart.push_back(_prereqs.size());
+    _sourceStart.push_back(_sources.size());
+    _outputStart.push_back(_outputs.size());
+  }
+  for (size_t i = targets.size(); i < _targets.size(); ++i) {
+    _prereqStart.push_back(_prereqs.size());
+    _sourceStart.push_back(_sources.size());
+    _outputStart.push_back(_outputs.size());
+  }
+  _pendingCounts.resize(_targets.size(), 0);
+}
+
+BuildGraph::Index BuildGraph::targetIndex(Target * target, unsigned generation) {
+  if (target->markVisited(generation)) {
+    target->_graphId = _targets.size();
+    _targets.push_back(target);
+    _targetFlags.push_back(CHECKED | (target->isSourceOnly() ? SOURCE_ONLY : 0));
+    _states.push_back(target->state());
+    _inputStamps.push_back(target->inputStamp());
+  }
+  return target->_graphId;
+}
+
+BuildGraph::Index BuildGraph::fileIndex(File * file, unsigned generation) {
+  if (file->_graphGeneration != generation) {
+    file->_graphGeneration = generation;
+    file->_graphId = _files.size();
+    _files.push_back(file);
+    _fileFlags.push_back(file->outputOf().empty() ? 0 : GENERATED);
+    _lastModified.push_back(TimeStamp());
+  }
+  return file->_graphId;
+}
+
+void BuildGraph::readFileStatus() {
+  SmallVector<File *, 64> unchecked;
+  for (SmallVector<File *, 0>::const_iterator it = _files.begin(), itEnd = _files.end();
+      it != itEnd; ++it) {
+    if (!(*it)->statusChecked()) {
+      unchecked.push_back(*it);
+    }
+  }
+  File::updateFileStatus(unchecked);
+
+  for (size_t i = 0; i < _files.size(); ++i) {
+    File * file = _files[i];
+    unsigned flags = _fileFlags[i] & GENERATED;
+    if (file->statusValid()) {
+      flags |= STATUS_VALID;
+      if (file->exists()) {
+        flags |= EXISTS;
+      }
+    }
+    _fileFlags[i] = flags;
+    _lastModified[i] = file->lastModified();
+  }
+}
+
+void BuildGraph::computeStates() {
+  size_t count = _targets.size();
+  SmallVector<unsigned, 0> waiterCounts;
+  waiterCounts.resize(count, 0);
+
+  for (Index id = 0; id < count; ++id) {
+    unsigned flags = _targetFlags[id];
+    if (flags & CHECKED) {
+      continue;
+    }
+
+    // Check output files. 'outOfDate' records whether the target needs rebuilding on
+    // its own account, as opposed to because of the targets it depends on.
+    bool needsRebuild = false;
+    bool needsRebuildDeps = false;
+    bool outOfDate = false;
+    const TimeStamp * oldestOutput = NULL;
+    ArrayRef<Index> outputIds = outputs(id);
+    for (ArrayRef<Index>::const_iterator it = outputIds.begin(), itEnd = outputIds.end();
+        it != itEnd; ++it) {
+      unsigned fileFlags = _fileFlags[*it];
+      if (fileFlags & STATUS_VALID) {
+        if (!(fileFlags & EXISTS)) {
+          if (VERBOSE) {
+            console::out() << "  Output " << _files[*it] << " is missing.\n";
+          }
+          needsRebuild = true;
+          outOfDate = true;
+          break;
+        } else if (oldestOutput == NULL || _lastModified[*it] < *oldestOutput) {
+          oldestOutput = &_lastModified[*it];
+        }
+      }
+    }
+
+    if (outputIds.empty()) {
+      needsRebuild = true;
+      outOfDate = true;
+    }
+
+    // A RESTAT target whose outputs last came out the same kept their older times, but
+    // is up to date with the sources it was built against.
+    if (oldestOutput != NULL && *oldestOutput < _inputStamps[id]) {
+      oldestOutput = &_inputStamps[id];
+    }
+
+    // Check source files. A file that another target produces is up to date once that
+    // target is, which is dealt with along with the other prerequisites below.
+    ArrayRef<Index> sourceIds = sources(id);
+    for (ArrayRef<Index>::const_iterator it = sourceIds.begin(), itEnd = sourceIds.end();
+        it != itEnd; ++it) {
+      unsigned fileFlags = _fileFlags[*it];
+      if (fileFlags & STATUS_VALID) {
+        if (!(fileFlags & EXISTS)) {
+          needsRebuild = true;
+          outOfDate = true;
+        }
+        if ((fileFlags & GENERATED) && !(flags & SOURCE_ONLY)) {
+          continue;
+        } else if (!(fileFlags & EXISTS)) {
+          Target * target = _targets[id];
+          diag::error(target->location()) << "Target " << target
+              << " depends on non-existent file " << _files[*it]->name();
+          break;
+        } else if (oldestOutput != NULL && *oldestOutput < _lastModified[*it]) {
+          needsRebuild = true;
+          outOfDate = true;
+        }
+      }
+    }
+
+    // A prerequisite numbered after this target is part of a cycle, which has been
+    // reported.
+    unsigned pendingCount = 0;
+    ArrayRef<Index> prereqIds = prerequisites(id);
+    for (ArrayRef<Index>::const_iterator it = prereqIds.begin(), itEnd = prereqIds.end();
+        it != itEnd; ++it) {
+      Index dep = *it;
+      if (dep < id || (_targetFlags[dep] & CHECKED)) {
+        if (isPending(_states[dep])) {
+          needsRebuild = true;
+          needsRebuildDeps = true;
+          ++pendingCount;
+          ++waiterCounts[dep];
+        }
+      }
+    }
+
+    _pendingCounts[id] = pendingCount;
+    if (outOfDate) {
+      _targetFlags[id] = flags | OUT_OF_DATE;
+    }
+    if (needsRebuild) {
+      _states[id] = needsRebuildDeps ? Target::WAITING : Target::READY;
+    } else {
+      _states[id] = Target::FINISHED;
+    }
+    if (VERBOSE) {
+      console::out() << "Target " << _targets[id] << " is " << state(id) << "\n";
+    }
+  }
+
+  // Turn the counts of waiters into rows, then fill them in. Each row lists its
+  // waiters in index order.
+  _waiterStart.resize(count + 1);
+  _waiterStart[0] = 0;
+  for (Index id = 0; id < count; ++id) {
+    _waiterStart[id + 1] = _waiterStart[id] + waiterCounts[id];
+  }
+  _waiters.resize(_waiterStart[count]);
+  for (Index id = 0; id < count; ++id) {
+    waiterCounts[id] = _waiterStart[id];
+  }
+  for (Index id = 0; id < count; ++id) {
+    if (_states[id] != Target::WAITING || (_targetFlags[id] & CHECKED)) {
+      continue;
+    }
+    ArrayRef<Index> prereqIds = prerequisites(id);
+    for (ArrayRef<Index>::const_iterator it = prereqIds.begin(), itEnd = prereqIds.end();
+        it != itEnd; ++it) {
+      Index dep = *it;
+      if (dep < id || (_targetFlags[dep] & CHECKED)) {
+        if (isPending(_states[dep])) {
+          _waiters[waiterCounts[dep]++] = id;
+        }
+      }
+    }
+  }
+}
+
+void BuildGraph::storeStates() const {
+  for (Index id = 0; id < _targets.size(); ++id) {
+    Target * target = _targets[id];
+    if (!(_targetFlags[id] & CHECKED)) {
+      target->_state = Target::TargetState(_states[id]);
+      target->_outOfDate = (_targetFlags[id] & OUT_OF_DATE) != 0;
+      target->_pendingCount = _pendingCounts[id];
+    }
+    ArrayRef<Index> waiterIds = waiters(id);
+    for (ArrayRef<Index>::const_iterator it = waiterIds.begin(), itEnd = waiterIds.end();
+        it != itEnd; ++it) {
+      target->_waiters.push_back(_targets[*it]);
+    }
+  }
+}
+
+}
@@ -0,0 +1,45 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#include "mint/build/BuildStats.h"
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+namespace mint {
+
+namespace {
+  /// First line of the statistics file; change the number if the format changes.
+  const char STATS_HEADER[] = "mint-build-stats 1";
+}
+
+BuildStats::BuildStats() : _records(STATS_HEADER) {}
+
+// Each line is 'wall user system maxrss inblocks outblocks path'.
+bool BuildStats::Format::parse(const char * line, ResourceUsage & usage, int & pathStart) {
+  unsigned long long wall, user, system, resident, inBlocks, outBlocks;
+  if (sscanf(line, "%llu %llu %llu %llu %llu %llu %n",
+      &wall, &user, &system, &resident, &inBlocks, &outBlocks, &pathStart) != 6) {
+    return false;
+  }
+  usage.wallTime = wall;
+  usage.userTime = user;
+  usage.systemTime = system;
+  usage.maxResident = resident;
+  usage.inputBlocks = inBlocks;
+  usage.outputBlocks = outBlocks;
+  return true;
+}
+
+void BuildStats::Format::format(const ResourceUsage & usage, SmallVectorImpl<char> & out) {
+  char buffer[160];
+  int length = snprintf(buffer, sizeof(buffer), "%llu %llu %llu %llu %llu %llu ",
+      (unsigned long long)usage.wallTime, (unsigned long long)usage.userTime,
+      (unsigned long long)usage.systemTime, (unsigned long long)usage.maxResident,
+      (unsigned long long)usage.inputBlocks, (unsigned long long)usage.outputBlocks);
+  out.append(buffer, buffer + length);
+}
+
+}
@@ -0,0 +1,294 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#include "mint/build/BuiltinAction.h"
+
+#include "mint/collections/SmallString.h"
+
+#include "mint/graph/Oper.h"
+#include "mint/graph/String.h"
+
+#include "mint/support/Assert.h"
+#include "mint/support/Diagnostics.h"
+#include "mint/support/Path.h"
+#include "mint/support/TarWriter.h"
+
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
+namespace mint {
+
+namespace {
+  /// Return the string value of the action's argument 'index'.
+  StringRef actionArg(Oper * action, unsigned index) {
+    return String::cast(action->arg(index))->value();
+  }
+
+  /// Set 'result' to the action's path argument 'index', made absolute.
+  void actionPath(Oper * action, unsigned index, StringRef workingDir,
+      SmallVectorImpl<char> & result) {
+    result.assign(workingDir.begin(), workingDir.end());
+    path::combine(result, actionArg(action, index));
+  }
+
+  /// Orders the entries of an archive action by their name in the archive.
+  struct ArchiveEntryLess {
+    ArchiveEntryLess(Oper * names) : _names(names) {}
+
+    bool operator()(unsigned lhs, unsigned rhs) const {
+      return String::cast(_names->arg(lhs))->value().compare(
+          String::cast(_names->arg(rhs))->value()) < 0;
+    }
+
+    Oper * _names;
+  };
+
+  /// Write the archive for 'action' to 'outputPath'. The entries are written in order
+  /// of their names, each preceded by any directories that haven't been written yet,
+  /// and all with the same modification time: SOURCE_DATE_EPOCH if it is set, and
+  /// otherwise the newest of the source files.
+  bool runArchiveAction(Oper * action, StringRef outputPath, StringRef workingDir) {
+    Oper * names = action->arg(1)->requireOper();
+    Oper * sources = action->arg(2)->requireOper();
+    if (names->size() != sources->size()) {
+      console::err() << "Error writing '" << outputPath
+          << "': archive must have the same number of names and sources.\n";
+      return false;
+    }
+
+    TarWriter::Compression compression;
+    if (!TarWriter::compressionForPath(outputPath, compression)) {
+      console::err() << "Error writing '" << outputPath << "': unsupported archive format.\n";
+      return false;
+    }
+
+    SmallVector<unsigned, 64> order;
+    for (unsigned i = 0; i < names->size(); ++i) {
+      order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), ArchiveEntryLess(names));
+
+    int64_t mtime = 0;
+    const char * epoch = ::getenv("SOURCE_DATE_EPOCH");
+    if (epoch != NULL) {
+      mtime = ::strtoll(epoch, NULL, 10);
+    } else {
+      SmallString<128> sourcePath;
+      for (unsigned i = 0; i < sources->size(); ++i) {
+        actionPath(sources, i, workingDir, sourcePath);
+        path::FileStatus st;
+        if (path::fileStatus(sourcePath, st) && st.exists &&
+            int64_t(st.lastModified.seconds()) > mtime) {
+          mtime = st.lastModified.seconds();
+        }
+      }
+    }
+
+    TarWriter writer;
+    if (!writer.open(outputPath, compression, mtime)) {
+      return false;
+    }
+    StringRef prevName;
+    SmallString<128> sourcePath;
+    for (unsigned * it = order.begin(); it != order.end(); ++it) {
+      StringRef name = String::cast(names->arg(*it))->value();
+      if (name == prevName) {
+        console::err() << "Error writing '" << outputPath << "': '" << name
+            << "' is in the archive more than once.\n";
+        return false;
+      }
+
+      // Entries are sorted, so everything under a directory is together; a directory
+      // needs writing unless the previous entry was also inside it.
+      for (size_t pos = name.find('/'); pos != StringRef::npos; pos = name.find('/', pos + 1)) {
+        if (!(prevName.size() > pos && prevName[pos] == '/' &&
+            prevName.substr(0, pos) == name.substr(0, pos))) {
+          if (!writer.addDirectory(name.substr(0, pos))) {
+            return false;
+          }
+        }
+      }
+
+      actionPath(sources, *it, workingDir, sourcePath);
+      if (!writer.addFile(name, sourcePath)) {
+        return false;
+      }
+      prevName = name;
+    }
+    return writer.close();
+  }
+
+  /// Append 'arg' to a shell command line, quoting it if needed.
+  void appendShellArg(SmallVectorImpl<char> & result, StringRef arg) {
+    result.push_back(' ');
+    bool needsQuotes = arg.empty();
+    for (StringRef::const_iterator it = arg.begin(), itEnd = arg.end(); it != itEnd; ++it) {
+      char ch = *it;
+      if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+          ch == '/' || ch == '.' || ch == '-' || ch == '_' || ch == '+' || ch == ',' ||
+          ch == ':' || ch == '=' || ch == '@')) {
+        needsQuotes = true;
+        break;
+      }
+    }
+    if (!needsQuotes) {
+      result.append(arg.begin(), arg.end());
+      return;
+    }
+    result.push_back('\'');
+    for (StringRef::const_iterator it = arg.begin(), itEnd = arg.end(); it != itEnd; ++it) {
+      if (*it == '\'') {
+        StringRef escaped("'\\''");
+        result.append(escaped.begin(), escaped.end());
+      } else {
+        result.push_back(*it);
+      }
+    }
+    result.push_back('\'');
+  }
+
+  /// Append 'text' as a printf format string which prints it unchanged. Newlines are
+  /// escaped so that the whole command stays on one line.
+  void appendPrintfText(SmallVectorImpl<char> & result, StringRef text) {
+    SmallString<128> format;
+    for (StringRef::const_iterator it = text.begin(), itEnd = text.end(); it != itEnd; ++it) {
+      switch (*it) {
+        case '\n': format.append(StringRef("\\n")); break;
+        case '\\': format.append(StringRef("\\\\")); break;
+        case '%': format.append(StringRef("%%")); break;
+        default: format.push_back(*it); break;
+      }
+    }
+    appendShellArg(result, format);
+  }
+
+  /// Append 'text' to a shell command line as is.
+  void appendText(SmallVectorImpl<char> & result, StringRef text) {
+    result.append(text.begin(), text.end());
+  }
+
+  /// The shell equivalent of an archive action assembles the files in a temporary
+  /// directory, and then runs 'tar' on that.
+  void formatArchiveAction(Oper * action, SmallVectorImpl<char> & result) {
+    StringRef output = actionArg(action, 0);
+    Oper * names = action->arg(1)->requireOper();
+    Oper * sources = action->arg(2)->requireOper();
+    SmallString<128> stagingDir(output);
+    stagingDir.append(StringRef(".d"));
+
+    appendText(result, "rm -rf");
+    appendShellArg(result, stagingDir);
+    SmallVector<StringRef, 8> topLevel;
+    for (unsigned i = 0; i < names->size(); ++i) {
+      StringRef name = String::cast(names->arg(i))->value();
+      SmallString<128> stagedPath(stagingDir);
+      path::combine(stagedPath, name);
+      appendText(result, " && mkdir -p");
+      appendShellArg(result, path::parent(stagedPath));
+      appendText(result, " && cp -p");
+      appendShellArg(result, String::cast(sources->arg(i))->value());
+      appendShellArg(result, stagedPath);
+      StringRef top = name.substr(0, name.find('/'));
+      if (std::find(topLevel.begin(), topLevel.end(), top) == topLevel.end()) {
+        topLevel.push_back(top);
+      }
+    }
+
+    TarWriter::Compression compression = TarWriter::NONE;
+    TarWriter::compressionForPath(output, compression);
+    appendText(result, " && tar -C");
+    appendShellArg(result, stagingDir);
+    appendText(result, compression == TarWriter::GZIP ? " -czf" : " -cf");
+    appendShellArg(result, output);
+    for (StringRef * it = topLevel.begin(); it != topLevel.end(); ++it) {
+      appendShellArg(result, *it);
+    }
+    appendText(result, " && rm -rf");
+    appendShellArg(result, stagingDir);
+  }
+}
+
+bool runBuiltinAction(Oper * action, StringRef workingDir) {
+  SmallString<128> target;
+  actionPath(action, 0, workingDir, target);
+  switch (action->nodeKind()) {
+    case Node::NK_ACTION_ARCHIVE:
+      return runArchiveAction(action, target, workingDir);
+
+    case Node::NK_ACTION_COPY:
+    case Node::NK_ACTION_LINK: {
+      SmallString<128> output;
+      actionPath(action, 1, workingDir, output);
+      return path::copyFile(target, output, action->nodeKind() == Node::NK_ACTION_LINK ?
+          path::COPY_HARDLINK : path::COPY_PRESERVE_TIME);
+    }
+
+    case Node::NK_ACTION_MKDIR:
+      return path::makeDirectoryPath(target);
+
+    case Node::NK_ACTION_REMOVE:
+      return path::remove(target);
+
+    case Node::NK_ACTION_TOUCH: {
+      path::FileStatus st;
+      if (!path::fileStatus(target, st)) {
+        return false;
+      } else if (!st.exists) {
+        return path::writeFileContents(target, StringRef());
+      }
+      return path::setLastModified(target, TimeStamp(::time(NULL)));
+    }
+
+    case Node::NK_ACTION_WRITE:
+      return path::writeFileContents(target, actionArg(action, 1));
+
+    default:
+      M_ASSERT(false) << "Not a builtin action: " << action->nodeKind();
+      return false;
+  }
+}
+
+void formatBuiltinAction(Oper * action, SmallVectorImpl<char> & result) {
+  StringRef command;
+  switch (action->nodeKind()) {
+    case Node::NK_ACTION_ARCHIVE:
+      formatArchiveAction(action, result);
+      return;
+
+    case Node::NK_ACTION_COPY: command = "cp -p"; break;
+    case Node::NK_ACTION_LINK: command = "ln -f"; break;
+    case Node::NK_ACTION_MKDIR: command = "mkdir -p"; break;
+    case Node::NK_ACTION_REMOVE: command = "rm -f"; break;
+    case Node::NK_ACTION_TOUCH: command = "touch"; break;
+    case Node::NK_ACTION_WRITE: {
+      command = "printf";
+      result.append(command.begin(), command.end());
+      appendPrintfText(result, actionArg(action, 1));
+      StringRef redirect(" >");
+      result.append(redirect.begin(), redirect.end());
+      appendShellArg(result, actionArg(action, 0));
+      return;
+    }
+
+    default:
+      M_ASSERT(false) << "Not a builtin action: " << action->nodeKind();
+      return;
+  }
+
+  result.append(command.begin(), command.end());
+  for (Oper::const_iterator it = action->begin(), itEnd = action->end(); it != itEnd; ++it) {
+    appendShellArg(result, String::cast(*it)->value());
+  }
+}
+
+}
@@ -21,6 +21,15 @@ bool Directory::create() {
   return path::makeDirectoryPath(_name->value());
 }
 
+bool Directory::remove() {
+  if (!path::removeDirectory(_name->value())) {
+    return false;
+  }
+  _status.exists = false;
+  _statusChecked = true;
+  return true;
+}
+
 void Directory::trace() const {
   safeMark(_parent);
   safeMark(_name);
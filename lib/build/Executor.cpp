@@ -0,0 +1,453 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#include "mint/build/Executor.h"
+#include "mint/build/JobMgr.h"
+
+#include "mint/support/Diagnostics.h"
+#include "mint/support/Path.h"
+
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+namespace mint {
+
+// -------------------------------------------------------------------------
+// LocalExecutor
+// -------------------------------------------------------------------------
+
+bool LocalExecutor::runCommand(
+    Job * job, StringRef program, ArrayRef<StringRef> args, StringRef workingDir) {
+  return job->process().begin(program, args, workingDir);
+}
+
+bool LocalExecutor::waitForEvent() {
+  return Process::waitForProcessEvent();
+}
+
+// -------------------------------------------------------------------------
+// RemoteExecutor
+// -------------------------------------------------------------------------
+
+/// A connected worker.
+struct RemoteExecutor::WorkerInfo {
+  SmallString<32> address;
+  MessageConnection * conn;
+  unsigned slots;
+  unsigned running;
+};
+
+/// A command that has been sent to a worker.
+struct RemoteExecutor::Request {
+  uint32_t id;
+  Job * job;
+  WorkerInfo * worker;
+  SmallVector<File *, 8> inputs;
+  SmallVector<ContentDigest, 8> hashes;
+};
+
+namespace {
+  /// How long to wait for a worker to say hello, in milliseconds.
+  const int CONNECT_TIMEOUT = 10000;
+
+  /// True if 'path' is one of the outputs of 'target'.
+  bool isTargetOutput(Target * target, StringRef path) {
+    const FileList & outputs = target->outputs();
+    for (FileList::const_iterator it = outputs.begin(), itEnd = outputs.end(); it != itEnd; ++it) {
+      if ((*it)->name()->value() == path) {
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+RemoteExecutor::~RemoteExecutor() {
+  for (SmallVectorImpl<WorkerInfo *>::iterator
+      it = _workers.begin(), itEnd = _workers.end(); it != itEnd; ++it) {
+    (*it)->conn->close();
+    delete (*it)->conn;
+    delete *it;
+  }
+}
+
+bool RemoteExecutor::connect(StringRef addresses, StringRef token) {
+  if (token.empty()) {
+    diag::error() << "Workers need a token: use --worker-token, or set MINT_WORKER_TOKEN.";
+    return false;
+  }
+  while (!addresses.empty()) {
+    size_t comma = addresses.find(',');
+    StringRef address = addresses.substr(0, comma);
+    addresses = comma == StringRef::npos ? StringRef() : addresses.substr(comma + 1);
+    if (address.empty()) {
+      continue;
+    }
+
+    int fd = connectToAddress(address);
+    if (fd < 0) {
+      return false;
+    }
+    WorkerInfo * worker = new WorkerInfo();
+    worker->address.append(address);
+    worker->conn = new MessageConnection(fd);
+    worker->slots = 0;
+    worker->running = 0;
+    _workers.push_back(worker);
+
+    // Wait for the greeting, which tells us how many commands the worker will take.
+    WorkerMessageType type;
+    StringRef body;
+    while (!worker->conn->nextMessage(type, body)) {
+      if (worker->conn->failed()) {
+        diag::error() << "Worker " << address << " speaks an incompatible protocol.";
+        return false;
+      }
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (::poll(&pfd, 1, CONNECT_TIMEOUT) <= 0 || !worker->conn->readInput()) {
+        diag::error() << "No response from worker " << address;
+        return false;
+      }
+    }
+    MessageReader reader(body);
+    uint32_t version = 0, slots = 0;
+    reader.getInt(version);
+    reader.getInt(slots);
+    if (type != WORKER_HELLO || !reader.ok() || version != WORKER_PROTOCOL_VERSION) {
+      diag::error() << "Worker " << address << " speaks an incompatible protocol.";
+      return false;
+    }
+    worker->slots = slots;
+
+    // A worker with a different token just hangs up, which shows up as a lost
+    // connection once the first command is sent.
+    MessageWriter auth(WORKER_AUTH);
+    auth.putString(token);
+    worker->conn->send(auth);
+    if (!worker->conn->flushOutput(false)) {
+      diag::error() << "Lost connection to worker " << address;
+      return false;
+    }
+  }
+
+  if (_workers.empty()) {
+    diag::error() << "No worker addresses given.";
+    return false;
+  }
+  return true;
+}
+
+unsigned RemoteExecutor::slotCount() const {
+  unsigned count = 0;
+  for (SmallVectorImpl<WorkerInfo *>::const_iterator
+      it = _workers.begin(), itEnd = _workers.end(); it != itEnd; ++it) {
+    count += (*it)->slots;
+  }
+  return count;
+}
+
+bool RemoteExecutor::runCommand(
+    Job * job, StringRef program, ArrayRef<StringRef> args, StringRef workingDir) {
+  // Pick the least busy worker that has a free slot.
+  WorkerInfo * worker = NULL;
+  for (SmallVectorImpl<WorkerInfo *>::const_iterator
+      it = _workers.begin(), itEnd = _workers.end(); it != itEnd; ++it) {
+    WorkerInfo * w = *it;
+    if (w->running < w->slots && (worker == NULL || w->running < worker->running)) {
+      worker = w;
+    }
+  }
+  if (worker == NULL) {
+    diag::error() << "No worker available to run '" << program << "'.";
+    return false;
+  }
+
+  Request * request = new Request();
+  request->id = _nextId++;
+  request->job = job;
+  request->worker = worker;
+
+  MessageWriter msg(WORKER_RUN);
+  msg.putInt(request->id);
+  msg.putString(workingDir);
+  msg.putString(program);
+  msg.putInt(uint32_t(args.size()));
+  for (ArrayRef<StringRef>::const_iterator it = args.begin(), itEnd = args.end(); it != itEnd;
+      ++it) {
+    msg.putString(*it);
+  }
+
+  // Inputs are identified by content, so the worker only has to fetch what it
+  // doesn't already have.
+  const FileList & sources = job->target()->sources();
+  _targets->hashFiles(sources);
+  for (FileList::const_iterator it = sources.begin(), itEnd = sources.end(); it != itEnd; ++it) {
+    if ((*it)->hasContentHash()) {
+      request->inputs.push_back(*it);
+      request->hashes.push_back((*it)->contentHash());
+    }
+  }
+  msg.putInt(uint32_t(request->inputs.size()));
+  for (unsigned i = 0; i < request->inputs.size(); ++i) {
+    msg.putString(request->inputs[i]->name()->value());
+    msg.putDigest(request->hashes[i]);
+  }
+
+  const FileList & outputs = job->target()->outputs();
+  msg.putInt(uint32_t(outputs.size()));
+  for (FileList::const_iterator it = outputs.begin(), itEnd = outputs.end(); it != itEnd; ++it) {
+    msg.putString((*it)->name()->value());
+  }
+
+  worker->conn->send(msg);
+  if (!worker->conn->flushOutput(false)) {
+    delete request;
+    workerLost(worker);
+    return false;
+  }
+  worker->running++;
+  _requests.push_back(request);
+  return true;
+}
+
+bool RemoteExecutor::waitForEvent() {
+  if (_requests.empty()) {
+    return true;
+  }
+
+  SmallVector<struct pollfd, 8> fds;
+  SmallVector<WorkerInfo *, 8> polled;
+  for (SmallVectorImpl<WorkerInfo *>::const_iterator
+      it = _workers.begin(), itEnd = _workers.end(); it != itEnd; ++it) {
+    WorkerInfo * worker = *it;
+    if (worker->conn->isOpen()) {
+      struct pollfd pfd;
+      pfd.fd = worker->conn->fd();
+      pfd.events = POLLIN | (worker->conn->hasOutput() ? POLLOUT : 0);
+      pfd.revents = 0;
+      fds.push_back(pfd);
+      polled.push_back(worker);
+    }
+  }
+
+  int status = ::poll(fds.data(), fds.size(), 1000);
+  if (status < 0) {
+    if (errno == EINTR) {
+      return true;
+    }
+    perror("waiting for workers");
+    return false;
+  }
+
+  for (unsigned i = 0; i < fds.size(); ++i) {
+    WorkerInfo * worker = polled[i];
+    short revents = fds[i].revents;
+    if (revents & POLLOUT) {
+      if (!worker->conn->flushOutput(false)) {
+        workerLost(worker);
+        continue;
+      }
+    }
+    if (revents & (POLLIN | POLLHUP | POLLERR)) {
+      bool open = worker->conn->readInput();
+      WorkerMessageType type;
+      StringRef body;
+      while (worker->conn->nextMessage(type, body)) {
+        if (!handleMessage(worker, type, body)) {
+          diag::warn() << "Invalid message from worker " << worker->address;
+          open = false;
+          break;
+        }
+      }
+      if (worker->conn->failed()) {
+        diag::warn() << "Invalid message frame from worker " << worker->address;
+        open = false;
+      }
+      if (!open) {
+        workerLost(worker);
+      }
+    }
+  }
+  return true;
+}
+
+bool RemoteExecutor::handleMessage(WorkerInfo * worker, WorkerMessageType type, StringRef body) {
+  MessageReader reader(body);
+  uint32_t id;
+  if (!reader.getInt(id)) {
+    return false;
+  }
+  Request * request = findRequest(id);
+  if (request == NULL || request->worker != worker) {
+    return false;
+  }
+
+  switch (type) {
+    case WORKER_NEED:
+      return sendInputs(worker, request, body);
+
+    case WORKER_OUTPUT: {
+      uint32_t stream;
+      StringRef text;
+      reader.getInt(stream);
+      reader.getString(text);
+      if (!reader.ok()) {
+        return false;
+      }
+      StreamBuffer & buffer = stream == 1 ? request->job->output() : request->job->errors();
+      buffer.append(text.data(), text.size());
+      return true;
+    }
+
+    case WORKER_RESULT:
+      return finishRequest(worker, request, body);
+
+    default:
+      return false;
+  }
+}
+
+bool RemoteExecutor::sendInputs(WorkerInfo * worker, Request * request, StringRef body) {
+  MessageReader reader(body);
+  uint32_t id, count;
+  reader.getInt(id);
+  reader.getInt(count);
+  for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+    ContentDigest hash;
+    if (!reader.getDigest(hash)) {
+      break;
+    }
+    for (unsigned j = 0; j < request->hashes.size(); ++j) {
+      if (request->hashes[j] == hash) {
+        SmallString<0> content;
+        if (!path::readFileContents(request->inputs[j]->name()->value(), content)) {
+          return false;
+        }
+        MessageWriter msg(WORKER_BLOB);
+        msg.putDigest(hash);
+        msg.putString(content);
+        worker->conn->send(msg);
+        break;
+      }
+    }
+  }
+  return reader.ok() && worker->conn->flushOutput(false);
+}
+
+bool RemoteExecutor::finishRequest(WorkerInfo * worker, Request * request, StringRef body) {
+  MessageReader reader(body);
+  uint32_t id, exitStatus, signaled, count;
+  reader.getInt(id);
+  reader.getInt(exitStatus);
+  reader.getInt(signaled);
+  reader.getInt(count);
+  for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+    StringRef outputPath, content;
+    uint32_t exists, mode;
+    reader.getString(outputPath);
+    reader.getInt(exists);
+    reader.getInt(mode);
+    reader.getString(content);
+    if (!reader.ok()) {
+      break;
+    }
+    // Only the files that the request asked for may be written; anything else means
+    // the worker is broken or hostile, and is treated as having lost it.
+    if (!isTargetOutput(request->job->target(), outputPath)) {
+      diag::warn() << "Worker " << worker->address << " sent back '" << outputPath
+          << "', which is not an output of the command.";
+      return false;
+    }
+    if (!exists) {
+      continue;
+    }
+
+    // A worker sharing our file system has already written the file; don't write
+    // it again if the contents are the same.
+    ContentDigest localHash, remoteHash;
+    Blake3::hash(content.data(), content.size(), remoteHash.bytes);
+    if (path::test(outputPath, path::IS_FILE, true) &&
+        ContentHasher::hashFile(outputPath, localHash) && localHash == remoteHash) {
+      continue;
+    }
+    if (path::writeFileContents(outputPath, content)) {
+      SmallString<128> nativePath(outputPath);
+      nativePath.push_back('\0');
+      ::chmod(nativePath.data(), mode_t(mode));
+    }
+  }
+  if (!reader.ok()) {
+    return false;
+  }
+
+  for (SmallVectorImpl<Request *>::iterator
+      it = _requests.begin(), itEnd = _requests.end(); it != itEnd; ++it) {
+    if (*it == request) {
+      _requests.erase(it);
+      break;
+    }
+  }
+  worker->running--;
+  Job * job = request->job;
+  delete request;
+  job->commandFinished(exitStatus == 0 && signaled == 0, int(exitStatus), signaled != 0);
+  return true;
+}
+
+void RemoteExecutor::workerLost(WorkerInfo * worker) {
+  if (!worker->conn->isOpen()) {
+    return;
+  }
+  // Not an error in itself: the commands that were running there fail, and the
+  // build stops the same way it would if they had failed locally.
+  diag::warn() << "Lost connection to worker " << worker->address;
+  worker->conn->close();
+  worker->slots = 0;
+
+  // Collect the orphaned requests first, since finishing a job may start another one.
+  SmallVector<Request *, 16> orphans;
+  for (unsigned i = 0; i < _requests.size();) {
+    if (_requests[i]->worker == worker) {
+      orphans.push_back(_requests[i]);
+      _requests.erase(_requests.begin() + i);
+    } else {
+      ++i;
+    }
+  }
+  worker->running = 0;
+  for (SmallVectorImpl<Request *>::iterator
+      it = orphans.begin(), itEnd = orphans.end(); it != itEnd; ++it) {
+    Job * job = (*it)->job;
+    delete *it;
+    SmallString<64> message("Lost connection to worker ");
+    message.append(worker->address);
+    message.push_back('\n');
+    job->errors().append(message.data(), message.size());
+    job->commandFinished(false, -1, false);
+  }
+}
+
+RemoteExecutor::Request * RemoteExecutor::findRequest(uint32_t id) {
+  for (SmallVectorImpl<Request *>::const_iterator
+      it = _requests.begin(), itEnd = _requests.end(); it != itEnd; ++it) {
+    if ((*it)->id == id) {
+      return *it;
+    }
+  }
+  return NULL;
+}
+
+}
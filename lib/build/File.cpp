@@ -7,10 +7,116 @@
 #include "mint/build/Target.h"
 
 #include "mint/support/Diagnostics.h"
+#include "mint/support/OSError.h"
+#include "mint/support/ParallelFor.h"
 #include "mint/support/Path.h"
 
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
 namespace mint {
 
+namespace {
+  /// Fewer files than this are checked on the calling thread; starting threads would
+  /// take longer than the checks themselves.
+  const size_t PARALLEL_THRESHOLD = 256;
+
+  /// Most threads to check files with. Past this the file system is the bottleneck.
+  const unsigned MAX_THREADS = 8;
+
+  /// The files being checked by one call to updateFileStatus. The results are stored
+  /// separately, so that the files themselves are only touched by the calling thread.
+  struct StatusBatch {
+    ArrayRef<File *> files;
+    path::FileStatus * status;
+    int * errors;
+  };
+
+  /// Number of files a thread claims at once, to keep contention on the lock down.
+  const size_t STATUS_CHUNK = 32;
+
+  void checkStatus(size_t start, size_t end, void * batchPtr) {
+    StatusBatch * batch = static_cast<StatusBatch *>(batchPtr);
+    for (size_t i = start; i < end; ++i) {
+      path::fileStatus(batch->files[i]->name()->value(), batch->status[i], batch->errors[i]);
+    }
+  }
+
+  unsigned workerCount(size_t fileCount) {
+    unsigned threads = std::min(processorCount(), MAX_THREADS);
+    return unsigned(std::max(size_t(1),
+        std::min(size_t(threads), fileCount / (PARALLEL_THRESHOLD / 2))));
+  }
+
+#if HAVE_UNLINKAT && HAVE_FCNTL_H
+  /// A run of files, in a batch being removed, that are all in the same directory.
+  struct RemoveGroup {
+    Directory * dir;
+    size_t start;
+    size_t end;
+  };
+
+  /// The files being removed by one call to removeFiles. Each thread claims a whole
+  /// directory at a time, so that it only has to open the directory once.
+  struct RemoveBatch {
+    ArrayRef<File *> files;
+    ArrayRef<RemoveGroup> groups;
+    int * errors;
+  };
+
+  struct ParentLess {
+    bool operator()(File * lhs, File * rhs) const {
+      return lhs->parent() < rhs->parent();
+    }
+  };
+
+  void removeGroup(RemoveBatch * batch, const RemoveGroup & group) {
+    // If the directory can't be opened, fall back to unlinking by the full path.
+    int dirFd = AT_FDCWD;
+    if (group.dir != NULL) {
+      SmallString<128> dirPath(group.dir->name()->value());
+      dirFd = ::open(dirPath.cstr(), O_RDONLY | O_DIRECTORY);
+      if (dirFd == -1) {
+        if (errno == ENOENT) {
+          return;
+        }
+        dirFd = AT_FDCWD;
+      }
+    }
+    for (size_t i = group.start; i < group.end; ++i) {
+      StringRef filePath = batch->files[i]->name()->value();
+      SmallString<128> entry(dirFd == AT_FDCWD ? filePath : path::filename(filePath));
+      if (::unlinkat(dirFd, entry.cstr(), 0) == -1 && errno != ENOENT) {
+        batch->errors[i] = errno;
+      }
+    }
+    if (dirFd != AT_FDCWD) {
+      ::close(dirFd);
+    }
+  }
+
+  void removeGroups(size_t start, size_t end, void * batchPtr) {
+    RemoveBatch * batch = static_cast<RemoveBatch *>(batchPtr);
+    for (size_t i = start; i < end; ++i) {
+      removeGroup(batch, batch->groups[i]);
+    }
+  }
+#endif
+}
+
 bool File::updateFileStatus() {
   _statusValid = path::fileStatus(name()->value(), _status);
   _statusChecked = true;
@@ -20,6 +126,44 @@ bool File::updateFileStatus() {
   return _statusValid;
 }
 
+bool File::updateFileStatus(ArrayRef<File *> files) {
+  if (files.size() < PARALLEL_THRESHOLD) {
+    bool success = true;
+    for (ArrayRef<File *>::const_iterator it = files.begin(), itEnd = files.end();
+        it != itEnd; ++it) {
+      success &= (*it)->updateFileStatus();
+    }
+    return success;
+  }
+
+  SmallVector<path::FileStatus, 0> status;
+  status.resize(files.size());
+  SmallVector<int, 0> errors;
+  errors.resize(files.size());
+
+  StatusBatch batch;
+  batch.files = files;
+  batch.status = status.data();
+  batch.errors = errors.data();
+  parallelFor(files.size(), STATUS_CHUNK, checkStatus, &batch, workerCount(files.size()));
+
+  // Now that the other threads are done, store the results and report any errors.
+  bool success = true;
+  for (size_t i = 0; i < files.size(); ++i) {
+    File * file = files[i];
+    file->_status = status[i];
+    file->_statusValid = errors[i] == 0;
+    file->_statusChecked = true;
+    if (errors[i] != 0) {
+      printPosixFileError("accessing", file->name()->value(), errors[i]);
+      success = false;
+    } else if (file->_status.exists && !file->_status.isFile) {
+      diag::error() << "'" << file->name()->value() << "' is not a file.";
+    }
+  }
+  return success;
+}
+
 void File::trace() const {
   safeMark(_parent);
   safeMark(_name);
@@ -33,6 +177,50 @@ bool File::remove() {
   return path::remove(_name->value());
 }
 
+bool File::removeFiles(ArrayRef<File *> files) {
+#if HAVE_UNLINKAT && HAVE_FCNTL_H
+  SmallVector<File *, 0> sorted(files.begin(), files.end());
+  std::sort(sorted.begin(), sorted.end(), ParentLess());
+  SmallVector<RemoveGroup, 0> groups;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    if (groups.empty() || groups.back().dir != sorted[i]->parent()) {
+      RemoveGroup group = { sorted[i]->parent(), i, i };
+      groups.push_back(group);
+    }
+    groups.back().end = i + 1;
+  }
+  SmallVector<int, 0> errors;
+  errors.resize(sorted.size(), 0);
+
+  RemoveBatch batch;
+  batch.files = sorted;
+  batch.groups = groups;
+  batch.errors = errors.data();
+  parallelFor(groups.size(), 1, removeGroups, &batch, workerCount(sorted.size()));
+
+  bool success = true;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    File * file = sorted[i];
+    if (errors[i] != 0) {
+      printPosixFileError("removing", file->name()->value(), errors[i]);
+      success = false;
+    } else {
+      file->_status.exists = false;
+      file->_statusValid = true;
+      file->_statusChecked = true;
+    }
+  }
+  return success;
+#else
+  bool success = true;
+  for (ArrayRef<File *>::const_iterator it = files.begin(), itEnd = files.end(); it != itEnd;
+      ++it) {
+    success &= (*it)->remove();
+  }
+  return success;
+#endif
+}
+
 OStream & operator<<(OStream & strm, const File * file) {
   strm << file->name();
   return strm;
@@ -2,6 +2,7 @@
  * Mint
  * ================================================================== */
 
+#include "mint/build/BuiltinAction.h"
 #include "mint/build/JobMgr.h"
 
 #include "mint/eval/Evaluator.h"
@@ -12,6 +13,12 @@
 #include "mint/support/Assert.h"
 #include "mint/support/CommandLine.h"
 #include "mint/support/Diagnostics.h"
+#include "mint/support/DirectoryCache.h"
+#include "mint/support/Path.h"
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
 
 namespace mint {
 
@@ -21,11 +28,33 @@ cl::Option<bool> optShowJobs("show-jobs", cl::Group("debug"),
 cl::Option<bool> optPreview("preview", cl::Group("global"),
     cl::Description("Show the actions that would be performed, but don't do them."));
 
+cl::Option<StringRef> optWorkers("workers", cl::Group("global"),
+    cl::Description("Run commands on the 'mint worker' processes at the given "
+        "comma-separated host:port addresses."));
+
+cl::Option<StringRef> optWorkerToken("worker-token", cl::Group("global"),
+    cl::Description("Token to present to the workers given by --workers "
+        "(default: $MINT_WORKER_TOKEN)."));
+
+cl::Option<StringRef> optMemoryBudget("memory-budget", cl::Group("global"),
+    cl::Description("Only start another job if the memory that the running jobs used in "
+        "previous builds stays under this size, such as '8G'."));
+
+namespace {
+  /// Limits on how far the estimates of a build can be scaled by the jobs that it
+  /// has already run.
+  const double MAX_MEMORY_SCALE = 4.0;
+  const double MIN_MEMORY_SCALE = 1.0;
+}
+
 // -------------------------------------------------------------------------
 // Job
 // -------------------------------------------------------------------------
 
 void Job::begin() {
+  // The actions are evaluated now, after earlier jobs may have written files, so
+  // 'glob' mustn't see listings from before then.
+  DirectoryCache::get().clear();
   Evaluator eval(_target->definition());
   Object * targetObj = _target->definition();
   if (optShowJobs) {
@@ -44,6 +73,10 @@ void Job::begin() {
   }
 
   _target->setState(Target::BUILDING);
+  _startTime = Process::monotonicTime();
+  if (_target->isRestat() && !optPreview) {
+    snapshotOutputs();
+  }
   runNextAction();
 }
 
@@ -71,7 +104,8 @@ void Job::runNextAction() {
           command->print(console::err());
           console::err() << "\n";
         }
-        if (!_process.begin(program->value(), args, _outputDir)) {
+        _command = command;
+        if (!_mgr->executor()->runCommand(this, program->value(), args, _outputDir)) {
           // Tell manager we're done and in an error.
           _status = ERROR;
           _mgr->jobFinished(this);
@@ -86,6 +120,8 @@ void Job::runNextAction() {
           op->print(console::err());
           console::err() << "\n";
         }
+        // Keep messages in order with the output of any earlier commands.
+        writeOutput();
         diag::Severity severity = diag::Severity(op->arg(0)->requireInt());
         String * text = op->arg(1)->requireString();
         Location loc;
@@ -96,12 +132,43 @@ void Job::runNextAction() {
         break;
       }
 
+      case Node::NK_ACTION_ARCHIVE:
+      case Node::NK_ACTION_COPY:
+      case Node::NK_ACTION_LINK:
+      case Node::NK_ACTION_MKDIR:
+      case Node::NK_ACTION_REMOVE:
+      case Node::NK_ACTION_TOUCH:
+      case Node::NK_ACTION_WRITE: {
+        Oper * op = static_cast<Oper *>(action);
+        if (optPreview) {
+          SmallString<128> commandLine;
+          formatBuiltinAction(op, commandLine);
+          console::out() << commandLine << "\n";
+          continue;
+        }
+        if (optShowJobs) {
+          console::err() << "JobMgr: Action for target: " << _target->definition() << ": ";
+          op->print(console::err());
+          console::err() << "\n";
+        }
+        // These are done right here; they take less time than starting a process would.
+        _command = op;
+        if (!runBuiltinAction(op, _outputDir)) {
+          SmallString<0> commandLine;
+          recordFailure(commandLine);
+          diag::status() << "  " << commandLine << "\n";
+        }
+        _command = NULL;
+        break;
+      }
+
       default:
         diag::error(action->location()) << "Invalid action type: " << action;
         break;
     }
   }
 
+  writeOutput();
   if (_status == ERROR) {
     if (optShowJobs) {
       console::err() << "JobMgr: Target abandoned: " << _target->definition() << "\n";
@@ -144,18 +211,20 @@ void Job::runNextAction() {
       }
     }
 
-    // For any dependent targets, see if they are ready.
-    for (TargetList::const_iterator
-        it = _target->dependents().begin(), itEnd = _target->dependents().end();
-        it != itEnd; ++it) {
-      Target * dep = *it;
-      if (dep->state() == Target::WAITING) {
-        dep->recheckState();
-      }
-      if (dep->state() == Target::READY) {
-        _mgr->addReady(dep);
-      }
+    bool unchanged = _target->isRestat() && !optPreview && outputsUnchanged();
+    if (unchanged && optShowJobs) {
+      console::err() << "JobMgr: Outputs unchanged: " << _target->definition() << "\n";
+    }
+    _target->setOutputsChanged(!unchanged);
+
+    // Remember what it took, for 'mint stats' and for scheduling later builds.
+    _usage.wallTime = Process::monotonicTime() - _startTime;
+    if (!optPreview && _target->path() != NULL) {
+      _mgr->targets()->buildStats().record(_target->path()->value(), _usage);
     }
+
+    // For any dependent targets, see if they are ready.
+    _mgr->releaseDependents(_target);
   }
 
   // Tell the manager we're done
@@ -163,15 +232,123 @@ void Job::runNextAction() {
 }
 
 void Job::processFinished(Process & process, bool success) {
+  _usage.add(process.usage());
+  commandFinished(success, process.exitStatus(), process.signaled());
+}
+
+void Job::commandFinished(bool success, int exitStatus, bool signaled) {
   if (!success) {
-    _status = ERROR;
+    SmallString<0> commandLine;
+    recordFailure(commandLine);
+    if (signaled) {
+      diag::info() << "Process terminated with signal " << exitStatus;
+    } else if (exitStatus >= 0) {
+      diag::info() << "Process terminated with exit code " << exitStatus;
+    } else {
+      diag::info() << "Process could not be run";
+    }
+    diag::status() << "  " << commandLine << "\n";
   }
+  _command = NULL;
   runNextAction();
 }
 
+void Job::recordFailure(SmallVectorImpl<char> & commandLine) {
+  _status = ERROR;
+  formatCommandLine(commandLine);
+  _mgr->commandFailed(_target, commandLine, output(), errors());
+
+  // Show the failing command's output right before the error that goes with it.
+  writeOutput();
+}
+
+void Job::formatCommandLine(SmallVectorImpl<char> & result) const {
+  if (_command == NULL) {
+    return;
+  }
+  if (Node::isBuiltinAction(_command->nodeKind())) {
+    formatBuiltinAction(_command, result);
+    return;
+  }
+  StringRef program = String::cast(_command->arg(0))->value();
+  result.append(program.begin(), program.end());
+  Oper * cargs = static_cast<Oper *>(_command->arg(1));
+  for (Oper::const_iterator it = cargs->begin(), itEnd = cargs->end(); it != itEnd; ++it) {
+    StringRef arg = String::cast(*it)->value();
+    result.push_back(' ');
+    result.append(arg.begin(), arg.end());
+  }
+}
+
+void Job::snapshotOutputs() {
+  // The hashes come from the build's content hash cache, so outputs that haven't
+  // changed since the last build aren't read.
+  const FileList & outputs = _target->outputs();
+  _mgr->targets()->hashFiles(outputs);
+  _snapshots.clear();
+  for (FileList::const_iterator it = outputs.begin(), itEnd = outputs.end(); it != itEnd; ++it) {
+    File * outputFile = *it;
+    OutputSnapshot snapshot;
+    snapshot.exists = outputFile->updateFileStatus() && outputFile->exists() &&
+        outputFile->hasContentHash();
+    snapshot.lastModified = outputFile->lastModified();
+    if (snapshot.exists) {
+      snapshot.contentHash = outputFile->contentHash();
+    }
+    _snapshots.push_back(snapshot);
+  }
+
+  _inputStamp = TimeStamp();
+  const FileList & sources = _target->sources();
+  for (FileList::const_iterator it = sources.begin(), itEnd = sources.end(); it != itEnd; ++it) {
+    if ((*it)->exists() && _inputStamp < (*it)->lastModified()) {
+      _inputStamp = (*it)->lastModified();
+    }
+  }
+}
+
+bool Job::outputsUnchanged() {
+  const FileList & outputs = _target->outputs();
+  if (outputs.empty() || _snapshots.size() != outputs.size()) {
+    return false;
+  }
+  for (unsigned i = 0; i < outputs.size(); ++i) {
+    if (!_snapshots[i].exists || !outputs[i]->exists()) {
+      return false;
+    }
+  }
+
+  // Compare everything first, so that we don't touch any timestamps unless all of
+  // the outputs are the same.
+  _mgr->targets()->hashFiles(outputs);
+  for (unsigned i = 0; i < outputs.size(); ++i) {
+    File * outputFile = outputs[i];
+    if (!outputFile->hasContentHash() || outputFile->contentHash() != _snapshots[i].contentHash) {
+      return false;
+    }
+  }
+
+  for (unsigned i = 0; i < outputs.size(); ++i) {
+    File * outputFile = outputs[i];
+    if (outputFile->lastModified() != _snapshots[i].lastModified) {
+      path::setLastModified(outputFile->name()->value(), _snapshots[i].lastModified);
+      outputFile->updateFileStatus();
+    }
+  }
+  _target->setInputStamp(_inputStamp);
+  _mgr->targets()->recordRestatStamp(outputs.front(), _inputStamp);
+  return true;
+}
+
+void Job::writeOutput() {
+  _process.output().writeTo(console::out());
+  _process.errors().writeTo(console::err());
+}
+
 void Job::trace() const {
   _mgr->mark();
   _target->mark();
+  safeMark(_command);
   markArray(makeArrayRef(_actions.begin(), _actions.end()));
 }
 
@@ -180,45 +357,65 @@ void Job::trace() const {
 // -------------------------------------------------------------------------
 
 void JobMgr::addReady(Target * target) {
-  if (target->state() == Target::INITIALIZED) {
-    target->checkState();
-  }
+  target->checkState();
+  addReady(target, Target::newGeneration());
+}
 
-  switch (target->state()) {
-    case Target::READY:
-      target->setState(Target::READY_IN_QUEUE);
-      _ready.push(target);
-      break;
+void JobMgr::addReady(Target * target, unsigned generation) {
+  if (!target->markVisited(generation)) {
+    return;
+  }
 
-    case Target::READY_IN_QUEUE:
-      break;
+  // Queue the target if it's ready, or otherwise the prerequisites it's waiting for,
+  // visiting each target only once.
+  SmallVector<Target *, 32> stack;
+  stack.push_back(target);
+  while (!stack.empty()) {
+    Target * tg = stack.back();
+    stack.pop_back();
+    switch (tg->state()) {
+      case Target::READY:
+        tg->setState(Target::READY_IN_QUEUE);
+        _ready.push(tg);
+        break;
 
-    case Target::WAITING: {
-      // TODO: Add cycle check
-      for (TargetList::const_iterator
-          it = target->depends().begin(), itEnd = target->depends().end(); it != itEnd; ++it) {
-        addReady(*it);
+      case Target::WAITING: {
+        for (TargetList::const_iterator it = tg->prerequisites().begin(),
+            itEnd = tg->prerequisites().end(); it != itEnd; ++it) {
+          if ((*it)->isPending() && (*it)->markVisited(generation)) {
+            stack.push_back(*it);
+          }
+        }
+        break;
       }
-      break;
-    }
-    case Target::FINISHED:
-    case Target::BUILDING:
-    case Target::ERROR:
-      break;
 
-    default:
-      diag::error() << "Invalid state for target " << target << ": "
-          << target->state();
-      break;
+      case Target::READY_IN_QUEUE:
+      case Target::FINISHED:
+      case Target::BUILDING:
+      case Target::ERROR:
+        break;
+
+      default:
+        diag::error() << "Invalid state for target " << tg << ": " << tg->state();
+        break;
+    }
   }
 }
 
 void JobMgr::addAllReady() {
+  // Check all of the states before walking the graph, since checking uses the same
+  // visit marks.
+  for (TargetMap::const_iterator it =
+      _targets->targets().begin(), itEnd = _targets->targets().end(); it != itEnd; ++it) {
+    if (it->second->path() != NULL) {
+      it->second->checkState();
+    }
+  }
+  unsigned generation = Target::newGeneration();
   for (TargetMap::const_iterator it =
       _targets->targets().begin(), itEnd = _targets->targets().end(); it != itEnd; ++it) {
-    String * path = it->second->path();
-    if (path != NULL) {
-      addReady(it->second);
+    if (it->second->path() != NULL) {
+      addReady(it->second, generation);
     }
   }
 }
@@ -232,18 +429,67 @@ Target * JobMgr::nextReady() {
   return result;
 }
 
+bool JobMgr::createExecutor() {
+  if (_executor != NULL) {
+    return true;
+  }
+  if (!optWorkers.value().empty()) {
+    RemoteExecutor * remote = new RemoteExecutor(_targets);
+    _executor = remote;
+    return remote->connect(optWorkers.value(), workerToken(optWorkerToken.value()));
+  }
+  _executor = new LocalExecutor();
+  return true;
+}
+
 void JobMgr::run() {
+  if (!createExecutor()) {
+    _error = true;
+    return;
+  }
+  if (!optMemoryBudget.value().empty() &&
+      !parseMemorySize(optMemoryBudget.value(), _memoryBudget)) {
+    diag::error() << "Invalid memory budget: " << optMemoryBudget.value();
+    _error = true;
+    return;
+  }
+
   for (;;) {
-    while (_jobs.size() < _maxJobCount && !_error) {
+    // Remote workers decide how many commands can run at once.
+    unsigned maxJobCount = _executor->slotCount() > 0 ? _executor->slotCount() : _maxJobCount;
+    while (_slotsUsed < maxJobCount && !_error) {
       Target * target = nextReady();
       if (target != NULL) {
+        unsigned slots = std::min(target->weight(), maxJobCount);
+        // The memory budget is for this machine, so it doesn't apply to remote workers.
+        uint64_t memory = 0;
+        uint64_t recorded = 0;
+        if (_memoryBudget > 0 && _executor->slotCount() == 0) {
+          memory = memoryEstimate(target, maxJobCount, recorded);
+        }
+        bool memoryFull = memory > 0 && _memoryReserved + memory > _memoryBudget;
+        bool poolFull = !poolHasRoom(target, slots);
+        if (!_jobs.empty() && (_slotsUsed + slots > maxJobCount || poolFull || memoryFull)) {
+          // Set this one aside until a job finishes, and try to fill the free slots with
+          // other targets.
+          if (optShowJobs) {
+            console::err() << "JobMgr: Target deferred, waiting for free "
+                << (memoryFull ? "memory: " : "slots: ") << target->definition() << "\n";
+          }
+          parkTarget(target, poolFull);
+          continue;
+        }
         //diag::status() << "Beginning target " << target << "\n";
-        Job * job = new Job(this, target);
+        Job * job = new Job(this, target, slots, memory, recorded);
         _jobs.push_back(job);
+        _slotsUsed += slots;
+        _memoryReserved += memory;
+        updatePoolUsage(target, int(slots));
         job->begin();
       } else if (_jobs.empty()) {
         // No ready targets and no jobs running
         //diag::info() << "No targets ready and no jobs running";
+        reportFailures();
         return;
       } else {
         // No targets, but jobs are running, so wait for one.
@@ -251,8 +497,16 @@ void JobMgr::run() {
         break;
       }
     }
+    if (_jobs.empty()) {
+      // Jobs that only had builtin actions finish without anything to wait for. If that
+      // released targets that were set aside, start them now.
+      if (!_ready.empty() && !_error) {
+        continue;
+      }
+      break;
+    }
 
-    bool success = Process::waitForProcessEvent();
+    bool success = _executor->waitForEvent();
     if (!success) {
       _error = true;
     }
@@ -260,6 +514,7 @@ void JobMgr::run() {
       break;
     }
   }
+  reportFailures();
 }
 
 void JobMgr::jobFinished(Job * job) {
@@ -269,13 +524,186 @@ void JobMgr::jobFinished(Job * job) {
   for (JobList::iterator it = _jobs.begin(), itEnd = _jobs.end(); it != itEnd; ++it) {
     if (*it == job) {
       _jobs.erase(it);
+      _slotsUsed -= job->slots();
+      _memoryReserved -= job->memoryEstimate();
+      updatePoolUsage(job->target(), -int(job->slots()));
+      uint64_t actual = job->usage().maxResident;
+      if (optShowJobs && job->memoryRecorded() > 0 && actual > job->memoryEstimate()) {
+        console::err() << "JobMgr: Target used " << actual << "K of memory, expected "
+            << job->memoryEstimate() << "K: " << job->target()->definition() << "\n";
+      }
+      updateMemoryScale(job->memoryRecorded(), actual);
+      releaseParked(job->target());
       break;
     }
   }
 }
 
+JobMgr::PoolUsage & JobMgr::poolUsage(Object * pool) {
+  for (PoolUsage * it = _pools.begin(); it != _pools.end(); ++it) {
+    if (it->pool == pool) {
+      return *it;
+    }
+  }
+  PoolUsage usage;
+  usage.pool = pool;
+  usage.used = 0;
+  _pools.push_back(usage);
+  return _pools.back();
+}
+
+bool JobMgr::parseMemorySize(StringRef text, uint64_t & kilobytes) {
+  uint64_t value = 0;
+  StringRef::const_iterator it = text.begin();
+  for (; it != text.end() && *it >= '0' && *it <= '9'; ++it) {
+    value = value * 10 + unsigned(*it - '0');
+  }
+  if (it == text.begin()) {
+    return false;
+  }
+  StringRef suffix = text.substr(it - text.begin());
+  if (suffix.empty()) {
+    kilobytes = value / 1024;
+  } else if (suffix == "K" || suffix == "k") {
+    kilobytes = value;
+  } else if (suffix == "M" || suffix == "m") {
+    kilobytes = value * 1024;
+  } else if (suffix == "G" || suffix == "g") {
+    kilobytes = value * 1024 * 1024;
+  } else {
+    return false;
+  }
+  return kilobytes > 0;
+}
+
+bool JobMgr::poolHasRoom(Target * target, unsigned slots) {
+  if (target->pool() == NULL) {
+    return true;
+  }
+  // A job can't take more than the whole pool, so that it can always run eventually.
+  unsigned depth = target->poolDepth();
+  return poolUsage(target->pool()).used + std::min(slots, depth) <= depth;
+}
+
+void JobMgr::updatePoolUsage(Target * target, int slots) {
+  if (target->pool() != NULL) {
+    int depth = int(target->poolDepth());
+    poolUsage(target->pool()).used += slots < 0 ? std::max(slots, -depth) : std::min(slots, depth);
+  }
+}
+
+void JobMgr::parkTarget(Target * target, bool poolFull) {
+  if (poolFull) {
+    poolUsage(target->pool()).waiting.push_back(target);
+  } else {
+    _waitingForRoom.push_back(target);
+  }
+}
+
+void JobMgr::releaseParked(Target * target) {
+  for (TargetList::const_iterator it = _waitingForRoom.begin(), itEnd = _waitingForRoom.end();
+      it != itEnd; ++it) {
+    _ready.push(*it);
+  }
+  _waitingForRoom.clear();
+  if (target->pool() != NULL) {
+    TargetList & waiting = poolUsage(target->pool()).waiting;
+    for (TargetList::const_iterator it = waiting.begin(), itEnd = waiting.end(); it != itEnd;
+        ++it) {
+      _ready.push(*it);
+    }
+    waiting.clear();
+  }
+}
+
+uint64_t JobMgr::memoryEstimate(Target * target, unsigned maxJobCount, uint64_t & recorded) {
+  const ResourceUsage * usage = target->path() != NULL ?
+      _targets->buildStats().find(target->path()->value()) : NULL;
+  recorded = usage != NULL ? usage->maxResident : 0;
+  if (recorded == 0) {
+    return std::max(_memoryBudget / maxJobCount, uint64_t(1));
+  }
+  return std::max(uint64_t(recorded * _memoryScale), uint64_t(1));
+}
+
+void JobMgr::updateMemoryScale(uint64_t recorded, uint64_t actual) {
+  if (recorded == 0 || actual == 0) {
+    return;
+  }
+  // Move part of the way towards how much this job has grown since it was recorded, so
+  // that one unusual job doesn't throw off all of the others. Jobs that use less than
+  // they did last time bring the scale back down, but never below the recorded usage.
+  double ratio = double(actual) / double(recorded);
+  _memoryScale = std::min(MAX_MEMORY_SCALE,
+      std::max(MIN_MEMORY_SCALE, _memoryScale * 0.75 + ratio * 0.25));
+}
+
+void JobMgr::commandFailed(Target * target, StringRef commandLine, StreamBuffer & output,
+    StreamBuffer & errors) {
+  // Only the beginning of a failing command's output goes in the summary; the first
+  // errors are usually the interesting ones, and the full text was already shown.
+  static const size_t MAX_OUTPUT = 16 * 1024;
+
+  OStrStream strm;
+  strm << "  " << target << ":\n    " << commandLine << "\n";
+  _failureLog.append(strm.str());
+
+  size_t outputSize = errors.size() + output.size();
+  size_t copied = errors.copyTo(_failureLog, MAX_OUTPUT);
+  copied += output.copyTo(_failureLog, MAX_OUTPUT - copied);
+  if (!_failureLog.empty() && _failureLog.back() != '\n') {
+    _failureLog.push_back('\n');
+  }
+  if (copied < outputSize) {
+    _failureLog.append(StringRef("    [output truncated]\n"));
+  }
+  ++_failureCount;
+}
+
+void JobMgr::reportFailures() {
+  if (_failureCount == 0) {
+    return;
+  }
+  diag::info() << _failureCount << (_failureCount == 1 ? " command" : " commands") << " failed:";
+  diag::status() << _failureLog;
+  _failureLog.clear();
+  _failureCount = 0;
+}
+
+void JobMgr::releaseDependents(Target * target) {
+  // Targets that turn out to be up to date release their own waiters in turn.
+  SmallVector<Target *, 16> finished;
+  finished.push_back(target);
+  while (!finished.empty()) {
+    Target * tg = finished.back();
+    finished.pop_back();
+    for (TargetList::const_iterator it = tg->waiters().begin(), itEnd = tg->waiters().end();
+        it != itEnd; ++it) {
+      Target * dep = *it;
+      if (!dep->prerequisiteFinished()) {
+        continue;
+      }
+      if (dep->state() == Target::FINISHED) {
+        // Nothing it was waiting on changed, so it's up to date; and so are any of
+        // its own waiters that were only waiting on it.
+        if (optShowJobs) {
+          console::err() << "JobMgr: Target skipped, dependencies unchanged: "
+              << dep->definition() << "\n";
+        }
+        finished.push_back(dep);
+      } else if (dep->state() == Target::READY) {
+        dep->setState(Target::READY_IN_QUEUE);
+        _ready.push(dep);
+      }
+    }
+  }
+}
+
 void JobMgr::trace() const {
   _targets->mark();
+  for (const PoolUsage * it = _pools.begin(); it != _pools.end(); ++it) {
+    it->pool->mark();
+  }
   markArray(ArrayRef<Job *>(_jobs));
 }
 
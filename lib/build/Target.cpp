@@ -2,6 +2,7 @@
  * Mint
  * ================================================================== */
 
+#include "mint/build/BuildGraph.h"
 #include "mint/build/File.h"
 #include "mint/build/Target.h"
 
@@ -58,171 +59,119 @@ String * Target::sortKey() {
   return _sortKey;
 }
 
-void Target::checkState() {
-  if (_state == INITIALIZED) {
-    _state = CHECKING_STATE;
-
-    // Check output files
-    bool needsRebuild = false;
-    bool needsRebuildDeps = false;
-    File * oldestOutput = NULL;
-    for (FileList::const_iterator it = _outputs.begin(), itEnd = _outputs.end(); it != itEnd;
-        ++it) {
-      File * f = *it;
-      if (!f->statusChecked()) {
-        //console::out() << "    Checking status of " << f->name() << "\n";
-        if (!f->updateFileStatus()) {
-          continue;
-        }
-      }
-      if (f->statusValid()) {
-        if (!f->exists()) {
-          if (!needsRebuild) {
-            if (VERBOSE) {
-              console::out() << "  Output " << f << " is missing.\n";
-            }
-          }
-          needsRebuild = true;
-          break;
-        } else if (oldestOutput == NULL || f->lastModified() < oldestOutput->lastModified()) {
-          oldestOutput = f;
-        }
-      }
-    }
+namespace {
+  /// The most recently used generation number for walking the target graph.
+  unsigned lastGeneration = 0;
 
-    if (_outputs.empty()) {
-      needsRebuild = true;
-    }
+  /// A target being visited while checking states, and the index of the next
+  /// prerequisite of it to visit.
+  struct CheckFrame {
+    Target * target;
+    unsigned next;
+  };
+}
 
-    // Check source files. Don't bother checking source file timestamps if we know we need
-    // a rebuild, or if there are no declared outputs.
-    for (FileList::const_iterator it = _sources.begin(), itEnd = _sources.end(); it != itEnd;
-        ++it) {
-      File * f = *it;
-      if (!f->statusChecked()) {
-        //console::out() << "    Checking status of " << f->name() << "\n";
-        if (!f->updateFileStatus()) {
-          continue;
-        }
-      }
-      if (f->statusValid()) {
-        // If this file is the output of another target, then unless that target is up
-        // to date, then it doesn't matter what the timestamp of the output is in.
-        if (!f->exists()) {
-          needsRebuild = true;
-        }
-        if (!f->outputOf().empty() && !isSourceOnly()) {
-          for (TargetList::const_iterator ti = f->outputOf().begin(), tiEnd = f->outputOf().end();
-              ti != tiEnd; ++ti) {
-            Target * dep = *ti;
-            if (dep->state() == CHECKING_STATE) {
-              diag::error(this->location()) << "Circular dependency between target: " << this;
-              diag::info(dep->location()) << "and target: " << dep;
-              continue;
-            }
-            dep->checkState();
-            if (dep->state() == READY || dep->state() == WAITING || dep->state() == BUILDING) {
-              needsRebuild = true;
-              needsRebuildDeps = true;
-            }
-            // TODO: Do we want to add to implicit deps?
-          }
-        } else if (!f->exists()) {
-          diag::error(this->location()) << "Target " << this << " depends on non-existent file "
-              << f->name();
-          break;
-        } else if (oldestOutput != NULL && oldestOutput->lastModified() < f->lastModified()) {
-          if (!needsRebuild) {
-            if (VERBOSE) {
-              console::out() << "  Output " << oldestOutput << " is older than source " << f << ".\n";
-            }
-          }
-          needsRebuild = true;
-        }
-      }
-    }
+unsigned Target::newGeneration() {
+  return ++lastGeneration;
+}
 
-    for (TargetList::const_iterator ti = _depends.begin(), tiEnd = _depends.end(); ti != tiEnd;
-        ++ti) {
-      Target * dep = *ti;
-      if (dep->state() == CHECKING_STATE) {
-        diag::error(this->location()) << "Circular dependency between target: " << this;
+void Target::checkState() {
+  if (_state != INITIALIZED) {
+    return;
+  }
+
+  // Walk everything this target depends on that hasn't been checked, using an explicit
+  // stack. A target is in CHECKING_STATE from when it is first reached until its own
+  // state is worked out; '_cycleCheck' is set only while it is on the stack, which
+  // is how cycles are spotted. 'order' gets each target after all its prerequisites.
+  TargetList order;
+  SmallVector<CheckFrame, 32> stack;
+  _state = CHECKING_STATE;
+  _cycleCheck = true;
+  gatherPrerequisites();
+  CheckFrame root = { this, 0 };
+  stack.push_back(root);
+  while (!stack.empty()) {
+    Target * target = stack.back().target;
+    if (stack.back().next < target->_prerequisites.size()) {
+      Target * dep = target->_prerequisites[stack.back().next++];
+      if (dep->_cycleCheck) {
+        diag::error(target->location()) << "Circular dependency between target: " << target;
         diag::info(dep->location()) << "and target: " << dep;
-        continue;
-      }
-      dep->checkState();
-      if (dep->state() == READY || dep->state() == WAITING || dep->state() == BUILDING) {
-        needsRebuild = true;
-        needsRebuildDeps = true;
+      } else if (dep->_state == INITIALIZED) {
+        dep->_state = CHECKING_STATE;
+        dep->_cycleCheck = true;
+        dep->gatherPrerequisites();
+        CheckFrame frame = { dep, 0 };
+        stack.push_back(frame);
       }
+    } else {
+      target->_cycleCheck = false;
+      order.push_back(target);
+      stack.pop_back();
     }
+  }
 
-    if (needsRebuild) {
-      if (needsRebuildDeps) {
-        _state = WAITING;
-        if (VERBOSE) {
-          console::out() << "Target " << this << " is waiting on other targets\n";
-        }
-      } else {
-        _state = READY;
-        if (VERBOSE) {
-          console::out() << "Target " << this << " is ready to build\n";
+  // Work out their states over a compact copy of the graph.
+  BuildGraph graph;
+  graph.lower(order);
+  graph.readFileStatus();
+  graph.computeStates();
+  graph.storeStates();
+}
+
+void Target::gatherPrerequisites() {
+  unsigned generation = newGeneration();
+  markVisited(generation);
+  _prerequisites.clear();
+  for (TargetList::const_iterator ti = _depends.begin(), tiEnd = _depends.end(); ti != tiEnd;
+      ++ti) {
+    if ((*ti)->markVisited(generation)) {
+      _prerequisites.push_back(*ti);
+    }
+  }
+  // A target made only of source files doesn't wait for whatever generates them.
+  if (!isSourceOnly()) {
+    for (FileList::const_iterator it = _sources.begin(), itEnd = _sources.end(); it != itEnd;
+        ++it) {
+      const TargetList & producers = (*it)->outputOf();
+      for (TargetList::const_iterator ti = producers.begin(), tiEnd = producers.end();
+          ti != tiEnd; ++ti) {
+        if ((*ti)->markVisited(generation)) {
+          _prerequisites.push_back(*ti);
         }
       }
-    } else {
-      _state = FINISHED;
-      if (VERBOSE) {
-        console::out() << "Target " << this << " is up to date\n";
-        console::out() << "Target has " << _depends.size() << " dependencies, and " << _dependents.size() << " dependents.\n";
-      }
     }
-  } else {
-    //console::out() << "Target " << this << " is in a weird state: " << _state << ".\n";
   }
 }
 
-void Target::recheckState() {
-  if (_state == WAITING) {
-    // Check dependent targets
-    bool allDepsFinished = true;
-    for (TargetList::const_iterator ti = _depends.begin(), tiEnd = _depends.end(); ti != tiEnd;
-        ++ti) {
-      Target * dep = *ti;
-      dep->checkState();
-      if (dep->state() != FINISHED) {
-        //diag::info() << "" << this << " still waiting on " << dep << " which is in state " << dep->state();
-        allDepsFinished = false;
-        break;
-      }
+bool Target::prerequisiteFinished() {
+  if (_state != WAITING || _pendingCount == 0 || --_pendingCount > 0) {
+    return false;
+  }
+  if (_outOfDate || dependencyChanged()) {
+    _state = READY;
+    if (VERBOSE) {
+      console::out() << "Target " << this << " is ready to build\n";
     }
-
-    if (allDepsFinished) {
-      // Check source files.
-      for (FileList::const_iterator it = _sources.begin(), itEnd = _sources.end(); it != itEnd;
-          ++it) {
-        File * f = *it;
-        if (f->statusValid()) {
-          for (TargetList::const_iterator ti = f->outputOf().begin(), tiEnd = f->outputOf().end();
-              ti != tiEnd; ++ti) {
-            Target * dep = *ti;
-            dep->checkState();
-            if (dep->state() != FINISHED) {
-              //diag::info() << "" << this << " still waiting on file " << dep << " which is in state " << dep->state();
-              allDepsFinished = false;
-              break;
-            }
-          }
-        }
-      }
+  } else {
+    // Everything we were waiting on was rebuilt without changing its outputs.
+    _state = FINISHED;
+    if (VERBOSE) {
+      console::out() << "Target " << this << " is up to date, dependencies unchanged\n";
     }
+  }
+  return true;
+}
 
-    if (allDepsFinished) {
-      _state = READY;
-      if (VERBOSE) {
-        console::out() << "Target " << this << " is ready to build\n";
-      }
+bool Target::dependencyChanged() const {
+  for (TargetList::const_iterator ti = _prerequisites.begin(), tiEnd = _prerequisites.end();
+      ti != tiEnd; ++ti) {
+    if ((*ti)->outputsChanged()) {
+      return true;
     }
   }
+  return false;
 }
 
 void Target::print(OStream & strm) const {
@@ -237,8 +186,11 @@ void Target::print(OStream & strm) const {
 
 void Target::trace() const {
   _definition->mark();
+  safeMark(_pool);
   markArray(ArrayRef<Target *>(_depends));
   markArray(ArrayRef<Target *>(_dependents));
+  markArray(ArrayRef<Target *>(_prerequisites));
+  markArray(ArrayRef<Target *>(_waiters));
   markArray(ArrayRef<File *>(_sources));
   markArray(ArrayRef<File *>(_outputs));
 }
@@ -6,15 +6,18 @@
 #include "mint/build/TargetMgr.h"
 #include "mint/build/TargetFinder.h"
 
+#include "mint/project/Configurator.h"
+
 #include "mint/support/Assert.h"
 #include "mint/support/Diagnostics.h"
 #include "mint/support/Path.h"
 
 namespace mint {
 
-TargetFinder::TargetFinder(TargetMgr * targetMgr, Project * project)
+TargetFinder::TargetFinder(TargetMgr * targetMgr, Project * project, bool configure)
   : _targetMgr(targetMgr)
   , _project(project)
+  , _configure(configure)
 {
   _targetProto = TypeRegistry::targetType();
 }
@@ -27,6 +30,11 @@ void TargetFinder::visitObject(Object * obj) {
       Module * module = obj->module();
       M_ASSERT(module != NULL);
 
+      if (_configure) {
+        Configurator config(_project, module);
+        config.visitObject(obj);
+      }
+
       Evaluator eval(module);
       Oper * depends = eval.attributeValueAsList(obj, "depends");
       Oper * implicit_depends = eval.attributeValueAsList(obj, "implicit_depends");
@@ -44,6 +52,28 @@ void TargetFinder::visitObject(Object * obj) {
       if (eval.attributeValueAsBool(obj, "internal")) {
         target->setFlag(Target::INTERNAL, true);
       }
+      if (eval.attributeValueAsBool(obj, "restat")) {
+        target->setFlag(Target::RESTAT, true);
+      }
+
+      // Limits on how many jobs can run at once
+      Node * pool = eval.attributeValue(obj, "pool");
+      if (pool != NULL && pool->nodeKind() == Node::NK_OBJECT) {
+        Node * depth = eval.attributeValue(pool, "depth");
+        if (depth == NULL || depth->nodeKind() != Node::NK_INTEGER || depth->requireInt() < 1) {
+          diag::error(pool->location()) << "Pool depth must be a positive integer.";
+        } else {
+          target->setPool(static_cast<Object *>(pool), unsigned(depth->requireInt()));
+        }
+      }
+      Node * weight = eval.attributeValue(obj, "weight");
+      if (weight != NULL && weight->nodeKind() == Node::NK_INTEGER) {
+        if (weight->requireInt() < 1) {
+          diag::error(weight->location()) << "Target weight must be a positive integer.";
+        } else {
+          target->setWeight(unsigned(weight->requireInt()));
+        }
+      }
 
       // Default source directory
       StringRef sourceDir = module->sourceDir();
@@ -83,6 +113,11 @@ void TargetFinder::visitObject(Object * obj) {
       M_ASSERT(outputs != NULL);
       addOutputsToTarget(target, outputs, outputDir);
 
+      // What a RESTAT target was last built against, keyed by its first output.
+      if (target->isRestat() && !target->outputs().empty()) {
+        target->setInputStamp(_targetMgr->restatStamp(target->outputs().front()));
+      }
+
       target->setState(Target::INITIALIZED);
     }
   }
@@ -117,8 +152,7 @@ void TargetFinder::addSourcesToTarget(Target * target, Oper * list, StringRef ba
       diag::error(n->location()) << "Invalid type for source file: " << n->nodeKind();
       diag::info(target->definition()->location()) << "For target: " << target->definition();
     } else {
-      String * path = makeAbsolute(static_cast<String *>(n), baseDir);
-      File * file = _targetMgr->getFile(path);
+      File * file = getFile(static_cast<String *>(n), baseDir);
       target->addSource(file);
       file->addSourceFor(target);
     }
@@ -132,21 +166,20 @@ void TargetFinder::addOutputsToTarget(Target * target, Oper * list, StringRef ba
       diag::error(n->location()) << "Invalid type for output file: " << n->nodeKind();
       diag::info(target->definition()->location()) << "For target: " << target->definition();
     } else {
-      String * path = makeAbsolute(static_cast<String *>(n), baseDir);
-      File * file = _targetMgr->getFile(path);
+      File * file = getFile(static_cast<String *>(n), baseDir);
       target->addOutput(file);
       file->addOutputOf(target);
     }
   }
 }
 
-String * TargetFinder::makeAbsolute(String * filepath, StringRef baseDir) {
+File * TargetFinder::getFile(String * filepath, StringRef baseDir) {
   if (path::isAbsolute(filepath->value())) {
-    return filepath;
+    return _targetMgr->getFile(filepath);
   }
   SmallString<128> absPath(baseDir);
   path::combine(absPath, filepath->value());
-  return String::create(filepath->location(), absPath);
+  return _targetMgr->getFile(absPath);
 }
 
 }
@@ -0,0 +1,397 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#include "mint/build/TargetIndex.h"
+#include "mint/build/TargetMgr.h"
+
+#include "mint/support/OStream.h"
+#include "mint/support/Path.h"
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
+namespace mint {
+
+namespace {
+  /// First line of the index file; change the number if the format changes.
+  const char INDEX_HEADER[] = "mint-target-graph 1";
+
+  /// A target or file, where its name is in the index's text, and the number it is
+  /// given.
+  template <class T>
+  struct IndexedNode {
+    T * ptr;
+    unsigned offset;
+    unsigned length;
+    unsigned id;
+  };
+
+  /// Orders nodes by name.
+  template <class T>
+  struct NameLess {
+    NameLess(const char * text) : _text(text) {}
+
+    bool operator()(const IndexedNode<T> & lhs, const IndexedNode<T> & rhs) const {
+      return StringRef(_text + lhs.offset, lhs.length).compare(
+          StringRef(_text + rhs.offset, rhs.length)) < 0;
+    }
+
+    const char * _text;
+  };
+
+  /// Orders nodes by address, for looking up the number given to a target or file.
+  template <class T>
+  struct PtrLess {
+    bool operator()(const IndexedNode<T> & lhs, const IndexedNode<T> & rhs) const {
+      return lhs.ptr < rhs.ptr;
+    }
+  };
+
+  template <class T>
+  unsigned lookupId(const SmallVectorImpl<IndexedNode<T> > & nodes, T * ptr) {
+    IndexedNode<T> key = { ptr, 0, 0, 0 };
+    return std::lower_bound(nodes.begin(), nodes.end(), key, PtrLess<T>())->id;
+  }
+
+  /// Read an unsigned number at 'pos', followed by a space.
+  bool readNumber(const char *& pos, const char * end, unsigned & value) {
+    if (pos >= end || *pos < '0' || *pos > '9') {
+      return false;
+    }
+    value = 0;
+    while (pos < end && *pos >= '0' && *pos <= '9') {
+      value = value * 10 + unsigned(*pos - '0');
+      ++pos;
+    }
+    if (pos >= end || *pos != ' ') {
+      return false;
+    }
+    ++pos;
+    return true;
+  }
+}
+
+const TargetIndex::Index TargetIndex::NOT_FOUND;
+
+struct TargetIndex::TextLess {
+  TextLess(const char * text) : _text(text) {}
+
+  bool operator()(const TextRef & lhs, StringRef rhs) const {
+    return StringRef(_text + lhs.offset, lhs.length).compare(rhs) < 0;
+  }
+
+  const char * _text;
+};
+
+void TargetIndex::clear() {
+  _text.clear();
+  _targetNames.clear();
+  _filePaths.clear();
+  _depends.clear();
+  _sources.clear();
+  _outputs.clear();
+  _dependents.clear();
+  _producers.clear();
+  _consumers.clear();
+}
+
+TargetIndex::TextRef TargetIndex::addText(StringRef str) {
+  TextRef ref = { unsigned(_text.size()), unsigned(str.size()) };
+  _text.append(str);
+  return ref;
+}
+
+void TargetIndex::build(const TargetMap & targetMap) {
+  clear();
+
+  // Name every target, using its first output or source if it has no name of its own,
+  // and gather up every file.
+  SmallVector<IndexedNode<Target>, 0> targets;
+  SmallVector<IndexedNode<File>, 0> files;
+  for (TargetMap::const_iterator it = targetMap.begin(), itEnd = targetMap.end(); it != itEnd;
+      ++it) {
+    Target * target = it->second;
+    TextRef name;
+    if (target->path() != NULL) {
+      name = addText(target->path()->value());
+    } else {
+      OStrStream strm;
+      strm << target;
+      name = addText(strm.str());
+    }
+    IndexedNode<Target> node = { target, name.offset, name.length, 0 };
+    targets.push_back(node);
+    for (FileList::const_iterator fi = target->sources().begin(),
+        fiEnd = target->sources().end(); fi != fiEnd; ++fi) {
+      IndexedNode<File> file = { *fi, 0, 0, 0 };
+      files.push_back(file);
+    }
+    for (FileList::const_iterator fi = target->outputs().begin(),
+        fiEnd = target->outputs().end(); fi != fiEnd; ++fi) {
+      IndexedNode<File> file = { *fi, 0, 0, 0 };
+      files.push_back(file);
+    }
+  }
+  std::sort(files.begin(), files.end(), PtrLess<File>());
+  size_t fileCount = 0;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (fileCount == 0 || files[fileCount - 1].ptr != files[i].ptr) {
+      TextRef path = addText(files[i].ptr->name()->value());
+      files[fileCount] = files[i];
+      files[fileCount].offset = path.offset;
+      files[fileCount].length = path.length;
+      ++fileCount;
+    }
+  }
+  files.resize(fileCount);
+
+  // Number targets and files in order of name, then sort them back into order of
+  // address for looking the numbers up.
+  std::stable_sort(targets.begin(), targets.end(), NameLess<Target>(_text.data()));
+  for (unsigned i = 0; i < targets.size(); ++i) {
+    targets[i].id = i;
+    TextRef name = { targets[i].offset, targets[i].length };
+    _targetNames.push_back(name);
+  }
+  std::sort(files.begin(), files.end(), NameLess<File>(_text.data()));
+  for (unsigned i = 0; i < files.size(); ++i) {
+    files[i].id = i;
+    TextRef path = { files[i].offset, files[i].length };
+    _filePaths.push_back(path);
+  }
+  SmallVector<IndexedNode<Target>, 0> byName(targets.begin(), targets.end());
+  std::sort(targets.begin(), targets.end(), PtrLess<Target>());
+  std::sort(files.begin(), files.end(), PtrLess<File>());
+
+  // Now the edges, in order of target number.
+  _depends.start.push_back(0);
+  _sources.start.push_back(0);
+  _outputs.start.push_back(0);
+  IndexArray row;
+  for (SmallVectorImpl<IndexedNode<Target> >::const_iterator it = byName.begin(), itEnd = byName.end();
+      it != itEnd; ++it) {
+    Target * target = it->ptr;
+    row.clear();
+    for (TargetList::const_iterator ti = target->depends().begin(),
+        tiEnd = target->depends().end(); ti != tiEnd; ++ti) {
+      row.push_back(lookupId(targets, *ti));
+    }
+    for (FileList::const_iterator fi = target->sources().begin(),
+        fiEnd = target->sources().end(); fi != fiEnd; ++fi) {
+      _sources.edges.push_back(lookupId(files, *fi));
+      // A target made only of source files doesn't wait for whatever generates them.
+      if (!target->isSourceOnly()) {
+        const TargetList & producers = (*fi)->outputOf();
+        for (TargetList::const_iterator ti = producers.begin(), tiEnd = producers.end();
+            ti != tiEnd; ++ti) {
+          row.push_back(lookupId(targets, *ti));
+        }
+      }
+    }
+    for (FileList::const_iterator fi = target->outputs().begin(),
+        fiEnd = target->outputs().end(); fi != fiEnd; ++fi) {
+      _outputs.edges.push_back(lookupId(files, *fi));
+    }
+    std::sort(row.begin(), row.end());
+    row.erase(std::unique(row.begin(), row.end()), row.end());
+    _depends.edges.append(row.begin(), row.end());
+    _depends.start.push_back(_depends.edges.size());
+    _sources.start.push_back(_sources.edges.size());
+    _outputs.start.push_back(_outputs.edges.size());
+  }
+  buildReverseRows();
+}
+
+bool TargetIndex::read(StringRef path) {
+  clear();
+
+  SmallString<0> content;
+  path::FileStatus st;
+  if (!path::fileStatus(path, st) || !st.exists || !path::readFileContents(path, content)) {
+    return false;
+  }
+
+  // After the header come the number of files and targets, then a line with the path
+  // of each file, then a line for each target: the number of dependencies, sources and
+  // outputs, those themselves, and then the target's name.
+  const char * pos = content.begin();
+  const char * end = content.end();
+  StringRef text(content);
+  size_t eol = text.find('\n');
+  if (eol == StringRef::npos || text.substr(0, eol) != INDEX_HEADER) {
+    return false;
+  }
+  pos += eol + 1;
+  unsigned fileCount, targetCount;
+  if (!readNumber(pos, end, fileCount) || !readNumber(pos, end, targetCount) ||
+      pos >= end || *pos++ != '\n') {
+    clear();
+    return false;
+  }
+
+  for (unsigned i = 0; i < fileCount; ++i) {
+    const char * lineEnd = std::find(pos, end, '\n');
+    if (lineEnd == end) {
+      clear();
+      return false;
+    }
+    _filePaths.push_back(addText(StringRef(pos, lineEnd - pos)));
+    pos = lineEnd + 1;
+  }
+
+  _depends.start.push_back(0);
+  _sources.start.push_back(0);
+  _outputs.start.push_back(0);
+  for (unsigned i = 0; i < targetCount; ++i) {
+    unsigned counts[3];
+    if (!readNumber(pos, end, counts[0]) || !readNumber(pos, end, counts[1]) ||
+        !readNumber(pos, end, counts[2])) {
+      clear();
+      return false;
+    }
+    Rows * rows[3] = { &_depends, &_sources, &_outputs };
+    unsigned limits[3] = { targetCount, fileCount, fileCount };
+    for (unsigned r = 0; r < 3; ++r) {
+      for (unsigned j = 0; j < counts[r]; ++j) {
+        unsigned id;
+        if (!readNumber(pos, end, id) || id >= limits[r]) {
+          clear();
+          return false;
+        }
+        rows[r]->edges.push_back(id);
+      }
+      rows[r]->start.push_back(rows[r]->edges.size());
+    }
+    const char * lineEnd = std::find(pos, end, '\n');
+    if (lineEnd == end) {
+      clear();
+      return false;
+    }
+    _targetNames.push_back(addText(StringRef(pos, lineEnd - pos)));
+    pos = lineEnd + 1;
+  }
+
+  // Lookups depend on the names being in order.
+  if (!isSorted(_targetNames) || !isSorted(_filePaths)) {
+    clear();
+    return false;
+  }
+  buildReverseRows();
+  return true;
+}
+
+void TargetIndex::write(SmallVectorImpl<char> & out) const {
+  OStrStream strm;
+  strm << INDEX_HEADER << "\n";
+  strm << unsigned(fileCount()) << " " << unsigned(targetCount()) << " \n";
+  for (Index id = 0; id < fileCount(); ++id) {
+    strm << filePath(id) << "\n";
+  }
+  for (Index id = 0; id < targetCount(); ++id) {
+    ArrayRef<Index> rows[3] = { depends(id), sources(id), outputs(id) };
+    strm << unsigned(rows[0].size()) << " " << unsigned(rows[1].size()) << " "
+        << unsigned(rows[2].size()) << " ";
+    for (unsigned r = 0; r < 3; ++r) {
+      for (ArrayRef<Index>::const_iterator it = rows[r].begin(), itEnd = rows[r].end();
+          it != itEnd; ++it) {
+        strm << *it << " ";
+      }
+    }
+    strm << targetName(id) << "\n";
+  }
+  out.append(strm.str().begin(), strm.str().end());
+}
+
+bool TargetIndex::isSorted(const SmallVectorImpl<TextRef> & names) const {
+  for (size_t i = 1; i < names.size(); ++i) {
+    if (text(names[i]).compare(text(names[i - 1])) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TargetIndex::Index TargetIndex::find(
+    const SmallVectorImpl<TextRef> & names, StringRef name) const {
+  const TextRef * it = std::lower_bound(names.begin(), names.end(), name,
+      TextLess(_text.data()));
+  if (it != names.end() && text(*it) == name) {
+    return Index(it - names.begin());
+  }
+  return NOT_FOUND;
+}
+
+TargetIndex::Index TargetIndex::findTarget(StringRef name) const {
+  return find(_targetNames, name);
+}
+
+TargetIndex::Index TargetIndex::findFile(StringRef path) const {
+  return find(_filePaths, path);
+}
+
+void TargetIndex::buildReverseRows() {
+  reverseRows(_depends, targetCount(), _dependents);
+  reverseRows(_outputs, fileCount(), _producers);
+  reverseRows(_sources, fileCount(), _consumers);
+}
+
+void TargetIndex::reverseRows(const Rows & forward, size_t count, Rows & reverse) {
+  reverse.clear();
+  reverse.start.resize(count + 1, 0);
+  for (IndexArray::const_iterator it = forward.edges.begin(), itEnd = forward.edges.end();
+      it != itEnd; ++it) {
+    ++reverse.start[*it + 1];
+  }
+  for (size_t i = 0; i < count; ++i) {
+    reverse.start[i + 1] += reverse.start[i];
+  }
+  reverse.edges.resize(forward.edges.size());
+  IndexArray next(reverse.start.begin(), reverse.start.end() - 1);
+  size_t sourceCount = forward.start.empty() ? 0 : forward.start.size() - 1;
+  for (Index source = 0; source < sourceCount; ++source) {
+    ArrayRef<Index> edges = row(forward, source);
+    for (ArrayRef<Index>::const_iterator it = edges.begin(), itEnd = edges.end();
+        it != itEnd; ++it) {
+      reverse.edges[next[*it]++] = source;
+    }
+  }
+}
+
+void TargetIndex::closure(const Rows & rows, size_t count, ArrayRef<Index> roots,
+    SmallVectorImpl<Index> & result) {
+  SmallVector<bool, 0> reached;
+  reached.resize(count, false);
+  IndexArray stack(roots.begin(), roots.end());
+  while (!stack.empty()) {
+    Index id = stack.back();
+    stack.pop_back();
+    ArrayRef<Index> edges = row(rows, id);
+    for (ArrayRef<Index>::const_iterator it = edges.begin(), itEnd = edges.end();
+        it != itEnd; ++it) {
+      if (!reached[*it]) {
+        reached[*it] = true;
+        stack.push_back(*it);
+      }
+    }
+  }
+  result.clear();
+  for (Index id = 0; id < count; ++id) {
+    if (reached[id]) {
+      result.push_back(id);
+    }
+  }
+}
+
+void TargetIndex::dependencyClosure(
+    ArrayRef<Index> roots, SmallVectorImpl<Index> & result) const {
+  closure(_depends, targetCount(), roots, result);
+}
+
+void TargetIndex::dependentClosure(
+    ArrayRef<Index> roots, SmallVectorImpl<Index> & result) const {
+  closure(_dependents, targetCount(), roots, result);
+}
+
+}
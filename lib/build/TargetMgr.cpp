@@ -6,8 +6,58 @@
 
 #include "mint/support/Diagnostics.h"
 
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
 namespace mint {
 
+namespace {
+  /// Name of the file in the build root which holds cached content hashes.
+  const char HASH_CACHE_NAME[] = "hashes.cache";
+
+  /// Name of the file in the build root which holds the resources used by each target.
+  const char STATS_FILE_NAME[] = "stats.cache";
+
+  void hashCachePath(Directory * buildRoot, SmallVectorImpl<char> & result) {
+    StringRef root = buildRoot->name()->value();
+    result.assign(root.begin(), root.end());
+    path::combine(result, HASH_CACHE_NAME);
+  }
+
+  /// Name of the file in the build root which holds the input stamps of RESTAT targets.
+  const char RESTAT_FILE_NAME[] = "restat.cache";
+
+  /// First line of the RESTAT stamps file; change the number if the format changes.
+  const char RESTAT_HEADER[] = "mint-restat-stamps 1";
+
+  void statsFilePath(Directory * buildRoot, SmallVectorImpl<char> & result) {
+    StringRef root = buildRoot->name()->value();
+    result.assign(root.begin(), root.end());
+    path::combine(result, STATS_FILE_NAME);
+  }
+
+  void restatFilePath(Directory * buildRoot, SmallVectorImpl<char> & result) {
+    StringRef root = buildRoot->name()->value();
+    result.assign(root.begin(), root.end());
+    path::combine(result, RESTAT_FILE_NAME);
+  }
+
+  const int64_t NANOSECONDS = 1000000000;
+}
+
+TargetMgr::TargetMgr()
+  : _buildRoot(NULL)
+  , _restatStamps(RESTAT_HEADER)
+  , _hashesLoaded(false)
+  , _statsLoaded(false)
+  , _stampsLoaded(false)
+{}
+
 Target * TargetMgr::getTarget(Object * targetDefinition, bool create) {
   TargetMap::const_iterator it = _targets.find(targetDefinition);
   if (it != _targets.end()) {
@@ -35,6 +85,14 @@ File * TargetMgr::getFile(String * filePath) {
   return file;
 }
 
+File * TargetMgr::getFile(StringRef filePath) {
+  FileMap::const_iterator it = _files.find_as(filePath);
+  if (it != _files.end()) {
+    return it->second;
+  }
+  return getFile(String::create(filePath));
+}
+
 Directory * TargetMgr::getDirectory(String * dirPath) {
   DirectoryMap::const_iterator it = _dirs.find(dirPath);
   if (it != _dirs.end()) {
@@ -98,21 +156,243 @@ Directory * TargetMgr::setBuildRoot(StringRef buildRoot) {
 }
 
 void TargetMgr::deleteOutputFiles() {
+  TargetList targets;
   for (TargetMap::const_iterator it = _targets.begin(), itEnd = _targets.end(); it != itEnd; ++it) {
-    Target * tg = it->second;
+    targets.push_back(it->second);
+  }
+  removeOutputs(targets);
+}
+
+void TargetMgr::deleteOutputFiles(ArrayRef<Target *> roots) {
+  // Everything the roots depend on, including the producers of their source files.
+  unsigned generation = Target::newGeneration();
+  TargetList targets;
+  TargetList stack;
+  for (ArrayRef<Target *>::const_iterator it = roots.begin(), itEnd = roots.end();
+      it != itEnd; ++it) {
+    if ((*it)->markVisited(generation)) {
+      stack.push_back(*it);
+    }
+  }
+  while (!stack.empty()) {
+    Target * target = stack.back();
+    stack.pop_back();
+    targets.push_back(target);
+    for (TargetList::const_iterator ti = target->depends().begin(),
+        tiEnd = target->depends().end(); ti != tiEnd; ++ti) {
+      if ((*ti)->markVisited(generation)) {
+        stack.push_back(*ti);
+      }
+    }
+    for (FileList::const_iterator fi = target->sources().begin(),
+        fiEnd = target->sources().end(); fi != fiEnd; ++fi) {
+      const TargetList & producers = (*fi)->outputOf();
+      for (TargetList::const_iterator ti = producers.begin(), tiEnd = producers.end();
+          ti != tiEnd; ++ti) {
+        if ((*ti)->markVisited(generation)) {
+          stack.push_back(*ti);
+        }
+      }
+    }
+  }
+  removeOutputs(targets);
+}
+
+namespace {
+  /// A directory that might be left empty by cleaning, and how far down the tree it is.
+  struct PruneEntry {
+    Directory * dir;
+    unsigned depth;
+  };
+
+  /// Orders directories so that each comes before its parent.
+  struct DeepestFirst {
+    bool operator()(const PruneEntry & lhs, const PruneEntry & rhs) const {
+      return lhs.depth > rhs.depth;
+    }
+  };
+}
+
+void TargetMgr::removeOutputs(ArrayRef<Target *> targets) {
+  FileList files;
+  for (ArrayRef<Target *>::const_iterator it = targets.begin(), itEnd = targets.end();
+      it != itEnd; ++it) {
+    Target * tg = *it;
     if (!tg->isSourceOnly() && tg->state() != Target::CLEANING) {
       tg->setState(Target::CLEANING);
       for (FileList::const_iterator
           fi = tg->outputs().begin(), fiEnd = tg->outputs().end(); fi != fiEnd; ++fi) {
         File * file = *fi;
-        // TODO: Don't remove files outside of the build directory.
-        file->remove();
+        if (inBuildRoot(file->parent())) {
+          files.push_back(file);
+        } else {
+          diag::warn(tg->location()) << "Not removing " << file
+              << ", which is outside of the build directory.";
+        }
+      }
+    }
+  }
+  File::removeFiles(files);
+
+  // Try each directory that held an output, and each of its parents up to the build
+  // root, deepest first, so that a directory which has just been emptied of
+  // subdirectories is removed as well.
+  SmallVector<Directory *, 32> dirs;
+  for (FileList::const_iterator it = files.begin(), itEnd = files.end(); it != itEnd; ++it) {
+    dirs.push_back((*it)->parent());
+  }
+  std::sort(dirs.begin(), dirs.end());
+  dirs.erase(std::unique(dirs.begin(), dirs.end()), dirs.end());
+  size_t leafCount = dirs.size();
+  for (size_t i = 0; i < leafCount; ++i) {
+    for (Directory * dir = dirs[i]->parent(); dir != NULL && dir != _buildRoot;
+        dir = dir->parent()) {
+      dirs.push_back(dir);
+    }
+  }
+  std::sort(dirs.begin(), dirs.end());
+  dirs.erase(std::unique(dirs.begin(), dirs.end()), dirs.end());
+
+  SmallVector<PruneEntry, 32> prune;
+  for (SmallVectorImpl<Directory *>::const_iterator it = dirs.begin(), itEnd = dirs.end();
+      it != itEnd; ++it) {
+    if (*it != _buildRoot) {
+      PruneEntry entry = { *it, 0 };
+      for (Directory * dir = *it; dir != _buildRoot; dir = dir->parent()) {
+        ++entry.depth;
       }
-      tg->setState(Target::CLEANED);
+      prune.push_back(entry);
+    }
+  }
+  std::sort(prune.begin(), prune.end(), DeepestFirst());
+  for (SmallVectorImpl<PruneEntry>::const_iterator it = prune.begin(), itEnd = prune.end();
+      it != itEnd; ++it) {
+    it->dir->remove();
+  }
+
+  for (ArrayRef<Target *>::const_iterator it = targets.begin(), itEnd = targets.end();
+      it != itEnd; ++it) {
+    if ((*it)->state() == Target::CLEANING) {
+      (*it)->setState(Target::CLEANED);
     }
   }
 }
 
+bool TargetMgr::inBuildRoot(Directory * dir) const {
+  for (; dir != NULL; dir = dir->parent()) {
+    if (dir == _buildRoot) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TargetMgr::hashFiles(const FileList & files) {
+  if (!_hashesLoaded && _buildRoot != NULL) {
+    SmallString<128> cachePath;
+    hashCachePath(_buildRoot, cachePath);
+    _hasher.readCache(cachePath);
+    _hashesLoaded = true;
+  }
+
+  SmallVector<StringRef, 64> paths;
+  for (FileList::const_iterator it = files.begin(), itEnd = files.end(); it != itEnd; ++it) {
+    paths.push_back((*it)->name()->value());
+  }
+  SmallVector<ContentHasher::Result, 64> results;
+  bool success = _hasher.hashFiles(paths, results);
+  for (unsigned i = 0; i < files.size(); ++i) {
+    if (results[i].valid) {
+      files[i]->setContentHash(results[i].digest);
+    } else {
+      files[i]->clearContentHash();
+    }
+  }
+  return success;
+}
+
+void TargetMgr::saveContentHashes() {
+  if (_hashesLoaded) {
+    SmallString<128> cachePath;
+    hashCachePath(_buildRoot, cachePath);
+    _hasher.writeCache(cachePath);
+  }
+}
+
+BuildStats & TargetMgr::buildStats() {
+  if (!_statsLoaded && _buildRoot != NULL) {
+    SmallString<128> statsPath;
+    statsFilePath(_buildRoot, statsPath);
+    _stats.read(statsPath);
+    _statsLoaded = true;
+  }
+  return _stats;
+}
+
+void TargetMgr::saveBuildStats() {
+  if (_statsLoaded) {
+    SmallString<128> statsPath;
+    statsFilePath(_buildRoot, statsPath);
+    _stats.write(statsPath);
+  }
+}
+
+void TargetMgr::loadRestatStamps() {
+  if (!_stampsLoaded && _buildRoot != NULL) {
+    SmallString<128> restatPath;
+    restatFilePath(_buildRoot, restatPath);
+    _restatStamps.read(restatPath);
+    _stampsLoaded = true;
+  }
+}
+
+TimeStamp TargetMgr::restatStamp(File * output) {
+  loadRestatStamps();
+  _restatStamps.sort();
+  const int64_t * stamp = _restatStamps.find(output->name()->value());
+  if (stamp == NULL) {
+    return TimeStamp();
+  }
+  #if HAVE_TYPE_TIMESPEC
+    struct timespec ts;
+    ts.tv_sec = time_t(*stamp / NANOSECONDS);
+    ts.tv_nsec = long(*stamp % NANOSECONDS);
+    return TimeStamp(ts);
+  #else
+    return TimeStamp(time_t(*stamp / NANOSECONDS));
+  #endif
+}
+
+void TargetMgr::recordRestatStamp(File * output, const TimeStamp & stamp) {
+  loadRestatStamps();
+  _restatStamps.set(output->name()->value(),
+      int64_t(stamp.seconds()) * NANOSECONDS + stamp.nanoseconds());
+}
+
+void TargetMgr::saveRestatStamps() {
+  if (_stampsLoaded) {
+    SmallString<128> restatPath;
+    restatFilePath(_buildRoot, restatPath);
+    _restatStamps.write(restatPath);
+  }
+}
+
+// Each line is 'stamp path'.
+bool TargetMgr::StampFormat::parse(const char * line, int64_t & stamp, int & pathStart) {
+  long long value;
+  if (sscanf(line, "%lld %n", &value, &pathStart) != 1) {
+    return false;
+  }
+  stamp = value;
+  return true;
+}
+
+void TargetMgr::StampFormat::format(const int64_t & stamp, SmallVectorImpl<char> & out) {
+  char buffer[32];
+  int length = snprintf(buffer, sizeof(buffer), "%lld ", (long long)stamp);
+  out.append(buffer, buffer + length);
+}
+
 void TargetMgr::trace() const {
   _targets.trace();
   _files.trace();
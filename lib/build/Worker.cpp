@@ -0,0 +1,569 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#include "mint/build/Worker.h"
+
+#include "mint/support/CommandLine.h"
+#include "mint/support/Diagnostics.h"
+#include "mint/support/OStream.h"
+#include "mint/support/Path.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#if HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+namespace mint {
+
+cl::Option<StringRef> optListen("listen", cl::Group("worker"),
+    cl::Description("Address to accept build clients on, as host:port (default 127.0.0.1:7878)."));
+
+cl::Option<unsigned> optSlots("slots", cl::Group("worker"),
+    cl::Description("Number of commands to run at once (default: number of CPUs)."));
+
+cl::Option<StringRef> optCacheDir("cache-dir", cl::Group("worker"),
+    cl::Description("Directory in which to keep input files received from clients "
+        "(default: .mint-worker-cache)."));
+
+cl::Option<StringRef> optToken("token", cl::Group("worker"),
+    cl::Description("Token that clients must present before they can run commands "
+        "(default: $MINT_WORKER_TOKEN)."));
+
+/// A connected build client.
+struct Worker::Client {
+  Client(int fd) : conn(fd), authenticated(false) {}
+
+  MessageConnection conn;
+
+  /// The directory, inside the cache directory, that this client's inputs are written to.
+  SmallString<128> root;
+
+  /// True once the client has presented the right token.
+  bool authenticated;
+};
+
+/** -------------------------------------------------------------------------
+    A command being run on behalf of a client.
+ */
+class Worker::Task : public ProcessListener {
+public:
+  Task(Client * client) : client(client), process(this), started(false), finished(false) {}
+  virtual ~Task() {}
+
+  void processFinished(Process &, bool) { finished = true; }
+
+  Client * client;
+  Process process;
+  uint32_t id;
+  SmallString<128> workingDir;
+  SmallString<64> program;
+  SmallVector<SmallString<64>, 16> args;
+  SmallVector<SmallString<128>, 8> inputs;
+  SmallVector<ContentDigest, 8> hashes;
+  SmallVector<SmallString<128>, 8> stagedInputs;
+  SmallVector<SmallString<128>, 4> outputs;
+  SmallVector<ContentDigest, 8> missing;
+  bool started;
+  bool finished;
+};
+
+namespace {
+  /// True if 'path' is absolute and can't climb out of the directory it is put under.
+  bool isSafeInputPath(StringRef path) {
+    if (!path::isAbsolute(path)) {
+      return false;
+    }
+    for (size_t pos = 0; pos != StringRef::npos;) {
+      size_t end = path.find('/', pos);
+      if (path.substr(pos, end == StringRef::npos ? StringRef::npos : end - pos) == "..") {
+        return false;
+      }
+      pos = end == StringRef::npos ? end : end + 1;
+    }
+    return true;
+  }
+
+  /// Compare tokens in time that doesn't depend on where they differ.
+  bool tokensMatch(StringRef token, StringRef expected) {
+    unsigned diff = token.size() != expected.size();
+    for (size_t i = 0; i < token.size() && i < expected.size(); ++i) {
+      diff |= unsigned(token[i] ^ expected[i]);
+    }
+    return diff == 0;
+  }
+
+  /// True if the BLAKE3 digest of 'content' is 'hash'.
+  bool contentHasHash(StringRef content, const ContentDigest & hash) {
+    ContentDigest digest;
+    Blake3::hash(content.data(), content.size(), digest.bytes);
+    return digest == hash;
+  }
+
+  /// Write 'content' to 'path', creating the parent directory if needed.
+  bool writeInput(StringRef path, StringRef content) {
+    StringRef dir = path::parent(path);
+    if (!dir.empty() && !path::makeDirectoryPath(dir)) {
+      return false;
+    }
+    return path::writeFileContents(path, content);
+  }
+
+  unsigned defaultSlotCount() {
+    #if HAVE_UNISTD_H && defined(_SC_NPROCESSORS_ONLN)
+      long count = ::sysconf(_SC_NPROCESSORS_ONLN);
+      if (count > 0) {
+        return unsigned(count);
+      }
+    #endif
+    return 4;
+  }
+}
+
+Worker::Worker() : _listenFd(-1), _slots(0), _nextClientId(1) {}
+
+Worker::~Worker() {
+  for (SmallVectorImpl<Task *>::iterator it = _tasks.begin(), itEnd = _tasks.end(); it != itEnd;
+      ++it) {
+    delete *it;
+  }
+  for (SmallVectorImpl<Client *>::iterator
+      it = _clients.begin(), itEnd = _clients.end(); it != itEnd; ++it) {
+    (*it)->conn.close();
+    delete *it;
+  }
+  if (_listenFd >= 0) {
+    ::close(_listenFd);
+  }
+}
+
+int Worker::run(char ** first, char ** last) {
+  StringRef groups[] = { "worker" };
+  first = cl::Parser::parse(groups, first, last);
+  if (first != last) {
+    diag::error() << "Unexpected argument to 'worker': " << *first;
+    return -1;
+  }
+
+  StringRef address = optListen.present() ? optListen.value() : StringRef("127.0.0.1:7878");
+  _slots = optSlots.present() && optSlots.value() > 0 ? optSlots.value() : defaultSlotCount();
+  _token.assign(workerToken(optToken.value()));
+  if (_token.empty()) {
+    diag::error() << "A worker needs a token for clients to present: use --token, or set "
+        "MINT_WORKER_TOKEN.";
+    return -1;
+  }
+
+  // Commands are given paths inside the cache, so it has to be absolute.
+  path::getCurrentDir(_cacheDir);
+  path::combine(_cacheDir,
+      optCacheDir.present() ? optCacheDir.value() : StringRef(".mint-worker-cache"));
+  if (!path::makeDirectoryPath(_cacheDir)) {
+    return -1;
+  }
+
+  _listenFd = listenOnAddress(address);
+  if (_listenFd < 0) {
+    return -1;
+  }
+  // Accept without blocking, and don't leak the socket into commands.
+  int flags = ::fcntl(_listenFd, F_GETFL, 0);
+  ::fcntl(_listenFd, F_SETFL, (flags == -1 ? 0 : flags) | O_NONBLOCK);
+  ::fcntl(_listenFd, F_SETFD, FD_CLOEXEC);
+  diag::status() << "Worker listening on " << address << " with " << _slots << " slots.\n";
+
+  SmallVector<int, 16> wakeFds;
+  SmallVector<int, 16> writeFds;
+  for (;;) {
+    wakeFds.clear();
+    writeFds.clear();
+    wakeFds.push_back(_listenFd);
+    for (SmallVectorImpl<Client *>::const_iterator
+        it = _clients.begin(), itEnd = _clients.end(); it != itEnd; ++it) {
+      if ((*it)->conn.isOpen()) {
+        wakeFds.push_back((*it)->conn.fd());
+        if ((*it)->conn.hasOutput()) {
+          writeFds.push_back((*it)->conn.fd());
+        }
+      }
+    }
+    // A false result only means that a command failed, which is the client's business.
+    Process::waitForProcessEvent(wakeFds, writeFds);
+
+    acceptClients();
+    for (unsigned i = 0; i < _clients.size(); ++i) {
+      Client * client = _clients[i];
+      if (client->conn.isOpen() && !serviceClient(client)) {
+        client->conn.close();
+      }
+    }
+
+    // Report finished tasks. This is done here rather than from the process
+    // callback, so that the process is completely done with before it is deleted.
+    for (unsigned i = 0; i < _tasks.size();) {
+      Task * task = _tasks[i];
+      if (task->finished) {
+        if (task->client != NULL) {
+          sendResult(task);
+        }
+        _tasks.erase(_tasks.begin() + i);
+        delete task;
+      } else {
+        ++i;
+      }
+    }
+    startReadyTasks();
+
+    // Send what the sockets will take without blocking; the rest waits for them to
+    // become writable, so that one slow client can't hold up the others.
+    for (unsigned i = 0; i < _clients.size(); ++i) {
+      Client * client = _clients[i];
+      if (client->conn.isOpen() && client->conn.hasOutput() &&
+          !client->conn.flushOutput(false)) {
+        client->conn.close();
+      }
+    }
+
+    // Drop clients that have gone away, once none of their commands are still running.
+    for (unsigned i = 0; i < _clients.size();) {
+      Client * client = _clients[i];
+      if (client->conn.isOpen()) {
+        ++i;
+        continue;
+      }
+      for (SmallVectorImpl<Task *>::iterator
+          it = _tasks.begin(), itEnd = _tasks.end(); it != itEnd; ++it) {
+        if ((*it)->client == client) {
+          (*it)->client = NULL;
+        }
+      }
+      // Tasks that never started will never finish on their own.
+      for (unsigned j = 0; j < _tasks.size();) {
+        if (_tasks[j]->client == NULL && !_tasks[j]->started) {
+          delete _tasks[j];
+          _tasks.erase(_tasks.begin() + j);
+        } else {
+          ++j;
+        }
+      }
+      _clients.erase(_clients.begin() + i);
+      delete client;
+    }
+  }
+}
+
+void Worker::acceptClients() {
+  for (;;) {
+    int fd = ::accept(_listenFd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    Client * client = new Client(fd);
+    char name[16];
+    snprintf(name, sizeof(name), "%u", _nextClientId++);
+    client->root.assign(_cacheDir);
+    path::combine(client->root, "clients");
+    path::combine(client->root, name);
+    _clients.push_back(client);
+
+    MessageWriter hello(WORKER_HELLO);
+    hello.putInt(WORKER_PROTOCOL_VERSION);
+    hello.putInt(_slots);
+    client->conn.send(hello);
+  }
+}
+
+bool Worker::serviceClient(Client * client) {
+  bool open = client->conn.readInput();
+  WorkerMessageType type;
+  StringRef body;
+  while (client->conn.nextMessage(type, body)) {
+    if (!client->authenticated) {
+      MessageReader reader(body);
+      StringRef token;
+      if (type != WORKER_AUTH || !reader.getString(token) || !tokensMatch(token, _token)) {
+        diag::warn() << "Client did not present the worker's token, closing connection.";
+        return false;
+      }
+      client->authenticated = true;
+      continue;
+    }
+
+    bool valid = false;
+    switch (type) {
+      case WORKER_RUN:
+        valid = runRequest(client, body);
+        break;
+
+      case WORKER_BLOB:
+        valid = receiveBlob(client, body);
+        break;
+
+      default:
+        break;
+    }
+    if (!valid) {
+      diag::warn() << "Invalid message from client, closing connection.";
+      return false;
+    }
+  }
+  if (client->conn.failed()) {
+    diag::warn() << "Invalid message frame from client, closing connection.";
+    return false;
+  }
+  return open;
+}
+
+bool Worker::runRequest(Client * client, StringRef body) {
+  MessageReader reader(body);
+  Task * task = new Task(client);
+  StringRef str;
+  uint32_t count;
+
+  reader.getInt(task->id);
+  reader.getString(str);
+  task->workingDir.assign(str);
+  reader.getString(str);
+  task->program.assign(str);
+  reader.getInt(count);
+  for (uint32_t i = 0; i < count && reader.getString(str); ++i) {
+    task->args.push_back(SmallString<64>(str));
+  }
+  reader.getInt(count);
+  for (uint32_t i = 0; i < count && reader.getString(str); ++i) {
+    ContentDigest hash;
+    reader.getDigest(hash);
+    if (!isSafeInputPath(str)) {
+      delete task;
+      return false;
+    }
+    task->inputs.push_back(SmallString<128>(str));
+    task->hashes.push_back(hash);
+  }
+  reader.getInt(count);
+  for (uint32_t i = 0; i < count && reader.getString(str); ++i) {
+    task->outputs.push_back(SmallString<128>(str));
+  }
+  if (!reader.ok()) {
+    delete task;
+    return false;
+  }
+  _tasks.push_back(task);
+
+  // Work out which inputs we still need from the client. Inputs that were used by
+  // earlier commands are usually found unchanged in the hasher's cache. Those that
+  // we don't see with the client's contents are staged under the client's root.
+  SmallVector<StringRef, 16> inputPaths;
+  for (unsigned i = 0; i < task->inputs.size(); ++i) {
+    inputPaths.push_back(task->inputs[i]);
+  }
+  SmallVector<ContentHasher::Result, 16> present;
+  _hasher.hashFiles(inputPaths, present);
+  for (unsigned i = 0; i < task->inputs.size(); ++i) {
+    task->stagedInputs.push_back(SmallString<128>());
+    if (present[i].valid && present[i].digest == task->hashes[i]) {
+      continue;
+    }
+    SmallString<128> & staged = task->stagedInputs.back();
+    staged.assign(client->root);
+    path::concat(staged, StringRef(task->inputs[i]).substr(1));
+    if (!materializeInput(staged, task->hashes[i])) {
+      task->missing.push_back(task->hashes[i]);
+    }
+  }
+
+  if (!task->missing.empty()) {
+    MessageWriter need(WORKER_NEED);
+    need.putInt(task->id);
+    need.putInt(uint32_t(task->missing.size()));
+    for (SmallVectorImpl<ContentDigest>::const_iterator
+        it = task->missing.begin(), itEnd = task->missing.end(); it != itEnd; ++it) {
+      need.putDigest(*it);
+    }
+    client->conn.send(need);
+  }
+  return true;
+}
+
+bool Worker::receiveBlob(Client * client, StringRef body) {
+  MessageReader reader(body);
+  ContentDigest hash;
+  StringRef content;
+  reader.getDigest(hash);
+  reader.getString(content);
+  if (!reader.ok() || !contentHasHash(content, hash)) {
+    return false;
+  }
+
+  SmallString<128> cachePath;
+  blobPath(hash, cachePath);
+  path::writeFileContents(cachePath, content);
+
+  // Fill in this input for every task that was waiting on it.
+  for (unsigned i = 0; i < _tasks.size(); ++i) {
+    Task * task = _tasks[i];
+    if (task->client != client || task->started) {
+      continue;
+    }
+    bool wanted = false;
+    for (unsigned j = 0; j < task->missing.size();) {
+      if (task->missing[j] == hash) {
+        task->missing.erase(task->missing.begin() + j);
+        wanted = true;
+      } else {
+        ++j;
+      }
+    }
+    if (!wanted) {
+      continue;
+    }
+    for (unsigned j = 0; j < task->inputs.size(); ++j) {
+      if (task->hashes[j] == hash && !task->stagedInputs[j].empty()) {
+        writeInput(task->stagedInputs[j], content);
+      }
+    }
+  }
+  return true;
+}
+
+bool Worker::materializeInput(StringRef path, const ContentDigest & hash) {
+  SmallString<128> cachePath;
+  blobPath(hash, cachePath);
+  if (!path::test(cachePath, path::IS_FILE, true)) {
+    return false;
+  }
+  SmallString<0> content;
+  return path::readFileContents(cachePath, content) &&
+      contentHasHash(content, hash) &&
+      writeInput(path, content);
+}
+
+void Worker::startReadyTasks() {
+  unsigned running = 0;
+  for (SmallVectorImpl<Task *>::const_iterator
+      it = _tasks.begin(), itEnd = _tasks.end(); it != itEnd; ++it) {
+    if ((*it)->started && !(*it)->finished) {
+      ++running;
+    }
+  }
+  // Tasks start in the order they arrived, whichever client sent them.
+  for (unsigned i = 0; i < _tasks.size() && running < _slots; ++i) {
+    Task * task = _tasks[i];
+    if (!task->started && task->missing.empty() && task->client != NULL) {
+      startTask(task);
+      if (!task->finished) {
+        ++running;
+      }
+    }
+  }
+}
+
+void Worker::startTask(Task * task) {
+  task->started = true;
+  // Arguments that name a staged input are pointed at the staged copy.
+  SmallVector<StringRef, 32> args;
+  for (unsigned i = 0; i < task->args.size(); ++i) {
+    StringRef arg = task->args[i];
+    for (unsigned j = 0; j < task->inputs.size(); ++j) {
+      if (!task->stagedInputs[j].empty() && arg == task->inputs[j]) {
+        arg = task->stagedInputs[j];
+        break;
+      }
+    }
+    args.push_back(arg);
+  }
+  if (!path::makeDirectoryPath(task->workingDir) ||
+      !task->process.begin(task->program, args, task->workingDir)) {
+    // Report it like a command that could not be run at all.
+    if (task->client != NULL) {
+      MessageWriter result(WORKER_RESULT);
+      result.putInt(task->id);
+      result.putInt(uint32_t(-1));
+      result.putInt(0);
+      result.putInt(0);
+      task->client->conn.send(result);
+    }
+    task->client = NULL;
+    task->finished = true;
+  }
+}
+
+void Worker::sendResult(Task * task) {
+  MessageConnection & conn = task->client->conn;
+  StreamBuffer * streams[2] = { &task->process.output(), &task->process.errors() };
+  for (unsigned i = 0; i < 2; ++i) {
+    if (!streams[i]->empty()) {
+      SmallString<0> text;
+      streams[i]->copyTo(text, streams[i]->size());
+      streams[i]->clear();
+      MessageWriter output(WORKER_OUTPUT);
+      output.putInt(task->id);
+      output.putInt(i + 1);
+      output.putString(text);
+      conn.send(output);
+    }
+  }
+
+  MessageWriter result(WORKER_RESULT);
+  result.putInt(task->id);
+  result.putInt(uint32_t(task->process.exitStatus()));
+  result.putInt(task->process.signaled() ? 1 : 0);
+  result.putInt(uint32_t(task->outputs.size()));
+  for (unsigned i = 0; i < task->outputs.size(); ++i) {
+    StringRef outputPath = task->outputs[i];
+    SmallString<0> content;
+    uint32_t mode = 0;
+    bool exists = path::test(outputPath, path::IS_FILE, true) &&
+        path::readFileContents(outputPath, content);
+    #if HAVE_SYS_STAT_H
+      if (exists) {
+        SmallString<128> nativePath(outputPath);
+        nativePath.push_back('\0');
+        struct stat st;
+        if (::stat(nativePath.data(), &st) == 0) {
+          mode = uint32_t(st.st_mode & 07777);
+        }
+      }
+    #endif
+    result.putString(outputPath);
+    result.putInt(exists ? 1 : 0);
+    result.putInt(mode);
+    result.putString(content);
+  }
+  conn.send(result);
+}
+
+void Worker::blobPath(const ContentDigest & hash, SmallVectorImpl<char> & result) const {
+  SmallString<64> name;
+  hash.toHex(name);
+  result.assign(_cacheDir.begin(), _cacheDir.end());
+  path::combine(result, name);
+}
+
+}
@@ -0,0 +1,340 @@
+/* ================================================================== *
+ * Mint
+ * ================================================================== */
+
+#include "mint/build/WorkerProtocol.h"
+
+#include "mint/support/Diagnostics.h"
+#include "mint/support/OSError.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
+#if HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#endif
+
+namespace mint {
+
+// -------------------------------------------------------------------------
+// MessageWriter
+// -------------------------------------------------------------------------
+
+MessageWriter::MessageWriter(WorkerMessageType type) {
+  // Room for the frame length, which is filled in by finish().
+  _buffer.resize(4);
+  _buffer.push_back(char(type));
+}
+
+void MessageWriter::putInt(uint32_t value) {
+  char bytes[4] = {
+    char(value >> 24), char(value >> 16), char(value >> 8), char(value)
+  };
+  _buffer.append(bytes, bytes + 4);
+}
+
+void MessageWriter::putInt64(uint64_t value) {
+  putInt(uint32_t(value >> 32));
+  putInt(uint32_t(value));
+}
+
+void MessageWriter::putString(StringRef value) {
+  putInt(uint32_t(value.size()));
+  _buffer.append(value.begin(), value.end());
+}
+
+void MessageWriter::putDigest(const ContentDigest & value) {
+  const char * bytes = reinterpret_cast<const char *>(value.bytes);
+  _buffer.append(bytes, bytes + Blake3::DIGEST_SIZE);
+}
+
+StringRef MessageWriter::finish() {
+  uint32_t length = uint32_t(_buffer.size() - 4);
+  _buffer[0] = char(length >> 24);
+  _buffer[1] = char(length >> 16);
+  _buffer[2] = char(length >> 8);
+  _buffer[3] = char(length);
+  return _buffer;
+}
+
+// -------------------------------------------------------------------------
+// MessageReader
+// -------------------------------------------------------------------------
+
+bool MessageReader::require(size_t size) {
+  if (_ok && size_t(_end - _pos) < size) {
+    _ok = false;
+  }
+  return _ok;
+}
+
+bool MessageReader::getInt(uint32_t & value) {
+  if (!require(4)) {
+    value = 0;
+    return false;
+  }
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(_pos);
+  value = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+  _pos += 4;
+  return true;
+}
+
+bool MessageReader::getInt64(uint64_t & value) {
+  uint32_t hi, lo;
+  getInt(hi);
+  getInt(lo);
+  value = (uint64_t(hi) << 32) | lo;
+  return _ok;
+}
+
+bool MessageReader::getString(StringRef & value) {
+  uint32_t size;
+  if (!getInt(size) || !require(size)) {
+    value = StringRef();
+    return false;
+  }
+  value = StringRef(_pos, size);
+  _pos += size;
+  return true;
+}
+
+bool MessageReader::getDigest(ContentDigest & value) {
+  if (!require(Blake3::DIGEST_SIZE)) {
+    value = ContentDigest();
+    return false;
+  }
+  for (unsigned i = 0; i < Blake3::DIGEST_SIZE; ++i) {
+    value.bytes[i] = uint8_t(_pos[i]);
+  }
+  _pos += Blake3::DIGEST_SIZE;
+  return true;
+}
+
+// -------------------------------------------------------------------------
+// MessageConnection
+// -------------------------------------------------------------------------
+
+MessageConnection::MessageConnection(int fd)
+  : _fd(fd)
+  , _inPos(0)
+  , _outPos(0)
+  , _failed(false)
+{
+  int flags = ::fcntl(_fd, F_GETFL, 0);
+  ::fcntl(_fd, F_SETFL, (flags == -1 ? 0 : flags) | O_NONBLOCK);
+  ::fcntl(_fd, F_SETFD, FD_CLOEXEC);
+}
+
+void MessageConnection::send(MessageWriter & msg) {
+  StringRef data = msg.finish();
+  _out.append(data.begin(), data.end());
+}
+
+bool MessageConnection::flushOutput(bool wait) {
+  while (_fd >= 0 && _outPos < _out.size()) {
+    ssize_t actual = ::write(_fd, _out.data() + _outPos, _out.size() - _outPos);
+    if (actual < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        if (!wait) {
+          return true;
+        }
+        struct pollfd pfd;
+        pfd.fd = _fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        ::poll(&pfd, 1, -1);
+        continue;
+      }
+      return false;
+    }
+    _outPos += actual;
+  }
+  if (_outPos == _out.size()) {
+    _out.clear();
+    _outPos = 0;
+  }
+  return _fd >= 0;
+}
+
+bool MessageConnection::readInput() {
+  // Discard messages that have already been consumed.
+  if (_inPos > 0) {
+    _in.erase(_in.begin(), _in.begin() + _inPos);
+    _inPos = 0;
+  }
+
+  char buffer[65536];
+  for (;;) {
+    ssize_t actual = ::read(_fd, buffer, sizeof(buffer));
+    if (actual > 0) {
+      _in.append(buffer, buffer + actual);
+    } else if (actual == 0) {
+      return false;
+    } else if (errno == EINTR) {
+      continue;
+    } else {
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+  }
+}
+
+bool MessageConnection::nextMessage(WorkerMessageType & type, StringRef & body) {
+  size_t avail = _in.size() - _inPos;
+  if (_failed || avail < 4) {
+    return false;
+  }
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(_in.data() + _inPos);
+  size_t length = (size_t(p[0]) << 24) | (size_t(p[1]) << 16) | (size_t(p[2]) << 8) | p[3];
+  // Every frame has at least a type byte, and a bad length would otherwise leave us
+  // waiting for, and buffering, data that is never going to make a valid message.
+  if (length == 0 || length > WORKER_MAX_FRAME_SIZE) {
+    _failed = true;
+    return false;
+  }
+  if (avail < length + 4) {
+    return false;
+  }
+  type = WorkerMessageType(p[4]);
+  body = StringRef(_in.data() + _inPos + 5, length - 1);
+  _inPos += length + 4;
+  return true;
+}
+
+void MessageConnection::close() {
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+// -------------------------------------------------------------------------
+// Authentication
+// -------------------------------------------------------------------------
+
+StringRef workerToken(StringRef option) {
+  if (!option.empty()) {
+    return option;
+  }
+  const char * token = ::getenv("MINT_WORKER_TOKEN");
+  return token != NULL ? StringRef(token) : StringRef();
+}
+
+// -------------------------------------------------------------------------
+// Addresses
+// -------------------------------------------------------------------------
+
+namespace {
+  /// Resolve "host:port" to a list of socket addresses.
+  struct addrinfo * resolveAddress(StringRef address, bool passive) {
+    size_t colon = address.rfind(':');
+    if (colon == StringRef::npos) {
+      diag::error() << "Invalid worker address '" << address << "', expected host:port.";
+      return NULL;
+    }
+    SmallString<64> host(address.substr(0, colon));
+    SmallString<16> port(address.substr(colon + 1));
+    host.push_back('\0');
+    port.push_back('\0');
+
+    struct addrinfo hints;
+    ::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    struct addrinfo * result = NULL;
+    int status = ::getaddrinfo(host.size() > 1 ? host.data() : NULL, port.data(), &hints, &result);
+    if (status != 0) {
+      diag::error() << "Cannot resolve worker address '" << address << "': "
+          << ::gai_strerror(status);
+      return NULL;
+    }
+    return result;
+  }
+}
+
+int listenOnAddress(StringRef address) {
+  struct addrinfo * addrs = resolveAddress(address, true);
+  if (addrs == NULL) {
+    return -1;
+  }
+  int fd = -1;
+  int error = 0;
+  for (struct addrinfo * ai = addrs; ai != NULL; ai = ai->ai_next) {
+    fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) {
+      error = errno;
+      continue;
+    }
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 64) == 0) {
+      break;
+    }
+    error = errno;
+    ::close(fd);
+    fd = -1;
+  }
+  ::freeaddrinfo(addrs);
+  if (fd < 0) {
+    printPosixFileError("listening on", address, error);
+  }
+  return fd;
+}
+
+int connectToAddress(StringRef address) {
+  struct addrinfo * addrs = resolveAddress(address, false);
+  if (addrs == NULL) {
+    return -1;
+  }
+  int fd = -1;
+  int error = 0;
+  for (struct addrinfo * ai = addrs; ai != NULL; ai = ai->ai_next) {
+    fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) {
+      error = errno;
+      continue;
+    }
+    if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      // Messages are small and latency matters more than throughput.
+      int on = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      break;
+    }
+    error = errno;
+    ::close(fd);
+    fd = -1;
+  }
+  ::freeaddrinfo(addrs);
+  if (fd < 0) {
+    printPosixFileError("connecting to worker", address, error);
+  }
+  return fd;
+}
+
+}
@@ -3,19 +3,12 @@
  * ================================================================== */
 
 #include "mint/collections/StringRef.h"
+#include "mint/support/Hashing.h"
 
 namespace mint {
 
-// Simple FNV-1 hash
 unsigned StringRef::hash() const {
-  const_iterator s = begin();
-  const_iterator e = end();
-
-  unsigned hash = 2166136261;
-  while (s < e) {
-    hash = (hash ^ *s++) * 16777619;
-  }
-  return hash;
+  return ::mint::hash(begin(), end());
 }
 
 }
@@ -455,7 +455,7 @@ bool Evaluator::evalModuleContents(Module * module, Oper * content) {
           /// Create a scope to store the module by the 'as' name.
           Object * newScope = new Object(Node::NK_DICT, importOp->location(), NULL);
           String * asName = String::cast(importOp->arg(1));
-          newScope->attrs()[asName] = m;
+          newScope->setAttribute(asName, m);
           module->addImportScope(newScope);
         }
         break;
@@ -477,7 +477,7 @@ bool Evaluator::evalModuleContents(Module * module, Oper * content) {
               diag::error(symName->location()) << "Undefined symbol '" << symName << "'.";
               return NULL;
             }
-            newScope->attrs()[symName] = value;
+            newScope->setAttribute(symName, value);
           }
           module->addImportScope(newScope);
         }
@@ -574,7 +574,7 @@ bool Evaluator::setConfigVar(Node * config) {
     return false;
   }
 
-  obj->attrs()[name] = value;
+  obj->setAttribute(name, value);
   return true;
 }
 
@@ -1024,7 +1024,7 @@ Node * Evaluator::evalLetStmt(Oper * op) {
     M_ASSERT(setOp->nodeKind() == Node::NK_SET_MEMBER);
     String * attrName = String::cast(setOp->arg(0));
     Node * attrValue = eval(setOp->arg(1), NULL);
-    localScope->attrs()[attrName] = attrValue;
+    localScope->setAttribute(attrName, attrValue);
   }
   result = eval(*(op->end() - 1), NULL);
   setLexicalScope(savedScope);
@@ -1032,7 +1032,7 @@ Node * Evaluator::evalLetStmt(Oper * op) {
 }
 
 Node * Evaluator::evalTemplateForEach(Oper * op) {
-  String * loopVar = op->arg(0)->requireString();
+  String * loopVar = StringRegistry::intern(op->arg(0)->requireString());
   Node * iterableExpr = op->arg(1);
   Node * iterable = eval(iterableExpr, NULL);
   if (iterable->isUndefined()) {
@@ -1118,7 +1118,7 @@ bool Evaluator::setAttribute(Object * obj, String * attrName, Node * attrValue)
     attrValue = makeObject(static_cast<Oper *>(attrValue), attrName);
   } else if (attrValue->nodeKind() == Node::NK_MAKE_DEFERRED) {
     attrValue = createDeferred(static_cast<Oper *>(attrValue), attrDef->type(), obj);
-    obj->attrs()[attrName] = attrValue;
+    obj->setAttribute(attrName, attrValue);
     return true;
   } else {
     attrValue = eval(attrValue, attrDef->type());
@@ -1134,7 +1134,7 @@ bool Evaluator::setAttribute(Object * obj, String * attrName, Node * attrValue)
     attrValue = coercedValue;
   }
 
-  obj->attrs()[attrName] = attrValue;
+  obj->setAttribute(attrName, attrValue);
   return true;
 }
 
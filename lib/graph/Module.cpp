@@ -5,6 +5,7 @@
 #include "mint/graph/Module.h"
 #include "mint/graph/Object.h"
 
+#include "mint/intrinsic/StringRegistry.h"
 #include "mint/intrinsic/TypeRegistry.h"
 
 #include "mint/project/Project.h"
@@ -23,6 +24,7 @@ Module::Module(StringRef moduleName, Project * project)
 }
 
 void Module::setAttribute(String * name, Node * value) {
+  name = StringRegistry::intern(name);
   _attrs[name] = value;
   _keyOrder.push_back(name);
 }
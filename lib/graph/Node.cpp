@@ -174,6 +174,11 @@ bool Node::isConstant(NodeKind nk) {
   return nk >= Node::NK_CONSTANTS_FIRST && nk <= Node::NK_CONSTANTS_LAST;
 }
 
+/// Return true if this node kind is an action that mint performs itself.
+bool Node::isBuiltinAction(NodeKind nk) {
+  return nk >= Node::NK_BUILTIN_ACTIONS_FIRST && nk <= Node::NK_BUILTIN_ACTIONS_LAST;
+}
+
 OStream & operator<<(OStream & strm, Node::NodeKind nk) {
   strm << Node::kindName(nk);
   return strm;
@@ -45,6 +45,10 @@ void Object::setName(StringRef name) {
   setName(StringRegistry::str(name));
 }
 
+void Object::setAttribute(String * attrName, Node * attrValue) {
+  _attrs[StringRegistry::intern(attrName)] = attrValue;
+}
+
 AttributeDefinition * Object::defineAttribute(StringRef name, Node * value, Type * type, int flags) {
   AttributeDefinition * p = new AttributeDefinition(value, type, flags);
   _attrs[strings::str(name)] = p;
@@ -67,10 +71,11 @@ AttributeDefinition * Object::defineDynamicAttribute(
 }
 
 Node * Object::getAttributeValue(StringRef name) const {
+  HashedStringRef key(name);
   for (const Node * ob = this; ob != NULL; ob = ob->type()) {
     if (ob->nodeKind() >= Node::NK_OBJECTS_FIRST && ob->nodeKind() <= Node::NK_OBJECTS_LAST) {
       const Attributes & attrs = static_cast<const Object *>(ob)->_attrs;
-      Attributes::const_iterator it = attrs.find_as(name);
+      Attributes::const_iterator it = attrs.find_as(key);
       if (it != attrs.end()) {
         return it->second;
       }
@@ -80,10 +85,11 @@ Node * Object::getAttributeValue(StringRef name) const {
 }
 
 bool Object::getAttribute(StringRef name, AttributeLookup & result) const {
+  HashedStringRef key(name);
   for (const Node * ob = this; ob != NULL; ob = ob->type()) {
     if (ob->nodeKind() >= Node::NK_OBJECTS_FIRST && ob->nodeKind() <= Node::NK_OBJECTS_LAST) {
       const Attributes & attrs = static_cast<const Object *>(ob)->_attrs;
-      Attributes::const_iterator it = attrs.find_as(name);
+      Attributes::const_iterator it = attrs.find_as(key);
       if (it != attrs.end()) {
         Node * n = it->second;
         if (n->nodeKind() == Node::NK_ATTRDEF) {
@@ -57,6 +57,21 @@ Oper * Oper::createList(Location location, Type * type, Node * arg0, Node * arg1
   return create(Node::NK_LIST, location, type, args);
 }
 
+const char * Oper::builtinActionName(NodeKind nk) {
+  switch (nk) {
+    case NK_ACTION_ARCHIVE: return "archive";
+    case NK_ACTION_COPY: return "copy";
+    case NK_ACTION_LINK: return "link";
+    case NK_ACTION_MKDIR: return "mkdir";
+    case NK_ACTION_REMOVE: return "remove";
+    case NK_ACTION_TOUCH: return "touch";
+    case NK_ACTION_WRITE: return "write";
+    default:
+      M_ASSERT(false) << "Not a builtin action: " << nk;
+      return "";
+  }
+}
+
 Node * Oper::arg(unsigned index) const {
   M_ASSERT(index < _size);
   return _data[index];
@@ -92,6 +107,15 @@ void Oper::print(OStream & strm) const {
     strm << "fundamentals.message."
         << diag::severityMethodName(diag::Severity(arg(0)->requireInt()))
         << "(" << arg(1) << ")";
+  } else if (isBuiltinAction(nodeKind())) {
+    strm << "fundamentals.action." << builtinActionName(nodeKind()) << "(";
+    for (const_iterator it = this->begin(); it != this->end(); ++it) {
+      if (it != begin()) {
+        strm << ", ";
+      }
+      strm << *it;
+    }
+    strm << ")";
   } else if (nodeKind() == NK_LIST) {
     strm << "[";
     for (const_iterator it = this->begin(); it != this->end(); ++it) {
@@ -16,15 +16,13 @@ namespace mint {
 
 String::String(NodeKind nt, Location location, Type * ty, StringRef value)
   : Node(nt, location, ty)
+  , _hash(value.hash())
+  , _interned(false)
   , _size(value.size())
 {
   memcpy(_data, value.data(), value.size());
 }
 
-unsigned String::hash() const {
-  return value().hash();
-}
-
 String * String::create(NodeKind nt, Location location, Type * ty, StringRef value) {
   size_t size = sizeof(String) + value.size() - 1;
   return new (size) String(nt, location, ty, value);
@@ -48,7 +48,7 @@ Node * methodFileCopy(Location loc, Evaluator * ex, Function * fn, Node * self,
   M_ASSERT(args.size() == 2);
   String * source = String::cast(args[0]);
   String * output = String::cast(args[1]);
-  path::copyFile(*source, *output);
+  path::copyFile(*source, *output, path::COPY_PRESERVE_TIME);
   return &Node::UNDEFINED_NODE;
 }
 
@@ -62,8 +62,7 @@ void initFileMethods(Fundamentals * fundamentals) {
       methodFileWrite);
   file->defineMethod("remove",
       TypeRegistry::undefinedType(), TypeRegistry::stringType(), methodFileRemove);
-// TODO: Uncomment this once it's been tested.
-//  file->defineMethod("copy", "u,source:s,output:s", methodFileCopy);
+  file->defineMethod("copy", "u,source:s,output:s", methodFileCopy);
 }
 
 }
@@ -13,111 +13,179 @@
 
 #include "mint/support/Assert.h"
 #include "mint/support/Diagnostics.h"
-#include "mint/support/DirectoryIterator.h"
+#include "mint/support/DirectoryCache.h"
 #include "mint/support/OStream.h"
 #include "mint/support/Path.h"
 #include "mint/support/Wildcard.h"
 
+#include <algorithm>
+
 namespace mint {
 
-void glob(
-    Location loc, SmallVectorImpl<Node *> & dirOut, StringRef basePath, StringRef pattern,
-    bool recurseFiles = true) {
-  int dirSep = path::findSeparatorFwd(pattern, 0);
-  int nextPath = dirSep + 1;
-  if (dirSep < 0) {
-    dirSep = nextPath = pattern.size();
+/** -------------------------------------------------------------------------
+    Finds the files that match a 'glob' pattern. The pattern is split into its
+    path components, and each component that contains wildcards is compiled
+    once, before the search starts.
+ */
+class Globber {
+public:
+  Globber(Location loc, SmallVectorImpl<Node *> & out) : _loc(loc), _out(out), _filter("*") {}
+
+  ~Globber() {
+    for (Component * it = _components.begin(); it != _components.end(); ++it) {
+      delete it->matcher;
+    }
   }
 
-  StringRef leadingDirPart = pattern.substr(0, dirSep);
-  StringRef trailingDirPart = pattern.substr(nextPath);
-  if (leadingDirPart == ".") {
-    // Current directory indicator - just ignore it.
-    glob(loc, dirOut, basePath, trailingDirPart);
-  } else if (leadingDirPart == "..") {
-    // Parent directory - not allowed in pattern.
-    diag::error(loc) << "Parent directory '..' not allowed as argument to 'glob'.";
-  } else if (leadingDirPart == "**") {
-    if (!trailingDirPart.empty()) {
-      if (trailingDirPart.startsWith("**")) {
-        diag::error(loc) << "Multiple '**' wildcards are not allowed as argument to 'glob'.";
-        return;
+  /// Split 'pattern' into components. Returns false if the pattern isn't valid.
+  bool compile(StringRef pattern);
+
+  /// Leave out files whose path relative to the search directory matches 'pattern'.
+  void exclude(StringRef pattern) { _filter.exclude(pattern); }
+
+  /// Add the files under 'basePath' that match the pattern to the output list.
+  void run(StringRef basePath) {
+    _baseLength = basePath.size();
+    glob(basePath, 0);
+  }
+
+private:
+  struct Component {
+    StringRef text;
+    WildcardMatcher * matcher;
+    bool recursive;
+  };
+
+  void glob(StringRef dirPath, unsigned index);
+  void globRecursive(StringRef dirPath, unsigned index);
+  void addResult(StringRef filePath);
+
+  Location _loc;
+  SmallVectorImpl<Node *> & _out;
+  SmallVector<Component, 8> _components;
+  WildcardMatcher _filter;
+  size_t _baseLength;
+};
+
+bool Globber::compile(StringRef pattern) {
+  size_t pos = 0;
+  while (pos <= pattern.size()) {
+    int dirSep = path::findSeparatorFwd(pattern, pos);
+    size_t end = dirSep < 0 ? pattern.size() : size_t(dirSep);
+    StringRef text = pattern.substr(pos, end - pos);
+    pos = end + 1;
+    if (text.empty() || text == ".") {
+      // Current directory indicator (or a doubled separator) - just ignore it.
+      continue;
+    } else if (text == "..") {
+      // Parent directory - not allowed in pattern.
+      diag::error(_loc) << "Parent directory '..' not allowed as argument to 'glob'.";
+      return false;
+    }
+    Component comp;
+    comp.text = text;
+    comp.matcher = NULL;
+    comp.recursive = (text == "**");
+    if (comp.recursive) {
+      if (!_components.empty() && _components.back().recursive) {
+        diag::error(_loc) << "Multiple '**' wildcards are not allowed as argument to 'glob'.";
+        return false;
       }
-      DirectoryIterator di;
-      di.begin(basePath);
-      SmallString<64> newPath;
-      WildcardMatcher matcher(trailingDirPart);
-      bool isLastPiece = path::findSeparatorFwd(trailingDirPart, 0) < 0;
-      while (di.next()) {
-        StringRef name = di.entryName();
-        if (name == "." || name == "..") {
-          continue;
-        }
+    } else if (WildcardMatcher::hasWildcardChars(text)) {
+      comp.matcher = new WildcardMatcher(text);
+    }
+    _components.push_back(comp);
+  }
+  return true;
+}
+
+void Globber::glob(StringRef dirPath, unsigned index) {
+  if (index >= _components.size()) {
+    return;
+  }
+  const Component & comp = _components[index];
+  bool isLast = (index + 1 == _components.size());
+  const DirectoryListing * listing = DirectoryCache::get().list(dirPath);
+  SmallString<64> newPath;
+  if (comp.recursive) {
+    // A trailing '**' matches nothing.
+    if (!isLast) {
+      globRecursive(dirPath, index + 1);
+    }
+  } else if (comp.matcher != NULL) {
+    for (size_t i = 0, n = listing->size(); i < n; ++i) {
+      StringRef name = listing->name(i);
+      if (comp.matcher->match(name)) {
         // Combine base path with fs entry.
-        newPath.assign(basePath);
+        newPath.assign(dirPath);
         path::combine(newPath, name);
-        if (di.isDirectory()) {
-          // For directories, we try twice
-          glob(loc, dirOut, newPath, trailingDirPart);
-          glob(loc, dirOut, newPath, pattern, false);
-        } else if (isLastPiece && recurseFiles) {
-          if (matcher.match(name)) {
-            dirOut.push_back(String::create(loc, newPath));
+        if (listing->isDirectory(i)) {
+          // If it's a dir, only add if there are more pattern parts.
+          if (!isLast) {
+            glob(newPath, index + 1);
           }
+        } else if (isLast) {
+          // If it's a file, only add if there are no more pattern parts.
+          addResult(newPath);
         }
       }
-      di.finish();
     }
-  } else if (WildcardMatcher::hasWildcardChars(leadingDirPart)) {
-    //console::out() << "WC: " << basePath << "/{" << leadingDirPart << "}/" << trailingDirPart << "\n";
-    // Make sure base path is even a directory
-    if (path::test(basePath, path::IS_DIRECTORY | path::IS_SEARCHABLE, true)) {
-      WildcardMatcher matcher(leadingDirPart);
-      DirectoryIterator di;
-      di.begin(basePath);
-      SmallString<64> newPath;
-      while (di.next()) {
-        StringRef name = di.entryName();
-        if (name == "." || name == "..") {
-          continue;
-        }
-        if (matcher.match(name)) {
-          // Combine base path with fs entry.
-          newPath.assign(basePath);
-          path::combine(newPath, name);
-          if (di.isDirectory()) {
-            // If it's a dir, only add if there are more pattern parts.
-            if (!trailingDirPart.empty()) {
-              glob(loc, dirOut, newPath, trailingDirPart);
-            }
-          } else {
-            // If it's a file, only add if there are no more pattern parts.
-            if (trailingDirPart.empty()) {
-              dirOut.push_back(String::create(loc, newPath));
-            }
-          }
+  } else {
+    // The component contains no wildcards, it's a constant.
+    int i = listing->find(comp.text);
+    if (i >= 0) {
+      newPath.assign(dirPath);
+      path::combine(newPath, comp.text);
+      if (listing->isDirectory(i)) {
+        if (!isLast) {
+          glob(newPath, index + 1);
         }
+      } else if (isLast) {
+        addResult(newPath);
       }
-      di.finish();
     }
-  } else {
-    // leadingDirPart contains no wildcards, it's a constant.
-    SmallString<64> newPath(basePath);
-    path::combine(newPath, leadingDirPart);
-    if (trailingDirPart.size() == 0) {
-      // No more pattern parts - if this isn't a file, then there's no match
-      if (path::test(newPath, path::IS_FILE, true)) {
-        dirOut.push_back(String::create(loc, newPath));
-      }
-    } else {
-      // More pattern parts, which means that there's more searching to do.
-      glob(loc, dirOut, newPath, trailingDirPart);
+  }
+}
+
+/// Match the components from 'index' onward against 'dirPath' and every directory
+/// beneath it, which is what '**' means. Each directory is visited once; symbolic
+/// links are not followed, so that a link back up the tree can't cause a loop.
+void Globber::globRecursive(StringRef dirPath, unsigned index) {
+  glob(dirPath, index);
+  const DirectoryListing * listing = DirectoryCache::get().list(dirPath);
+  SmallString<64> newPath;
+  for (size_t i = 0, n = listing->size(); i < n; ++i) {
+    if (listing->isDirectory(i) && !listing->isLink(i)) {
+      newPath.assign(dirPath);
+      path::combine(newPath, listing->name(i));
+      globRecursive(newPath, index);
     }
   }
 }
 
+void Globber::addResult(StringRef filePath) {
+  if (_filter.match(filePath.substr(_baseLength + 1))) {
+    _out.push_back(String::create(_loc, filePath));
+  }
+}
+
+/// Orders the results of 'glob' by path.
+struct GlobResultLess {
+  bool operator()(Node * lhs, Node * rhs) const {
+    return static_cast<String *>(lhs)->value().compare(static_cast<String *>(rhs)->value()) < 0;
+  }
+};
+
+/// True if two results of 'glob' have the same path.
+struct GlobResultEqual {
+  bool operator()(Node * lhs, Node * rhs) const {
+    return static_cast<String *>(lhs)->value() == static_cast<String *>(rhs)->value();
+  }
+};
+
 Node * methodGlob(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
   String * pathArg = String::cast(args[0]);
+  Oper * excludeArg = args[1]->requireOper();
 
   SmallVector<Node *, 64> dirs;
   if (path::isAbsolute(pathArg->value())) {
@@ -126,19 +194,28 @@ Node * methodGlob(Location loc, Evaluator * ex, Function * fn, Node * self, Node
   } else {
     Module * m = ex->lexicalScope()->module();
     M_ASSERT(m != NULL);
-    glob(pathArg->location(), dirs, m->sourceDir(), pathArg->value());
+    Globber globber(pathArg->location(), dirs);
+    if (globber.compile(pathArg->value())) {
+      for (Oper::const_iterator it = excludeArg->begin(), itEnd = excludeArg->end(); it != itEnd;
+          ++it) {
+        globber.exclude(String::cast(*it)->value());
+      }
+      globber.run(m->sourceDir());
+    }
     if (dirs.empty()) {
       diag::warn(loc) << "No files found matching pattern.";
     }
+    // A pattern with more than one '**' can reach the same file by different routes.
+    std::sort(dirs.begin(), dirs.end(), GlobResultLess());
+    dirs.erase(std::unique(dirs.begin(), dirs.end(), GlobResultEqual()), dirs.end());
   }
 
   return Oper::createList(pathArg->location(), fn->returnType(), dirs);
 }
 
 void initDirSearchMethods(Fundamentals * fundamentals) {
-  // Function 'glob'.
-  Type * typeStringList = TypeRegistry::get().getListType(TypeRegistry::stringType());
-  fundamentals->defineMethod("glob", typeStringList, TypeRegistry::stringType(), methodGlob);
+  // Function 'glob'. Any further arguments are patterns for files to leave out.
+  fundamentals->defineMethod("glob", "[s,pattern:s,exclude:*s", methodGlob);
 }
 
 }
@@ -7,6 +7,7 @@
 #include "mint/intrinsic/Fundamentals.h"
 #include "mint/intrinsic/StringRegistry.h"
 
+#include "mint/graph/Literal.h"
 #include "mint/graph/Object.h"
 #include "mint/graph/Oper.h"
 
@@ -39,6 +40,38 @@ Node * functionCommand(Location loc, Evaluator * ex, Function * fn, Node * self,
   return Oper::create(Node::NK_ACTION_COMMAND, loc, TypeRegistry::actionType(), args);
 }
 
+Node * builtinAction(Node::NodeKind kind, Location loc, NodeArray args) {
+  return Oper::create(kind, loc, TypeRegistry::actionType(), args);
+}
+
+Node * methodActionArchive(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  return builtinAction(Node::NK_ACTION_ARCHIVE, loc, args);
+}
+
+Node * methodActionCopy(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  return builtinAction(Node::NK_ACTION_COPY, loc, args);
+}
+
+Node * methodActionLink(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  return builtinAction(Node::NK_ACTION_LINK, loc, args);
+}
+
+Node * methodActionMkdir(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  return builtinAction(Node::NK_ACTION_MKDIR, loc, args);
+}
+
+Node * methodActionRemove(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  return builtinAction(Node::NK_ACTION_REMOVE, loc, args);
+}
+
+Node * methodActionTouch(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  return builtinAction(Node::NK_ACTION_TOUCH, loc, args);
+}
+
+Node * methodActionWrite(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  return builtinAction(Node::NK_ACTION_WRITE, loc, args);
+}
+
 Node * functionMakeArglist(Location loc, Evaluator * ex, Function * fn, Node * self,
     NodeArray args) {
   M_ASSERT(args.size() == 1);
@@ -207,6 +240,11 @@ void Fundamentals::initTargetType() {
     targetType->defineAttribute("exclude_from_all", Node::boolFalse(), TypeRegistry::boolType());
     targetType->defineAttribute("source_only", Node::boolFalse(), TypeRegistry::boolType());
     targetType->defineAttribute("internal", Node::boolFalse(), TypeRegistry::boolType());
+    targetType->defineAttribute("restat", Node::boolFalse(), TypeRegistry::boolType());
+    targetType->defineAttribute("pool", &Node::UNDEFINED_NODE, TypeRegistry::objectType());
+    targetType->defineAttribute("weight",
+        new IntegerLiteral(Node::NK_INTEGER, Location(), TypeRegistry::integerType(), 1),
+        TypeRegistry::integerType());
 
     targetType->defineAttribute(
         "depends", Oper::createEmptyList(typeTargetList), typeTargetList,
@@ -245,6 +283,15 @@ void Fundamentals::initActionType() {
   setAttribute(actionType->name(), actionType);
   if (actionType->attrs().empty()) {
     //Type * typeObjectList = TypeRegistry::get().getListType(TypeRegistry::actionType());
+
+    // Actions that mint performs itself, without starting a process.
+    actionType->defineMethod("archive", "A,output:s,names:[s,sources:[s", methodActionArchive);
+    actionType->defineMethod("copy", "A,source:s,output:s", methodActionCopy);
+    actionType->defineMethod("link", "A,source:s,output:s", methodActionLink);
+    actionType->defineMethod("mkdir", "A,dir:s", methodActionMkdir);
+    actionType->defineMethod("remove", "A,path:s", methodActionRemove);
+    actionType->defineMethod("touch", "A,path:s", methodActionTouch);
+    actionType->defineMethod("write", "A,path:s,content:s", methodActionWrite);
   }
 }
 
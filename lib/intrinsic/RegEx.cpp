@@ -12,6 +12,8 @@
 #include "mint/graph/Oper.h"
 #include "mint/graph/String.h"
 
+#include "mint/collections/Table.h"
+
 #include "mint/support/Assert.h"
 #include "mint/support/Diagnostics.h"
 #include "mint/support/Path.h"
@@ -45,6 +47,52 @@ static String * getStrGroup() {
   return str;
 }
 
+/** -------------------------------------------------------------------------
+    TableKeyTraits for compiled regular expressions, keyed by their pattern.
+ */
+struct RegExKeyTraits {
+  static inline unsigned hash(const re2::RE2 * key) {
+    return StringRef(key->pattern()).hash();
+  }
+
+  static inline unsigned equals(const re2::RE2 * rl, const re2::RE2 * rr) {
+    return rl == rr || rl->pattern() == rr->pattern();
+  }
+
+  static inline unsigned hash(StringRef key) {
+    return key.hash();
+  }
+
+  static inline unsigned equals(const re2::RE2 * rl, StringRef rr) {
+    return StringRef(rl->pattern()) == rr;
+  }
+};
+
+/** -------------------------------------------------------------------------
+    Compiled regular expressions, shared by every 're.compile' call with the
+    same pattern. Templates tend to compile the same few patterns once per
+    object that uses them, and compiling is much more expensive than matching.
+    Entries live as long as the process does.
+ */
+class RegExCache {
+public:
+  /// Return the compiled form of 'pattern'. If the pattern is invalid, the
+  /// result's 'ok()' method returns false.
+  static re2::RE2 * get(StringRef pattern) {
+    static RegExTable table;
+    RegExTable::const_iterator it = table.find_as(pattern);
+    if (it != table.end()) {
+      return it->first;
+    }
+    re2::RE2 * regexp = new re2::RE2(toStringPiece(pattern));
+    table[regexp] = NULL;
+    return regexp;
+  }
+
+private:
+  typedef Table<re2::RE2, char, RegExKeyTraits> RegExTable;
+};
+
 /** -------------------------------------------------------------------------
     A regular expression object.
  */
@@ -61,35 +109,43 @@ public:
 
     int matchStart() const { return captures[0].begin() - text.begin(); }
     int matchLength() const { return captures[0].length(); }
+    int matchEnd() const { return matchStart() + matchLength(); }
   };
 
-  RegExNode(Location loc, StringRef pattern)
+  RegExNode(Location loc, re2::RE2 * regexp)
     : Node(Node::NK_REGEX, loc, getRegExType())
-    , _regexp(re2::StringPiece(pattern.data(), pattern.size()))
+    , _regexp(regexp)
   {}
 
   /// The regular expression
-  const re2::RE2 & regexp() const { return _regexp; }
-  re2::RE2 & regexp() { return _regexp; }
+  const re2::RE2 & regexp() const { return *_regexp; }
 
   /// Prepare the match state.
   void initMatchState(MatchState & ms, StringRef text) {
-    int numCaptures = _regexp.NumberOfCapturingGroups();
+    int numCaptures = _regexp->NumberOfCapturingGroups();
     ms.text = toStringPiece(text);
     ms.captures.resize(numCaptures + 1);
     ms.groups.resize(numCaptures + 1);
     ms.pos = 0;
   }
 
-  /// Match function - returns either a match object or NULL.
-  Object * match(Location loc, MatchState & ms) {
-    bool matched = _regexp.Match(
-        ms.text, ms.pos, ms.text.length(), re2::RE2::UNANCHORED, ms.captures.data(), ms.captures.size());
-
-    if (!matched) {
-      return NULL;
+  /// Find the next match, starting at 'ms.pos'. Returns false if there are no more.
+  bool search(MatchState & ms) {
+    if (ms.pos > int(ms.text.length())) {
+      return false;
     }
+    return _regexp->Match(ms.text, ms.pos, ms.text.length(), re2::RE2::UNANCHORED,
+        ms.captures.data(), ms.captures.size());
+  }
 
+  /// Move past the current match. After an empty match, the search resumes one
+  /// character further on, so that it doesn't find the same empty match again.
+  void advance(MatchState & ms) {
+    ms.pos = ms.matchLength() == 0 ? ms.matchEnd() + 1 : ms.matchEnd();
+  }
+
+  /// Create a match object for the current match.
+  Object * createMatch(Location loc, MatchState & ms) {
     Groups::iterator gi = ms.groups.begin();
     for (Captures::const_iterator it = ms.captures.begin(), itEnd = ms.captures.end(); it != itEnd; ++it) {
       *gi++ = String::create(loc, StringRef(it->data(), it->length()));
@@ -100,21 +156,140 @@ public:
     return match;
   }
 
+  /// Match function - returns either a match object or NULL.
+  Object * match(Location loc, MatchState & ms) {
+    if (!search(ms)) {
+      return NULL;
+    }
+    return createMatch(loc, ms);
+  }
+
 private:
 
-  re2::RE2 _regexp;
+  re2::RE2 * _regexp;
 };
 
+/// Return true if 'replacement' is a function to call for each match, rather than a string.
+static bool isReplacementCallable(Node * replacement) {
+  return replacement->nodeKind() == Node::NK_FUNCTION
+      || replacement->nodeKind() == Node::NK_CLOSURE;
+}
+
+/// Call the replacement function for 'match'; returns NULL if the result wasn't a string.
+static String * callReplacement(Location loc, Evaluator * ex, Node * replacement, Object * match) {
+  Node * args[] = { match };
+  Node * replacementExpr = ex->call(loc, replacement, NULL, args);
+  String * replacementStr = static_cast<String *>(ex->coerce(loc,
+      replacementExpr, TypeRegistry::stringType()));
+  if (replacementStr == NULL) {
+    return NULL;
+  } else if (replacementStr->nodeKind() != Node::NK_STRING) {
+    diag::error(replacement->location()) << "Replacement function should return a string.";
+    return NULL;
+  }
+  return replacementStr;
+}
+
+/// Convert a replacement argument to a rewrite string, checking that its '\N'
+/// references are valid for 'regexp'. Returns NULL on error.
+static String * getRewriteString(Location loc, Evaluator * ex, Node * replacement,
+    const re2::RE2 & regexp) {
+  String * replacementStr = String::dyn_cast(
+      ex->coerce(loc, replacement, TypeRegistry::stringType()));
+  if (replacementStr == NULL) {
+    diag::error(replacement->location()) << "Incorrect type for replacement string: "
+        << replacement->type();
+    return NULL;
+  }
+  std::string error;
+  if (!regexp.CheckRewriteString(toStringPiece(replacementStr->value()), &error)) {
+    diag::error(replacement->location()) << "Invalid replacement string: " << StringRef(error);
+    return NULL;
+  }
+  return replacementStr;
+}
+
 Node * methodRegExFind(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
-  M_ASSERT(args.size() == 2);
+  M_ASSERT(args.size() == 1);
   M_ASSERT(self->nodeKind() == Node::NK_REGEX);
-  return NULL;
+  RegExNode * rn = static_cast<RegExNode *>(self);
+  RegExNode::MatchState ms;
+  rn->initMatchState(ms, String::cast(args[0])->value());
+  Object * match = rn->match(loc, ms);
+  return match != NULL ? match : &Node::UNDEFINED_NODE;
+}
+
+Node * methodRegExFindAll(
+    Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  M_ASSERT(args.size() == 1);
+  M_ASSERT(self->nodeKind() == Node::NK_REGEX);
+  RegExNode * rn = static_cast<RegExNode *>(self);
+  RegExNode::MatchState ms;
+  rn->initMatchState(ms, String::cast(args[0])->value());
+  SmallVector<Node *, 16> result;
+  while (rn->search(ms)) {
+    result.push_back(String::create(loc, StringRef(ms.captures[0].data(), ms.matchLength())));
+    rn->advance(ms);
+  }
+  return Oper::createList(loc, getStrListType(), result);
+}
+
+Node * methodRegExSplit(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
+  M_ASSERT(args.size() == 1);
+  M_ASSERT(self->nodeKind() == Node::NK_REGEX);
+  RegExNode * rn = static_cast<RegExNode *>(self);
+  StringRef text = String::cast(args[0])->value();
+  RegExNode::MatchState ms;
+  rn->initMatchState(ms, text);
+  SmallVector<Node *, 16> result;
+  int pieceStart = 0;
+  while (rn->search(ms)) {
+    // Empty matches don't split the text.
+    if (ms.matchLength() != 0) {
+      result.push_back(String::create(loc, text.substr(pieceStart, ms.matchStart() - pieceStart)));
+      pieceStart = ms.matchEnd();
+    }
+    rn->advance(ms);
+  }
+  result.push_back(String::create(loc, text.substr(pieceStart)));
+  return Oper::createList(loc, getStrListType(), result);
 }
 
 Node * methodRegExSubst(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
   M_ASSERT(args.size() == 2);
   M_ASSERT(self->nodeKind() == Node::NK_REGEX);
-  return NULL;
+  RegExNode * rn = static_cast<RegExNode *>(self);
+  String * textStr = String::cast(args[0]);
+  Node * replacement = args[1];
+  StringRef text = textStr->value();
+
+  if (isReplacementCallable(replacement)) {
+    RegExNode::MatchState ms;
+    rn->initMatchState(ms, text);
+    Object * match = rn->match(loc, ms);
+    if (match == NULL) {
+      return textStr;
+    }
+    String * replacementStr = callReplacement(loc, ex, replacement, match);
+    if (replacementStr == NULL) {
+      return &Node::UNDEFINED_NODE;
+    }
+    SmallString<0> result;
+    result.append(text.substr(0, ms.matchStart()));
+    result.append(replacementStr->value());
+    result.append(text.substr(ms.matchEnd()));
+    return String::create(loc, result);
+  } else {
+    String * replacementStr = getRewriteString(loc, ex, replacement, rn->regexp());
+    if (replacementStr == NULL) {
+      return &Node::UNDEFINED_NODE;
+    }
+    std::string newText(text.data(), text.size());
+    if (!re2::RE2::Replace(&newText, rn->regexp(), toStringPiece(replacementStr->value()))) {
+      return textStr;
+    }
+    return String::create(loc, newText);
+  }
 }
 
 Node * methodRegExSubstAll(
@@ -126,73 +301,52 @@ Node * methodRegExSubstAll(
   Node * replacement = args[1];
   StringRef text = textStr->value();
 
-  if (replacement->nodeKind() == Node::NK_FUNCTION || replacement->nodeKind() == Node::NK_CLOSURE) {
-
+  if (isReplacementCallable(replacement)) {
     RegExNode::MatchState ms;
     SmallString<0> result;
     int numReplacements = 0;
+    int copyStart = 0;
     rn->initMatchState(ms, text);
 
-    for (;;) {
-      Object * match = rn->match(loc, ms);
-      if (match != NULL) {
-        int matchStart = ms.matchStart();
-        int matchEnd = matchStart + ms.matchLength();
-        Node * args[] = { match };
-        Node * replacementExpr = ex->call(loc, replacement, NULL, args);
-        String * replacementStr = static_cast<String *>(ex->coerce(loc,
-            replacementExpr, TypeRegistry::stringType()));
-        if (replacementStr == NULL) {
-          return &Node::UNDEFINED_NODE;
-        } else if (replacementStr->nodeKind() != Node::NK_STRING) {
-          diag::error(replacement->location()) << "Replacement function should return a string.";
-          return &Node::UNDEFINED_NODE;
-        }
-        result.append(text.substr(ms.pos, matchStart - ms.pos));
-        result.append(replacementStr->value());
-        ms.pos = matchEnd;
-        ++numReplacements;
-      } else {
-        result.append(text.substr(ms.pos, ms.text.length() - ms.pos));
-        if (numReplacements == 0) {
-          return textStr;
-        } else {
-          return String::create(loc, result);
-        }
+    while (rn->search(ms)) {
+      Object * match = rn->createMatch(loc, ms);
+      String * replacementStr = callReplacement(loc, ex, replacement, match);
+      if (replacementStr == NULL) {
+        return &Node::UNDEFINED_NODE;
       }
+      result.append(text.substr(copyStart, ms.matchStart() - copyStart));
+      result.append(replacementStr->value());
+      copyStart = ms.matchEnd();
+      ++numReplacements;
+      rn->advance(ms);
     }
+
+    if (numReplacements == 0) {
+      return textStr;
+    }
+    result.append(text.substr(copyStart));
+    return String::create(loc, result);
   } else {
-    String * replacementStr = String::dyn_cast(
-        ex->coerce(loc, replacement, TypeRegistry::stringType()));
+    // A plain replacement string needs no evaluation per match, so let RE2 do all
+    // of the work in one pass.
+    String * replacementStr = getRewriteString(loc, ex, replacement, rn->regexp());
     if (replacementStr == NULL) {
-      diag::error(replacement->location()) << "Incorrect type for replacement string: "
-          << replacement->type();
       return &Node::UNDEFINED_NODE;
     }
-
-    re2::StringPiece replacementText = toStringPiece(replacementStr->value());
-    std::string error;
-    if (!rn->regexp().CheckRewriteString(replacementText, &error)) {
-      diag::error(replacement->location()) << "Invalid replacement string: " << error;
-    }
-
-    std::string newText;
-    newText.assign(text.data(), text.size());
-    int numReplacements = re2::RE2::GlobalReplace(&newText, rn->regexp(), replacementText);
+    std::string newText(text.data(), text.size());
+    int numReplacements = re2::RE2::GlobalReplace(
+        &newText, rn->regexp(), toStringPiece(replacementStr->value()));
     if (numReplacements == 0) {
       return textStr;
-    } else {
-      return String::create(loc, newText);
     }
+    return String::create(loc, newText);
   }
-
-  return NULL;
 }
 
 Node * methodReCompile(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
   M_ASSERT(args.size() == 1);
   String * pattern = String::cast(args[0]);
-  RegExNode * result = new RegExNode(loc, pattern->value());
+  RegExNode * result = new RegExNode(loc, RegExCache::get(pattern->value()));
   if (!result->regexp().ok()) {
     diag::error(pattern->location()) << StringRef(result->regexp().error());
   }
@@ -206,7 +360,9 @@ void initRegExMethods(Fundamentals * fundamentals) {
   // Regular expression type
   Object * regexType = getRegExType();
   if (regexType->attrs().empty()) {
-    regexType->defineMethod("find", stringType, stringType, methodRegExFind);
+    regexType->defineMethod("find", anyType, stringType, methodRegExFind);
+    regexType->defineMethod("find_all", getStrListType(), stringType, methodRegExFindAll);
+    regexType->defineMethod("split", getStrListType(), stringType, methodRegExSplit);
     regexType->defineMethod("subst", stringType, stringType, anyType, methodRegExSubst);
     regexType->defineMethod("subst_all", stringType, stringType, anyType, methodRegExSubstAll);
   }
@@ -13,6 +13,19 @@ String * StringRegistry::makestr(StringRef in) {
     return it->first;
   }
   String * result = String::create(Node::NK_IDENT, Location(), TypeRegistry::stringType(), in);
+  result->_interned = true;
+  _strings[result] = result;
+  return result;
+}
+
+String * StringRegistry::makestr(String * in) {
+  StringDict<Node>::const_iterator it = _strings.find(in);
+  if (it != _strings.end()) {
+    return it->first;
+  }
+  String * result = String::create(
+      Node::NK_IDENT, Location(), TypeRegistry::stringType(), in->value());
+  result->_interned = true;
   _strings[result] = result;
   return result;
 }
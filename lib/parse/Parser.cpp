@@ -523,7 +523,6 @@ Node * Parser::binaryOperator() {
 
       case TOKEN_NOT: {
         next();
-        Location loc = loc;
         if (match(TOKEN_IN)) {
           opstack.pushOperator(Node::NK_NOT_IN, PREC_CONTAINS);
         } else {
@@ -3,6 +3,7 @@
  * ================================================================== */
 
 #include "mint/build/JobMgr.h"
+#include "mint/build/TargetIndex.h"
 #include "mint/build/TargetMgr.h"
 
 #include "mint/parse/Parser.h"
@@ -11,21 +12,43 @@
 #include "mint/graph/Oper.h"
 
 #include "mint/project/BuildConfiguration.h"
+#include "mint/project/GeneratorStamp.h"
 #include "mint/project/Project.h"
 #include "mint/project/ProjectWriterXml.h"
 
 #include "mint/intrinsic/Fundamentals.h"
+#include "mint/intrinsic/TypeRegistry.h"
 
 #include "mint/support/Assert.h"
+#include "mint/support/CommandLine.h"
 #include "mint/support/Diagnostics.h"
+#include "mint/support/DirectoryCache.h"
 #include "mint/support/OStream.h"
 #include "mint/support/Path.h"
 #include "mint/support/TextBuffer.h"
 
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
 namespace mint {
 
 static const char * BUILD_FILE = "build.mint";
 static const char * CONFIG_FILE = "config.mint";
+static const char * MAKEFILE_STAMP_FILE = "makefiles.stamp";
+static const char * GRAPH_INDEX_FILE = "graph.cache";
+static const char * GRAPH_STAMP_FILE = "graph.stamp";
+
+cl::Option<bool> optJson("json", cl::Group("query"),
+    cl::Description("Print the results as a JSON array of strings."));
 
 #ifdef SRCDIR_PRELUDE_PATH
 const char * SRC_PRELUDE_PATH = SRCDIR_PRELUDE_PATH;
@@ -271,6 +294,17 @@ void BuildConfiguration::generate(CStringArray cmdLineArgs) {
     diag::warn(Location()) << "Additional input parameters ignored.";
   }
 
+  // If nothing that the makefiles were generated from has changed since last time,
+  // there's no need to evaluate the project at all.
+  SmallString<128> stampPath(_buildRoot);
+  path::combine(stampPath, MAKEFILE_STAMP_FILE);
+  GeneratorStamp previousStamp;
+  if (makeFormat && previousStamp.read(stampPath) && previousStamp.isUpToDate()) {
+    diag::status() << "Makefiles are up to date.\n";
+    return;
+  }
+  DirectoryCache::get().clear();
+
   readOptions();
   if (!readConfig()) {
     exit(-1);
@@ -283,64 +317,149 @@ void BuildConfiguration::generate(CStringArray cmdLineArgs) {
       ProjectWriterXml projectWriter(console::out());
       projectWriter.writeBuildConfiguration(this);
     } else if (makeFormat) {
-      _mainProject->writeMakefiles();
+      GeneratorStamp stamp;
+      _mainProject->writeMakefiles(previousStamp, stamp);
+      if (diag::errorCount() == 0) {
+        addGeneratorInputs(stamp);
+        stamp.write(stampPath);
+      }
     }
   }
 }
 
+void BuildConfiguration::addGeneratorInputs(GeneratorStamp & stamp) {
+  SmallString<128> filePath(_buildRoot);
+  path::combine(filePath, BUILD_FILE);
+  stamp.addInput(filePath);
+  filePath.assign(_buildRoot);
+  path::combine(filePath, CONFIG_FILE);
+  stamp.addInput(filePath);
+
+  // The source of every module that was loaded, including the prelude.
+  SmallVector<Project *, 4> projects;
+  projects.push_back(_prelude);
+  for (StringDict<Project>::const_iterator it = _projects.begin(), itEnd = _projects.end();
+      it != itEnd; ++it) {
+    projects.push_back(it->second);
+  }
+  for (SmallVectorImpl<Project *>::const_iterator
+      pi = projects.begin(), piEnd = projects.end(); pi != piEnd; ++pi) {
+    for (Project::ModuleTable::const_iterator
+        mi = (*pi)->modules().begin(), miEnd = (*pi)->modules().end(); mi != miEnd; ++mi) {
+      TextBuffer * buffer = mi->second->textBuffer();
+      if (buffer != NULL && !buffer->filePath().empty()) {
+        stamp.addInput(buffer->filePath(), StringRef(buffer->buffer()));
+      }
+    }
+  }
+
+  // Every directory that was listed while evaluating, since the results of 'glob'
+  // depend on them.
+  SmallVector<const DirectoryListing *, 64> listings;
+  DirectoryCache::get().getListings(listings);
+  for (SmallVectorImpl<const DirectoryListing *>::const_iterator
+      it = listings.begin(), itEnd = listings.end(); it != itEnd; ++it) {
+    stamp.addDirectory(*it);
+  }
+}
+
 void BuildConfiguration::build(CStringArray cmdLineArgs) {
   readOptions();
   if (!readConfig()) {
     exit(-1);
   }
-  _mainProject->configure();
-  _mainProject->gatherTargets();
+
+  // If specific targets were named, only evaluate those and their dependencies,
+  // rather than every target in the project.
+  SmallVector<Object *, 8> roots;
+  for (CStringArray::const_iterator
+      it = cmdLineArgs.begin(), itEnd = cmdLineArgs.end(); it != itEnd; ++it) {
+    char * arg = *it;
+    Object * obj = _mainProject->lookupObject(arg);
+    if (obj != NULL && obj->inheritsFrom(TypeRegistry::targetType())) {
+      roots.push_back(obj);
+    } else {
+      diag::error() << "No such target: " << arg;
+    }
+  }
+  if (diag::errorCount() != 0) {
+    return;
+  }
+
+  if (roots.empty()) {
+    _mainProject->configure();
+    _mainProject->gatherTargets();
+  } else {
+    _mainProject->gatherTargets(roots);
+  }
   if (diag::errorCount() != 0) {
     return;
   }
+  // Listings from gathering the targets go out of date as soon as jobs start writing.
+  DirectoryCache::get().clear();
   GC::sweep();
   createSubdirs(_targetMgr->buildRoot());
   GC::sweep();
 
   JobMgr * jm = jobMgr();
   if (diag::errorCount() == 0) {
-    bool all = true;
-
-    for (CStringArray::const_iterator
-        it = cmdLineArgs.begin(), itEnd = cmdLineArgs.end(); it != itEnd; ++it) {
-      char * arg = *it;
-      Object * obj = _mainProject->lookupObject(arg);
-      Target * target = obj != NULL ? _targetMgr->getTarget(obj, false) : NULL;
-      if (target != NULL) {
-        jm->addReady(target);
-      } else {
-        diag::error() << "No such target: " << arg;
-      }
-      all = false;
-    }
-
-    if (all) {
+    if (roots.empty()) {
       jm->addAllReady();
+    } else {
+      for (SmallVectorImpl<Object *>::const_iterator
+          it = roots.begin(), itEnd = roots.end(); it != itEnd; ++it) {
+        jm->addReady(_targetMgr->getTarget(*it, false));
+      }
     }
   }
   if (diag::errorCount() == 0) {
     jm->run();
   }
+  _targetMgr->saveContentHashes();
+  _targetMgr->saveBuildStats();
+  _targetMgr->saveRestatStamps();
 }
 
 void BuildConfiguration::clean(CStringArray cmdLineArgs) {
-  if (!cmdLineArgs.empty()) {
-    diag::warn(Location()) << "Additional input parameters ignored.";
-  }
   readOptions();
   if (!readConfig()) {
     exit(-1);
   }
-  _mainProject->configure(); // TODO: load configuration
-  _mainProject->gatherTargets();
+
+  // As with 'build', naming targets limits cleaning to them and their dependencies.
+  SmallVector<Object *, 8> roots;
+  for (CStringArray::const_iterator
+      it = cmdLineArgs.begin(), itEnd = cmdLineArgs.end(); it != itEnd; ++it) {
+    char * arg = *it;
+    Object * obj = _mainProject->lookupObject(arg);
+    if (obj != NULL && obj->inheritsFrom(TypeRegistry::targetType())) {
+      roots.push_back(obj);
+    } else {
+      diag::error() << "No such target: " << arg;
+    }
+  }
+  if (diag::errorCount() != 0) {
+    return;
+  }
+
+  if (roots.empty()) {
+    _mainProject->configure(); // TODO: load configuration
+    _mainProject->gatherTargets();
+  } else {
+    _mainProject->gatherTargets(roots);
+  }
   GC::sweep();
   if (diag::errorCount() == 0) {
-    targetMgr()->deleteOutputFiles();
+    if (roots.empty()) {
+      targetMgr()->deleteOutputFiles();
+    } else {
+      TargetList targets;
+      for (SmallVectorImpl<Object *>::const_iterator
+          it = roots.begin(), itEnd = roots.end(); it != itEnd; ++it) {
+        targets.push_back(_targetMgr->getTarget(*it, false));
+      }
+      targetMgr()->deleteOutputFiles(targets);
+    }
   }
 }
 
@@ -372,6 +491,92 @@ void BuildConfiguration::showTargets(CStringArray cmdLineArgs) {
   }
 }
 
+namespace {
+  /// The measurements that 'mint stats' ranks targets by.
+  enum StatsKind {
+    STATS_TIME,
+    STATS_MEMORY,
+    STATS_IO
+  };
+
+  uint64_t statsValue(const ResourceUsage & usage, StatsKind kind) {
+    switch (kind) {
+      case STATS_TIME: return usage.wallTime;
+      case STATS_MEMORY: return usage.maxResident;
+      case STATS_IO: return usage.inputBlocks + usage.outputBlocks;
+    }
+    return 0;
+  }
+
+  /// Orders the targets in the build statistics from the largest value to the smallest.
+  struct StatsGreater {
+    StatsGreater(BuildStats & stats, StatsKind kind) : _stats(stats), _kind(kind) {}
+
+    bool operator()(unsigned lhs, unsigned rhs) const {
+      return statsValue(_stats.usage(lhs), _kind) > statsValue(_stats.usage(rhs), _kind);
+    }
+
+    BuildStats & _stats;
+    StatsKind _kind;
+  };
+
+  /// Print the 'count' targets with the largest values of 'kind'. Targets for which
+  /// the value wasn't measured are left out.
+  void printStatsTable(BuildStats & stats, StatsKind kind, StringRef title, unsigned count) {
+    SmallVector<unsigned, 64> order;
+    for (unsigned i = 0; i < stats.size(); ++i) {
+      if (statsValue(stats.usage(i), kind) != 0) {
+        order.push_back(i);
+      }
+    }
+    if (order.empty()) {
+      return;
+    }
+    std::stable_sort(order.begin(), order.end(), StatsGreater(stats, kind));
+    if (order.size() > count) {
+      order.resize(count);
+    }
+
+    console::out() << title << ":\n";
+    console::out() << "        wall         cpu     max rss   blocks in  blocks out  target\n";
+    char buffer[80];
+    for (unsigned * it = order.begin(); it != order.end(); ++it) {
+      const ResourceUsage & usage = stats.usage(*it);
+      snprintf(buffer, sizeof(buffer), "  %9.2fs  %9.2fs  %9.1fM  %10llu  %10llu  ",
+          usage.wallTime / 1e6, (usage.userTime + usage.systemTime) / 1e6,
+          usage.maxResident / 1024.0, (unsigned long long)usage.inputBlocks,
+          (unsigned long long)usage.outputBlocks);
+      console::out() << buffer << stats.targetPath(*it) << "\n";
+    }
+    console::out() << "\n";
+  }
+}
+
+void BuildConfiguration::showStats(CStringArray cmdLineArgs) {
+  unsigned count = 10;
+  if (!cmdLineArgs.empty()) {
+    char * end = NULL;
+    long value = ::strtol(cmdLineArgs[0], &end, 10);
+    if (*end != '\0' || value <= 0) {
+      diag::error() << "Invalid count: " << cmdLineArgs[0];
+      return;
+    }
+    count = unsigned(value);
+    if (cmdLineArgs.size() > 1) {
+      diag::warn(Location()) << "Additional input parameters ignored.";
+    }
+  }
+
+  BuildStats & stats = targetMgr()->buildStats();
+  if (stats.size() == 0) {
+    diag::status() << "No build statistics yet; they are recorded by 'mint build'.\n";
+    return;
+  }
+  printStatsTable(stats, STATS_TIME, "Slowest targets", count);
+  printStatsTable(stats, STATS_MEMORY, "Targets using the most memory", count);
+  printStatsTable(stats, STATS_IO, "Targets doing the most I/O", count);
+}
+
 void BuildConfiguration::dumpTargets(CStringArray cmdLineArgs) {
   if (!readOptions()) {
     M_ASSERT(false) << "No build configuration!";
@@ -450,4 +655,199 @@ void BuildConfiguration::trace() const {
   GC::safeMark(_jobMgr);
 }
 
+bool BuildConfiguration::loadTargetIndex(TargetIndex & index) {
+  SmallString<128> stampPath(_buildRoot);
+  path::combine(stampPath, GRAPH_STAMP_FILE);
+  SmallString<128> indexPath(_buildRoot);
+  path::combine(indexPath, GRAPH_INDEX_FILE);
+  GeneratorStamp previousStamp;
+  if (previousStamp.read(stampPath) && previousStamp.isUpToDate() && index.read(indexPath)) {
+    return true;
+  }
+
+  // Evaluate the project, and save the index, along with what it was evaluated from,
+  // for next time.
+  DirectoryCache::get().clear();
+  readOptions();
+  if (!readConfig()) {
+    exit(-1);
+  }
+  _mainProject->configure();
+  _mainProject->gatherTargets();
+  GC::sweep();
+  if (diag::errorCount() != 0) {
+    return false;
+  }
+  index.build(_targetMgr->targets());
+  SmallString<0> content;
+  index.write(content);
+  GeneratorStamp stamp;
+  if (stamp.writeOutput(indexPath, content, previousStamp)) {
+    addGeneratorInputs(stamp);
+    stamp.write(stampPath);
+  }
+  return true;
+}
+
+namespace {
+  enum QueryKind {
+    QUERY_DEPS,
+    QUERY_RDEPS,
+    QUERY_OUTPUTS,
+    QUERY_OWNER
+  };
+
+  void writeJsonString(OStream & strm, StringRef str) {
+    strm << '"';
+    for (StringRef::const_iterator it = str.begin(), itEnd = str.end(); it != itEnd; ++it) {
+      char ch = *it;
+      if (ch == '"' || ch == '\\') {
+        strm << '\\' << ch;
+      } else if ((unsigned char)ch < 0x20) {
+        char buffer[8];
+        snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned)ch);
+        strm << buffer;
+      } else {
+        strm << ch;
+      }
+    }
+    strm << '"';
+  }
+}
+
+void BuildConfiguration::query(CStringArray cmdLineArgs) {
+  CStringArray::const_iterator ai = cmdLineArgs.begin(), aiEnd = cmdLineArgs.end();
+  if (ai == aiEnd) {
+    diag::error() << "Query type missing: expected 'deps', 'rdeps', 'outputs' or 'owner'.";
+    return;
+  }
+  StringRef kindName = *ai++;
+  QueryKind kind;
+  if (kindName == "deps") {
+    kind = QUERY_DEPS;
+  } else if (kindName == "rdeps") {
+    kind = QUERY_RDEPS;
+  } else if (kindName == "outputs") {
+    kind = QUERY_OUTPUTS;
+  } else if (kindName == "owner") {
+    kind = QUERY_OWNER;
+  } else {
+    diag::error() << "Unrecognized query type: '" << kindName << "'.";
+    return;
+  }
+  if (ai == aiEnd) {
+    diag::error() << "Query '" << kindName << "' needs at least one target or file.";
+    return;
+  }
+
+  TargetIndex index;
+  if (!loadTargetIndex(index)) {
+    return;
+  }
+
+  // Each argument is a target name or, except for 'deps' and 'outputs', a file path.
+  // 'roots' are the targets whose closure is wanted, and 'targets' or 'files' collect
+  // the results.
+  typedef TargetIndex::Index Index;
+  SmallVector<Index, 16> roots;
+  SmallVector<Index, 16> targets;
+  SmallVector<Index, 16> files;
+  bool acceptFiles = kind == QUERY_RDEPS || kind == QUERY_OWNER;
+  SmallString<128> cwd;
+  path::getCurrentDir(cwd);
+  for (; ai != aiEnd; ++ai) {
+    StringRef arg = *ai;
+    Index target = kind == QUERY_OWNER ? TargetIndex::NOT_FOUND : index.findTarget(arg);
+    if (target != TargetIndex::NOT_FOUND) {
+      if (kind == QUERY_OUTPUTS) {
+        ArrayRef<Index> outputs = index.outputs(target);
+        files.append(outputs.begin(), outputs.end());
+      } else {
+        roots.push_back(target);
+      }
+      continue;
+    }
+    // A file path is relative to the current directory or, if there's no such file in
+    // the graph, to the main project's source directory.
+    Index file = TargetIndex::NOT_FOUND;
+    if (acceptFiles) {
+      SmallString<128> filePath(cwd);
+      path::combine(filePath, arg);
+      file = index.findFile(filePath);
+      if (file == TargetIndex::NOT_FOUND && !path::isAbsolute(arg)) {
+        if (_mainProject == NULL) {
+          readOptions(false);
+        }
+        if (_mainProject != NULL) {
+          filePath.assign(_mainProject->sourceRoot());
+          path::combine(filePath, arg);
+          file = index.findFile(filePath);
+        }
+      }
+    }
+    if (file == TargetIndex::NOT_FOUND) {
+      diag::error() << "No such " << (acceptFiles ? "target or file" : "target") << ": " << arg;
+      continue;
+    }
+    // A file's owner is the target that produces it or, for a source file, the targets
+    // that use it. Its reverse dependencies are the targets that use it, and everything
+    // that depends on them.
+    ArrayRef<Index> producers = index.producers(file);
+    ArrayRef<Index> consumers = index.consumers(file);
+    if (kind == QUERY_OWNER && !producers.empty()) {
+      targets.append(producers.begin(), producers.end());
+    } else {
+      targets.append(consumers.begin(), consumers.end());
+      if (kind == QUERY_RDEPS) {
+        roots.append(consumers.begin(), consumers.end());
+      }
+    }
+  }
+  if (diag::errorCount() != 0) {
+    return;
+  }
+
+  if (!roots.empty()) {
+    SmallVector<Index, 64> closure;
+    if (kind == QUERY_DEPS) {
+      index.dependencyClosure(roots, closure);
+    } else {
+      index.dependentClosure(roots, closure);
+    }
+    targets.append(closure.begin(), closure.end());
+  }
+  std::sort(targets.begin(), targets.end());
+  targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+  std::sort(files.begin(), files.end());
+  files.erase(std::unique(files.begin(), files.end()), files.end());
+
+  SmallVector<StringRef, 64> results;
+  for (SmallVectorImpl<Index>::const_iterator it = targets.begin(), itEnd = targets.end();
+      it != itEnd; ++it) {
+    results.push_back(index.targetName(*it));
+  }
+  for (SmallVectorImpl<Index>::const_iterator it = files.begin(), itEnd = files.end();
+      it != itEnd; ++it) {
+    results.push_back(index.filePath(*it));
+  }
+
+  OStream & strm = console::out();
+  if (optJson) {
+    strm << "[";
+    for (SmallVectorImpl<StringRef>::const_iterator it = results.begin(), itEnd = results.end();
+        it != itEnd; ++it) {
+      if (it != results.begin()) {
+        strm << ", ";
+      }
+      writeJsonString(strm, *it);
+    }
+    strm << "]\n";
+  } else {
+    for (SmallVectorImpl<StringRef>::const_iterator it = results.begin(), itEnd = results.end();
+        it != itEnd; ++it) {
+      strm << *it << "\n";
+    }
+  }
+}
+
 }
@@ -0,0 +1,238 @@
+/* ================================================================== *
+ * Mint: A refreshing approach to build configuration.
+ * ================================================================== */
+
+#include "mint/project/GeneratorStamp.h"
+
+#include "mint/support/DirectoryCache.h"
+#include "mint/support/OStream.h"
+#include "mint/support/Path.h"
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <algorithm>
+
+namespace mint {
+
+namespace {
+  /// First line of the stamp file; change the number if the format changes.
+  const char STAMP_HEADER[] = "mint-generator-stamp 2";
+
+  const char * KIND_NAMES[] = { "input", "dir", "output" };
+
+  /// A modification time in nanoseconds, so that a file rewritten within the same
+  /// second as it was recorded is still noticed.
+  int64_t stampTime(const TimeStamp & ts) {
+    return int64_t(ts.seconds()) * 1000000000 + ts.nanoseconds();
+  }
+}
+
+/// Orders records by kind, then by path.
+struct GeneratorStamp::RecordLess {
+  RecordLess(const char * paths) : _paths(paths) {}
+
+  bool operator()(const Record & lhs, const Record & rhs) const {
+    if (lhs.kind != rhs.kind) {
+      return lhs.kind < rhs.kind;
+    }
+    return StringRef(_paths + lhs.pathOffset, lhs.pathLength).compare(
+        StringRef(_paths + rhs.pathOffset, rhs.pathLength)) < 0;
+  }
+
+  /// Compare a record with the path of an output.
+  bool operator()(const Record & lhs, StringRef outputPath) const {
+    if (lhs.kind != OUTPUT) {
+      return lhs.kind < OUTPUT;
+    }
+    return StringRef(_paths + lhs.pathOffset, lhs.pathLength).compare(outputPath) < 0;
+  }
+
+  const char * _paths;
+};
+
+bool GeneratorStamp::read(StringRef path) {
+  _records.clear();
+  _paths.clear();
+
+  SmallString<0> content;
+  path::FileStatus st;
+  if (!path::fileStatus(path, st) || !st.exists || !path::readFileContents(path, content)) {
+    return false;
+  }
+
+  // Each line is 'kind digest size mtime path', except for the header.
+  StringRef text(content);
+  size_t pos = text.find('\n');
+  if (pos == StringRef::npos || text.substr(0, pos) != STAMP_HEADER) {
+    return false;
+  }
+  ++pos;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if (end == StringRef::npos) {
+      end = text.size();
+    }
+    SmallString<256> line(text.substr(pos, end - pos));
+    pos = end + 1;
+
+    char kindName[16];
+    char hex[2 * Blake3::DIGEST_SIZE + 1];
+    unsigned long long size;
+    long long lastModified;
+    int pathStart = 0;
+    ContentDigest digest;
+    if (sscanf(line.cstr(), "%15s %64s %llu %lld %n",
+        kindName, hex, &size, &lastModified, &pathStart) != 4 || pathStart == 0 ||
+        !digest.fromHex(hex)) {
+      _records.clear();
+      return false;
+    }
+    int kind = 0;
+    while (kind <= OUTPUT && StringRef(kindName) != KIND_NAMES[kind]) {
+      ++kind;
+    }
+    if (kind > OUTPUT) {
+      _records.clear();
+      return false;
+    }
+    add(Kind(kind), line.substr(pathStart), digest, size, lastModified);
+  }
+  return true;
+}
+
+bool GeneratorStamp::write(StringRef path) {
+  std::sort(_records.begin(), _records.end(), RecordLess(_paths.data()));
+  OStrStream strm;
+  strm << STAMP_HEADER << "\n";
+  char buffer[80];
+  SmallString<2 * Blake3::DIGEST_SIZE> hex;
+  for (const Record * rec = _records.begin(); rec != _records.end(); ++rec) {
+    hex.clear();
+    rec->digest.toHex(hex);
+    snprintf(buffer, sizeof(buffer), " %llu %lld ", (unsigned long long)rec->size,
+        (long long)rec->lastModified);
+    strm << KIND_NAMES[rec->kind] << " " << StringRef(hex) << buffer << recordPath(*rec) << "\n";
+  }
+  return path::writeFileContents(path, strm.str());
+}
+
+bool GeneratorStamp::isUpToDate() const {
+  bool hasOutputs = false;
+  SmallString<0> content;
+  for (const Record * rec = _records.begin(); rec != _records.end(); ++rec) {
+    StringRef recPath = recordPath(*rec);
+    switch (rec->kind) {
+      case INPUT:
+        if (!path::readFileContents(recPath, content) || contentDigest(content) != rec->digest) {
+          return false;
+        }
+        break;
+
+      case DIRECTORY:
+        if (listingDigest(DirectoryCache::get().list(recPath)) != rec->digest) {
+          return false;
+        }
+        break;
+
+      case OUTPUT: {
+        path::FileStatus st;
+        if (!path::fileStatus(recPath, st) || !st.exists || st.size != rec->size ||
+            stampTime(st.lastModified) != rec->lastModified) {
+          return false;
+        }
+        hasOutputs = true;
+        break;
+      }
+    }
+  }
+  return hasOutputs;
+}
+
+void GeneratorStamp::addInput(StringRef path, StringRef contents) {
+  add(INPUT, path, contentDigest(contents));
+}
+
+void GeneratorStamp::addInput(StringRef path) {
+  SmallString<0> content;
+  if (path::readFileContents(path, content)) {
+    addInput(path, content);
+  }
+}
+
+void GeneratorStamp::addDirectory(const DirectoryListing * listing) {
+  add(DIRECTORY, listing->path(), listingDigest(listing));
+}
+
+bool GeneratorStamp::writeOutput(
+    StringRef path, StringRef contents, const GeneratorStamp & previous) {
+  ContentDigest digest = contentDigest(contents);
+  const Record * prev = previous.findOutput(path);
+  path::FileStatus st;
+  path::fileStatus(path, st);
+  if (prev == NULL) {
+    // We don't know what's in the file, so compare the contents the slow way.
+    if (!path::writeFileContentsIfDifferent(path, contents)) {
+      return false;
+    }
+    path::fileStatus(path, st);
+  } else if (prev->digest != digest || !st.exists || st.size != prev->size ||
+      stampTime(st.lastModified) != prev->lastModified) {
+    // Either the contents are different, or someone has changed the file since.
+    if (!path::writeFileContents(path, contents)) {
+      return false;
+    }
+    path::fileStatus(path, st);
+  }
+  add(OUTPUT, path, digest, st.size, stampTime(st.lastModified));
+  return true;
+}
+
+void GeneratorStamp::add(Kind kind, StringRef path, const ContentDigest & digest,
+    uint64_t size, int64_t lastModified) {
+  Record rec;
+  rec.kind = kind;
+  rec.digest = digest;
+  rec.size = size;
+  rec.lastModified = lastModified;
+  rec.pathOffset = _paths.size();
+  rec.pathLength = path.size();
+  _paths.append(path);
+  _records.push_back(rec);
+}
+
+const GeneratorStamp::Record * GeneratorStamp::findOutput(StringRef path) const {
+  // Records are sorted when the stamp is written, so a stamp that was read in is sorted.
+  const Record * it = std::lower_bound(
+      _records.begin(), _records.end(), path, RecordLess(_paths.data()));
+  if (it != _records.end() && it->kind == OUTPUT && recordPath(*it) == path) {
+    return it;
+  }
+  return NULL;
+}
+
+ContentDigest GeneratorStamp::contentDigest(StringRef contents) {
+  ContentDigest digest;
+  Blake3::hash(contents.data(), contents.size(), digest.bytes);
+  return digest;
+}
+
+ContentDigest GeneratorStamp::listingDigest(const DirectoryListing * listing) {
+  // A missing directory is all zeros, which no listing's digest will be.
+  if (!listing->exists()) {
+    return ContentDigest();
+  }
+  SmallString<0> buffer;
+  for (size_t i = 0, n = listing->size(); i < n; ++i) {
+    buffer.append(listing->name(i));
+    buffer.push_back(listing->isDirectory(i) ? '/' : '\0');
+  }
+  return contentDigest(buffer);
+}
+
+}
@@ -2,6 +2,7 @@
  * Mint: A refreshing approach to build configuration.
  * ================================================================== */
 
+#include "mint/build/BuiltinAction.h"
 #include "mint/build/Target.h"
 #include "mint/build/TargetMgr.h"
 
@@ -162,16 +163,18 @@ void MakefileGenerator::writeModule() {
     }
     _strm << "\n\n";
   }
-
-  path::writeFileContentsIfDifferent(_outputPath, _strm.str());
 }
 
 void MakefileGenerator::writeTarget(Target * target) {
   Object * targetObj = target->definition();
 
-  // Temporarily change the 'implicit_sources' variable to the makefile syntax for the
-  // dependent files in this makefile.
-  targetObj->attrs()[String::create("implicit_sources")] =
+  // The actions are evaluated on an object derived from the target, which changes the
+  // 'implicit_sources' variable to the makefile syntax for the dependent files in this
+  // makefile. This leaves the target itself unchanged.
+  Object * actionScope = new Object(targetObj->location(), targetObj);
+  actionScope->setParentScope(targetObj->parentScope());
+  actionScope->setName(targetObj->name());
+  actionScope->attrs()[String::create("implicit_sources")] =
       Oper::createList(
           Location(), TypeRegistry::stringListType(), String::create(Location(), "$^"));
 
@@ -247,8 +250,8 @@ void MakefileGenerator::writeTarget(Target * target) {
 
   // Write out the actions
   SmallVector<String *, 16> inputArgs;
-  Evaluator eval(targetObj);
-  Oper * actions = eval.attributeValueAsList(targetObj, "actions");
+  Evaluator eval(actionScope);
+  Oper * actions = eval.attributeValueAsList(actionScope, "actions");
   if (actions != NULL) {
     for (Oper::const_iterator
         ai = actions->begin(), aiEnd = actions->end(); ai != aiEnd; ++ai) {
@@ -304,6 +307,17 @@ void MakefileGenerator::writeAction(Oper * action) {
     // TODO: Quoting
     // TODO: ANSI colors?
     _strm << "\n\t@echo \"" << msg << "\"";
+  } else if (Node::isBuiltinAction(action->nodeKind())) {
+    SmallString<128> commandLine;
+    formatBuiltinAction(action, commandLine);
+    _strm << "\n\t@";
+    // Make would expand variable references in the text.
+    for (const char * ch = commandLine.begin(); ch != commandLine.end(); ++ch) {
+      if (*ch == '$') {
+        _strm << '$';
+      }
+      _strm << *ch;
+    }
   } else {
     action->dump();
     M_ASSERT(false) << "Unsupported action type for makefile generator!";
@@ -15,6 +15,7 @@
 
 #include "mint/project/BuildConfiguration.h"
 #include "mint/project/Configurator.h"
+#include "mint/project/GeneratorStamp.h"
 #include "mint/project/MakefileGenerator.h"
 #include "mint/project/OptionFinder.h"
 #include "mint/project/Project.h"
@@ -385,6 +386,21 @@ void Project::gatherTargets() {
   }
 }
 
+void Project::gatherTargets(ArrayRef<Object *> roots) {
+  M_ASSERT(_mainModule != NULL) << "No main module defined for project " << _buildRoot;
+  TargetMgr * targetMgr = _buildConfig->targetMgr();
+  targetMgr->addRootDirectory(_sourceRoot->value());
+  TargetFinder finder(targetMgr, this, true);
+  for (ArrayRef<Object *>::const_iterator it = roots.begin(), itEnd = roots.end(); it != itEnd;
+      ++it) {
+    finder.visitObject(*it);
+  }
+  if (diag::errorCount() > 0) {
+    return;
+  }
+  GC::sweep();
+}
+
 void Project::writeOptions(GraphWriter & writer) const {
   // TODO: Need to escape this string.
   writer.strm() << "project '" << sourceRoot() << "' {\n";
@@ -413,11 +429,12 @@ void Project::writeConfig(GraphWriter & writer) const {
   writer.strm() << "}\n";
 }
 
-void Project::writeMakefiles() const {
+void Project::writeMakefiles(const GeneratorStamp & previous, GeneratorStamp & stamp) const {
   SmallString<128> makefilePath(_mainModule->buildDir());
   path::combine(makefilePath, "Makefile");
   MakefileGenerator gen(makefilePath, _mainModule, _buildConfig->targetMgr());
   gen.writeModule();
+  stamp.writeOutput(makefilePath, gen.contents(), previous);
   for (ModuleLoader::ModuleTable::const_iterator
       mi = _modules.modules().begin(), miEnd = _modules.modules().end(); mi != miEnd; ++mi) {
     Module * m = mi->second;
@@ -426,6 +443,7 @@ void Project::writeMakefiles() const {
       path::combine(makefilePath, "Makefile");
       MakefileGenerator mgen(makefilePath, m, _buildConfig->targetMgr());
       mgen.writeModule();
+      stamp.writeOutput(makefilePath, mgen.contents(), previous);
     }
   }
 }
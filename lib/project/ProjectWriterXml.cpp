@@ -296,6 +296,25 @@ bool ProjectWriterXml::writeValue(Node * node, bool isDefinition) {
       break;
     }
 
+    case Node::NK_ACTION_ARCHIVE:
+    case Node::NK_ACTION_COPY:
+    case Node::NK_ACTION_LINK:
+    case Node::NK_ACTION_MKDIR:
+    case Node::NK_ACTION_REMOVE:
+    case Node::NK_ACTION_TOUCH:
+    case Node::NK_ACTION_WRITE: {
+      Oper * op = static_cast<Oper *>(node);
+      _strm << "fundamentals.action." << Oper::builtinActionName(op->nodeKind()) << "(";
+      for (Oper::const_iterator it = op->begin(), itEnd = op->end(); it != itEnd; ++it) {
+        if (it != op->begin()) {
+          _strm << ",";
+        }
+        writeValue(*it);
+      }
+      _strm << ")";
+      break;
+    }
+
     default:
       console::err() << "Invalid node type for writing: " << node->nodeKind() << "\n";
       console::err() << "Node value is: " << node << "\n";
@@ -0,0 +1,408 @@
+/* ================================================================== *
+ * Mint: A refreshing approach to build configuration.
+ * ================================================================== */
+
+#include "mint/support/Blake3.h"
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mint {
+
+namespace {
+  const uint32_t IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+  };
+
+  /// The message words used by each round; each row is the previous one permuted.
+  const unsigned char SCHEDULE[7][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    {  2,  6,  3, 10,  7,  0,  4, 13,  1, 11, 12,  5,  9, 14, 15,  8 },
+    {  3,  4, 10, 12, 13,  2,  7, 14,  6,  5,  9,  0, 11, 15,  8,  1 },
+    { 10,  7, 12,  9, 14,  3, 13, 15,  4,  0, 11,  2,  5,  8,  1,  6 },
+    { 12, 13,  9, 11, 15, 10, 14,  8,  7,  2,  5,  3,  0,  1,  6,  4 },
+    {  9, 14, 11,  5,  8, 12, 15,  1, 13,  3,  0, 10,  2,  6,  4,  7 },
+    { 11, 15,  5,  0,  1,  9,  8,  6, 14, 10,  2, 12,  3,  4,  7, 13 }
+  };
+
+  enum Flags {
+    CHUNK_START = (1<<0),
+    CHUNK_END = (1<<1),
+    PARENT = (1<<2),
+    ROOT = (1<<3)
+  };
+
+  inline uint32_t loadWord(const uint8_t * p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+        (uint32_t(p[3]) << 24);
+  }
+
+  inline void storeWord(uint8_t * p, uint32_t w) {
+    p[0] = uint8_t(w);
+    p[1] = uint8_t(w >> 8);
+    p[2] = uint8_t(w >> 16);
+    p[3] = uint8_t(w >> 24);
+  }
+
+  inline void loadBlock(const uint8_t * p, uint32_t m[16]) {
+    for (unsigned i = 0; i < 16; ++i) {
+      m[i] = loadWord(p + i * 4);
+    }
+  }
+
+  inline uint32_t rotr(uint32_t w, unsigned n) {
+    return (w >> n) | (w << (32 - n));
+  }
+
+  inline void g(uint32_t * v, unsigned a, unsigned b, unsigned c, unsigned d,
+      uint32_t x, uint32_t y) {
+    v[a] = v[a] + v[b] + x;
+    v[d] = rotr(v[d] ^ v[a], 16);
+    v[c] = v[c] + v[d];
+    v[b] = rotr(v[b] ^ v[c], 12);
+    v[a] = v[a] + v[b] + y;
+    v[d] = rotr(v[d] ^ v[a], 8);
+    v[c] = v[c] + v[d];
+    v[b] = rotr(v[b] ^ v[c], 7);
+  }
+
+  /// The compression function, leaving the full 16-word state in 'out'.
+  void compress(const uint32_t cv[8], const uint32_t m[16], uint64_t counter,
+      uint32_t blockLength, uint32_t flags, uint32_t out[16]) {
+    uint32_t v[16] = {
+      cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+      IV[0], IV[1], IV[2], IV[3],
+      uint32_t(counter), uint32_t(counter >> 32), blockLength, flags
+    };
+    for (unsigned r = 0; r < 7; ++r) {
+      const unsigned char * s = SCHEDULE[r];
+      g(v, 0, 4,  8, 12, m[s[0]], m[s[1]]);
+      g(v, 1, 5,  9, 13, m[s[2]], m[s[3]]);
+      g(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+      g(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+      g(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+      g(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+      g(v, 2, 7,  8, 13, m[s[12]], m[s[13]]);
+      g(v, 3, 4,  9, 14, m[s[14]], m[s[15]]);
+    }
+    for (unsigned i = 0; i < 8; ++i) {
+      out[i] = v[i] ^ v[i + 8];
+      out[i + 8] = v[i + 8] ^ cv[i];
+    }
+  }
+
+  /// Compress a block in place into the chaining value 'cv'.
+  void compressInPlace(uint32_t cv[8], const uint32_t m[16], uint64_t counter,
+      uint32_t blockLength, uint32_t flags) {
+    uint32_t out[16];
+    compress(cv, m, counter, blockLength, flags, out);
+    memcpy(cv, out, 8 * sizeof(uint32_t));
+  }
+
+  /// Compute the chaining value of a parent node from those of its children.
+  void parentValue(const uint32_t left[8], const uint32_t right[8], uint32_t out[8]) {
+    uint32_t m[16];
+    memcpy(m, left, 8 * sizeof(uint32_t));
+    memcpy(m + 8, right, 8 * sizeof(uint32_t));
+    uint32_t cv[8];
+    memcpy(cv, IV, sizeof(cv));
+    compressInPlace(cv, m, 0, Blake3::BLOCK_SIZE, PARENT);
+    memcpy(out, cv, sizeof(cv));
+  }
+
+  /// The last compression of a node, which is deferred until we know whether the node
+  /// is the root.
+  struct Output {
+    uint32_t cv[8];
+    uint32_t block[16];
+    uint64_t counter;
+    uint32_t blockLength;
+    uint32_t flags;
+
+    void chainingValue(uint32_t out[8]) const {
+      uint32_t state[16];
+      compress(cv, block, counter, blockLength, flags, state);
+      memcpy(out, state, 8 * sizeof(uint32_t));
+    }
+
+    void rootDigest(uint8_t out[Blake3::DIGEST_SIZE]) const {
+      uint32_t state[16];
+      compress(cv, block, 0, blockLength, flags | ROOT, state);
+      for (unsigned i = 0; i < 8; ++i) {
+        storeWord(out + i * 4, state[i]);
+      }
+    }
+  };
+
+#if defined(__SSE2__)
+  /// Four 32-bit words, one from each of four independent hash states.
+  typedef __m128i Lanes;
+
+  inline Lanes add(Lanes a, Lanes b) { return _mm_add_epi32(a, b); }
+  inline Lanes xorLanes(Lanes a, Lanes b) { return _mm_xor_si128(a, b); }
+  inline Lanes splat(uint32_t w) { return _mm_set1_epi32(int(w)); }
+  inline Lanes lanes(uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3) {
+    return _mm_setr_epi32(int(w0), int(w1), int(w2), int(w3));
+  }
+  template<int N> inline Lanes rotrLanes(Lanes x) {
+    return _mm_or_si128(_mm_srli_epi32(x, N), _mm_slli_epi32(x, 32 - N));
+  }
+
+  /// Transpose a 4x4 matrix of words, so that rows become lanes and vice versa.
+  inline void transpose(Lanes & r0, Lanes & r1, Lanes & r2, Lanes & r3) {
+    Lanes t0 = _mm_unpacklo_epi32(r0, r1);
+    Lanes t1 = _mm_unpacklo_epi32(r2, r3);
+    Lanes t2 = _mm_unpackhi_epi32(r0, r1);
+    Lanes t3 = _mm_unpackhi_epi32(r2, r3);
+    r0 = _mm_unpacklo_epi64(t0, t1);
+    r1 = _mm_unpackhi_epi64(t0, t1);
+    r2 = _mm_unpacklo_epi64(t2, t3);
+    r3 = _mm_unpackhi_epi64(t2, t3);
+  }
+
+  /// Load message word 'i' of block 'offset' from each of the four chunks at 'input'.
+  /// x86 is little-endian, so the words can be loaded directly.
+  void loadLanes(const uint8_t * input, size_t offset, Lanes m[16]) {
+    for (unsigned i = 0; i < 16; i += 4) {
+      for (unsigned c = 0; c < 4; ++c) {
+        m[i + c] = _mm_loadu_si128(
+            reinterpret_cast<const Lanes *>(input + c * Blake3::CHUNK_SIZE + offset + i * 4));
+      }
+      transpose(m[i], m[i + 1], m[i + 2], m[i + 3]);
+    }
+  }
+
+  void storeLanes(const Lanes cv[8], uint32_t out[4][8]) {
+    Lanes lo[4] = { cv[0], cv[1], cv[2], cv[3] };
+    Lanes hi[4] = { cv[4], cv[5], cv[6], cv[7] };
+    transpose(lo[0], lo[1], lo[2], lo[3]);
+    transpose(hi[0], hi[1], hi[2], hi[3]);
+    for (unsigned c = 0; c < 4; ++c) {
+      _mm_storeu_si128(reinterpret_cast<Lanes *>(out[c]), lo[c]);
+      _mm_storeu_si128(reinterpret_cast<Lanes *>(out[c] + 4), hi[c]);
+    }
+  }
+#else
+  /// Four 32-bit words, one from each of four independent hash states.
+  struct Lanes {
+    uint32_t w[4];
+  };
+
+  inline Lanes add(Lanes a, Lanes b) {
+    for (unsigned i = 0; i < 4; ++i) { a.w[i] += b.w[i]; }
+    return a;
+  }
+  inline Lanes xorLanes(Lanes a, Lanes b) {
+    for (unsigned i = 0; i < 4; ++i) { a.w[i] ^= b.w[i]; }
+    return a;
+  }
+  inline Lanes lanes(uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3) {
+    Lanes result = {{ w0, w1, w2, w3 }};
+    return result;
+  }
+  inline Lanes splat(uint32_t w) { return lanes(w, w, w, w); }
+  template<int N> inline Lanes rotrLanes(Lanes x) {
+    for (unsigned i = 0; i < 4; ++i) { x.w[i] = rotr(x.w[i], N); }
+    return x;
+  }
+
+  void loadLanes(const uint8_t * input, size_t offset, Lanes m[16]) {
+    for (unsigned i = 0; i < 16; ++i) {
+      for (unsigned c = 0; c < 4; ++c) {
+        m[i].w[c] = loadWord(input + c * Blake3::CHUNK_SIZE + offset + i * 4);
+      }
+    }
+  }
+
+  void storeLanes(const Lanes cv[8], uint32_t out[4][8]) {
+    for (unsigned i = 0; i < 8; ++i) {
+      for (unsigned c = 0; c < 4; ++c) {
+        out[c][i] = cv[i].w[c];
+      }
+    }
+  }
+#endif
+
+  inline void gLanes(Lanes * v, unsigned a, unsigned b, unsigned c, unsigned d,
+      Lanes x, Lanes y) {
+    v[a] = add(add(v[a], v[b]), x);
+    v[d] = rotrLanes<16>(xorLanes(v[d], v[a]));
+    v[c] = add(v[c], v[d]);
+    v[b] = rotrLanes<12>(xorLanes(v[b], v[c]));
+    v[a] = add(add(v[a], v[b]), y);
+    v[d] = rotrLanes<8>(xorLanes(v[d], v[a]));
+    v[c] = add(v[c], v[d]);
+    v[b] = rotrLanes<7>(xorLanes(v[b], v[c]));
+  }
+
+  /// Hash four complete, consecutive chunks, the first of which is chunk 'counter',
+  /// writing their chaining values to 'out'. None of them may be the root.
+  void hashFourChunks(const uint8_t * input, uint64_t counter, uint32_t out[4][8]) {
+    Lanes cv[8];
+    for (unsigned i = 0; i < 8; ++i) {
+      cv[i] = splat(IV[i]);
+    }
+    Lanes counterLow = lanes(
+        uint32_t(counter), uint32_t(counter + 1), uint32_t(counter + 2), uint32_t(counter + 3));
+    Lanes counterHigh = lanes(uint32_t((counter) >> 32), uint32_t((counter + 1) >> 32),
+        uint32_t((counter + 2) >> 32), uint32_t((counter + 3) >> 32));
+    Lanes blockLength = splat(Blake3::BLOCK_SIZE);
+    for (size_t offset = 0; offset < Blake3::CHUNK_SIZE; offset += Blake3::BLOCK_SIZE) {
+      uint32_t flags = 0;
+      if (offset == 0) {
+        flags |= CHUNK_START;
+      }
+      if (offset + Blake3::BLOCK_SIZE == Blake3::CHUNK_SIZE) {
+        flags |= CHUNK_END;
+      }
+      Lanes m[16];
+      loadLanes(input, offset, m);
+      Lanes v[16] = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        splat(IV[0]), splat(IV[1]), splat(IV[2]), splat(IV[3]),
+        counterLow, counterHigh, blockLength, splat(flags)
+      };
+      for (unsigned r = 0; r < 7; ++r) {
+        const unsigned char * s = SCHEDULE[r];
+        gLanes(v, 0, 4,  8, 12, m[s[0]], m[s[1]]);
+        gLanes(v, 1, 5,  9, 13, m[s[2]], m[s[3]]);
+        gLanes(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        gLanes(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        gLanes(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        gLanes(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        gLanes(v, 2, 7,  8, 13, m[s[12]], m[s[13]]);
+        gLanes(v, 3, 4,  9, 14, m[s[14]], m[s[15]]);
+      }
+      for (unsigned i = 0; i < 8; ++i) {
+        cv[i] = xorLanes(v[i], v[i + 8]);
+      }
+    }
+    storeLanes(cv, out);
+  }
+}
+
+Blake3::Blake3()
+  : _chunkCounter(0)
+  , _blockLength(0)
+  , _blocksCompressed(0)
+  , _stackSize(0)
+{
+  memcpy(_chunkValue, IV, sizeof(_chunkValue));
+  memset(_block, 0, sizeof(_block));
+}
+
+void Blake3::update(const char * data, size_t size) {
+  while (size > 0) {
+    // The current chunk can't be the last one if there is more input, so finish it.
+    if (chunkLength() == CHUNK_SIZE) {
+      finishChunk();
+    }
+
+    // Hash whole chunks four at a time, as long as there is input after them.
+    if (chunkLength() == 0) {
+      while (size > 4 * CHUNK_SIZE) {
+        uint32_t values[4][8];
+        hashFourChunks(reinterpret_cast<const uint8_t *>(data), _chunkCounter, values);
+        for (unsigned i = 0; i < 4; ++i) {
+          pushChunkValue(values[i], _chunkCounter + i + 1);
+        }
+        _chunkCounter += 4;
+        data += 4 * CHUNK_SIZE;
+        size -= 4 * CHUNK_SIZE;
+      }
+    }
+
+    size_t take = CHUNK_SIZE - chunkLength();
+    if (take > size) {
+      take = size;
+    }
+    updateChunk(data, take);
+    data += take;
+    size -= take;
+  }
+}
+
+void Blake3::updateChunk(const char * data, size_t size) {
+  while (size > 0) {
+    if (_blockLength == BLOCK_SIZE) {
+      uint32_t m[16];
+      loadBlock(_block, m);
+      compressInPlace(_chunkValue, m, _chunkCounter, BLOCK_SIZE,
+          _blocksCompressed == 0 ? CHUNK_START : 0);
+      ++_blocksCompressed;
+      _blockLength = 0;
+      memset(_block, 0, sizeof(_block));
+    }
+    size_t take = BLOCK_SIZE - _blockLength;
+    if (take > size) {
+      take = size;
+    }
+    memcpy(_block + _blockLength, data, take);
+    _blockLength += unsigned(take);
+    data += take;
+    size -= take;
+  }
+}
+
+void Blake3::finishChunk() {
+  uint32_t m[16];
+  loadBlock(_block, m);
+  compressInPlace(_chunkValue, m, _chunkCounter, _blockLength,
+      (_blocksCompressed == 0 ? CHUNK_START : 0) | CHUNK_END);
+  pushChunkValue(_chunkValue, _chunkCounter + 1);
+  ++_chunkCounter;
+  memcpy(_chunkValue, IV, sizeof(_chunkValue));
+  memset(_block, 0, sizeof(_block));
+  _blockLength = 0;
+  _blocksCompressed = 0;
+}
+
+void Blake3::pushChunkValue(const uint32_t cv[8], uint64_t totalChunks) {
+  // Each trailing zero bit in the chunk count means a subtree has been completed,
+  // so its two halves can be merged.
+  uint32_t value[8];
+  memcpy(value, cv, sizeof(value));
+  while ((totalChunks & 1) == 0) {
+    --_stackSize;
+    parentValue(_stack[_stackSize], value, value);
+    totalChunks >>= 1;
+  }
+  memcpy(_stack[_stackSize], value, sizeof(value));
+  ++_stackSize;
+}
+
+void Blake3::finalize(uint8_t out[DIGEST_SIZE]) const {
+  Output output;
+  memcpy(output.cv, _chunkValue, sizeof(output.cv));
+  loadBlock(_block, output.block);
+  output.counter = _chunkCounter;
+  output.blockLength = _blockLength;
+  output.flags = (_blocksCompressed == 0 ? CHUNK_START : 0) | CHUNK_END;
+
+  // Merge the unfinished subtrees from right to left.
+  for (unsigned i = _stackSize; i > 0; --i) {
+    uint32_t right[8];
+    output.chainingValue(right);
+    memcpy(output.cv, IV, sizeof(output.cv));
+    memcpy(output.block, _stack[i - 1], 8 * sizeof(uint32_t));
+    memcpy(output.block + 8, right, 8 * sizeof(uint32_t));
+    output.counter = 0;
+    output.blockLength = BLOCK_SIZE;
+    output.flags = PARENT;
+  }
+  output.rootDigest(out);
+}
+
+void Blake3::hash(const char * data, size_t size, uint8_t out[DIGEST_SIZE]) {
+  Blake3 hasher;
+  hasher.update(data, size);
+  hasher.finalize(out);
+}
+
+}
@@ -85,6 +85,29 @@ void Option<StringRef>::parse(StringRef argName, StringRef argValue) {
   _present = true;
 }
 
+// -------------------------------------------------------------------------
+// Option<unsigned>
+// -------------------------------------------------------------------------
+
+template<>
+void Option<unsigned>::parse(StringRef argName, StringRef argValue) {
+  unsigned value = 0;
+  bool valid = !argValue.empty();
+  for (StringRef::const_iterator it = argValue.begin(), itEnd = argValue.end(); it != itEnd; ++it) {
+    if (*it < '0' || *it > '9') {
+      valid = false;
+      break;
+    }
+    value = value * 10 + unsigned(*it - '0');
+  }
+  if (valid) {
+    _value = value;
+    _present = true;
+  } else {
+    diag::error() << "Invalid value for option '" << argName << "': " << argValue;
+  }
+}
+
 // -------------------------------------------------------------------------
 // OptionGroup
 // -------------------------------------------------------------------------
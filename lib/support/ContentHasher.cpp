@@ -0,0 +1,302 @@
+/* ================================================================ *
+   Parallel, cached hashing of file contents.
+ * ================================================================ */
+
+#include "mint/support/ContentHasher.h"
+#include "mint/support/OSError.h"
+#include "mint/support/ParallelFor.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#if defined(_WIN32)
+  #include <io.h>
+  typedef SSIZE_T ssize_t;
+#endif
+
+namespace mint {
+
+namespace {
+  /// First line of the cache file; change the number if the format changes.
+  const char CACHE_HEADER[] = "mint-content-hashes 1";
+
+  /// Files at least this big are mapped into memory instead of being read.
+  const uint64_t MAP_THRESHOLD = 64 * 1024;
+
+  /// Files modified less than this long ago (in nanoseconds) are not cached.
+  const int64_t RACY_INTERVAL = 1000000000;
+
+  const char HEX_DIGITS[] = "0123456789abcdef";
+
+  /// The current time in nanoseconds since the epoch.
+  int64_t currentTime() {
+    #if HAVE_TYPE_TIMESPEC && defined(CLOCK_REALTIME)
+      struct timespec ts;
+      if (::clock_gettime(CLOCK_REALTIME, &ts) == 0) {
+        return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+      }
+    #endif
+    return int64_t(::time(NULL)) * 1000000000;
+  }
+
+  void fileKey(const struct stat & st, ContentHasher::FileKey & key) {
+    key.size = st.st_size;
+    key.inode = st.st_ino;
+    #if defined(__APPLE__)
+      key.lastModified = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+    #elif HAVE_TYPE_TIMESPEC
+      key.lastModified = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    #else
+      key.lastModified = int64_t(st.st_mtime) * 1000000000;
+    #endif
+  }
+
+  /// Hash the 'size' bytes of the open file 'fd'. Returns an errno value, or 0 if
+  /// successful.
+  int hashDescriptor(int fd, uint64_t size, ContentDigest & digest) {
+    Blake3 hasher;
+    #if HAVE_SYS_MMAN_H
+      if (size >= MAP_THRESHOLD && size == uint64_t(size_t(size))) {
+        void * data = ::mmap(NULL, size_t(size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+          #if defined(MADV_SEQUENTIAL)
+            ::madvise(data, size_t(size), MADV_SEQUENTIAL);
+          #endif
+          hasher.update(static_cast<const char *>(data), size_t(size));
+          ::munmap(data, size_t(size));
+          hasher.finalize(digest.bytes);
+          return 0;
+        }
+      }
+    #endif
+
+    char buffer[64 * 1024];
+    for (;;) {
+      ssize_t count = ::read(fd, buffer, sizeof(buffer));
+      if (count < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return errno;
+      } else if (count == 0) {
+        break;
+      }
+      hasher.update(buffer, size_t(count));
+    }
+    hasher.finalize(digest.bytes);
+    return 0;
+  }
+}
+
+void ContentDigest::toHex(SmallVectorImpl<char> & out) const {
+  for (unsigned i = 0; i < Blake3::DIGEST_SIZE; ++i) {
+    out.push_back(HEX_DIGITS[bytes[i] >> 4]);
+    out.push_back(HEX_DIGITS[bytes[i] & 15]);
+  }
+}
+
+bool ContentDigest::fromHex(StringRef hex) {
+  if (hex.size() != 2 * Blake3::DIGEST_SIZE) {
+    return false;
+  }
+  for (unsigned i = 0; i < hex.size(); ++i) {
+    char ch = hex[i];
+    unsigned digit;
+    if (ch >= '0' && ch <= '9') {
+      digit = ch - '0';
+    } else if (ch >= 'a' && ch <= 'f') {
+      digit = ch - 'a' + 10;
+    } else {
+      return false;
+    }
+    if (i & 1) {
+      bytes[i / 2] = uint8_t(bytes[i / 2] | digit);
+    } else {
+      bytes[i / 2] = uint8_t(digit << 4);
+    }
+  }
+  return true;
+}
+
+/// The files being hashed by one call to hashFiles. Each thread takes the next file
+/// from the batch until there are none left; the cache is only read while the threads
+/// are running.
+struct ContentHasher::Batch {
+  const ContentHasher * hasher;
+  const SmallVectorImpl<StringRef> * paths;
+  Result * results;
+  FileKey * keys;
+  int * errors;
+  bool * hashed;
+};
+
+ContentHasher::ContentHasher()
+  : _cache(CACHE_HEADER)
+  , _threadCount(processorCount(4))
+  , _filesRead(0)
+{}
+
+bool ContentHasher::readCache(StringRef path) {
+  return _cache.read(path);
+}
+
+bool ContentHasher::writeCache(StringRef path) {
+  return _cache.write(path);
+}
+
+// Each line is 'digest size mtime inode path'.
+bool ContentHasher::Format::parse(const char * line, Entry & entry, int & pathStart) {
+  char hex[2 * Blake3::DIGEST_SIZE + 1];
+  unsigned long long size, inode;
+  long long lastModified;
+  if (sscanf(line, "%64s %llu %lld %llu %n",
+      hex, &size, &lastModified, &inode, &pathStart) != 4 || !entry.digest.fromHex(hex)) {
+    return false;
+  }
+  entry.key.size = size;
+  entry.key.lastModified = lastModified;
+  entry.key.inode = inode;
+  return true;
+}
+
+void ContentHasher::Format::format(const Entry & entry, SmallVectorImpl<char> & out) {
+  entry.digest.toHex(out);
+  char buffer[80];
+  int length = snprintf(buffer, sizeof(buffer), " %llu %lld %llu ",
+      (unsigned long long)entry.key.size, (long long)entry.key.lastModified,
+      (unsigned long long)entry.key.inode);
+  out.append(buffer, buffer + length);
+}
+
+bool ContentHasher::hashFiles(
+    const SmallVectorImpl<StringRef> & paths, SmallVectorImpl<Result> & results) {
+  size_t count = paths.size();
+  results.clear();
+  results.resize(count);
+  _filesRead = 0;
+  if (count == 0) {
+    return true;
+  }
+  _cache.sort();
+
+  SmallVector<FileKey, 0> keys;
+  keys.resize(count);
+  SmallVector<int, 0> errors;
+  errors.resize(count);
+  SmallVector<bool, 0> hashed;
+  hashed.resize(count);
+
+  Batch batch;
+  batch.hasher = this;
+  batch.paths = &paths;
+  batch.results = results.data();
+  batch.keys = keys.data();
+  batch.errors = errors.data();
+  batch.hashed = hashed.data();
+
+  int64_t startTime = currentTime();
+  parallelFor(count, 1, hashRange, &batch, _threadCount);
+
+  // Report errors and update the cache now that the other threads are finished.
+  bool success = true;
+  for (size_t i = 0; i < count; ++i) {
+    if (errors[i] != 0) {
+      printPosixFileError("hashing", paths[i], errors[i]);
+      success = false;
+    } else if (hashed[i]) {
+      ++_filesRead;
+      if (keys[i].lastModified < startTime - RACY_INTERVAL) {
+        Entry entry;
+        entry.key = keys[i];
+        entry.digest = results[i].digest;
+        _cache.set(paths[i], entry);
+      }
+    }
+  }
+  return success;
+}
+
+bool ContentHasher::hashFile(StringRef path, ContentDigest & digest) {
+  SmallString<128> pathBuffer(path);
+  int fd = ::open(pathBuffer.cstr(), O_RDONLY);
+  if (fd < 0) {
+    printPosixFileError("opening", path, errno);
+    return false;
+  }
+  struct stat st;
+  int error = ::fstat(fd, &st) == 0 ? hashDescriptor(fd, st.st_size, digest) : errno;
+  ::close(fd);
+  if (error != 0) {
+    printPosixFileError("hashing", path, error);
+    return false;
+  }
+  return true;
+}
+
+void ContentHasher::hashRange(size_t start, size_t end, void * batchPtr) {
+  Batch * batch = static_cast<Batch *>(batchPtr);
+  for (size_t i = start; i < end; ++i) {
+    hashOne(batch, i);
+  }
+}
+
+void ContentHasher::hashOne(Batch * batch, size_t index) {
+  StringRef path = (*batch->paths)[index];
+  Result & result = batch->results[index];
+  FileKey & key = batch->keys[index];
+  SmallString<128> pathBuffer(path);
+  int fd = ::open(pathBuffer.cstr(), O_RDONLY);
+  if (fd < 0) {
+    if (errno != ENOENT && errno != ENOTDIR) {
+      batch->errors[index] = errno;
+    }
+    return;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    batch->errors[index] = errno;
+    ::close(fd);
+    return;
+  }
+  result.exists = true;
+  fileKey(st, key);
+
+  const Entry * entry = batch->hasher->_cache.find(path);
+  if (entry != NULL && entry->key == key) {
+    result.digest = entry->digest;
+    result.valid = true;
+  } else {
+    batch->errors[index] = hashDescriptor(fd, key.size, result.digest);
+    result.valid = batch->errors[index] == 0;
+    batch->hashed[index] = result.valid;
+  }
+  ::close(fd);
+}
+
+}
@@ -101,8 +101,8 @@ void writeMessage(Severity sev, Location loc, StringRef msg) {
     }
   }
 
-  unsigned lineStartOffset;
-  unsigned lineEndOffset;
+  unsigned lineStartOffset = 0;
+  unsigned lineEndOffset = 0;
   bool showErrorLine = false;
   if (loc.source != NULL && !loc.source->filePath().empty()) {
     M_ASSERT(loc.end >= loc.begin);
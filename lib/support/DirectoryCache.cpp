@@ -0,0 +1,118 @@
+/* ================================================================ *
+   Cache of directory listings.
+ * ================================================================ */
+
+#include "mint/support/DirectoryCache.h"
+#include "mint/support/DirectoryIterator.h"
+#include "mint/support/Path.h"
+
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <algorithm>
+
+namespace mint {
+
+/// Orders entries by name. Names are compared as bytes, so the order doesn't
+/// depend on the locale or on the order in which the file system returns them.
+struct DirectoryListing::EntryLess {
+  EntryLess(const char * names) : _names(names) {}
+
+  bool operator()(const Entry & lhs, const Entry & rhs) const {
+    return StringRef(_names + lhs.offset, lhs.length).compare(
+        StringRef(_names + rhs.offset, rhs.length)) < 0;
+  }
+
+  bool operator()(const Entry & lhs, StringRef rhs) const {
+    return StringRef(_names + lhs.offset, lhs.length).compare(rhs) < 0;
+  }
+
+  const char * _names;
+};
+
+int DirectoryListing::find(StringRef name) const {
+  const Entry * first = _entries.begin();
+  const Entry * last = _entries.end();
+  const Entry * it = std::lower_bound(first, last, name, EntryLess(_names.data()));
+  if (it != last && StringRef(_names.data() + it->offset, it->length) == name) {
+    return int(it - first);
+  }
+  return -1;
+}
+
+void DirectoryListing::read() {
+  _names.clear();
+  _entries.clear();
+  DirectoryIterator di;
+  _exists = di.begin(_path, true);
+  if (!_exists) {
+    return;
+  }
+  SmallString<128> entryPath;
+  while (di.next()) {
+    const char * name = di.entryName();
+    if (::strcmp(name, ".") == 0 || ::strcmp(name, "..") == 0) {
+      continue;
+    }
+    Entry e;
+    e.offset = unsigned(_names.size());
+    e.length = unsigned(::strlen(name));
+    e.isDirectory = di.isDirectory();
+    e.isLink = false;
+    if (!di.isTypeKnown()) {
+      // The directory entry didn't tell us, so look at the file itself.
+      entryPath = _path;
+      path::combine(entryPath, name);
+      #if HAVE_SYS_STAT_H && !_WIN32
+        struct stat st;
+        if (::lstat(entryPath.cstr(), &st) == 0 && S_ISLNK(st.st_mode)) {
+          e.isLink = true;
+        }
+      #else
+        e.isLink = true;
+      #endif
+      e.isDirectory = path::test(entryPath, path::IS_DIRECTORY, true);
+    }
+    _names.append(name, name + e.length);
+    _entries.push_back(e);
+  }
+  di.finish();
+  std::sort(_entries.begin(), _entries.end(), EntryLess(_names.data()));
+}
+
+const DirectoryListing * DirectoryCache::list(StringRef dirPath) {
+  ListingTable::const_iterator it = _listings.find_as(dirPath);
+  if (it != _listings.end()) {
+    return it->first;
+  }
+  DirectoryListing * listing = new DirectoryListing(dirPath);
+  listing->read();
+  _listings[listing] = NULL;
+  return listing;
+}
+
+void DirectoryCache::getListings(SmallVectorImpl<const DirectoryListing *> & out) const {
+  for (ListingTable::const_iterator it = _listings.begin(), itEnd = _listings.end(); it != itEnd;
+      ++it) {
+    out.push_back(it->first);
+  }
+}
+
+void DirectoryCache::clear() {
+  for (ListingTable::iterator it = _listings.begin(), itEnd = _listings.end(); it != itEnd; ++it) {
+    delete it->first;
+  }
+  _listings.clear();
+}
+
+DirectoryCache & DirectoryCache::get() {
+  static DirectoryCache instance;
+  return instance;
+}
+
+}
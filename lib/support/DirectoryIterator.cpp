@@ -18,7 +18,7 @@ namespace mint {
 #if _WIN32
   DirectoryIterator::DirectoryIterator() : _dirp(INVALID_HANDLE_VALUE) {}
 
-  bool DirectoryIterator::begin(StringRef dirPath) {
+  bool DirectoryIterator::begin(StringRef dirPath, bool quiet) {
     if (_dirp) {
       ::FindClose(_dirp);
     }
@@ -29,7 +29,9 @@ namespace mint {
 
     _dirp = ::FindFirstFileW(pathBuffer.data(), &_findData);
     if (_dirp == INVALID_HANDLE_VALUE) {
-      printWin32FileError("accessing", dirPath, ::GetLastError());
+      if (!quiet) {
+        printWin32FileError("accessing", dirPath, ::GetLastError());
+      }
       return false;
     }
     return true;
@@ -45,6 +47,10 @@ namespace mint {
     return (_findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
   }
 
+  bool DirectoryIterator::isTypeKnown() const {
+    return (_findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0;
+  }
+
   bool DirectoryIterator::next() {
     if (_dirp != INVALID_HANDLE_VALUE) {
       if (::FindNextFileW(_dirp, &_findData)) {
@@ -68,9 +74,10 @@ namespace mint {
 
 #elif HAVE_DIRENT_H
 
-  DirectoryIterator::DirectoryIterator() : _dirp(NULL), _entryName(NULL) {}
+  DirectoryIterator::DirectoryIterator()
+    : _dirp(NULL), _entryName(NULL), _isDirectory(false), _isTypeKnown(false) {}
 
-  bool DirectoryIterator::begin(StringRef dirPath) {
+  bool DirectoryIterator::begin(StringRef dirPath, bool quiet) {
     if (_dirp) {
       ::closedir(_dirp);
     }
@@ -81,7 +88,9 @@ namespace mint {
 
     _dirp = ::opendir(pathBuffer.data());
     if (_dirp == NULL) {
-      printPosixFileError("accessing", dirPath, errno);
+      if (!quiet) {
+        printPosixFileError("accessing", dirPath, errno);
+      }
       return false;
     }
     return true;
@@ -92,12 +101,13 @@ namespace mint {
   }
 
   bool DirectoryIterator::isDirectory() const {
-    #if !DIRENT_HAS_D_TYPE
-      M_ASSERT(false) << "Implement isDirectory() for systems with no dirent::d_type field.";
-    #endif
     return _isDirectory;
   }
 
+  bool DirectoryIterator::isTypeKnown() const {
+    return _isTypeKnown;
+  }
+
   bool DirectoryIterator::next() {
     if (_dirp) {
       ::dirent * de = ::readdir(_dirp);
@@ -105,6 +115,10 @@ namespace mint {
         _entryName = de->d_name;
         #if DIRENT_HAS_D_TYPE
           _isDirectory = (de->d_type == DT_DIR);
+          _isTypeKnown = (de->d_type != DT_UNKNOWN && de->d_type != DT_LNK);
+        #else
+          _isDirectory = false;
+          _isTypeKnown = false;
         #endif
         return true;
       } else {
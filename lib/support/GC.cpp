@@ -23,6 +23,7 @@ namespace mint {
 bool GC::_initialized = false;
 unsigned GC::_debugLevel = 0;
 GC * GC::_allocList = NULL;
+unsigned long GC::_allocCount = 0;
 GCRootBase * GC::_roots = NULL;
 
 unsigned char GC::_cycleIndex = 0;
@@ -53,6 +54,7 @@ void * GC::alloc(size_t size) {
   gc->_next = _allocList;
   gc->_cycle = _cycleIndex;
   _allocList = gc;
+  ++_allocCount;
   return gc;
 }
 
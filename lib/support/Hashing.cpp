@@ -1,18 +1,128 @@
 /* ================================================================== *
- * Diagnostic functions and macros
+ * Hashing
  * ================================================================== */
 
 #include "mint/support/Hashing.h"
 
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
 namespace mint {
 
+namespace {
+
+  // Constants from wyhash (public domain), which this function follows closely. The input
+  // is consumed eight bytes at a time and mixed with a 64x64->128 bit multiply, which is
+  // several times faster than byte-at-a-time FNV on long keys such as absolute paths. On
+  // short identifiers it is slightly slower than FNV, though it spreads keys as well.
+  const uint64_t SECRET0 = 0xa0761d6478bd642fULL;
+  const uint64_t SECRET1 = 0xe7037ed1a0b428dbULL;
+  const uint64_t SECRET2 = 0x8ebc6af09c88c6e3ULL;
+  const uint64_t SECRET3 = 0x589965cc75374cc3ULL;
+
+  /// Multiply two 64-bit values, leaving the low half of the product in 'a' and
+  /// the high half in 'b'.
+  inline void multiply(uint64_t & a, uint64_t & b) {
+  #if defined(__SIZEOF_INT128__)
+    __uint128_t r = a;
+    r *= b;
+    a = uint64_t(r);
+    b = uint64_t(r >> 64);
+  #else
+    uint64_t ha = a >> 32, hb = b >> 32, la = uint32_t(a), lb = uint32_t(b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    a = lo;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  #endif
+  }
+
+  /// Multiply two 64-bit values and fold the 128-bit product into 64 bits.
+  inline uint64_t mix(uint64_t a, uint64_t b) {
+    multiply(a, b);
+    return a ^ b;
+  }
+
+  // Unaligned loads; memcpy compiles down to a single move.
+  inline uint64_t read8(const char * p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+  }
+
+  inline uint64_t read4(const char * p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+  }
+
+  /// Read 1 to 3 bytes.
+  inline uint64_t read3(const char * p, size_t k) {
+    return (uint64_t((unsigned char) p[0]) << 16) | (uint64_t((unsigned char) p[k >> 1]) << 8)
+        | uint64_t((unsigned char) p[k - 1]);
+  }
+
+  /// Hash all of the bytes in the range [first, last) to 64 bits.
+  inline uint64_t hashBytes(const char * first, const char * last) {
+    const char * p = first;
+    size_t len = size_t(last - first);
+    uint64_t seed = SECRET0;
+    uint64_t a, b;
+    if (len <= 16) {
+      if (len >= 4) {
+        size_t mid = (len >> 3) << 2;
+        a = (read4(p) << 32) | read4(p + mid);
+        b = (read4(p + len - 4) << 32) | read4(p + len - 4 - mid);
+      } else if (len > 0) {
+        a = read3(p, len);
+        b = 0;
+      } else {
+        a = b = 0;
+      }
+    } else {
+      size_t i = len;
+      if (i > 48) {
+        uint64_t see1 = seed, see2 = seed;
+        do {
+          seed = mix(read8(p) ^ SECRET1, read8(p + 8) ^ seed);
+          see1 = mix(read8(p + 16) ^ SECRET2, read8(p + 24) ^ see1);
+          see2 = mix(read8(p + 32) ^ SECRET3, read8(p + 40) ^ see2);
+          p += 48;
+          i -= 48;
+        } while (i > 48);
+        seed ^= see1 ^ see2;
+      }
+      while (i > 16) {
+        seed = mix(read8(p) ^ SECRET1, read8(p + 8) ^ seed);
+        i -= 16;
+        p += 16;
+      }
+      a = read8(p + i - 16);
+      b = read8(p + i - 8);
+    }
+    a ^= SECRET1;
+    b ^= seed;
+    multiply(a, b);
+    return mix(a ^ SECRET0 ^ len, b ^ SECRET1);
+  }
+}
+
 /// Hash all of the bytes in the range [first, last)
 unsigned hash(const char * first, const char * last) {
-  unsigned hash = 2166136261;
-  while (first < last) {
-    hash = (hash ^ *first++) * 16777619;
-  }
-  return hash;
+  uint64_t h = hashBytes(first, last);
+  return unsigned(h ^ (h >> 32));
+}
+
+uint64_t hash64(const char * first, const char * last) {
+  return hashBytes(first, last);
 }
 
 }
@@ -0,0 +1,110 @@
+/* ================================================================ *
+   Running a loop over a range of items on several threads.
+ * ================================================================ */
+
+#include "mint/support/ParallelFor.h"
+
+#include "mint/collections/SmallVector.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
+namespace mint {
+
+namespace {
+  /// The state shared by the threads running one loop. Each thread claims the next
+  /// chunk of items until there are none left.
+  struct LoopState {
+    size_t count;
+    size_t chunk;
+    ParallelForFn fn;
+    void * arg;
+    size_t next;
+    #if HAVE_PTHREAD_H
+      pthread_mutex_t lock;
+    #endif
+  };
+
+  void * parallelForWorker(void * statePtr) {
+    LoopState * state = static_cast<LoopState *>(statePtr);
+    for (;;) {
+      #if HAVE_PTHREAD_H
+        pthread_mutex_lock(&state->lock);
+        size_t start = state->next;
+        state->next += state->chunk;
+        pthread_mutex_unlock(&state->lock);
+      #else
+        size_t start = state->next;
+        state->next += state->chunk;
+      #endif
+      if (start >= state->count) {
+        break;
+      }
+      (*state->fn)(start, std::min(start + state->chunk, state->count), state->arg);
+    }
+    return NULL;
+  }
+}
+
+unsigned processorCount(unsigned fallback) {
+  #if HAVE_UNISTD_H && defined(_SC_NPROCESSORS_ONLN)
+    long count = ::sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0) {
+      return unsigned(count);
+    }
+  #endif
+  return fallback;
+}
+
+void parallelFor(size_t count, size_t chunk, ParallelForFn fn, void * arg, unsigned threads) {
+  if (count == 0) {
+    return;
+  }
+  if (chunk == 0) {
+    chunk = 1;
+  }
+  if (threads == 0) {
+    threads = processorCount();
+  }
+  // No point in having more threads than chunks.
+  size_t chunks = (count + chunk - 1) / chunk;
+  if (threads > chunks) {
+    threads = unsigned(chunks);
+  }
+
+  LoopState state;
+  state.count = count;
+  state.chunk = chunk;
+  state.fn = fn;
+  state.arg = arg;
+  state.next = 0;
+  #if HAVE_PTHREAD_H
+    pthread_mutex_init(&state.lock, NULL);
+    SmallVector<pthread_t, 16> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+      pthread_t thread;
+      if (pthread_create(&thread, NULL, parallelForWorker, &state) != 0) {
+        break;
+      }
+      workers.push_back(thread);
+    }
+    parallelForWorker(&state);
+    for (pthread_t * it = workers.begin(); it != workers.end(); ++it) {
+      pthread_join(*it, NULL);
+    }
+    pthread_mutex_destroy(&state.lock);
+  #else
+    parallelForWorker(&state);
+  #endif
+}
+
+}
@@ -27,10 +27,28 @@
 #include <fcntl.h>
 #endif
 
+#if HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+
+#if HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+
+#if HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
 #if HAVE_IO_H
 #include <io.h>
 #endif
 
+#if defined(_WIN32)
+  #include <sys/utime.h>
+#elif HAVE_UNISTD_H
+  #include <utime.h>
+#endif
+
 #if defined(_WIN32)
   #include <windows.h>
   #undef min
@@ -522,29 +540,44 @@ unsigned fileSize(StringRef path) {
 #endif
 
 bool fileStatus(StringRef path, FileStatus & status) {
+  int error = 0;
+  if (!fileStatus(path, status, error)) {
+    printPosixFileError("accessing", path, error);
+    return false;
+  }
+  return true;
+}
+
+bool fileStatus(StringRef path, FileStatus & status, int & error) {
   // Create a null-terminated version of the path
   SmallString<128> pathBuffer(path.begin(), path.end());
   pathBuffer.push_back('\0');
-  using namespace mint::console;
 
   #if HAVE_STAT
+    error = 0;
     struct stat st;
     if (::stat(pathBuffer.data(), &st) != 0) {
-      int error = errno;
-      if (error == ENOENT) {
+      if (errno == ENOENT) {
         status.exists = false;
         status.size = 0;
         return true;
       }
-      printPosixFileError("accessing", path, error);
+      error = errno;
       return false;
     }
 
     status.exists = true;
     status.isFile = ((st.st_mode & S_IFREG) != 0);
     status.isDir = ((st.st_mode & S_IFDIR) != 0);
-    //status.lastModified = st.st_mtimespec;
-    status.lastModified = st.st_mtime;
+    #if defined(__APPLE__)
+      struct timespec mtime = st.st_mtimespec;
+      status.lastModified = TimeStamp(mtime);
+    #elif HAVE_TYPE_TIMESPEC
+      struct timespec mtime = st.st_mtim;
+      status.lastModified = TimeStamp(mtime);
+    #else
+      status.lastModified = st.st_mtime;
+    #endif
     status.size = st.st_size;
     return true;
   #else
@@ -695,11 +728,19 @@ bool writeFileContents(StringRef path, StringRef content) {
 #endif
 
 #if defined(_WIN32)
-bool copyFile(StringRef sourcePath, StringRef outputPath) {
+bool copyFile(StringRef sourcePath, StringRef outputPath, unsigned flags) {
   SmallVector<native_char_t, 128> sourcePathBuffer;
   SmallVector<native_char_t, 128> outputPathBuffer;
   toNative(sourcePath, sourcePathBuffer);
   toNative(outputPath, outputPathBuffer);
+  if (flags & COPY_HARDLINK) {
+    ::DeleteFile(outputPathBuffer.data());
+    if (::CreateHardLink(outputPathBuffer.data(), sourcePathBuffer.data(), NULL)) {
+      return true;
+    }
+    // Fall through and copy the file instead.
+  }
+  // CopyFile always preserves the modification time.
   if (!::CopyFile(sourcePathBuffer.data(), outputPathBuffer.data(), false)) {
     printWin32FileError("copying to", outputPath, ::GetLastError());
     return false;
@@ -707,57 +748,170 @@ bool copyFile(StringRef sourcePath, StringRef outputPath) {
   return true;
 }
 #else
-bool copyFile(StringRef sourcePath, StringRef outputPath) {
+namespace {
+  /// Size of the buffer used when the data has to be copied through user space.
+  const size_t COPY_BUFFER_SIZE = 256 * 1024;
+
+  /// Copy the contents of 'rfd' to 'wfd', starting at the current offset of each, using
+  /// the fastest method available. 'size' is the size of the source file when it was
+  /// opened, which is only a hint: the copy always continues to end of file.
+  bool copyFileData(int rfd, int wfd, off_t size, StringRef sourcePath, StringRef outputPath) {
+  #if HAVE_SYS_IOCTL_H && HAVE_LINUX_FS_H && defined(FICLONE)
+    // A reflink shares the source's storage until one of them is modified.
+    if (::ioctl(wfd, FICLONE, rfd) == 0) {
+      return true;
+    }
+  #endif
+
+    // Each of the methods below may be unsupported for this pair of files, in which case
+    // we move on to the next one. They all advance the file offsets, so any method can
+    // pick up where a previous one left off.
+  #if HAVE_COPY_FILE_RANGE || HAVE_SYS_SENDFILE_H
+    off_t remaining = size;
+  #else
+    (void)size;
+  #endif
+  #if HAVE_COPY_FILE_RANGE
+    while (remaining > 0) {
+      ssize_t copied = ::copy_file_range(rfd, NULL, wfd, NULL, size_t(remaining), 0);
+      if (copied > 0) {
+        remaining -= copied;
+      } else if (copied == 0 || errno != EINTR) {
+        break;
+      }
+    }
+  #endif
+
+  #if HAVE_SYS_SENDFILE_H
+    while (remaining > 0) {
+      ssize_t copied = ::sendfile(wfd, rfd, NULL, size_t(remaining));
+      if (copied > 0) {
+        remaining -= copied;
+      } else if (copied == 0 || errno != EINTR) {
+        break;
+      }
+    }
+  #endif
+
+    // Finish with a read loop in any case. Pseudo-files report a size of zero, and the
+    // file may have grown since we checked its size, so read until end of file; after a
+    // complete copy above, that is a single read that returns nothing, so the full
+    // size buffer is only allocated once there turns out to be data left.
+    char probe[512];
+    char * data = probe;
+    size_t capacity = sizeof(probe);
+    SmallVector<char, 0> buffer;
+    for (;;) {
+      ssize_t nread = ::read(rfd, data, capacity);
+      if (nread > 0) {
+        char * out = data;
+        do {
+          // Attempt to write all that was read, but we might get interrupted.
+          ssize_t written = ::write(wfd, out, size_t(nread));
+          if (written >= 0) {
+            out += written;
+            nread -= written;
+          } else if (errno != EINTR) {
+            printPosixFileError("writing", outputPath, errno);
+            return false;
+          }
+        } while (nread > 0);
+        if (buffer.empty()) {
+          buffer.resize(COPY_BUFFER_SIZE);
+          data = buffer.data();
+          capacity = buffer.size();
+        }
+      } else if (nread < 0) {
+        if (errno != EINTR) {
+          printPosixFileError("reading", sourcePath, errno);
+          return false;
+        }
+      } else {
+        // Done.
+        return true;
+      }
+    }
+  }
+}
+
+bool copyFile(StringRef sourcePath, StringRef outputPath, unsigned flags) {
   int rfd = openFileForRead(sourcePath);
   if (rfd == -1) {
     return false;
   }
 
+  struct stat sourceStat;
+  if (::fstat(rfd, &sourceStat) == -1) {
+    printPosixFileError("reading", sourcePath, errno);
+    ::close(rfd);
+    return false;
+  }
+
   StringRef parentDir = parent(outputPath);
   if (!parentDir.empty()) {
     if (!makeDirectoryPath(parentDir)) {
+      ::close(rfd);
       return false;
     }
   }
 
+  // If the output is already a hard link to the source, then either there's nothing to
+  // do, or the link has to be broken first - truncating the output would truncate the
+  // source as well.
+  SmallString<128> outputBuffer(outputPath);
+  struct stat outputStat;
+  if (::stat(outputBuffer.cstr(), &outputStat) == 0 &&
+      outputStat.st_dev == sourceStat.st_dev && outputStat.st_ino == sourceStat.st_ino) {
+    if (flags & COPY_HARDLINK) {
+      ::close(rfd);
+      return true;
+    }
+    ::unlink(outputBuffer.cstr());
+  }
+
+  if (flags & COPY_HARDLINK) {
+    SmallString<128> sourceBuffer(sourcePath);
+    ::unlink(outputBuffer.cstr());
+    if (::link(sourceBuffer.cstr(), outputBuffer.cstr()) == 0) {
+      ::close(rfd);
+      return true;
+    }
+    // Linking isn't possible across file systems, among other things; copy instead.
+  }
+
   int wfd = openFileForWrite(outputPath);
   if (wfd == -1) {
     ::close(rfd);
     return false;
   }
 
-  char buf[4096];
-  for (;;) {
-    ssize_t nread = ::read(rfd, buf, sizeof(buf));
-    if (nread > 0) {
-      char * out = buf;
-      do {
-        // Attempt to write all that was read, but we might get interrupted.
-        // (TODO: Modify the other functions here to do this as well.)
-        ssize_t written = ::write(wfd, out, size_t(nread));
-        if (written >= 0) {
-          out += written;
-          nread -= written;
-        } else if (errno != EINTR) {
-          printPosixFileError("writing", outputPath, errno);
-          goto done;
-        }
-      } while (nread > 0);
-    } else if (nread < 0) {
-      if (errno != EINTR) {
-        printPosixFileError("reading", sourcePath, errno);
-        goto done;
-      }
-    } else {
-      // Done.
-      break;
+  bool success = copyFileData(rfd, wfd, sourceStat.st_size, sourcePath, outputPath);
+  if (success && ::fchmod(wfd, sourceStat.st_mode & 0777) == -1) {
+    printPosixFileError("setting permissions of", outputPath, errno);
+    success = false;
+  }
+  if (success && (flags & COPY_PRESERVE_TIME)) {
+  #if HAVE_FUTIMENS
+    struct timespec times[2];
+    #if defined(__APPLE__)
+      times[0] = sourceStat.st_atimespec;
+      times[1] = sourceStat.st_mtimespec;
+    #else
+      times[0] = sourceStat.st_atim;
+      times[1] = sourceStat.st_mtim;
+    #endif
+    if (::futimens(wfd, times) == -1) {
+      printPosixFileError("setting modification time of", outputPath, errno);
+      success = false;
     }
+  #else
+    success = setLastModified(outputPath, TimeStamp(sourceStat.st_mtime));
+  #endif
   }
 
-done:
   ::close(wfd);
   ::close(rfd);
-  return true;
+  return success;
 }
 #endif
 
@@ -851,4 +1005,52 @@ bool remove(StringRef path) {
   return true;
 }
 
+bool removeDirectory(StringRef path) {
+  SmallVector<native_char_t, 128> pathBuffer;
+  toNative(path, pathBuffer);
+  #if defined(_WIN32)
+    int status = ::_wrmdir(pathBuffer.data());
+  #elif HAVE_UNISTD_H
+    int status = ::rmdir(pathBuffer.data());
+  #else
+    #error Unimplemented: path::removeDirectory();
+  #endif
+  if (status == -1) {
+    int error = errno;
+    if (error != ENOENT && error != ENOTEMPTY && error != EEXIST) {
+      printPosixFileError("removing", path, error);
+    }
+    return false;
+  }
+  return true;
+}
+
+bool setLastModified(StringRef path, const TimeStamp & time) {
+  SmallVector<native_char_t, 128> pathBuffer;
+  toNative(path, pathBuffer);
+  #if defined(_WIN32)
+    struct _utimbuf times;
+    times.actime = times.modtime = time.seconds();
+    int status = ::_wutime(pathBuffer.data(), &times);
+  #elif HAVE_FUTIMENS
+    // Keep the fraction of a second, so that a restored time compares equal to the
+    // original.
+    struct timespec times[2];
+    times[0].tv_sec = times[1].tv_sec = time.seconds();
+    times[0].tv_nsec = times[1].tv_nsec = time.nanoseconds();
+    int status = ::utimensat(AT_FDCWD, pathBuffer.data(), times, 0);
+  #elif HAVE_UNISTD_H
+    struct utimbuf times;
+    times.actime = times.modtime = time.seconds();
+    int status = ::utime(pathBuffer.data(), &times);
+  #else
+    #error Unimplemented: path::setLastModified();
+  #endif
+  if (status == -1) {
+    printPosixFileError("setting modification time of", path, errno);
+    return false;
+  }
+  return true;
+}
+
 }}
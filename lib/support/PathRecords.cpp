@@ -0,0 +1,29 @@
+/* ================================================================ *
+   A table of records keyed by path, which can be saved to a file.
+ * ================================================================ */
+
+#include "mint/support/PathRecords.h"
+#include "mint/support/Path.h"
+
+namespace mint {
+
+bool PathRecordFile::read(StringRef path, StringRef header, SmallVectorImpl<char> & content,
+    size_t & bodyStart) {
+  path::FileStatus st;
+  if (!path::fileStatus(path, st) || !st.exists || !path::readFileContents(path, content)) {
+    return false;
+  }
+  StringRef text(content.data(), content.size());
+  size_t pos = text.find('\n');
+  if (pos == StringRef::npos || text.substr(0, pos) != header) {
+    return false;
+  }
+  bodyStart = pos + 1;
+  return true;
+}
+
+bool PathRecordFile::write(StringRef path, StringRef content) {
+  return path::writeFileContents(path, content);
+}
+
+}
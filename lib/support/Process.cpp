@@ -33,10 +33,18 @@
 #include <stdio.h>
 #endif
 
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
 #if HAVE_STDINT_H
 #include <stdint.h>
 #endif
 
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+
 #if HAVE_SYS_TYPES_H
 #include <sys/types.h>
 #endif
@@ -45,6 +53,22 @@
 #include <sys/wait.h>
 #endif
 
+#if HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#if HAVE_SPAWN_H
+#include <spawn.h>
+#endif
+
+#if HAVE_CPLUS_ALGORITHM
+#include <algorithm>
+#endif
+
 #if defined(_WIN32)
   #include <windows.h>
   #undef min
@@ -53,7 +77,9 @@
   typedef SSIZE_T ssize_t;
 #endif
 
-//extern char **environ;
+#if HAVE_SPAWN_H && HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+extern char **environ;
+#endif
 
 namespace mint {
 
@@ -64,17 +90,19 @@ cl::Option<bool> optVerbose("verbose", cl::Group("global"),
 // StreamBuffer
 // -------------------------------------------------------------------------
 
-StreamBuffer::StreamBuffer(OStream & out)
+StreamBuffer::StreamBuffer()
 #if defined(_WIN32)
   : _source(INVALID_HANDLE_VALUE)
 #else
   : _source(-1)
 #endif
-  , _out(out)
+  , _data(NULL)
   , _size(0)
-  , _finished(true) {
-  _buffer.resize(1024);
-}
+  , _capacity(0)
+  , _spillFile(NULL)
+  , _spillSize(0)
+  , _finished(true)
+{}
 
 void StreamBuffer::setSource(StreamID source) {
 #ifndef _WIN32
@@ -92,23 +120,21 @@ void StreamBuffer::setSource(StreamID source) {
 #endif
 }
 
-bool StreamBuffer::fillBuffer() {
+bool StreamBuffer::readAvailable() {
 #ifndef _WIN32
   while (!_finished) {
-    unsigned avail = _buffer.size() - _size;
-    M_ASSERT(_size <= _buffer.size());
-    M_ASSERT(avail <= _buffer.size());
-    if (avail == 0) {
-      return true;
+    if (_size == _capacity) {
+      grow();
     }
-    ssize_t actual = ::read(_source, _buffer.begin() + _size, avail);
+    M_ASSERT(_size < _capacity);
+    ssize_t actual = ::read(_source, _data + _size, _capacity - _size);
     if (actual < 0) {
-      if (errno == EWOULDBLOCK) {
-        return false;
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
       }
       ::perror("reading from child processes stream");
-      ::abort();
-      /// TODO: Set error code.
       _finished = true;
     } else if (actual == 0) {
       // End of stream.
@@ -118,68 +144,235 @@ bool StreamBuffer::fillBuffer() {
     }
   }
 #endif
-  return false;
+  return _finished;
 }
 
-bool StreamBuffer::processLines() {
-#ifndef _WIN32
-  bool more = true;
-  while (more && !_finished) {
-    more = fillBuffer();
-    if (_size == _buffer.size() || _finished) {
-      if (_size > 0) {
-        unsigned breakPos = _finished ? _size : lastLineBreak();
-        _out.write(_buffer.data(), breakPos);
-        unsigned remaining = unsigned(_size - breakPos);
-        if (remaining > 0) {
-          ::memcpy(_buffer.begin(), _buffer.begin() + breakPos, remaining);
-        }
-        _size = remaining;
+void StreamBuffer::grow() {
+  // Past the threshold, move what we have to disk and reuse the buffer. If there's
+  // no temporary file available, just keep growing in memory.
+  if (_capacity >= SPILL_THRESHOLD && spill()) {
+    return;
+  }
+
+  // Double the size of each read as the child produces more output, so that a
+  // chatty process needs only a few large reads.
+  size_t newCapacity = _capacity == 0 ? size_t(INITIAL_CAPACITY) : _capacity * 2;
+  char * newData = static_cast<char *>(::realloc(_data, newCapacity));
+  if (newData == NULL) {
+    ::perror("allocating buffer for child process output");
+    ::abort();
+  }
+  _data = newData;
+  _capacity = newCapacity;
+}
+
+bool StreamBuffer::spill() {
+  if (_spillFile == NULL) {
+    _spillFile = ::tmpfile();
+    if (_spillFile == NULL) {
+      return false;
+    }
+  }
+  if (::fwrite(_data, 1, _size, _spillFile) != _size) {
+    ::perror("writing child process output to temporary file");
+    return false;
+  }
+  _spillSize += _size;
+  _size = 0;
+  return true;
+}
+
+void StreamBuffer::append(const char * text, size_t length) {
+  while (length > 0) {
+    if (_size == _capacity) {
+      grow();
+    }
+    size_t count = std::min(length, _capacity - _size);
+    ::memcpy(_data + _size, text, count);
+    _size += count;
+    text += count;
+    length -= count;
+  }
+}
+
+size_t StreamBuffer::copyTo(SmallVectorImpl<char> & result, size_t maxSize) const {
+  size_t copied = 0;
+  if (_spillFile != NULL && maxSize > 0) {
+    size_t length = std::min(maxSize, _spillSize);
+    size_t start = result.size();
+    result.resize(start + length);
+    ::fflush(_spillFile);
+    ::rewind(_spillFile);
+    copied = ::fread(result.data() + start, 1, length, _spillFile);
+    result.resize(start + copied);
+    ::fseek(_spillFile, 0, SEEK_END);
+  }
+  if (copied < maxSize && _size > 0) {
+    size_t length = std::min(maxSize - copied, _size);
+    result.append(_data, _data + length);
+    copied += length;
+  }
+  return copied;
+}
+
+void StreamBuffer::writeTo(OStream & out) {
+  if (_spillFile != NULL) {
+    // Stream the spilled text back in large chunks.
+    char chunk[65536];
+    ::fflush(_spillFile);
+    ::rewind(_spillFile);
+    for (;;) {
+      size_t actual = ::fread(chunk, 1, sizeof(chunk), _spillFile);
+      if (actual == 0) {
+        break;
       }
+      out.write(chunk, actual);
     }
   }
-#endif
-  return _finished;
+  if (_size > 0) {
+    out.write(_data, _size);
+  }
+  clear();
 }
 
-bool StreamBuffer::flush() {
-  processLines();
-  _out.write(_buffer.data(), _size);
+void StreamBuffer::clear() {
+  // Note that GC'd owners never run our destructor, so release everything here.
+  if (_spillFile != NULL) {
+    ::fclose(_spillFile);
+    _spillFile = NULL;
+  }
+  ::free(_data);
+  _data = NULL;
   _size = 0;
-  return true;
+  _capacity = 0;
+  _spillSize = 0;
 }
 
 void StreamBuffer::close() {
 #ifndef _WIN32
-  flush();
+  readAvailable();
   ::close(_source);
   _finished = true;
   _source = -1;
 #endif
 }
 
-unsigned StreamBuffer::lastLineBreak() {
-  unsigned pos = _size;
-  while (pos > 0) {
-    char ch = _buffer[pos - 1];
-    if (ch == '\n' || ch == '\r') {
-      break;
-    }
-    --pos;
-  }
-  return pos > 0 ? pos : _size;
+// -------------------------------------------------------------------------
+// ResourceUsage
+// -------------------------------------------------------------------------
+
+void ResourceUsage::add(const ResourceUsage & other) {
+  wallTime += other.wallTime;
+  userTime += other.userTime;
+  systemTime += other.systemTime;
+  maxResident = std::max(maxResident, other.maxResident);
+  inputBlocks += other.inputBlocks;
+  outputBlocks += other.outputBlocks;
 }
 
 // -------------------------------------------------------------------------
 // Process
 // -------------------------------------------------------------------------
 
+#if HAVE_UNISTD_H
+namespace {
+  /// A program name and the path it was found at.
+  struct ProgramPath {
+    char * name;
+    char * path;
+  };
+
+  /// Programs that have already been looked up. A build only runs a handful of
+  /// distinct programs, so a linear list is plenty.
+  SmallVector<ProgramPath, 8> programPaths;
+}
+
+/// Return the location of 'program', searching the absolute directories in PATH
+/// once per distinct program. Names containing a slash are returned as-is. Returns
+/// NULL if the program wasn't found, in which case the caller should fall back to
+/// the system's own search.
+static const char * resolveProgram(const char * program) {
+  if (::strchr(program, '/') != NULL) {
+    return program;
+  }
+
+  for (SmallVectorImpl<ProgramPath>::const_iterator
+      it = programPaths.begin(), itEnd = programPaths.end(); it != itEnd; ++it) {
+    if (::strcmp(it->name, program) == 0) {
+      return it->path;
+    }
+  }
+
+  const char * searchPath = ::getenv("PATH");
+  if (searchPath == NULL) {
+    return NULL;
+  }
+
+  SmallString<256> candidate;
+  StringRef dirs(searchPath);
+  while (!dirs.empty()) {
+    size_t sep = dirs.find(':');
+    StringRef dir = dirs.substr(0, sep);
+    dirs = sep == StringRef::npos ? StringRef() : dirs.substr(sep + 1);
+
+    // Relative entries depend on the child's working directory, so leave those
+    // to the system.
+    if (dir.empty() || dir[0] != '/') {
+      continue;
+    }
+    candidate.clear();
+    candidate.append(dir);
+    candidate.push_back('/');
+    candidate.append(StringRef(program));
+    candidate.push_back('\0');
+
+    struct stat st;
+    if (::stat(candidate.data(), &st) == 0 && S_ISREG(st.st_mode) &&
+        ::access(candidate.data(), X_OK) == 0) {
+      ProgramPath entry;
+      entry.name = ::strdup(program);
+      entry.path = ::strdup(candidate.data());
+      programPaths.push_back(entry);
+      return entry.path;
+    }
+  }
+  return NULL;
+}
+
+/// Fill in 'argv' to run the file at 'path' as a shell script, with the arguments
+/// after the program name in 'args'. execvp does this when the kernel refuses a file
+/// (ENOEXEC), which is how scripts without a '#!' line run; posix_spawn and execv
+/// don't, so we do it ourselves.
+static void shellScriptArgs(const char * path, char * const * args,
+    SmallVectorImpl<char *> & argv) {
+  static char shell[] = "/bin/sh";
+  argv.push_back(shell);
+  argv.push_back(const_cast<char *>(path));
+  for (char * const * arg = args + 1; *arg != NULL; ++arg) {
+    argv.push_back(*arg);
+  }
+  argv.push_back(NULL);
+}
+
+/// Create a pipe whose ends are both close-on-exec, so that they don't leak into
+/// other child processes. (dup2() clears the flag on the child's copy.)
+static bool createPipe(int fds[2]) {
+  if (::pipe(fds) == -1) {
+    return false;
+  }
+  ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return true;
+}
+#endif
+
 Process * Process::_processList = NULL;
 
 Process::Process(ProcessListener * listener)
   : _listener(listener)
-  , _stdout(console::out())
-  , _stderr(console::err())
+  , _exitStatus(0)
+  , _signaled(false)
+  , _startTime(0)
 {
   #if HAVE_UNISTD_H
     _pid = 0;
@@ -188,6 +381,17 @@ Process::Process(ProcessListener * listener)
   _processList = this;
 }
 
+Process::~Process() {
+  for (Process ** p = &_processList; *p != NULL; p = &(*p)->_next) {
+    if (*p == this) {
+      *p = _next;
+      break;
+    }
+  }
+  _stdout.clear();
+  _stderr.clear();
+}
+
 bool Process::begin(StringRef programName, ArrayRef<StringRef> args, StringRef workingDir) {
   unsigned bufsize = programName.size() + workingDir.size() + 2;
   for (ArrayRef<StringRef>::const_iterator
@@ -234,6 +438,7 @@ bool Process::begin(StringRef programName, ArrayRef<StringRef> args, StringRef w
     diag::status() << commandLine;
   }
 
+  _startTime = monotonicTime();
   #if defined(_MSC_VER)
     M_ASSERT(false) << "Implement";
     return true;
@@ -255,41 +460,76 @@ bool Process::begin(StringRef programName, ArrayRef<StringRef> args, StringRef w
     // Create the pipes
     int fdout[2];
     int fderr[2];
-    if (::pipe(fdout) == -1) {
+    if (!createPipe(fdout)) {
       printPosixFileError("executing", programName, errno);
       return false;
     }
 
-    if (::pipe(fderr) == -1) {
+    if (!createPipe(fderr)) {
       printPosixFileError("executing", programName, errno);
+      ::close(fdout[0]);
+      ::close(fdout[1]);
+      return false;
+    }
+
+    const char * programPath = resolveProgram(program);
+
+  #if HAVE_SPAWN_H && HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+    // posix_spawn avoids copying the page tables of our (potentially large) heap,
+    // which is what makes fork() slow.
+    posix_spawn_file_actions_t actions;
+    ::posix_spawn_file_actions_init(&actions);
+    ::posix_spawn_file_actions_adddup2(&actions, fdout[1], STDOUT_FILENO);
+    ::posix_spawn_file_actions_adddup2(&actions, fderr[1], STDERR_FILENO);
+    ::posix_spawn_file_actions_addchdir_np(&actions, wdir);
+
+    pid_t pid = 0;
+    int error = programPath != NULL
+        ? ::posix_spawn(&pid, programPath, &actions, NULL, _argv.data(), environ)
+        : ::posix_spawnp(&pid, program, &actions, NULL, _argv.data(), environ);
+    if (error == ENOEXEC) {
+      SmallVector<char *, 32> shellArgv;
+      shellScriptArgs(programPath != NULL ? programPath : program, _argv.data(), shellArgv);
+      error = ::posix_spawn(&pid, shellArgv[0], &actions, NULL, shellArgv.data(), environ);
+    }
+    ::posix_spawn_file_actions_destroy(&actions);
+
+    // The parent must not hold on to the write ends, or we'd never see end of input.
+    ::close(fdout[1]);
+    ::close(fderr[1]);
+    if (error != 0) {
+      ::close(fdout[0]);
+      ::close(fderr[0]);
+      if (error == ENOENT && ::access(wdir, F_OK) != 0) {
+        printPosixFileError("changing directory to", workingDir, error);
+      } else if (error == ENOENT) {
+        diag::error() << "Program '" << programName << "' not found.";
+      } else {
+        printPosixFileError("executing", programName, error);
+      }
       return false;
     }
 
+    _pid = pid;
+    _stdout.setSource(fdout[0]);
+    _stderr.setSource(fderr[0]);
+    return true;
+  #else
     // Spawn the new process
     pid_t pid = ::fork();
     if (pid == 0) {
       // We're the child
 
-      // Close the read pipe
-      ::close(fdout[0]);
-      ::close(fderr[0]);
-
       // Assign stdout to our pipe
-      if (fdout[1] != STDOUT_FILENO) {
-        if (::dup2(fdout[1], STDOUT_FILENO) != STDOUT_FILENO) {
-          printPosixFileError("executing", programName, errno);
-          ::_exit(-1);
-        }
-        ::close(fdout[1]);
+      if (::dup2(fdout[1], STDOUT_FILENO) != STDOUT_FILENO) {
+        printPosixFileError("executing", programName, errno);
+        ::_exit(-1);
       }
 
       // Assign stderr to our pipe
-      if (fderr[1] != STDERR_FILENO) {
-        if (::dup2(fderr[1], STDERR_FILENO) != STDERR_FILENO) {
-          printPosixFileError("executing", programName, errno);
-          ::_exit(-1);
-        }
-        ::close(fderr[1]);
+      if (::dup2(fderr[1], STDERR_FILENO) != STDERR_FILENO) {
+        printPosixFileError("executing", programName, errno);
+        ::_exit(-1);
       }
 
       // Change to working dir
@@ -298,25 +538,41 @@ bool Process::begin(StringRef programName, ArrayRef<StringRef> args, StringRef w
         ::_exit(-1);
       }
 
-      // TODO: Search for program ourselves and control the environment precisely.
-      ::execvp(program, _argv.data());
+      // The remaining pipe descriptors are close-on-exec.
+      if (programPath != NULL) {
+        ::execv(programPath, _argv.data());
+        if (errno == ENOEXEC) {
+          SmallVector<char *, 32> shellArgv;
+          shellScriptArgs(programPath, _argv.data(), shellArgv);
+          ::execv(shellArgv[0], shellArgv.data());
+        }
+      } else {
+        ::execvp(program, _argv.data());
+      }
       if (errno == ENOENT) {
         diag::error() << "Program '" << programName << "' not found.";
       } else {
         printPosixFileError("executing", programName, errno);
       }
       ::_exit(-1);
-    } else if (pid == -1) {
+    }
+
+    // We're the parent. We must not hold on to the write ends, or we'd never see
+    // end of input.
+    ::close(fdout[1]);
+    ::close(fderr[1]);
+    if (pid == -1) {
       printPosixFileError("executing", programName, errno);
+      ::close(fdout[0]);
+      ::close(fderr[0]);
       return false;
-    } else {
-      // We're the parent
-      _pid = pid;
-      _stdout.setSource(fdout[0]);
-      _stderr.setSource(fderr[0]);
-
-      return true;
     }
+
+    _pid = pid;
+    _stdout.setSource(fdout[0]);
+    _stderr.setSource(fderr[0]);
+    return true;
+  #endif
   #else
     #error Unimplemented: Process::begin()
   #endif
@@ -341,49 +597,60 @@ native_char_t * Process::appendCommandArg(StringRef arg) {
 }
 
 bool Process::processChildIO() {
-  _stdout.processLines();
-  _stderr.processLines();
+  _stdout.readAvailable();
+  _stderr.readAvailable();
   return true;
 }
 
-bool Process::cleanup(int status, bool signaled) {
-  #if HAVE_UNISTD_H
-    _pid = 0;
-  #endif
-  _stdout.close();
-  _stderr.close();
-  if (status == 0 && !signaled) {
-    if (_listener) {
-      _listener->processFinished(*this, true);
-      return true;
-    }
-  } else if (signaled) {
-    diag::info() << "Process terminated with signal " << status;
-  } else {
-    diag::info() << "Process terminated with exit code " << status;
+void Process::formatCommandLine(SmallVectorImpl<char> & result) const {
   #if HAVE_UNISTD_H
-    SmallString<0> commandLine("  ");
     for (ArrayRef<char *>::const_iterator
         it = _argv.begin(), itEnd = _argv.end(); it != itEnd; ++it) {
       if (*it != NULL) {
         if (it != _argv.begin()) {
-          commandLine.push_back(' ');
+          result.push_back(' ');
         }
-        commandLine.append(*it);
+        StringRef arg(*it);
+        result.append(arg.begin(), arg.end());
       }
     }
-    commandLine.push_back('\n');
-    diag::status() << commandLine;
   #endif
-  }
+}
+
+bool Process::cleanup(int status, bool signaled, const ResourceUsage & usage) {
+  #if HAVE_UNISTD_H
+    _pid = 0;
+  #endif
+  _stdout.close();
+  _stderr.close();
+  _exitStatus = status;
+  _signaled = signaled;
+  _usage = usage;
+  _usage.wallTime = monotonicTime() - _startTime;
 
+  // Reporting the failure is left to the listener, which owns the captured output.
+  bool success = status == 0 && !signaled;
   if (_listener) {
-    _listener->processFinished(*this, false);
+    _listener->processFinished(*this, success);
   }
-  return false;
+  return success;
+}
+
+uint64_t Process::monotonicTime() {
+  #if HAVE_TYPE_TIMESPEC && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (::clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+      return uint64_t(ts.tv_sec) * 1000000 + uint64_t(ts.tv_nsec) / 1000;
+    }
+  #endif
+  return uint64_t(::time(NULL)) * 1000000;
 }
 
 bool Process::waitForProcessEvent() {
+  return waitForProcessEvent(ArrayRef<int>());
+}
+
+bool Process::waitForProcessEvent(ArrayRef<int> wakeFds, ArrayRef<int> writeFds) {
   #if HAVE_UNISTD_H
   // See if there are even any processes, don't wait otherwise
   int runningCount = 0;
@@ -393,12 +660,12 @@ bool Process::waitForProcessEvent() {
       ++runningCount;
     }
   }
-  if (runningCount == 0) {
+  if (runningCount == 0 && wakeFds.empty() && writeFds.empty()) {
     diag::info() << "No processes running";
     return true;
   }
 
-  fds.resize(runningCount * 2);
+  fds.resize(runningCount * 2 + wakeFds.size() + writeFds.size());
   unsigned index = 0;
   for (Process * p = _processList; p != NULL; p = p->_next) {
     if (p->_pid != 0) {
@@ -412,9 +679,26 @@ bool Process::waitForProcessEvent() {
       ++index;
     }
   }
+  for (ArrayRef<int>::const_iterator it = wakeFds.begin(), itEnd = wakeFds.end(); it != itEnd;
+      ++it) {
+    fds[index].fd = *it;
+    fds[index].events = POLLIN;
+    fds[index].revents = 0;
+    ++index;
+  }
+  for (ArrayRef<int>::const_iterator it = writeFds.begin(), itEnd = writeFds.end();
+      it != itEnd; ++it) {
+    fds[index].fd = *it;
+    fds[index].events = POLLOUT;
+    fds[index].revents = 0;
+    ++index;
+  }
 
   int status = ::poll(fds.data(), fds.size(), 100);
   if (status < 0) {
+    if (errno == EINTR) {
+      return true;
+    }
     perror("wait for child process");
     return false;
   }
@@ -423,14 +707,12 @@ bool Process::waitForProcessEvent() {
     index = 0;
     for (Process * p = _processList; p != NULL; p = p->_next) {
       if (p->_pid != 0) {
-        short revOut = fds[index].revents;
-        if (revOut & POLLIN) {
-          p->_stdout.processLines();
+        if (fds[index].revents & (POLLIN | POLLHUP)) {
+          p->_stdout.readAvailable();
         }
         ++index;
-        short revErr = fds[index].revents;
-        if (revErr & POLLIN) {
-          p->_stderr.flush();
+        if (fds[index].revents & (POLLIN | POLLHUP)) {
+          p->_stderr.readAvailable();
         }
         ++index;
       }
@@ -438,7 +720,25 @@ bool Process::waitForProcessEvent() {
   }
 
   while (runningCount > 0) {
+    ResourceUsage usage;
+  #if HAVE_WAIT4 && HAVE_SYS_RESOURCE_H
+    // wait4() also tells us what the child used, which costs nothing extra to collect.
+    struct rusage ru;
+    pid_t id = ::wait4(-1, &status, WNOHANG, &ru);
+    if (id > 0) {
+      usage.userTime = uint64_t(ru.ru_utime.tv_sec) * 1000000 + ru.ru_utime.tv_usec;
+      usage.systemTime = uint64_t(ru.ru_stime.tv_sec) * 1000000 + ru.ru_stime.tv_usec;
+      #if defined(__APPLE__)
+        usage.maxResident = uint64_t(ru.ru_maxrss) / 1024; // Reported in bytes
+      #else
+        usage.maxResident = uint64_t(ru.ru_maxrss);
+      #endif
+      usage.inputBlocks = uint64_t(ru.ru_inblock);
+      usage.outputBlocks = uint64_t(ru.ru_oublock);
+    }
+  #else
     pid_t id = ::waitpid(-1, &status, WNOHANG);
+  #endif
     if (id < 0) {
       if (errno == EINTR) {
         diag::warn() << "::wait() interrupted";
@@ -458,9 +758,9 @@ bool Process::waitForProcessEvent() {
     for (Process * p = _processList; p != NULL; p = p->_next) {
       if (p->_pid == id) {
         if (WIFEXITED(status)) {
-          return p->cleanup(WEXITSTATUS(status), false);
+          return p->cleanup(WEXITSTATUS(status), false, usage);
         } else if (WIFSIGNALED(status)) {
-          return p->cleanup(WTERMSIG(status), true);
+          return p->cleanup(WTERMSIG(status), true, usage);
         } else {
           M_ASSERT(false) << "Invalid result from call to wait()";
         }
@@ -0,0 +1,405 @@
+/* ================================================================ *
+   Writer for tar archives
+ * ================================================================ */
+
+#include "mint/support/Diagnostics.h"
+#include "mint/support/OSError.h"
+#include "mint/support/Path.h"
+#include "mint/support/TarWriter.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#if HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#if HAVE_ZLIB_H
+#include <zlib.h>
+#endif
+
+#if defined(_WIN32)
+  #include <io.h>
+  typedef SSIZE_T ssize_t;
+#endif
+
+namespace mint {
+
+namespace {
+  /// Size of a tar block; headers and file data are padded to a multiple of this.
+  const size_t BLOCK_SIZE = 512;
+
+  /// The archive as a whole is padded to a multiple of this, as tar itself does.
+  const size_t RECORD_SIZE = 20 * BLOCK_SIZE;
+
+  /// Size of the buffers used for compressed output, and for reading files when they
+  /// can't be mapped or sent directly.
+  const size_t BUFFER_SIZE = 256 * 1024;
+
+  /// Largest file size that fits in the 11 octal digits of a ustar header.
+  const uint64_t MAX_USTAR_SIZE = 077777777777ull;
+
+  /// Largest amount of data handed to the compressor at once.
+  const size_t MAX_DEFLATE_INPUT = 1 << 30;
+
+  const char ZEROS[BLOCK_SIZE] = { 0 };
+
+  /// Split 'name' into the 'prefix' and 'name' fields of a ustar header. Returns false
+  /// if there's no way to split it that fits.
+  bool splitName(StringRef name, StringRef & prefix, StringRef & rest) {
+    if (name.size() <= 100) {
+      prefix = StringRef();
+      rest = name;
+      return true;
+    }
+    for (size_t pos = name.size() - 101; pos <= 155 && pos < name.size(); ++pos) {
+      if (name[pos] == '/') {
+        prefix = name.substr(0, pos);
+        rest = name.substr(pos + 1);
+        return !rest.empty();
+      }
+    }
+    return false;
+  }
+
+  /// Append a pax extended header record, which is prefixed by its own length.
+  void appendPaxRecord(SmallVectorImpl<char> & out, StringRef key, StringRef value) {
+    // The length includes the digits of the length itself.
+    size_t length = key.size() + value.size() + 3;
+    char digits[24];
+    int numDigits = snprintf(digits, sizeof(digits), "%lu", (unsigned long)length);
+    length += numDigits;
+    numDigits = snprintf(digits, sizeof(digits), "%lu", (unsigned long)length);
+    if (size_t(numDigits) + key.size() + value.size() + 3 != length) {
+      ++length;
+      numDigits = snprintf(digits, sizeof(digits), "%lu", (unsigned long)length);
+    }
+    out.append(digits, digits + numDigits);
+    out.push_back(' ');
+    out.append(key.begin(), key.end());
+    out.push_back('=');
+    out.append(value.begin(), value.end());
+    out.push_back('\n');
+  }
+}
+
+TarWriter::TarWriter() : _fd(-1), _compression(NONE), _mtime(0), _written(0), _zstream(NULL) {}
+
+TarWriter::~TarWriter() {
+#if HAVE_ZLIB_H
+  if (_zstream != NULL) {
+    deflateEnd(static_cast<z_stream *>(_zstream));
+    delete static_cast<z_stream *>(_zstream);
+  }
+#endif
+  if (_fd != -1) {
+    ::close(_fd);
+  }
+}
+
+bool TarWriter::compressionForPath(StringRef path, Compression & result) {
+  if (path.endsWith(".tar")) {
+    result = NONE;
+    return true;
+  }
+#if HAVE_ZLIB_H
+  if (path.endsWith(".tar.gz") || path.endsWith(".tgz")) {
+    result = GZIP;
+    return true;
+  }
+#endif
+  return false;
+}
+
+bool TarWriter::open(StringRef path, Compression compression, int64_t mtime) {
+  _path.assign(path);
+  _compression = compression;
+  _mtime = mtime > 0 ? mtime : 0;
+  _written = 0;
+
+  StringRef parentDir = path::parent(path);
+  if (!parentDir.empty() && !path::makeDirectoryPath(parentDir)) {
+    return false;
+  }
+  _fd = ::open(_path.cstr(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (_fd == -1) {
+    printPosixFileError("writing", path, errno);
+    return false;
+  }
+
+  if (compression == GZIP) {
+#if HAVE_ZLIB_H
+    z_stream * strm = new z_stream;
+    ::memset(strm, 0, sizeof(z_stream));
+    // A window size of 15 + 16 asks for a gzip wrapper. Its header has no timestamp
+    // or file name, so it doesn't affect reproducibility.
+    if (deflateInit2(strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+        Z_DEFAULT_STRATEGY) != Z_OK) {
+      delete strm;
+      printPosixFileError("compressing", path, ENOMEM);
+      return false;
+    }
+    _zstream = strm;
+    _buffer.resize(BUFFER_SIZE);
+#else
+    return false;
+#endif
+  }
+  return true;
+}
+
+bool TarWriter::addDirectory(StringRef name) {
+  SmallString<128> dirName(name);
+  dirName.push_back('/');
+  return writeHeader(dirName, '5', 0, 0755);
+}
+
+bool TarWriter::addFile(StringRef name, StringRef sourcePath) {
+  SmallString<128> sourceBuffer(sourcePath);
+  int fd = ::open(sourceBuffer.cstr(), O_RDONLY);
+  if (fd == -1) {
+    printPosixFileError("reading", sourcePath, errno);
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) == -1) {
+    printPosixFileError("reading", sourcePath, errno);
+    ::close(fd);
+    return false;
+  }
+  // Only the executable bit is kept from the source's permissions.
+  unsigned mode = (st.st_mode & 0111) ? 0755 : 0644;
+  bool success = writeHeader(name, '0', st.st_size, mode) &&
+      writeFileData(fd, sourcePath, st.st_size);
+  ::close(fd);
+  return success;
+}
+
+bool TarWriter::close() {
+  // The end of the archive is marked by two empty blocks.
+  bool success = write(ZEROS, BLOCK_SIZE) && write(ZEROS, BLOCK_SIZE);
+  while (success && _written % RECORD_SIZE != 0) {
+    success = write(ZEROS, BLOCK_SIZE);
+  }
+#if HAVE_ZLIB_H
+  if (_zstream != NULL) {
+    success = success && deflate(NULL, 0, true);
+    deflateEnd(static_cast<z_stream *>(_zstream));
+    delete static_cast<z_stream *>(_zstream);
+    _zstream = NULL;
+  }
+#endif
+  if (::close(_fd) == -1 && success) {
+    printPosixFileError("writing", _path, errno);
+    success = false;
+  }
+  _fd = -1;
+  return success;
+}
+
+bool TarWriter::writeHeader(StringRef name, char type, uint64_t size, unsigned mode) {
+  StringRef prefix, rest;
+  bool nameFits = splitName(name, prefix, rest);
+  if (nameFits && size <= MAX_USTAR_SIZE) {
+    return writeUstarHeader(name, type, size, mode);
+  }
+
+  // Put whatever doesn't fit into a pax extended header, which applies to the entry
+  // that follows it.
+  SmallString<256> paxData;
+  if (!nameFits) {
+    appendPaxRecord(paxData, "path", name);
+  }
+  if (size > MAX_USTAR_SIZE) {
+    char digits[24];
+    int numDigits = snprintf(digits, sizeof(digits), "%llu", (unsigned long long)size);
+    appendPaxRecord(paxData, "size", StringRef(digits, numDigits));
+  }
+  StringRef shortName = nameFits ? name : name.substr(name.size() - 100);
+  return writeUstarHeader("PaxHeader", 'x', paxData.size(), 0644)
+      && write(paxData.data(), paxData.size())
+      && writePadding(paxData.size())
+      && writeUstarHeader(shortName, type, size > MAX_USTAR_SIZE ? 0 : size, mode);
+}
+
+bool TarWriter::writeUstarHeader(StringRef name, char type, uint64_t size, unsigned mode) {
+  StringRef prefix, rest;
+  if (!splitName(name, prefix, rest)) {
+    // Only reached with the truncated name of an entry that has a pax header.
+    prefix = StringRef();
+    rest = name.substr(name.size() - 100);
+  }
+
+  char block[BLOCK_SIZE];
+  ::memset(block, 0, sizeof(block));
+  ::memcpy(block, rest.data(), rest.size());
+  snprintf(block + 100, 8, "%07o", mode);
+  snprintf(block + 108, 8, "%07o", 0);
+  snprintf(block + 116, 8, "%07o", 0);
+  snprintf(block + 124, 12, "%011llo", (unsigned long long)size);
+  snprintf(block + 136, 12, "%011llo", (unsigned long long)_mtime);
+  block[156] = type;
+  ::memcpy(block + 257, "ustar", 6);
+  ::memcpy(block + 263, "00", 2);
+  ::memcpy(block + 265, "root", 4);
+  ::memcpy(block + 297, "root", 4);
+  ::memcpy(block + 345, prefix.data(), prefix.size());
+
+  // The checksum is computed with the checksum field itself filled with spaces.
+  ::memset(block + 148, ' ', 8);
+  unsigned checksum = 0;
+  for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+    checksum += (unsigned char)block[i];
+  }
+  snprintf(block + 148, 8, "%06o", checksum);
+  block[155] = ' ';
+  return write(block, BLOCK_SIZE);
+}
+
+bool TarWriter::writeFileData(int fd, StringRef sourcePath, uint64_t size) {
+  uint64_t remaining = size;
+  if (_compression == NONE) {
+  #if HAVE_SYS_SENDFILE_H
+    // Let the kernel move the data straight from the source file to the archive.
+    while (remaining > 0) {
+      ssize_t sent = ::sendfile(_fd, fd, NULL, size_t(remaining));
+      if (sent > 0) {
+        remaining -= sent;
+        _written += sent;
+      } else if (sent == 0 || errno != EINTR) {
+        break;
+      }
+    }
+  #endif
+  } else {
+  #if HAVE_SYS_MMAN_H
+    // Feed the compressor straight from the page cache.
+    if (remaining > 0) {
+      void * data = ::mmap(NULL, size_t(remaining), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        ::madvise(data, size_t(remaining), MADV_SEQUENTIAL);
+        bool success = write(static_cast<const char *>(data), size_t(remaining));
+        ::munmap(data, size_t(remaining));
+        if (!success) {
+          return false;
+        }
+        remaining = 0;
+      }
+    }
+  #endif
+  }
+
+  if (remaining > 0) {
+    // Read whatever is left, starting where the methods above stopped.
+    if (::lseek(fd, off_t(size - remaining), SEEK_SET) == -1) {
+      printPosixFileError("reading", sourcePath, errno);
+      return false;
+    }
+    SmallVector<char, 0> buffer;
+    buffer.resize(BUFFER_SIZE);
+    while (remaining > 0) {
+      size_t count = remaining < buffer.size() ? size_t(remaining) : buffer.size();
+      ssize_t nread = ::read(fd, buffer.data(), count);
+      if (nread > 0) {
+        if (!write(buffer.data(), size_t(nread))) {
+          return false;
+        }
+        remaining -= nread;
+      } else if (nread == 0) {
+        // The header has already promised 'size' bytes.
+        console::err() << "Error reading '" << sourcePath << "': file changed while archiving.\n";
+        return false;
+      } else if (errno != EINTR) {
+        printPosixFileError("reading", sourcePath, errno);
+        return false;
+      }
+    }
+  }
+  return writePadding(size);
+}
+
+bool TarWriter::writePadding(uint64_t size) {
+  size_t extra = size_t(size % BLOCK_SIZE);
+  return extra == 0 || write(ZEROS, BLOCK_SIZE - extra);
+}
+
+bool TarWriter::write(const char * data, size_t size) {
+  _written += size;
+  if (_compression == NONE) {
+    return writeRaw(data, size);
+  }
+  while (size > MAX_DEFLATE_INPUT) {
+    if (!deflate(data, MAX_DEFLATE_INPUT, false)) {
+      return false;
+    }
+    data += MAX_DEFLATE_INPUT;
+    size -= MAX_DEFLATE_INPUT;
+  }
+  return deflate(data, size, false);
+}
+
+bool TarWriter::writeRaw(const char * data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(_fd, data, size);
+    if (written >= 0) {
+      data += written;
+      size -= written;
+    } else if (errno != EINTR) {
+      printPosixFileError("writing", _path, errno);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TarWriter::deflate(const char * data, size_t size, bool finish) {
+#if HAVE_ZLIB_H
+  z_stream * strm = static_cast<z_stream *>(_zstream);
+  strm->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  strm->avail_in = uInt(size);
+  for (;;) {
+    strm->next_out = reinterpret_cast<Bytef *>(_buffer.data());
+    strm->avail_out = uInt(_buffer.size());
+    int status = ::deflate(strm, finish ? Z_FINISH : Z_NO_FLUSH);
+    if (status == Z_STREAM_ERROR) {
+      console::err() << "Error compressing '" << _path << "'.\n";
+      return false;
+    }
+    if (!writeRaw(_buffer.data(), _buffer.size() - strm->avail_out)) {
+      return false;
+    }
+    if (finish ? status == Z_STREAM_END : strm->avail_out != 0) {
+      return true;
+    }
+  }
+#else
+  return false;
+#endif
+}
+
+}
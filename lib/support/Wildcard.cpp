@@ -5,67 +5,275 @@
 #include "mint/support/Wildcard.h"
 #include "mint/support/OStream.h"
 
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
 namespace mint {
 
-WildcardMatcher::WildcardMatcher(StringRef pattern) : _pattern(pattern) {}
+namespace {
+  /// Upper limit on the number of alternatives that brace expansion can produce,
+  /// so that a pattern like '{a,b}{c,d}{e,f}...' can't grow without bound.
+  const size_t MAX_ALTERNATIVES = 1024;
+}
+
+WildcardMatcher::WildcardMatcher(StringRef pattern) {
+  expandBraces(StringRef(), pattern, false);
+}
 
-bool WildcardMatcher::match(StringRef str) {
-  return matchImpl(str, 0, 0);
+void WildcardMatcher::exclude(StringRef pattern) {
+  expandBraces(StringRef(), pattern, true);
 }
 
-unsigned WildcardMatcher::countNonStarChars(unsigned startIndex) {
-  unsigned count = 0;
-  for (unsigned j = startIndex; j < _pattern.size(); ++j) {
-    if (_pattern[j] != '*') {
-      ++count;
+bool WildcardMatcher::match(StringRef str) const {
+  bool matched = false;
+  for (const Alternative * alt = _alternatives.begin(); alt != _alternatives.end(); ++alt) {
+    if (!alt->isExclude && matchAlternative(*alt, str)) {
+      matched = true;
+      break;
+    }
+  }
+  if (!matched) {
+    return false;
+  }
+  for (const Alternative * alt = _alternatives.begin(); alt != _alternatives.end(); ++alt) {
+    if (alt->isExclude && matchAlternative(*alt, str)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void WildcardMatcher::expandBraces(StringRef prefix, StringRef pattern, bool isExclude) {
+  if (_alternatives.size() >= MAX_ALTERNATIVES) {
+    return;
+  }
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    char ch = pattern[i];
+    if (ch == '\\') {
+      ++i;
+    } else if (ch == '{') {
+      // Find the matching close brace, and the commas that separate the alternatives.
+      SmallVector<size_t, 8> commas;
+      size_t close = StringRef::npos;
+      int depth = 0;
+      for (size_t j = i + 1; j < pattern.size(); ++j) {
+        char c = pattern[j];
+        if (c == '\\') {
+          ++j;
+        } else if (c == '{') {
+          ++depth;
+        } else if (c == '}') {
+          if (depth == 0) {
+            close = j;
+            break;
+          }
+          --depth;
+        } else if (c == ',' && depth == 0) {
+          commas.push_back(j);
+        }
+      }
+      if (close == StringRef::npos) {
+        // No closing brace, so this one is literal.
+        continue;
+      }
+      commas.push_back(close);
+      SmallString<64> newPrefix(prefix);
+      newPrefix.append(pattern.substr(0, i));
+      size_t start = i + 1;
+      for (size_t * it = commas.begin(); it != commas.end(); ++it) {
+        SmallString<64> rest(pattern.substr(start, *it - start));
+        rest.append(pattern.substr(close + 1));
+        expandBraces(newPrefix, rest, isExclude);
+        start = *it + 1;
+      }
+      return;
     }
   }
-  return count;
+
+  SmallString<64> expanded(prefix);
+  expanded.append(pattern);
+  compileAlternative(expanded, isExclude);
 }
 
-bool WildcardMatcher::matchImpl(StringRef str, unsigned patternIndex, unsigned strIndex) {
-  while (patternIndex < _pattern.size()) {
-    char ch = _pattern[patternIndex++];
+void WildcardMatcher::compileAlternative(StringRef pattern, bool isExclude) {
+  Alternative alt;
+  alt.segmentBegin = _segments.size();
+  alt.hasStar = false;
+  alt.isExclude = isExclude;
+
+  Segment seg;
+  seg.atomBegin = _atoms.size();
+  seg.literalOffset = _literals.size();
+  seg.isLiteral = true;
+
+  size_t pos = 0;
+  while (pos < pattern.size()) {
+    char ch = pattern[pos++];
     if (ch == '*') {
-      if (patternIndex >= _pattern.size()) {
-        // Wildcard at end matches rest of input string.
-        return true;
+      // Consecutive stars are the same as one.
+      while (pos < pattern.size() && pattern[pos] == '*') {
+        ++pos;
       }
+      endSegment(seg);
+      alt.hasStar = true;
+      continue;
+    }
 
-      // Count the number of non-wildcard characters remaining in the pattern.
-      // this is how long the rest of the input string needs to be.
-      unsigned suffixLength = countNonStarChars(patternIndex);
-
-      // Simulate a greedy search: Start at the last possible position where
-      // a match could happen and call this function recursively on the trailing
-      // part of the pattern (after the star) and the trailing part of the input
-      // string (at the start of the suffix.) If that fails, then back up 1 character
-      // and try again. Repeat until we reach the position where this wildcard
-      // was found - the point where the wildcard matches 0 characters.
-      // Yes, this is N^2 - or worse if there are multiple stars in the pattern -
-      // but the setup time is small, and most input strings will fail early.
-      for (int i = str.size() - suffixLength; i >= int(strIndex); --i) {
-        if (matchImpl(str, patternIndex, i)) {
-          return true;
-        }
+    Atom atom;
+    atom.kind = LITERAL;
+    atom.ch = (unsigned char)ch;
+    atom.charClass = 0;
+    if (ch == '?') {
+      atom.kind = ANY;
+    } else if (ch == '[') {
+      size_t end = compileCharClass(pattern, pos);
+      if (end != StringRef::npos) {
+        atom.kind = CLASS;
+        atom.charClass = (unsigned short)(_classes.size() - 1);
+        pos = end;
       }
-      return false;
+    } else if (ch == '\\' && pos < pattern.size()) {
+      atom.ch = (unsigned char)pattern[pos++];
     }
 
-    // Either the input string is too short or the character doesn't match.
-    if (strIndex >= str.size() || (ch != '?' && ch != str[strIndex])) {
-      return false;
+    if (atom.kind == LITERAL) {
+      _literals.push_back(char(atom.ch));
+    } else {
+      seg.isLiteral = false;
     }
-    ++strIndex;
+    _atoms.push_back(atom);
   }
+  endSegment(seg);
+
+  alt.segmentEnd = _segments.size();
+  _alternatives.push_back(alt);
+}
 
-  // We must have gotten to the end of the input string.
-  return strIndex == str.size();
+size_t WildcardMatcher::compileCharClass(StringRef pattern, size_t pos) {
+  CharClass cc;
+  ::memset(cc.bits, 0, sizeof(cc.bits));
+  bool negate = false;
+  if (pos < pattern.size() && (pattern[pos] == '!' || pattern[pos] == '^')) {
+    negate = true;
+    ++pos;
+  }
+
+  // A ']' immediately after the opening bracket is part of the set.
+  bool first = true;
+  while (pos < pattern.size()) {
+    unsigned char lo = pattern[pos];
+    if (lo == ']' && !first) {
+      break;
+    }
+    first = false;
+    if (lo == '\\' && pos + 1 < pattern.size()) {
+      lo = pattern[++pos];
+    }
+    ++pos;
+    unsigned char hi = lo;
+    if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']') {
+      hi = pattern[pos + 1];
+      pos += 2;
+      if (hi == '\\' && pos < pattern.size()) {
+        hi = pattern[pos++];
+      }
+    }
+    for (unsigned c = lo; c <= hi; ++c) {
+      cc.bits[c >> 5] |= 1u << (c & 31);
+    }
+  }
+
+  if (pos >= pattern.size()) {
+    return StringRef::npos;
+  }
+
+  if (negate) {
+    for (unsigned i = 0; i < 256 / 32; ++i) {
+      cc.bits[i] = ~cc.bits[i];
+    }
+  }
+  _classes.push_back(cc);
+  return pos + 1;
+}
+
+void WildcardMatcher::endSegment(Segment & seg) {
+  seg.atomEnd = _atoms.size();
+  _segments.push_back(seg);
+  seg.atomBegin = _atoms.size();
+  seg.literalOffset = _literals.size();
+  seg.isLiteral = true;
+}
+
+bool WildcardMatcher::matchAlternative(const Alternative & alt, StringRef str) const {
+  const Segment & first = _segments[alt.segmentBegin];
+  size_t firstLength = first.atomEnd - first.atomBegin;
+  if (!alt.hasStar) {
+    return firstLength == str.size() && matchSegment(first, str.data());
+  }
+
+  // With at least one star, the first segment is anchored at the start of the input,
+  // and the last segment at the end. Check those first, since they are the most
+  // likely to reject the input.
+  const Segment & last = _segments[alt.segmentEnd - 1];
+  size_t lastLength = last.atomEnd - last.atomBegin;
+  if (firstLength + lastLength > str.size()) {
+    return false;
+  }
+  size_t limit = str.size() - lastLength;
+  if (!matchSegment(first, str.data()) || !matchSegment(last, str.data() + limit)) {
+    return false;
+  }
+
+  // Each segment in between is placed at the leftmost position where it fits; leaving
+  // as much room as possible for the segments that follow means that a later position
+  // would never succeed where this one failed, so there's no need to backtrack.
+  size_t pos = firstLength;
+  for (unsigned i = alt.segmentBegin + 1; i + 1 < alt.segmentEnd; ++i) {
+    const Segment & seg = _segments[i];
+    size_t length = seg.atomEnd - seg.atomBegin;
+    for (;;) {
+      if (pos + length > limit) {
+        return false;
+      }
+      if (matchSegment(seg, str.data() + pos)) {
+        pos += length;
+        break;
+      }
+      ++pos;
+    }
+  }
+  return true;
+}
+
+bool WildcardMatcher::matchSegment(const Segment & seg, const char * str) const {
+  if (seg.isLiteral) {
+    return ::memcmp(str, _literals.data() + seg.literalOffset, seg.atomEnd - seg.atomBegin) == 0;
+  }
+  for (unsigned i = seg.atomBegin; i < seg.atomEnd; ++i, ++str) {
+    const Atom & atom = _atoms[i];
+    unsigned char ch = *str;
+    switch (atom.kind) {
+      case LITERAL:
+        if (ch != atom.ch) {
+          return false;
+        }
+        break;
+      case ANY:
+        break;
+      case CLASS:
+        if ((_classes[atom.charClass].bits[ch >> 5] & (1u << (ch & 31))) == 0) {
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
 }
 
 bool WildcardMatcher::hasWildcardChars(StringRef str) {
   for (StringRef::const_iterator it = str.begin(), itEnd = str.end(); it != itEnd; ++it) {
-    if (*it == '*' || *it == '?') {
+    if (*it == '*' || *it == '?' || *it == '[' || *it == '{') {
       return true;
     }
   }
@@ -24,6 +24,14 @@ for dirpath, dirnames, filenames in os.walk("test/unit"):
     if file.endswith(".cpp"):
       unittest_objects.append(file[:-4] + ".o")
 
+benchmark_sources = []
+benchmark_objects = []
+for dirpath, dirnames, filenames in os.walk("test/bench"):
+  for file in filenames:
+    benchmark_sources.append(os.path.join(dirpath, file))
+    if file.endswith(".cpp"):
+      benchmark_objects.append(file[:-4] + ".o")
+
 if not headers:
   print "No header files found!"
   sys.exit(-1)
@@ -48,5 +56,9 @@ print >> fh
 print >> fh, "MINT_UNITTEST_SOURCES =\\\n  " + "\\\n  ".join(unittest_sources)
 print >> fh
 print >> fh, "MINT_UNITTEST_OBJECTS =\\\n  " + "\\\n  ".join(unittest_objects)
+print >> fh
+print >> fh, "MINT_BENCHMARK_SOURCES =\\\n  " + "\\\n  ".join(benchmark_sources)
+print >> fh
+print >> fh, "MINT_BENCHMARK_OBJECTS =\\\n  " + "\\\n  ".join(benchmark_objects)
 
 fh.close()
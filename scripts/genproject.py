@@ -0,0 +1,159 @@
+#!/usr/bin/env python
+#
+# Generate a synthetic Mint project for benchmarking.
+#
+# The project consists of a number of modules, each in its own subdirectory, each
+# containing a number of cplus_builder targets. Targets depend on targets from earlier
+# modules, and a fraction of them use glob() rather than an explicit source list. The
+# "compiler" is a shell script that just creates the output files, so the time measured
+# is the time spent in Mint itself.
+
+from __future__ import print_function
+
+import optparse
+import os
+import random
+import stat
+import sys
+
+STUB_COMPILER = """\
+#!/bin/sh
+# Stub compiler: create each output file listed before '--'.
+for f in "$@"; do
+  [ "$f" = "--" ] && break
+  mkdir -p "$(dirname "$f")" && : > "$f"
+done
+"""
+
+COMMON_MODULE = """\
+# -----------------------------------------------------------------------------
+# Definitions shared by all modules of the synthetic project.
+# -----------------------------------------------------------------------------
+
+from prelude:compilers.compiler import compiler
+
+stub_compiler = compiler {
+  param flags : list[string]
+  param include_dirs : list[string]
+  param source_dir : string
+  param warnings_as_errors : bool
+  param all_warnings : bool
+  actions => [
+    command(path.join(path.top_level_source_dir(), "stubcc"), outputs ++ ["--"] ++ sources)
+  ]
+}
+"""
+
+def add_options(parser):
+  """Add the options that control the shape of the generated project."""
+  parser.add_option("--modules", type="int", default=20,
+      help="number of modules (subdirectories) [%default]")
+  parser.add_option("--targets", type="int", default=5,
+      help="number of cplus_builder targets per module [%default]")
+  parser.add_option("--sources", type="int", default=20,
+      help="number of source files per target [%default]")
+  parser.add_option("--fan-in", type="int", default=3, dest="fan_in",
+      help="number of targets each target depends on [%default]")
+  parser.add_option("--glob-fraction", type="float", default=0.5, dest="glob_fraction",
+      help="fraction of targets that list their sources with glob() [%default]")
+  parser.add_option("--seed", type="int", default=1,
+      help="random seed, so that projects are reproducible [%default]")
+
+def module_name(m):
+  return "m%03d" % m
+
+def target_name(m, t):
+  return "m%03d_t%d" % (m, t)
+
+def write_file(path, contents):
+  fh = open(path, "w")
+  fh.write(contents)
+  fh.close()
+
+def generate(dest, options):
+  """Write the project into directory 'dest'. Returns a list of all source files."""
+  rng = random.Random(options.seed)
+  all_targets = []
+  all_sources = []
+  if not os.path.isdir(dest):
+    os.makedirs(dest)
+
+  stub_path = os.path.join(dest, "stubcc")
+  write_file(stub_path, STUB_COMPILER)
+  os.chmod(stub_path, os.stat(stub_path).st_mode | stat.S_IXUSR | stat.S_IXGRP | stat.S_IXOTH)
+  write_file(os.path.join(dest, "common.mint"), COMMON_MODULE)
+
+  for m in range(options.modules):
+    mod_dir = os.path.join(dest, module_name(m))
+    targets = []
+    imports = {}
+    for t in range(options.targets):
+      name = target_name(m, t)
+      src_dir = os.path.join(mod_dir, "t%d" % t)
+      os.makedirs(src_dir)
+      sources = []
+      for s in range(options.sources):
+        rel = "t%d/src%d.cpp" % (t, s)
+        write_file(os.path.join(mod_dir, rel), "int %s_%d() { return %d; }\n" % (name, s, s))
+        sources.append(rel)
+        all_sources.append(os.path.join(mod_dir, rel))
+
+      # Pick dependencies from targets defined before this one.
+      deps = rng.sample(all_targets, min(options.fan_in, len(all_targets)))
+      for dm, dt in deps:
+        if dm != m:
+          imports.setdefault(dm, set()).add(target_name(dm, dt))
+
+      targets.append((t, sources, deps, rng.random() < options.glob_fraction))
+      all_targets.append((m, t))
+
+    lines = [
+      "# Generated by genproject.py",
+      "",
+      "from prelude:builders import cplus_builder",
+      "from common import stub_compiler",
+    ]
+    for dm in sorted(imports):
+      lines.append("from %s import %s" % (module_name(dm), ", ".join(sorted(imports[dm]))))
+    lines.append("")
+    for t, sources, deps, use_glob in targets:
+      lines.append("%s = cplus_builder {" % target_name(m, t))
+      if use_glob:
+        lines.append("  sources = glob('t%d/*.cpp')" % t)
+      else:
+        lines.append("  sources = [")
+        lines.extend("    '%s'," % src for src in sources)
+        lines.append("  ]")
+      if deps:
+        lines.append("  depends = [ %s ]" % ", ".join(target_name(dm, dt) for dm, dt in deps))
+      lines.append("  compiler = stub_compiler")
+      lines.append("  include_dirs = [ 't%d' ]" % t)
+      lines.append("  cplus_flags = [ '-DSYNTHETIC' ]")
+      lines.append("}")
+      lines.append("")
+    write_file(os.path.join(mod_dir, "module.mint"), "\n".join(lines))
+
+  # The top-level module imports one target from each module so that all are loaded.
+  lines = [ "# Generated by genproject.py", "" ]
+  for m in range(options.modules):
+    lines.append("from %s import %s" % (module_name(m), target_name(m, 0)))
+  lines.append("")
+  write_file(os.path.join(dest, "module.mint"), "\n".join(lines))
+  return all_sources
+
+def main():
+  parser = optparse.OptionParser(usage="%prog [options] <output-dir>")
+  add_options(parser)
+  options, args = parser.parse_args()
+  if len(args) != 1:
+    parser.error("Expected a single output directory.")
+  if os.path.exists(args[0]) and os.listdir(args[0]):
+    parser.error("Output directory '%s' is not empty." % args[0])
+  if options.targets < 1:
+    parser.error("There must be at least one target per module.")
+  sources = generate(args[0], options)
+  print("Generated %d modules, %d targets, %d sources." % (
+      options.modules, options.modules * options.targets, len(sources)))
+
+if __name__ == "__main__":
+  main()
@@ -0,0 +1,147 @@
+#!/usr/bin/env python
+#
+# End-to-end benchmark driver. Generates a synthetic project with genproject.py,
+# then times each phase of a typical Mint session against it and writes the
+# results as JSON.
+
+from __future__ import print_function
+
+import json
+import optparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import genproject
+
+# Phases, in the order they are run. Each is (name, mint arguments, prepare function).
+def touch_one(options, sources):
+  """Make one source file newer than everything else in the tree."""
+  path = sources[len(sources) // 2]
+  stamp = max(time.time(), os.stat(path).st_mtime) + 2
+  os.utime(path, (stamp, stamp))
+
+PHASES = [
+  ("init", ["init", "<source-dir>"], None),
+  ("config", ["config"], None),
+  ("build", ["build"], None),
+  ("noop_build", ["build"], None),
+  ("touch_build", ["build"], touch_one),
+  ("targets", ["targets"], None),
+  ("generate_makefile", ["generate", "makefile"], None),
+]
+
+def run_phase(mint, args, cwd):
+  """Run mint once, returning wall time, and the CPU time and peak RSS of that process.
+     The child is reaped with wait4 so that its own resource usage can be read; the
+     totals for RUSAGE_CHILDREN would give the largest peak of any phase so far."""
+  return run_command([mint] + args, cwd)
+
+def run_command(argv, cwd):
+  start = time.time()
+  devnull = open(os.devnull, "w")
+  proc = subprocess.Popen(argv, cwd=cwd, stdout=devnull, stderr=subprocess.STDOUT)
+  _, status, usage = os.wait4(proc.pid, 0)
+  wall = time.time() - start
+  devnull.close()
+  if os.WIFEXITED(status):
+    status = os.WEXITSTATUS(status)
+  else:
+    status = -os.WTERMSIG(status)
+  proc.returncode = status
+  return {
+    "status": status,
+    "wall": wall,
+    "user": usage.ru_utime,
+    "sys": usage.ru_stime,
+    "maxrss_kb": usage.ru_maxrss,
+  }
+
+def median(values):
+  values = sorted(values)
+  mid = len(values) // 2
+  return values[mid] if len(values) % 2 else (values[mid - 1] + values[mid]) / 2.0
+
+def summarize(samples):
+  result = {}
+  for key in ("wall", "user", "sys"):
+    values = [s[key] for s in samples]
+    result[key] = { "min": min(values), "median": median(values), "samples": values }
+  result["maxrss_kb"] = max(s["maxrss_kb"] for s in samples)
+  return result
+
+def main():
+  parser = optparse.OptionParser(usage="%prog [options] --mint <path-to-mint>")
+  parser.add_option("--mint", help="path to the mint executable")
+  parser.add_option("--repeat", type="int", default=3,
+      help="number of times to run the whole sequence of phases [%default]")
+  parser.add_option("--workdir", help="directory for the generated project (default: temporary)")
+  parser.add_option("--output", "-o", help="write JSON results here instead of stdout")
+  parser.add_option("--keep", action="store_true", help="don't delete the generated project")
+  genproject.add_options(parser)
+  options, args = parser.parse_args()
+  if not options.mint:
+    parser.error("The --mint option is required.")
+  mint = os.path.abspath(options.mint)
+
+  workdir = options.workdir or tempfile.mkdtemp(prefix="mintbench")
+  source_dir = os.path.join(workdir, "src")
+  if os.path.exists(source_dir):
+    shutil.rmtree(source_dir)
+  sources = genproject.generate(source_dir, options)
+
+  samples = dict((name, []) for name, _, _ in PHASES)
+  failed = False
+  for run in range(options.repeat):
+    build_dir = os.path.join(workdir, "build%d" % run)
+    if os.path.exists(build_dir):
+      shutil.rmtree(build_dir)
+    os.makedirs(build_dir)
+    for name, args, prepare in PHASES:
+      if prepare:
+        prepare(options, sources)
+      args = [source_dir if a == "<source-dir>" else a for a in args]
+      sample = run_phase(mint, args, build_dir)
+      if sample["status"] != 0:
+        print("Phase '%s' failed with status %d." % (name, sample["status"]), file=sys.stderr)
+        failed = True
+      samples[name].append(sample)
+    if failed:
+      break
+
+  results = {
+    "mint": mint,
+    "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+    "project": {
+      "modules": options.modules,
+      "targets_per_module": options.targets,
+      "sources_per_target": options.sources,
+      "fan_in": options.fan_in,
+      "glob_fraction": options.glob_fraction,
+      "seed": options.seed,
+      "source_files": len(sources),
+    },
+    "repeat": options.repeat,
+    # On Linux the peak RSS of a child carries over from the driver it was forked from,
+    # so no phase can report less than this.
+    "rss_floor_kb": run_command(["true"], workdir)["maxrss_kb"],
+    "phases": [dict(name=name, **summarize(samples[name])) for name, _, _ in PHASES],
+  }
+
+  text = json.dumps(results, indent=2, sort_keys=True)
+  if options.output:
+    fh = open(options.output, "w")
+    fh.write(text + "\n")
+    fh.close()
+  else:
+    print(text)
+
+  if not options.keep and not options.workdir:
+    shutil.rmtree(workdir)
+  sys.exit(1 if failed else 0)
+
+if __name__ == "__main__":
+  main()
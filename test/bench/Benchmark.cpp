@@ -0,0 +1,199 @@
+/* ================================================================== *
+ * Main benchmark module.
+ * ================================================================== */
+
+#include "Benchmark.h"
+#include "mint/support/GC.h"
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <new>
+
+// Replace the global allocation functions so that heap allocations can be counted.
+// GC objects are allocated separately, and counted by GC::allocationCount().
+
+namespace {
+  unsigned long heapAllocations = 0;
+}
+
+void * operator new(size_t size) {
+  ++heapAllocations;
+  void * mem = malloc(size != 0 ? size : 1);
+  if (mem == NULL) {
+    throw std::bad_alloc();
+  }
+  return mem;
+}
+
+void * operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void * mem) throw() {
+  free(mem);
+}
+
+void operator delete[](void * mem) throw() {
+  free(mem);
+}
+
+namespace mint {
+namespace bench {
+
+namespace {
+  Registration * registrations = NULL;
+  volatile unsigned long sinkValue;
+  const void * volatile sinkPointer;
+
+  /// Minimum amount of time for a measurement to be considered accurate.
+  const double MIN_TIME = 0.25;
+
+  unsigned long allocationCount() {
+    return heapAllocations + GC::allocationCount();
+  }
+
+  double now() {
+  #if HAVE_TYPE_TIMESPEC && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+  #else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return double(tv.tv_sec) + double(tv.tv_usec) * 1e-6;
+  #endif
+  }
+
+  /// Run a benchmark with increasing iteration counts until it takes long enough to measure.
+  void run(const Registration * reg) {
+    for (unsigned iterations = 1;; iterations *= 2) {
+      State state(iterations);
+      reg->function()(state);
+      double elapsed = state.elapsed();
+      unsigned long allocations = state.allocations();
+      GC::sweep();
+      if (elapsed < MIN_TIME && iterations < (1u << 30)) {
+        continue;
+      }
+
+      printf("%-32s %10u %12.1f ns/op %8.2f allocs/op", reg->name(), iterations,
+          elapsed * 1e9 / iterations, double(allocations) / iterations);
+      if (state.bytesProcessed() > 0) {
+        printf(" %10.1f MB/s", state.bytesProcessed() / elapsed / (1024.0 * 1024.0));
+      }
+      for (SmallVectorImpl<State::Counter>::const_iterator
+          it = state.counters().begin(), itEnd = state.counters().end(); it != itEnd; ++it) {
+        printf("  %s=%.3g", it->name, it->value);
+      }
+      printf("\n");
+      fflush(stdout);
+      return;
+    }
+  }
+}
+
+State::State(unsigned iterations)
+  : _iterations(iterations)
+  , _start(now())
+  , _allocStart(allocationCount())
+  , _bytes(0)
+{
+}
+
+void State::resetTimer() {
+  _start = now();
+  _allocStart = allocationCount();
+}
+
+unsigned long State::allocations() const {
+  return allocationCount() - _allocStart;
+}
+
+double State::elapsed() const {
+  return now() - _start;
+}
+
+void State::setCounter(const char * name, double value) {
+  for (SmallVectorImpl<Counter>::iterator it = _counters.begin(); it != _counters.end(); ++it) {
+    if (strcmp(it->name, name) == 0) {
+      it->value = value;
+      return;
+    }
+  }
+  Counter c = { name, value };
+  _counters.push_back(c);
+}
+
+Registration::Registration(const char * name, BenchmarkFunction fn)
+  : _name(name)
+  , _function(fn)
+  , _next(registrations)
+{
+  registrations = this;
+}
+
+const Registration * Registration::first() {
+  return registrations;
+}
+
+void keep(unsigned long value) {
+  sinkValue = value;
+}
+
+void keep(const void * value) {
+  sinkPointer = value;
+}
+
+StringRef opaque(StringRef str) {
+  sinkPointer = str.data();
+  return str;
+}
+
+}
+}
+
+/// Run all benchmarks, or just the ones whose names contain one of the arguments.
+int main(int argc, char **argv) {
+  using namespace mint::bench;
+  mint::GC::init();
+  // Registrations are pushed onto the front of the list, so reverse it to run in
+  // the order of definition.
+  mint::SmallVector<const Registration *, 64> list;
+  for (const Registration * reg = Registration::first(); reg != NULL; reg = reg->next()) {
+    list.push_back(reg);
+  }
+  std::reverse(list.begin(), list.end());
+  for (mint::SmallVectorImpl<const Registration *>::const_iterator
+      it = list.begin(), itEnd = list.end(); it != itEnd; ++it) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; ++i) {
+      if (strstr((*it)->name(), argv[i]) != NULL) {
+        selected = true;
+      }
+    }
+    if (selected) {
+      run(*it);
+    }
+  }
+  mint::GC::uninit();
+  return 0;
+}
@@ -0,0 +1,102 @@
+/* ================================================================== *
+ * Minimal benchmark harness.
+ * ================================================================== */
+
+#ifndef MINT_BENCH_BENCHMARK_H
+#define MINT_BENCH_BENCHMARK_H
+
+#ifndef MINT_COLLECTIONS_SMALLVECTOR_H
+#include "mint/collections/SmallVector.h"
+#endif
+
+#ifndef MINT_COLLECTIONS_STRINGREF_H
+#include "mint/collections/StringRef.h"
+#endif
+
+namespace mint {
+namespace bench {
+
+/** -------------------------------------------------------------------------
+    State passed to a benchmark function. The function performs the operation
+    being measured 'iterations()' times; the harness chooses the count so that
+    each measurement runs long enough to time accurately.
+ */
+class State {
+public:
+  struct Counter {
+    const char * name;
+    double value;
+  };
+
+  State(unsigned iterations);
+
+  /// Number of times the measured operation should be performed.
+  unsigned iterations() const { return _iterations; }
+
+  /// Restart the clock, excluding any setup done so far from the measurement.
+  void resetTimer();
+
+  /// Seconds elapsed since the run (or the last call to resetTimer()) started.
+  double elapsed() const;
+
+  /// Heap and GC allocations made since the run (or the last call to resetTimer()) started.
+  unsigned long allocations() const;
+
+  /// Total number of bytes processed during the run, used to report throughput.
+  double bytesProcessed() const { return _bytes; }
+  void setBytesProcessed(double bytes) { _bytes = bytes; }
+
+  /// Record an additional statistic to be printed alongside the timing.
+  void setCounter(const char * name, double value);
+
+  /// Statistics recorded by the benchmark.
+  const SmallVectorImpl<Counter> & counters() const { return _counters; }
+
+private:
+  unsigned _iterations;
+  double _start;
+  unsigned long _allocStart;
+  double _bytes;
+  SmallVector<Counter, 4> _counters;
+};
+
+typedef void (*BenchmarkFunction)(State & state);
+
+/** -------------------------------------------------------------------------
+    Adds a benchmark function to the global list at static initialization time.
+ */
+class Registration {
+public:
+  Registration(const char * name, BenchmarkFunction fn);
+
+  const char * name() const { return _name; }
+  BenchmarkFunction function() const { return _function; }
+  const Registration * next() const { return _next; }
+
+  /// Start of the list of registered benchmarks.
+  static const Registration * first();
+
+private:
+  const char * _name;
+  BenchmarkFunction _function;
+  Registration * _next;
+};
+
+/// Prevent the optimizer from discarding a computed value.
+void keep(unsigned long value);
+void keep(const void * value);
+
+/// Return 'str' unchanged, but hide it from the optimizer so that operations on a constant
+/// input are not folded away.
+StringRef opaque(StringRef str);
+
+/// Define a benchmark function and register it.
+#define BENCHMARK(name) \
+  static void name(::mint::bench::State & state); \
+  static ::mint::bench::Registration name##_registration(#name, name); \
+  static void name(::mint::bench::State & state)
+
+}
+}
+
+#endif // MINT_BENCH_BENCHMARK_H
@@ -0,0 +1,179 @@
+/* ================================================================== *
+ * Benchmarks for SmallVector, StringRef and StringDict.
+ * ================================================================== */
+
+#include "Benchmark.h"
+#include "mint/collections/SmallString.h"
+#include "mint/graph/StringDict.h"
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#include <vector>
+
+namespace mint {
+namespace bench {
+
+namespace {
+  const unsigned DICT_SIZE = 1000;
+
+  /// Attribute-name-like keys.
+  void makeNames(std::vector<String *> & names, const char * prefix) {
+    char buffer[64];
+    for (unsigned i = 0; i < DICT_SIZE; ++i) {
+      snprintf(buffer, sizeof(buffer), "%s_attribute_%u", prefix, i);
+      names.push_back(String::create(buffer));
+    }
+  }
+}
+
+// -------------------------------------------------------------------------
+// SmallVector
+// -------------------------------------------------------------------------
+
+/// Push within the inline buffer; no allocation expected.
+BENCHMARK(SmallVectorPushInline) {
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); i += 16) {
+    SmallVector<unsigned, 16> vec;
+    for (unsigned j = 0; j < 16; ++j) {
+      vec.push_back(j);
+    }
+    total += vec.size();
+  }
+  keep(total);
+}
+
+/// Push past the inline buffer, so that the vector grows onto the heap.
+BENCHMARK(SmallVectorPushGrow) {
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); i += 1024) {
+    SmallVector<unsigned, 16> vec;
+    for (unsigned j = 0; j < 1024; ++j) {
+      vec.push_back(j);
+    }
+    total += vec.size();
+  }
+  keep(total);
+}
+
+BENCHMARK(SmallVectorAppendChars) {
+  StringRef text("/home/builder/projects/bigproject/lib/module/");
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    StringRef t = opaque(text);
+    SmallString<64> str;
+    str.append(t.begin(), t.end());
+    str.push_back('x');
+    total += str.size();
+  }
+  keep(total);
+  state.setBytesProcessed(double(state.iterations()) * text.size());
+}
+
+// -------------------------------------------------------------------------
+// StringRef
+// -------------------------------------------------------------------------
+
+BENCHMARK(StringRefCompare) {
+  StringRef a("/home/builder/projects/bigproject/lib/module7/File12.cpp");
+  StringRef b("/home/builder/projects/bigproject/lib/module7/File13.cpp");
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    StringRef l = opaque(a);
+    total += (l == b) + (l.compare(b) < 0);
+  }
+  keep(total);
+}
+
+BENCHMARK(StringRefFind) {
+  StringRef path("/home/builder/projects/bigproject/lib/module7/File12.cpp");
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    StringRef p = opaque(path);
+    total += p.find('.') + p.rfind('/') + p.startsWith("/home/builder");
+  }
+  keep(total);
+}
+
+BENCHMARK(StringRefHash) {
+  StringRef path("/home/builder/projects/bigproject/lib/module7/File12.cpp");
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    total += opaque(path).hash();
+  }
+  keep(total);
+  state.setBytesProcessed(double(state.iterations()) * path.size());
+}
+
+// -------------------------------------------------------------------------
+// StringDict
+// -------------------------------------------------------------------------
+
+BENCHMARK(StringDictInsert) {
+  std::vector<String *> names;
+  makeNames(names, "insert");
+  state.resetTimer();
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); i += DICT_SIZE) {
+    StringDict<String> dict;
+    for (unsigned j = 0; j < DICT_SIZE; ++j) {
+      dict[names[j]] = names[j];
+    }
+    total += dict.size();
+  }
+  keep(total);
+}
+
+BENCHMARK(StringDictFind) {
+  std::vector<String *> names;
+  makeNames(names, "find");
+  StringDict<String> dict;
+  for (unsigned j = 0; j < DICT_SIZE; ++j) {
+    dict[names[j]] = names[j];
+  }
+  state.resetTimer();
+  unsigned long found = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    found += dict.find(names[i % DICT_SIZE]) != dict.end();
+  }
+  keep(found);
+}
+
+/// Lookup by StringRef, as done by Object::getAttributeValue.
+BENCHMARK(StringDictFindAs) {
+  std::vector<String *> names;
+  makeNames(names, "find_as");
+  StringDict<String> dict;
+  for (unsigned j = 0; j < DICT_SIZE; ++j) {
+    dict[names[j]] = names[j];
+  }
+  state.resetTimer();
+  unsigned long found = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    found += dict.find_as(names[i % DICT_SIZE]->value()) != dict.end();
+  }
+  keep(found);
+}
+
+BENCHMARK(StringDictIterate) {
+  std::vector<String *> names;
+  makeNames(names, "iterate");
+  StringDict<String> dict;
+  for (unsigned j = 0; j < DICT_SIZE; ++j) {
+    dict[names[j]] = names[j];
+  }
+  state.resetTimer();
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); i += DICT_SIZE) {
+    for (StringDict<String>::const_iterator it = dict.begin(), itEnd = dict.end(); it != itEnd;
+        ++it) {
+      total += it->second->size();
+    }
+  }
+  keep(total);
+}
+
+}
+}
@@ -0,0 +1,194 @@
+/* ================================================================== *
+ * Benchmarks for the string hash function and Table probing.
+ * ================================================================== */
+
+#include "Benchmark.h"
+#include "mint/collections/Table.h"
+#include "mint/graph/String.h"
+#include "mint/support/Hashing.h"
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace mint {
+namespace bench {
+
+namespace {
+  /// Byte-at-a-time FNV-1, the previous hash function, kept as a baseline.
+  unsigned fnv1(const char * first, const char * last) {
+    unsigned hash = 2166136261u;
+    while (first < last) {
+      hash = (hash ^ *first++) * 16777619;
+    }
+    return hash;
+  }
+
+  typedef unsigned (*HashFunction)(const char * first, const char * last);
+
+  /// Absolute paths shaped like the ones TargetMgr stores for a large source tree.
+  const std::vector<std::string> & pathKeys() {
+    static std::vector<std::string> keys;
+    if (keys.empty()) {
+      static const char * const exts[] = { ".cpp", ".h", ".o", ".d" };
+      char buffer[256];
+      for (unsigned i = 0; i < 20000; ++i) {
+        snprintf(buffer, sizeof(buffer),
+            "/home/builder/projects/bigproject/build/lib/module%u/component%u/Source%u%s",
+            i / 400, (i / 20) % 20, i, exts[i % 4]);
+        keys.push_back(buffer);
+      }
+    }
+    return keys;
+  }
+
+  /// Short keys shaped like attribute names.
+  const std::vector<std::string> & identKeys() {
+    static std::vector<std::string> keys;
+    if (keys.empty()) {
+      static const char * const words[] = {
+        "sources", "outputs", "depends", "implicit_depends", "actions", "cflags", "name",
+        "include_dirs", "libs", "lib_dirs", "warnings_as_errors", "source_dir", "output_dir",
+        "value", "help", "prototype",
+      };
+      char buffer[64];
+      for (unsigned i = 0; i < 4096; ++i) {
+        snprintf(buffer, sizeof(buffer), "%s%u", words[i % 16], i / 16);
+        keys.push_back(buffer);
+      }
+    }
+    return keys;
+  }
+
+  void hashKeys(State & state, const std::vector<std::string> & keys, HashFunction fn) {
+    unsigned long result = 0;
+    double bytes = 0;
+    unsigned n = 0;
+    for (unsigned i = 0; i < state.iterations(); ++i) {
+      const std::string & key = keys[n];
+      result += fn(key.data(), key.data() + key.size());
+      bytes += key.size();
+      if (++n == keys.size()) {
+        n = 0;
+      }
+    }
+    keep(result);
+    state.setBytesProcessed(bytes);
+  }
+
+  /// Key traits that count key comparisons, used to measure probe lengths.
+  template<HashFunction fn>
+  struct CountingKeyTraits {
+    static unsigned compares;
+
+    static inline unsigned hash(const String * key) {
+      return fn(key->begin(), key->end());
+    }
+
+    static inline unsigned equals(const String * sl, const String * sr) {
+      ++compares;
+      return sl->value() == sr->value();
+    }
+  };
+
+  template<HashFunction fn>
+  unsigned CountingKeyTraits<fn>::compares = 0;
+
+  /// Build a Table of path keys, then report per-lookup compare counts for hits and misses,
+  /// along with the fraction of keys whose home bucket is shared with another key.
+  template<HashFunction fn>
+  void probeTable(State & state) {
+    typedef CountingKeyTraits<fn> Traits;
+    typedef Table<String, String, Traits> PathTable;
+    const std::vector<std::string> & keys = pathKeys();
+    std::vector<String *> present;
+    std::vector<String *> absent;
+    for (unsigned i = 0; i < keys.size(); ++i) {
+      String * s = String::create(keys[i]);
+      if (i & 1) {
+        absent.push_back(s);
+      } else {
+        present.push_back(s);
+      }
+    }
+    PathTable table;
+    for (unsigned i = 0; i < present.size(); ++i) {
+      table[present[i]] = present[i];
+    }
+
+    // Home-bucket collisions in an open-addressed table at the same load factor.
+    size_t buckets = 16;
+    while (present.size() * 8 > buckets * 7) {
+      buckets *= 2;
+    }
+    std::vector<unsigned char> occupied(buckets);
+    unsigned collisions = 0;
+    for (unsigned i = 0; i < present.size(); ++i) {
+      unsigned index = Traits::hash(present[i]) & (buckets - 1);
+      if (occupied[index]) {
+        ++collisions;
+      }
+      occupied[index] = 1;
+    }
+
+    Traits::compares = 0;
+    unsigned maxCompares = 0;
+    unsigned long hits = 0;
+    state.resetTimer();
+    for (unsigned i = 0; i < state.iterations(); ++i) {
+      unsigned before = Traits::compares;
+      hits += table.find(present[i % present.size()]) != table.end();
+      if (Traits::compares - before > maxCompares) {
+        maxCompares = Traits::compares - before;
+      }
+    }
+    double hitCompares = Traits::compares;
+    keep(hits);
+
+    Traits::compares = 0;
+    unsigned misses = std::min(state.iterations(), unsigned(absent.size()));
+    for (unsigned i = 0; i < misses; ++i) {
+      keep(table.find(absent[i]) != table.end());
+    }
+
+    state.setCounter("cmp/hit", hitCompares / state.iterations());
+    state.setCounter("cmp/miss", misses ? double(Traits::compares) / misses : 0.0);
+    state.setCounter("max_cmp", maxCompares);
+    state.setCounter("collide%", 100.0 * collisions / present.size());
+  }
+}
+
+// Built with -O2, as 'make benchmark' does, path keys (about 70 bytes) hash in around
+// 17 ns against 100 ns for FNV-1. Identifiers (under 20 bytes) are the other way round,
+// at 14-18 ns against 11-13 ns, since FNV-1 is inlined here and its per-byte cost is
+// small on short keys; most StringDict keys are identifiers, so little is won there.
+BENCHMARK(HashPaths) {
+  hashKeys(state, pathKeys(), hash);
+}
+
+BENCHMARK(HashPathsFNV1) {
+  hashKeys(state, pathKeys(), fnv1);
+}
+
+BENCHMARK(HashIdents) {
+  hashKeys(state, identKeys(), hash);
+}
+
+BENCHMARK(HashIdentsFNV1) {
+  hashKeys(state, identKeys(), fnv1);
+}
+
+BENCHMARK(TableProbePaths) {
+  probeTable<hash>(state);
+}
+
+BENCHMARK(TableProbePathsFNV1) {
+  probeTable<fnv1>(state);
+}
+
+}
+}
@@ -0,0 +1,80 @@
+/* ================================================================== *
+ * Benchmarks for path utilities and wildcard matching.
+ * ================================================================== */
+
+#include "Benchmark.h"
+#include "mint/collections/SmallString.h"
+#include "mint/support/Path.h"
+#include "mint/support/Wildcard.h"
+
+namespace mint {
+namespace bench {
+
+BENCHMARK(PathNormalize) {
+  static const char input[] = "/home/builder/./projects/bigproject/../bigproject/lib//module7/";
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    SmallString<128> path(input);
+    path::normalize(path);
+    total += path.size();
+  }
+  keep(total);
+}
+
+BENCHMARK(PathCombine) {
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    SmallString<128> path("/home/builder/projects/bigproject/lib");
+    path::combine(path, "module7/component3/File12.cpp");
+    total += path.size();
+  }
+  keep(total);
+}
+
+BENCHMARK(PathMakeRelative) {
+  StringRef base("/home/builder/projects/bigproject/build/lib/module7");
+  StringRef target("/home/builder/projects/bigproject/src/lib/module7/File12.cpp");
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    SmallString<128> result;
+    path::makeRelative(base, target, result);
+    total += result.size();
+  }
+  keep(total);
+}
+
+BENCHMARK(PathParent) {
+  StringRef path("/home/builder/projects/bigproject/lib/module7/component3/File12.cpp");
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    for (StringRef p = path; !p.empty() && p != "/"; p = path::parent(p)) {
+      total += p.size();
+    }
+  }
+  keep(total);
+}
+
+BENCHMARK(WildcardMatchSuffix) {
+  WildcardMatcher matcher("*.cpp");
+  StringRef names[] = { "File12.cpp", "File12.h", "README", "component3.cpp.o" };
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    total += matcher.match(names[i & 3]);
+  }
+  keep(total);
+}
+
+BENCHMARK(WildcardMatchComplex) {
+  WildcardMatcher matcher("*_test_*?.c*");
+  StringRef names[] = {
+    "parser_test_main.cpp", "lexer_test_.cpp", "module_tests_long_name.h", "a_test_b.cc"
+  };
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    total += matcher.match(names[i & 3]);
+  }
+  keep(total);
+}
+
+}
+}
@@ -0,0 +1,45 @@
+/* ================================================================== *
+ * Benchmarks for String node creation and interning.
+ * ================================================================== */
+
+#include "Benchmark.h"
+#include "mint/intrinsic/StringRegistry.h"
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace mint {
+namespace bench {
+
+BENCHMARK(StringCreate) {
+  StringRef text("/home/builder/projects/bigproject/lib/module7/File12.cpp");
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    total += String::create(text)->size();
+  }
+  keep(total);
+}
+
+/// Look up names that are already interned, as happens for every attribute name.
+BENCHMARK(StringRegistryStr) {
+  std::vector<std::string> names;
+  char buffer[64];
+  for (unsigned i = 0; i < 256; ++i) {
+    snprintf(buffer, sizeof(buffer), "attribute_name_%u", i);
+    names.push_back(buffer);
+    StringRegistry::str(buffer);
+  }
+  state.resetTimer();
+  unsigned long total = 0;
+  for (unsigned i = 0; i < state.iterations(); ++i) {
+    total += StringRegistry::str(names[i & 255])->size();
+  }
+  keep(total);
+}
+
+}
+}
@@ -0,0 +1,248 @@
+/* ================================================================== *
+ * Benchmarks for Table, compared with the linearly probed table it
+ * replaced.
+ * ================================================================== */
+
+#include "Benchmark.h"
+#include "mint/graph/StringDict.h"
+
+#if HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#include <vector>
+
+namespace mint {
+namespace bench {
+
+namespace {
+  /** -----------------------------------------------------------------------
+      The previous Table implementation: a linearly probed array of pairs,
+      growing at 2/3 load. Only the operations measured here are kept.
+   */
+  template<typename Key, typename Value, typename KeyTraits>
+  class LinearTable {
+  public:
+    typedef std::pair<Key *, Value *> value_type;
+
+    LinearTable() : _data(NULL), _dataSize(0), _size(0) {}
+    ~LinearTable() { delete[] _data; }
+
+    size_t size() const { return _size; }
+
+    template<class AltKey>
+    value_type * find(const AltKey & key) const {
+      if (_dataSize == 0) {
+        return NULL;
+      }
+      unsigned index = KeyTraits::hash(key) & (_dataSize - 1);
+      for (;;) {
+        value_type * e = &_data[index];
+        if (e->first == NULL) {
+          return NULL;
+        } else if (KeyTraits::equals(e->first, key)) {
+          return e;
+        }
+        index = (index + 7) & (_dataSize - 1);
+      }
+    }
+
+    Value *& operator[](Key * key) {
+      value_type * e = find(key);
+      if (e == NULL) {
+        if ((_size + 1) * 3 > _dataSize * 2) {
+          grow();
+        }
+        e = emptySlot(key);
+        e->first = key;
+        ++_size;
+      }
+      return e->second;
+    }
+
+    /// Visit every occupied slot, returning the number visited.
+    size_t iterate() const {
+      size_t count = 0;
+      for (const value_type * e = _data; e < _data + _dataSize; ++e) {
+        if (e->first != NULL) {
+          keep(e->second);
+          ++count;
+        }
+      }
+      return count;
+    }
+
+  private:
+    value_type * emptySlot(Key * key) {
+      unsigned index = KeyTraits::hash(key) & (_dataSize - 1);
+      while (_data[index].first != NULL) {
+        index = (index + 7) & (_dataSize - 1);
+      }
+      return &_data[index];
+    }
+
+    void grow() {
+      value_type * old = _data;
+      size_t oldSize = _dataSize;
+      _dataSize = _dataSize == 0 ? 16 : _dataSize * 2;
+      _data = new value_type[_dataSize]();
+      for (size_t i = 0; i < oldSize; ++i) {
+        if (old[i].first != NULL) {
+          *emptySlot(old[i].first) = old[i];
+        }
+      }
+      delete[] old;
+    }
+
+    value_type * _data;
+    size_t _dataSize;
+    size_t _size;
+  };
+
+  /// Adapts Table to the interface of LinearTable.
+  template<typename Key, typename Value, typename KeyTraits>
+  class GroupTable : public Table<Key, Value, KeyTraits> {
+  public:
+    typedef Table<Key, Value, KeyTraits> Base;
+
+    template<class AltKey>
+    const typename Base::value_type * find(const AltKey & key) const {
+      typename Base::const_iterator it = this->find_as(key);
+      return it != this->end() ? &*it : NULL;
+    }
+
+    size_t iterate() const {
+      size_t count = 0;
+      for (typename Base::const_iterator it = this->begin(), itEnd = this->end(); it != itEnd;
+          ++it) {
+        keep(it->second);
+        ++count;
+      }
+      return count;
+    }
+  };
+
+  struct PointerKeyTraits {
+    static inline unsigned hash(const String * key) {
+      return (unsigned(intptr_t(key)) >> 4) ^ (unsigned(intptr_t(key)) >> 9);
+    }
+
+    static inline unsigned equals(const String * l, const String * r) {
+      return l == r;
+    }
+  };
+
+  const unsigned KEY_COUNT = 10000;
+
+  /// Create 'count' distinct path strings, starting at 'offset'.
+  void makeKeys(std::vector<String *> & keys, unsigned offset) {
+    char buffer[128];
+    for (unsigned i = offset; i < offset + KEY_COUNT; ++i) {
+      snprintf(buffer, sizeof(buffer), "/src/project/lib/module%u/File%u.cpp", i / 64, i);
+      keys.push_back(String::create(buffer));
+    }
+  }
+
+  template<class T>
+  void insertKeys(State & state) {
+    std::vector<String *> keys;
+    makeKeys(keys, 0);
+    state.resetTimer();
+    T * table = new T();
+    for (unsigned i = 0, n = 0; i < state.iterations(); ++i) {
+      (*table)[keys[n]] = keys[n];
+      if (++n == keys.size()) {
+        delete table;
+        table = new T();
+        n = 0;
+      }
+    }
+    keep(table->size());
+    delete table;
+  }
+
+  template<class T>
+  void findKeys(State & state, bool hit) {
+    std::vector<String *> keys;
+    std::vector<String *> probes;
+    makeKeys(keys, 0);
+    makeKeys(probes, hit ? 0 : KEY_COUNT);
+    T table;
+    for (unsigned i = 0; i < keys.size(); ++i) {
+      table[keys[i]] = keys[i];
+    }
+    state.resetTimer();
+    unsigned long found = 0;
+    for (unsigned i = 0, n = 0; i < state.iterations(); ++i) {
+      found += table.find(probes[n]) != NULL;
+      if (++n == probes.size()) {
+        n = 0;
+      }
+    }
+    keep(found);
+  }
+
+  template<class T>
+  void iterateKeys(State & state) {
+    std::vector<String *> keys;
+    makeKeys(keys, 0);
+    T table;
+    for (unsigned i = 0; i < keys.size(); ++i) {
+      table[keys[i]] = keys[i];
+    }
+    state.resetTimer();
+    size_t visited = 0;
+    for (unsigned i = 0; i < state.iterations(); i += KEY_COUNT) {
+      visited += table.iterate();
+    }
+    keep(visited);
+  }
+
+  typedef GroupTable<String, String, StringKeyTraits> StringTable;
+  typedef LinearTable<String, String, StringKeyTraits> LinearStringTable;
+  typedef GroupTable<String, String, PointerKeyTraits> PointerTable;
+  typedef LinearTable<String, String, PointerKeyTraits> LinearPointerTable;
+}
+
+BENCHMARK(TableInsert) {
+  insertKeys<StringTable>(state);
+}
+
+BENCHMARK(LinearTableInsert) {
+  insertKeys<LinearStringTable>(state);
+}
+
+BENCHMARK(TableFindHit) {
+  findKeys<StringTable>(state, true);
+}
+
+BENCHMARK(LinearTableFindHit) {
+  findKeys<LinearStringTable>(state, true);
+}
+
+BENCHMARK(TableFindMiss) {
+  findKeys<StringTable>(state, false);
+}
+
+BENCHMARK(LinearTableFindMiss) {
+  findKeys<LinearStringTable>(state, false);
+}
+
+BENCHMARK(TableFindPointer) {
+  findKeys<PointerTable>(state, true);
+}
+
+BENCHMARK(LinearTableFindPointer) {
+  findKeys<LinearPointerTable>(state, true);
+}
+
+BENCHMARK(TableIterate) {
+  iterateKeys<StringTable>(state);
+}
+
+BENCHMARK(LinearTableIterate) {
+  iterateKeys<LinearStringTable>(state);
+}
+
+}
+}
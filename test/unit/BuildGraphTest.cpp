@@ -0,0 +1,202 @@
+/* ================================================================== *
+ * BuildGraph unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/build/BuildGraph.h"
+#include "mint/build/File.h"
+#include "mint/build/Target.h"
+#include "mint/graph/String.h"
+#include "mint/support/Path.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace mint {
+
+namespace {
+  /// Create a file in 'dir', if 'age' isn't negative, with a modification time 'age'
+  /// seconds ago.
+  File * makeFile(const char * dir, const char * name, int age) {
+    SmallString<128> filePath(dir);
+    path::combine(filePath, name);
+    if (age >= 0) {
+      path::writeFileContents(filePath, name);
+      path::setLastModified(filePath, TimeStamp(::time(NULL) - age));
+    }
+    return new File(NULL, String::create(filePath));
+  }
+
+  /// Remove the directory 'dir', and the files in it named 'names'.
+  void removeDir(const char * dir, ArrayRef<const char *> names) {
+    for (ArrayRef<const char *>::const_iterator it = names.begin(); it != names.end(); ++it) {
+      SmallString<128> filePath(dir);
+      path::combine(filePath, *it);
+      path::remove(filePath);
+    }
+    ::rmdir(dir);
+  }
+
+  Target * makeTarget() {
+    Target * target = new Target(NULL);
+    target->setState(Target::INITIALIZED);
+    return target;
+  }
+}
+
+TEST(BuildGraphTest, CheckState) {
+  char tmpl[] = "/tmp/mint-graph-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+
+  // 'compile' has a missing output, and 'link' uses that output, so has to wait for it.
+  File * mainSrc = makeFile(tmpl, "main.c", 60);
+  File * mainObj = makeFile(tmpl, "main.o", -1);
+  File * program = makeFile(tmpl, "program", 30);
+  Target * compile = makeTarget();
+  compile->addSource(mainSrc);
+  compile->addOutput(mainObj);
+  mainObj->addOutputOf(compile);
+  Target * link = makeTarget();
+  link->addSource(mainObj);
+  link->addOutput(program);
+
+  // 'library' is newer than its source, and so is 'docs', which depends on it.
+  File * libSrc = makeFile(tmpl, "lib.c", 60);
+  File * libObj = makeFile(tmpl, "lib.o", 30);
+  File * docs = makeFile(tmpl, "docs", 10);
+  Target * library = makeTarget();
+  library->addSource(libSrc);
+  library->addOutput(libObj);
+  Target * document = makeTarget();
+  document->addDependency(library);
+  document->addOutput(docs);
+
+  Target * all = makeTarget();
+  all->addDependency(link);
+  all->addDependency(document);
+  all->checkState();
+
+  EXPECT_EQ(Target::READY, compile->state());
+  EXPECT_EQ(Target::WAITING, link->state());
+  EXPECT_EQ(1u, link->pendingCount());
+  EXPECT_EQ(Target::FINISHED, library->state());
+  EXPECT_EQ(Target::FINISHED, document->state());
+  EXPECT_EQ(Target::WAITING, all->state());
+  EXPECT_EQ(1u, all->pendingCount());
+
+  ASSERT_EQ(1u, compile->waiters().size());
+  EXPECT_EQ(link, compile->waiters()[0]);
+  ASSERT_EQ(1u, link->waiters().size());
+  EXPECT_EQ(all, link->waiters()[0]);
+  EXPECT_TRUE(library->waiters().empty());
+
+  EXPECT_TRUE(link->prerequisiteFinished());
+  EXPECT_EQ(Target::READY, link->state());
+
+  const char * names[] = { "main.c", "program", "lib.c", "lib.o", "docs" };
+  removeDir(tmpl, names);
+}
+
+TEST(BuildGraphTest, RestatCutoff) {
+  char tmpl[] = "/tmp/mint-graph-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+
+  // 'generate' is a RESTAT target whose output is older than its source, as it is
+  // once a rebuild has produced the same output and restored the output's old time.
+  // 'compile' uses that output, and is up to date with it.
+  makeFile(tmpl, "gen.in", 10);
+  makeFile(tmpl, "gen.h", 60);
+  makeFile(tmpl, "out.o", 30);
+  for (int pass = 0; pass < 3; ++pass) {
+    File * genIn = makeFile(tmpl, "gen.in", -1);
+    File * genH = makeFile(tmpl, "gen.h", -1);
+    Target * generate = makeTarget();
+    generate->setFlag(Target::RESTAT);
+    generate->addSource(genIn);
+    generate->addOutput(genH);
+    genH->addOutputOf(generate);
+    Target * compile = makeTarget();
+    compile->addSource(genH);
+    compile->addOutput(makeFile(tmpl, "out.o", -1));
+
+    if (pass == 0) {
+      // With nothing recorded, the generator has to run. If its output comes out the
+      // same, the dependent doesn't.
+      compile->checkState();
+      EXPECT_EQ(Target::READY, generate->state());
+      EXPECT_EQ(Target::WAITING, compile->state());
+      generate->setOutputsChanged(false);
+      EXPECT_TRUE(compile->prerequisiteFinished());
+      EXPECT_EQ(Target::FINISHED, compile->state());
+    } else if (pass == 1) {
+      // Once the source it was built against is recorded, neither target runs.
+      genIn->updateFileStatus();
+      generate->setInputStamp(genIn->lastModified());
+      compile->checkState();
+      EXPECT_EQ(Target::FINISHED, generate->state());
+      EXPECT_EQ(Target::FINISHED, compile->state());
+    } else {
+      // A source newer than the recorded one makes the generator run again.
+      generate->setInputStamp(TimeStamp(::time(NULL) - 20));
+      compile->checkState();
+      EXPECT_EQ(Target::READY, generate->state());
+      EXPECT_EQ(Target::WAITING, compile->state());
+    }
+  }
+
+  const char * names[] = { "gen.in", "gen.h", "out.o" };
+  removeDir(tmpl, names);
+}
+
+TEST(BuildGraphTest, Lower) {
+  char tmpl[] = "/tmp/mint-graph-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+
+  File * src = makeFile(tmpl, "a.c", 60);
+  File * obj = makeFile(tmpl, "a.o", 30);
+  Target * compile = makeTarget();
+  compile->addSource(src);
+  compile->addOutput(obj);
+  obj->addOutputOf(compile);
+  Target * archive = makeTarget();
+  archive->addSource(obj);
+  archive->addSource(obj);
+  archive->addOutput(makeFile(tmpl, "a.a", 10));
+  archive->checkState();
+  EXPECT_EQ(Target::FINISHED, archive->state());
+
+  // A prerequisite that isn't listed is added to the graph, as already checked.
+  Target * targets[] = { archive };
+  BuildGraph graph;
+  graph.lower(targets);
+  ASSERT_EQ(2u, graph.targetCount());
+  EXPECT_EQ(archive, graph.target(0));
+  EXPECT_EQ(compile, graph.target(1));
+  EXPECT_EQ(0u, graph.targetFlags(0) & BuildGraph::CHECKED);
+  EXPECT_NE(0u, graph.targetFlags(1) & BuildGraph::CHECKED);
+
+  ASSERT_EQ(1u, graph.prerequisites(0).size());
+  EXPECT_EQ(1u, graph.prerequisites(0)[0]);
+  EXPECT_TRUE(graph.prerequisites(1).empty());
+  EXPECT_TRUE(graph.sources(1).empty());
+
+  // Each file is numbered once, however many times it appears.
+  ASSERT_EQ(2u, graph.fileCount());
+  ASSERT_EQ(2u, graph.sources(0).size());
+  EXPECT_EQ(graph.sources(0)[0], graph.sources(0)[1]);
+  EXPECT_EQ(obj, graph.file(graph.sources(0)[0]));
+  ASSERT_EQ(1u, graph.outputs(0).size());
+  EXPECT_NE(graph.sources(0)[0], graph.outputs(0)[0]);
+
+  graph.readFileStatus();
+  EXPECT_NE(0u, graph.fileFlags(graph.sources(0)[0]) & BuildGraph::GENERATED);
+  EXPECT_NE(0u, graph.fileFlags(graph.sources(0)[0]) & BuildGraph::EXISTS);
+  EXPECT_EQ(0u, graph.fileFlags(graph.outputs(0)[0]) & BuildGraph::GENERATED);
+  EXPECT_TRUE(graph.lastModified(graph.sources(0)[0]) < graph.lastModified(graph.outputs(0)[0]));
+
+  const char * names[] = { "a.c", "a.o", "a.a" };
+  removeDir(tmpl, names);
+}
+
+}
@@ -0,0 +1,85 @@
+/* ================================================================== *
+ * BuildStats unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/build/BuildStats.h"
+#include "mint/support/Path.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace mint {
+
+namespace {
+  ResourceUsage makeUsage(uint64_t wallTime, uint64_t maxResident) {
+    ResourceUsage usage;
+    usage.wallTime = wallTime;
+    usage.userTime = wallTime / 2;
+    usage.systemTime = wallTime / 4;
+    usage.maxResident = maxResident;
+    usage.inputBlocks = 8;
+    usage.outputBlocks = 16;
+    return usage;
+  }
+}
+
+TEST(BuildStatsTest, RecordAndFind) {
+  BuildStats stats;
+  stats.record("lib.b", makeUsage(200, 20));
+  stats.record("lib.a", makeUsage(100, 10));
+  stats.record("lib.b", makeUsage(300, 30));
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_EQ("lib.a", stats.targetPath(0));
+  EXPECT_EQ("lib.b", stats.targetPath(1));
+
+  const ResourceUsage * usage = stats.find("lib.b");
+  ASSERT_TRUE(usage != NULL);
+  EXPECT_EQ(300u, usage->wallTime);
+  EXPECT_EQ(30u, usage->maxResident);
+  EXPECT_TRUE(stats.find("lib.c") == NULL);
+
+  // Once sorted, recording replaces the existing entry in place.
+  stats.record("lib.a", makeUsage(150, 15));
+  ASSERT_EQ(2u, stats.size());
+  EXPECT_EQ(150u, stats.find("lib.a")->wallTime);
+}
+
+TEST(BuildStatsTest, ReadWrite) {
+  char tmpl[] = "/tmp/mint-stats-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> statsPath(tmpl);
+  path::combine(statsPath, "stats.cache");
+
+  BuildStats empty;
+  EXPECT_FALSE(empty.read(statsPath));
+
+  BuildStats stats;
+  stats.record("main.program", makeUsage(5000000, 204800));
+  stats.record("main.with space", makeUsage(42, 0));
+  ASSERT_TRUE(stats.write(statsPath));
+
+  BuildStats loaded;
+  ASSERT_TRUE(loaded.read(statsPath));
+  ASSERT_EQ(2u, loaded.size());
+  const ResourceUsage * usage = loaded.find("main.program");
+  ASSERT_TRUE(usage != NULL);
+  EXPECT_EQ(5000000u, usage->wallTime);
+  EXPECT_EQ(2500000u, usage->userTime);
+  EXPECT_EQ(1250000u, usage->systemTime);
+  EXPECT_EQ(204800u, usage->maxResident);
+  EXPECT_EQ(8u, usage->inputBlocks);
+  EXPECT_EQ(16u, usage->outputBlocks);
+  ASSERT_TRUE(loaded.find("main.with space") != NULL);
+  EXPECT_EQ(42u, loaded.find("main.with space")->wallTime);
+
+  // A file in some other format is rejected.
+  ASSERT_TRUE(path::writeFileContents(statsPath, "something else\n"));
+  EXPECT_FALSE(loaded.read(statsPath));
+  EXPECT_EQ(0u, loaded.size());
+
+  path::remove(statsPath);
+  rmdir(tmpl);
+}
+
+}
@@ -0,0 +1,128 @@
+/* ================================================================== *
+ * ContentHasher unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/support/ContentHasher.h"
+#include "mint/support/Path.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace mint {
+
+namespace {
+  /// The BLAKE3 digest of 'size' bytes of the standard test input, as hex.
+  std::string blake3Hex(size_t size) {
+    std::string input;
+    for (size_t i = 0; i < size; ++i) {
+      input.push_back(char(i % 251));
+    }
+    Blake3 hasher;
+    hasher.update(input.data(), input.size());
+    ContentDigest digest;
+    hasher.finalize(digest.bytes);
+    SmallString<64> hex;
+    digest.toHex(hex);
+    return std::string(hex.data(), hex.size());
+  }
+}
+
+TEST(ContentHasherTest, Blake3) {
+  // From the official BLAKE3 test vectors.
+  EXPECT_EQ("af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262", blake3Hex(0));
+  EXPECT_EQ("2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213", blake3Hex(1));
+  EXPECT_EQ("de1e5fa0be70df6d2be8fffd0e99ceaa8eb6e8c93a63f2d8d1c30ecb6b263dee", blake3Hex(65));
+  EXPECT_EQ("42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7", blake3Hex(1024));
+  EXPECT_EQ("d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444", blake3Hex(1025));
+  EXPECT_EQ("7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3", blake3Hex(3073));
+  EXPECT_EQ("9b4052b38f1c5fc8b1f9ff7ac7b27cd242487b3d890d15c96a1c25b8aa0fb995", blake3Hex(4097));
+  EXPECT_EQ("bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b", blake3Hex(8193));
+  EXPECT_EQ("62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47", blake3Hex(31744));
+  EXPECT_EQ("bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085", blake3Hex(102400));
+
+  // Feeding the input in pieces gives the same result.
+  std::string input;
+  for (size_t i = 0; i < 102400; ++i) {
+    input.push_back(char(i % 251));
+  }
+  Blake3 hasher;
+  for (size_t pos = 0; pos < input.size(); pos += 777) {
+    hasher.update(input.data() + pos, std::min(size_t(777), input.size() - pos));
+  }
+  ContentDigest digest;
+  hasher.finalize(digest.bytes);
+  SmallString<64> hex;
+  digest.toHex(hex);
+  EXPECT_EQ(blake3Hex(102400), std::string(hex.data(), hex.size()));
+}
+
+TEST(ContentHasherTest, HashFiles) {
+  char tmpl[] = "/tmp/mint-hash-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> smallPath(tmpl);
+  path::combine(smallPath, "small.txt");
+  SmallString<128> largePath(tmpl);
+  path::combine(largePath, "large.bin");
+  SmallString<128> missingPath(tmpl);
+  path::combine(missingPath, "missing.txt");
+  SmallString<128> cachePath(tmpl);
+  path::combine(cachePath, "hashes.cache");
+
+  std::string large(200000, 'x');
+  ASSERT_TRUE(path::writeFileContents(smallPath, "hello\n"));
+  ASSERT_TRUE(path::writeFileContents(largePath, StringRef(large.data(), large.size())));
+
+  SmallVector<StringRef, 4> paths;
+  paths.push_back(smallPath);
+  paths.push_back(largePath);
+  paths.push_back(missingPath);
+
+  ContentHasher hasher;
+  SmallVector<ContentHasher::Result, 4> results;
+  ASSERT_TRUE(hasher.hashFiles(paths, results));
+  ASSERT_EQ(3u, results.size());
+  EXPECT_EQ(2u, hasher.filesRead());
+  EXPECT_TRUE(results[0].exists && results[0].valid);
+  EXPECT_TRUE(results[1].exists && results[1].valid);
+  EXPECT_FALSE(results[2].exists);
+
+  ContentDigest expected;
+  Blake3::hash(large.data(), large.size(), expected.bytes);
+  EXPECT_TRUE(results[1].digest == expected);
+  Blake3::hash("hello\n", 6, expected.bytes);
+  EXPECT_TRUE(results[0].digest == expected);
+
+  // The files were only just written, so they aren't cached yet.
+  ASSERT_TRUE(hasher.writeCache(cachePath));
+  ContentHasher reloaded;
+  EXPECT_FALSE(reloaded.readCache(cachePath));
+  ASSERT_TRUE(reloaded.hashFiles(paths, results));
+  EXPECT_EQ(2u, reloaded.filesRead());
+
+  // Once they are old enough, a second run finds them in the cache.
+  ASSERT_TRUE(path::setLastModified(smallPath, TimeStamp(::time(NULL) - 60)));
+  ASSERT_TRUE(path::setLastModified(largePath, TimeStamp(::time(NULL) - 60)));
+  ASSERT_TRUE(reloaded.hashFiles(paths, results));
+  EXPECT_EQ(2u, reloaded.filesRead());
+  ASSERT_TRUE(reloaded.writeCache(cachePath));
+
+  ContentHasher cached;
+  ASSERT_TRUE(cached.readCache(cachePath));
+  ASSERT_TRUE(cached.hashFiles(paths, results));
+  EXPECT_EQ(0u, cached.filesRead());
+  EXPECT_TRUE(results[0].digest == expected);
+
+  // Changing a file's size invalidates its entry.
+  ASSERT_TRUE(path::writeFileContents(smallPath, "hello, world\n"));
+  ASSERT_TRUE(cached.hashFiles(paths, results));
+  EXPECT_EQ(1u, cached.filesRead());
+  EXPECT_TRUE(results[0].digest != expected);
+
+  path::remove(smallPath);
+  path::remove(largePath);
+  path::remove(cachePath);
+  ::rmdir(tmpl);
+}
+
+}
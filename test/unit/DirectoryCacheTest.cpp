@@ -0,0 +1,87 @@
+/* ================================================================== *
+ * DirectoryCache unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/support/DirectoryCache.h"
+#include "mint/support/Path.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace mint {
+
+namespace {
+  void touch(StringRef dir, StringRef name) {
+    SmallString<128> filePath(dir);
+    path::combine(filePath, name);
+    FILE * fh = fopen(filePath.cstr(), "w");
+    ASSERT_TRUE(fh != NULL);
+    fclose(fh);
+  }
+
+  void makeDir(StringRef dir, StringRef name) {
+    SmallString<128> dirPath(dir);
+    path::combine(dirPath, name);
+    ASSERT_EQ(0, mkdir(dirPath.cstr(), 0755));
+  }
+
+  void removeEntry(StringRef dir, StringRef name) {
+    SmallString<128> filePath(dir);
+    path::combine(filePath, name);
+    ::remove(filePath.cstr());
+  }
+}
+
+TEST(DirectoryCacheTest, ListingIsSorted) {
+  char tmpl[] = "/tmp/mint-dircache-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  StringRef dir(tmpl);
+  touch(dir, "b.cpp");
+  touch(dir, "a.cpp");
+  makeDir(dir, "sub");
+  SmallString<128> linkPath(dir);
+  path::combine(linkPath, "link");
+  ASSERT_EQ(0, symlink("sub", linkPath.cstr()));
+
+  DirectoryCache cache;
+  const DirectoryListing * listing = cache.list(dir);
+  ASSERT_TRUE(listing->exists());
+  ASSERT_EQ(4u, listing->size());
+  EXPECT_EQ("a.cpp", listing->name(0));
+  EXPECT_EQ("b.cpp", listing->name(1));
+  EXPECT_EQ("link", listing->name(2));
+  EXPECT_EQ("sub", listing->name(3));
+  EXPECT_FALSE(listing->isDirectory(0));
+  EXPECT_TRUE(listing->isDirectory(2));
+  EXPECT_TRUE(listing->isLink(2));
+  EXPECT_TRUE(listing->isDirectory(3));
+  EXPECT_FALSE(listing->isLink(3));
+  EXPECT_EQ(1, listing->find("b.cpp"));
+  EXPECT_EQ(-1, listing->find("c.cpp"));
+
+  // The same listing is returned until the cache is cleared.
+  touch(dir, "c.cpp");
+  EXPECT_EQ(listing, cache.list(dir));
+  cache.clear();
+  EXPECT_EQ(0, cache.list(dir)->find("a.cpp"));
+  EXPECT_EQ(2, cache.list(dir)->find("c.cpp"));
+
+  removeEntry(dir, "a.cpp");
+  removeEntry(dir, "b.cpp");
+  removeEntry(dir, "c.cpp");
+  removeEntry(dir, "link");
+  removeEntry(dir, "sub");
+  rmdir(tmpl);
+}
+
+TEST(DirectoryCacheTest, MissingDirectory) {
+  DirectoryCache cache;
+  const DirectoryListing * listing = cache.list("/nonexistent/mint-dircache");
+  EXPECT_FALSE(listing->exists());
+  EXPECT_EQ(0u, listing->size());
+}
+
+}
@@ -4,10 +4,13 @@
 
 #include "gtest/gtest.h"
 
+#include "mint/build/BuiltinAction.h"
+
 #include "mint/eval/Evaluator.h"
 
 #include "mint/graph/Literal.h"
 #include "mint/graph/Module.h"
+#include "mint/graph/Oper.h"
 
 #include "mint/intrinsic/Fundamentals.h"
 #include "mint/intrinsic/TypeRegistry.h"
@@ -15,8 +18,12 @@
 #include "mint/parse/Parser.h"
 
 #include "mint/support/Diagnostics.h"
+#include "mint/support/DirectoryCache.h"
+#include "mint/support/Path.h"
 
 #include <ostream>
+#include <stdlib.h>
+#include <unistd.h>
 
 namespace mint {
 
@@ -588,6 +595,85 @@ TEST_F(EvaluatorTest, ComparisonOperators) {
   EXPECT_NODE_EQ("false", n);
 }
 
+TEST_F(EvaluatorTest, BuiltinActions) {
+  Node * n;
+  SmallString<64> commandLine;
+
+  n = evalExpression("action.copy('a.txt', 'out/a.txt')");
+  ASSERT_EQ(Node::NK_ACTION_COPY, n->nodeKind());
+  formatBuiltinAction(n->asOper(), commandLine);
+  EXPECT_EQ("cp -p a.txt out/a.txt", StringRef(commandLine));
+
+  n = evalExpression("action.mkdir('out dir')");
+  ASSERT_EQ(Node::NK_ACTION_MKDIR, n->nodeKind());
+  commandLine.clear();
+  formatBuiltinAction(n->asOper(), commandLine);
+  EXPECT_EQ("mkdir -p 'out dir'", StringRef(commandLine));
+
+  n = evalExpression("action.write('stamp', 'it\\'s 100%\\n')");
+  ASSERT_EQ(Node::NK_ACTION_WRITE, n->nodeKind());
+  commandLine.clear();
+  formatBuiltinAction(n->asOper(), commandLine);
+  EXPECT_EQ("printf 'it'\\''s 100%%\\n' > stamp", StringRef(commandLine));
+}
+
+TEST_F(EvaluatorTest, RegularExpressions) {
+  Node * n;
+
+  n = evalExpression("re.compile('a+').find_all('caaab aa b')");
+  ASSERT_EQ(Node::NK_LIST, n->nodeKind());
+  EXPECT_NODE_EQ("['aaa', 'aa']", n);
+
+  n = evalExpression("re.compile('\\\\s*,\\\\s*').split('a, b ,c')");
+  ASSERT_EQ(Node::NK_LIST, n->nodeKind());
+  EXPECT_NODE_EQ("['a', 'b', 'c']", n);
+
+  n = evalExpression("re.compile('(\\\\w+)=(\\\\w+)').find('x y=z').group[2]");
+  ASSERT_EQ(Node::NK_STRING, n->nodeKind());
+  EXPECT_NODE_EQ("'z'", n);
+
+  n = evalExpression("re.compile('b').subst('abcb', 'X')");
+  ASSERT_EQ(Node::NK_STRING, n->nodeKind());
+  EXPECT_NODE_EQ("'aXcb'", n);
+
+  n = evalExpression("re.compile('(b)').subst_all('abcb', '<\\\\1>')");
+  ASSERT_EQ(Node::NK_STRING, n->nodeKind());
+  EXPECT_NODE_EQ("'a<b>c<b>'", n);
+
+  // An empty match must not stop the search from making progress.
+  n = evalExpression("re.compile('x*').subst_all('ab', m => '-')");
+  ASSERT_EQ(Node::NK_STRING, n->nodeKind());
+  EXPECT_NODE_EQ("'-a-b-'", n);
+}
+
+TEST_F(EvaluatorTest, GlobSeesNewFiles) {
+  char tmpl[] = "/tmp/mint-glob-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  module.setSourceDir(tmpl);
+  SmallString<128> first(tmpl), second(tmpl);
+  path::combine(first, "a.txt");
+  path::combine(second, "b.txt");
+  ASSERT_TRUE(path::writeFileContents(first, "a"));
+  DirectoryCache::get().clear();
+
+  Node * n = evalExpression("glob('*.txt')");
+  ASSERT_EQ(Node::NK_LIST, n->nodeKind());
+  EXPECT_EQ(1u, n->asOper()->size());
+
+  // Within one evaluation pass, the listing is read once.
+  ASSERT_TRUE(path::writeFileContents(second, "b"));
+  EXPECT_EQ(1u, evalExpression("glob('*.txt')")->asOper()->size());
+
+  // A job's actions are evaluated in a new pass, which sees the files written since.
+  DirectoryCache::get().clear();
+  EXPECT_EQ(2u, evalExpression("glob('*.txt')")->asOper()->size());
+
+  DirectoryCache::get().clear();
+  unlink(first.cstr());
+  unlink(second.cstr());
+  rmdir(tmpl);
+}
+
 Node * methodIdentity(Location loc, Evaluator * ex, Function * fn, Node * self, NodeArray args) {
   return args[0];
 }
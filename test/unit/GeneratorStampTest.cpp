@@ -0,0 +1,97 @@
+/* ================================================================== *
+ * GeneratorStamp unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/project/GeneratorStamp.h"
+#include "mint/support/Path.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace mint {
+
+TEST(GeneratorStampTest, UpToDate) {
+  char tmpl[] = "/tmp/mint-stamp-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> inputPath(tmpl);
+  path::combine(inputPath, "module.mint");
+  SmallString<128> outputPath(tmpl);
+  path::combine(outputPath, "Makefile");
+  SmallString<128> stampPath(tmpl);
+  path::combine(stampPath, "makefiles.stamp");
+
+  ASSERT_TRUE(path::writeFileContents(inputPath, "x = 1\n"));
+
+  // Nothing has been generated yet.
+  GeneratorStamp empty;
+  EXPECT_FALSE(empty.read(stampPath));
+  EXPECT_FALSE(empty.isUpToDate());
+
+  GeneratorStamp stamp;
+  stamp.addInput(inputPath);
+  ASSERT_TRUE(stamp.writeOutput(outputPath, "all:\n", empty));
+  ASSERT_TRUE(stamp.write(stampPath));
+
+  GeneratorStamp previous;
+  ASSERT_TRUE(previous.read(stampPath));
+  EXPECT_TRUE(previous.isUpToDate());
+
+  // Changing an input makes the stamp out of date.
+  ASSERT_TRUE(path::writeFileContents(inputPath, "x = 2\n"));
+  EXPECT_FALSE(previous.isUpToDate());
+
+  // Editing an output does too.
+  ASSERT_TRUE(path::writeFileContents(inputPath, "x = 1\n"));
+  EXPECT_TRUE(previous.isUpToDate());
+  ASSERT_TRUE(path::writeFileContents(outputPath, "all: foo\n"));
+  EXPECT_FALSE(previous.isUpToDate());
+
+  // The edited output is rewritten even though the generated text is the same.
+  GeneratorStamp next;
+  ASSERT_TRUE(next.writeOutput(outputPath, "all:\n", previous));
+  SmallString<0> content;
+  ASSERT_TRUE(path::readFileContents(outputPath, content));
+  EXPECT_EQ("all:\n", StringRef(content));
+
+  unlink(inputPath.cstr());
+  unlink(outputPath.cstr());
+  unlink(stampPath.cstr());
+  rmdir(tmpl);
+}
+
+TEST(GeneratorStampTest, EditWithinOneSecond) {
+  char tmpl[] = "/tmp/mint-stamp-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> outputPath(tmpl);
+  path::combine(outputPath, "Makefile");
+
+  SmallString<128> stampPath(tmpl);
+  path::combine(stampPath, "makefiles.stamp");
+
+  // The output already has the generated contents, so it is recorded as it is.
+  ASSERT_TRUE(path::writeFileContents(outputPath, "all:\n"));
+  struct timespec ts;
+  ts.tv_sec = 1000000000;
+  ts.tv_nsec = 100;
+  ASSERT_TRUE(path::setLastModified(outputPath, TimeStamp(ts)));
+  GeneratorStamp empty;
+  GeneratorStamp stamp;
+  ASSERT_TRUE(stamp.writeOutput(outputPath, "all:\n", empty));
+  ASSERT_TRUE(stamp.write(stampPath));
+  GeneratorStamp previous;
+  ASSERT_TRUE(previous.read(stampPath));
+  EXPECT_TRUE(previous.isUpToDate());
+
+  // An edit that keeps the size and the second of the modification time is noticed.
+  ASSERT_TRUE(path::writeFileContents(outputPath, "foo:\n"));
+  ts.tv_nsec = 200;
+  ASSERT_TRUE(path::setLastModified(outputPath, TimeStamp(ts)));
+  EXPECT_FALSE(previous.isUpToDate());
+
+  unlink(outputPath.cstr());
+  unlink(stampPath.cstr());
+  rmdir(tmpl);
+}
+
+}
@@ -0,0 +1,147 @@
+/* ================================================================== *
+ * JobMgr unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/build/JobMgr.h"
+#include "mint/build/TargetMgr.h"
+#include "mint/graph/Object.h"
+
+namespace mint {
+
+namespace {
+  Target * makeTarget(const char * name) {
+    Object * definition = new Object(Location(), NULL);
+    definition->setName(name);
+    return new Target(definition);
+  }
+}
+
+TEST(JobMgrTest, ParseMemorySize) {
+  uint64_t kilobytes = 0;
+  EXPECT_TRUE(JobMgr::parseMemorySize("8G", kilobytes));
+  EXPECT_EQ(8u * 1024 * 1024, kilobytes);
+  EXPECT_TRUE(JobMgr::parseMemorySize("512M", kilobytes));
+  EXPECT_EQ(512u * 1024, kilobytes);
+  EXPECT_TRUE(JobMgr::parseMemorySize("512m", kilobytes));
+  EXPECT_EQ(512u * 1024, kilobytes);
+  EXPECT_TRUE(JobMgr::parseMemorySize("100K", kilobytes));
+  EXPECT_EQ(100u, kilobytes);
+
+  // A bare number is in bytes, and has to come to at least a kilobyte.
+  EXPECT_TRUE(JobMgr::parseMemorySize("1048576", kilobytes));
+  EXPECT_EQ(1024u, kilobytes);
+  EXPECT_FALSE(JobMgr::parseMemorySize("512", kilobytes));
+
+  EXPECT_FALSE(JobMgr::parseMemorySize("8X", kilobytes));
+  EXPECT_FALSE(JobMgr::parseMemorySize("8GB", kilobytes));
+  EXPECT_FALSE(JobMgr::parseMemorySize("G", kilobytes));
+  EXPECT_FALSE(JobMgr::parseMemorySize("", kilobytes));
+  EXPECT_FALSE(JobMgr::parseMemorySize("0M", kilobytes));
+}
+
+TEST(JobMgrTest, Pools) {
+  TargetMgr targets;
+  JobMgr mgr(&targets);
+  Object * pool = new Object(Location(), NULL);
+  Target * link = makeTarget("link");
+  link->setPool(pool, 2);
+  Target * other = makeTarget("other");
+  other->setPool(pool, 2);
+  Target * unpooled = makeTarget("unpooled");
+
+  EXPECT_TRUE(mgr.poolHasRoom(link, 1));
+  EXPECT_TRUE(mgr.poolHasRoom(link, 2));
+  mgr.updatePoolUsage(link, 1);
+  EXPECT_TRUE(mgr.poolHasRoom(other, 1));
+  EXPECT_FALSE(mgr.poolHasRoom(other, 2));
+  mgr.updatePoolUsage(other, 1);
+  EXPECT_FALSE(mgr.poolHasRoom(link, 1));
+
+  // Targets without a pool are never held back by one.
+  EXPECT_TRUE(mgr.poolHasRoom(unpooled, 8));
+  mgr.updatePoolUsage(unpooled, 8);
+
+  mgr.updatePoolUsage(link, -1);
+  EXPECT_TRUE(mgr.poolHasRoom(link, 1));
+  mgr.updatePoolUsage(other, -1);
+
+  // A job weighing more than the whole pool takes all of it, but can still run.
+  EXPECT_TRUE(mgr.poolHasRoom(link, 5));
+  mgr.updatePoolUsage(link, 5);
+  EXPECT_FALSE(mgr.poolHasRoom(other, 1));
+  mgr.updatePoolUsage(link, -5);
+  EXPECT_TRUE(mgr.poolHasRoom(other, 2));
+}
+
+TEST(JobMgrTest, ParkedTargets) {
+  TargetMgr targets;
+  JobMgr mgr(&targets);
+  Object * pool = new Object(Location(), NULL);
+  Target * link = makeTarget("link");
+  link->setPool(pool, 1);
+  Target * other = makeTarget("other");
+  other->setPool(pool, 1);
+  Target * big = makeTarget("big");
+  Target * unpooled = makeTarget("unpooled");
+
+  // Any job finishing frees slots and memory, but only a job from the same pool frees
+  // room in the pool.
+  mgr.parkTarget(other, true);
+  mgr.parkTarget(big, false);
+  mgr.releaseParked(unpooled);
+  EXPECT_EQ(1u, mgr.readyCount());
+  EXPECT_EQ(big, mgr.nextReady());
+  mgr.releaseParked(link);
+  EXPECT_EQ(1u, mgr.readyCount());
+  EXPECT_EQ(other, mgr.nextReady());
+
+  // Each target is only released once.
+  mgr.releaseParked(link);
+  EXPECT_EQ(0u, mgr.readyCount());
+}
+
+TEST(JobMgrTest, MemoryEstimate) {
+  TargetMgr targets;
+  JobMgr mgr(&targets);
+  mgr.setMemoryBudget(8000);
+  ResourceUsage usage;
+  usage.maxResident = 1000;
+  targets.buildStats().record("big", usage);
+  Target * big = makeTarget("big");
+  Target * unknown = makeTarget("unknown");
+
+  // A target that hasn't been built before gets a fair share of the budget.
+  uint64_t recorded = 1;
+  EXPECT_EQ(2000u, mgr.memoryEstimate(unknown, 4, recorded));
+  EXPECT_EQ(0u, recorded);
+  EXPECT_EQ(1000u, mgr.memoryEstimate(big, 4, recorded));
+  EXPECT_EQ(1000u, recorded);
+
+  // Jobs that grow raise the estimates, part of the way at a time.
+  mgr.updateMemoryScale(1000, 3000);
+  EXPECT_DOUBLE_EQ(1.5, mgr.memoryScale());
+  EXPECT_EQ(1500u, mgr.memoryEstimate(big, 4, recorded));
+  EXPECT_EQ(1000u, recorded);
+  EXPECT_EQ(2000u, mgr.memoryEstimate(unknown, 4, recorded));
+
+  // Jobs that shrink lower them again, but not below what was recorded.
+  mgr.updateMemoryScale(1000, 100);
+  EXPECT_DOUBLE_EQ(1.15, mgr.memoryScale());
+  mgr.updateMemoryScale(1000, 100);
+  mgr.updateMemoryScale(1000, 100);
+  EXPECT_DOUBLE_EQ(1.0, mgr.memoryScale());
+
+  // Nor above the maximum.
+  for (int i = 0; i < 20; ++i) {
+    mgr.updateMemoryScale(1000, 100000);
+  }
+  EXPECT_DOUBLE_EQ(4.0, mgr.memoryScale());
+
+  // Jobs without a record, or without a measurement, don't change anything.
+  mgr.updateMemoryScale(0, 5000);
+  mgr.updateMemoryScale(1000, 0);
+  EXPECT_DOUBLE_EQ(4.0, mgr.memoryScale());
+}
+
+}
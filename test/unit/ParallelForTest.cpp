@@ -0,0 +1,55 @@
+/* ================================================================== *
+ * ParallelFor unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/support/ParallelFor.h"
+#include "mint/collections/SmallVector.h"
+
+namespace mint {
+
+namespace {
+  /// Counts how many times each item was visited. Each item belongs to exactly one
+  /// chunk, so no two threads write the same counter.
+  struct Visits {
+    int * counts;
+    size_t chunk;
+    bool chunksAligned;
+  };
+
+  void visit(size_t start, size_t end, void * arg) {
+    Visits * visits = static_cast<Visits *>(arg);
+    if (start % visits->chunk != 0 || end - start > visits->chunk) {
+      visits->chunksAligned = false;
+    }
+    for (size_t i = start; i < end; ++i) {
+      ++visits->counts[i];
+    }
+  }
+
+  void expectEachVisitedOnce(size_t count, size_t chunk, unsigned threads) {
+    SmallVector<int, 0> counts;
+    counts.resize(count, 0);
+    Visits visits = { counts.data(), chunk, true };
+    parallelFor(count, chunk, visit, &visits, threads);
+    EXPECT_TRUE(visits.chunksAligned);
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_EQ(1, counts[i]) << "item " << i;
+    }
+  }
+}
+
+TEST(ParallelForTest, VisitsEachItemOnce) {
+  expectEachVisitedOnce(0, 8, 4);
+  expectEachVisitedOnce(1, 8, 4);
+  expectEachVisitedOnce(1000, 1, 4);
+  expectEachVisitedOnce(1000, 32, 4);
+  expectEachVisitedOnce(1001, 32, 0);
+  expectEachVisitedOnce(1000, 32, 1);
+}
+
+TEST(ParallelForTest, ProcessorCount) {
+  EXPECT_GE(processorCount(), 1u);
+}
+
+}
@@ -7,6 +7,10 @@
 #include "mint/support/Path.h"
 #include "TestHelpers.h"
 
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace mint {
 
 inline void appendStr(SmallVectorImpl<char> & first, StringRef second) {
@@ -177,4 +181,100 @@ TEST(PathTest, MakeRelative) {
       "/Users/talin/Projects/mint/mint/build.osx",
       "/Users/talin/Projects/mint/mint/build.osx/lib/intrinsic/PathMethods.cpp.o");
   }
+
+TEST(PathTest, CopyFile) {
+  char tmpl[] = "/tmp/mint-copy-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> sourcePath(tmpl);
+  path::combine(sourcePath, "source");
+  SmallString<128> copyPath(tmpl);
+  path::combine(copyPath, "sub/copy");
+  SmallString<128> linkPath(tmpl);
+  path::combine(linkPath, "link");
+
+  // Make the source large enough that it doesn't fit in a single buffer.
+  SmallString<0> content;
+  for (int i = 0; i < 100000; ++i) {
+    content.append("0123456789");
+  }
+  ASSERT_TRUE(path::writeFileContents(sourcePath, content));
+  ASSERT_TRUE(path::setLastModified(sourcePath, TimeStamp(time_t(1000000000))));
+
+  ASSERT_TRUE(path::copyFile(sourcePath, copyPath, path::COPY_PRESERVE_TIME));
+  SmallString<0> copied;
+  ASSERT_TRUE(path::readFileContents(copyPath, copied));
+  EXPECT_TRUE(StringRef(copied) == StringRef(content));
+  path::FileStatus st;
+  ASSERT_TRUE(path::fileStatus(copyPath, st));
+  EXPECT_EQ(1000000000, st.lastModified.seconds());
+
+  // A hard link shares the source's inode.
+  struct stat sourceStat, linkStat;
+  ASSERT_TRUE(path::copyFile(sourcePath, linkPath, path::COPY_HARDLINK));
+  ASSERT_EQ(0, stat(sourcePath.cstr(), &sourceStat));
+  ASSERT_EQ(0, stat(linkPath.cstr(), &linkStat));
+  EXPECT_EQ(sourceStat.st_ino, linkStat.st_ino);
+
+  // Copying over the link must not truncate the source.
+  ASSERT_TRUE(path::copyFile(sourcePath, linkPath));
+  ASSERT_EQ(0, stat(linkPath.cstr(), &linkStat));
+  EXPECT_NE(sourceStat.st_ino, linkStat.st_ino);
+  ASSERT_TRUE(path::readFileContents(sourcePath, copied));
+  EXPECT_EQ(content.size(), copied.size());
+
+  // Pseudo-files report a size of zero, but still have contents.
+  if (path::test("/proc/self/status", path::IS_FILE, true)) {
+    ASSERT_TRUE(path::copyFile("/proc/self/status", copyPath));
+    ASSERT_TRUE(path::readFileContents(copyPath, copied));
+    EXPECT_TRUE(StringRef(copied).startsWith("Name:"));
+  }
+
+  unlink(linkPath.cstr());
+  unlink(copyPath.cstr());
+  unlink(sourcePath.cstr());
+  copyPath.assign(tmpl);
+  path::combine(copyPath, "sub");
+  rmdir(copyPath.cstr());
+  rmdir(tmpl);
+}
+
+TEST(PathTest, SetLastModified) {
+  char tmpl[] = "/tmp/mint-mtime-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> firstPath(tmpl);
+  path::combine(firstPath, "first");
+  SmallString<128> secondPath(tmpl);
+  path::combine(secondPath, "second");
+
+  // A time copied from one file to another compares equal, fraction of a second and all.
+  ASSERT_TRUE(path::writeFileContents(firstPath, "first"));
+  path::FileStatus first, second;
+  ASSERT_TRUE(path::fileStatus(firstPath, first));
+  ASSERT_TRUE(path::writeFileContents(secondPath, "second"));
+  ASSERT_TRUE(path::setLastModified(secondPath, first.lastModified));
+  ASSERT_TRUE(path::fileStatus(secondPath, second));
+  EXPECT_TRUE(first.lastModified == second.lastModified);
+
+  unlink(firstPath.cstr());
+  unlink(secondPath.cstr());
+  rmdir(tmpl);
+}
+
+TEST(PathTest, RemoveDirectory) {
+  char tmpl[] = "/tmp/mint-rmdir-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> filePath(tmpl);
+  path::combine(filePath, "file.txt");
+  ASSERT_TRUE(path::writeFileContents(filePath, "text"));
+
+  // A directory that isn't empty is left alone, without complaint.
+  EXPECT_FALSE(path::removeDirectory(tmpl));
+  ASSERT_TRUE(path::remove(filePath));
+  EXPECT_TRUE(path::removeDirectory(tmpl));
+  EXPECT_FALSE(path::removeDirectory(tmpl));
+  path::FileStatus st;
+  ASSERT_TRUE(path::fileStatus(tmpl, st));
+  EXPECT_FALSE(st.exists);
+}
+
 }
@@ -0,0 +1,142 @@
+/* ================================================================== *
+ * Process unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/support/OStream.h"
+#include "mint/support/Path.h"
+#include "mint/support/Process.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mint {
+
+namespace {
+  /// Return a read handle for a temporary file containing 'size' bytes.
+  int makeSource(size_t size) {
+    FILE * fh = tmpfile();
+    for (size_t i = 0; i < size; ++i) {
+      fputc('a' + int(i % 26), fh);
+    }
+    fflush(fh);
+    int fd = dup(fileno(fh));
+    fclose(fh);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+  }
+
+  /// Remembers that a process has finished.
+  class FinishedListener : public ProcessListener {
+  public:
+    FinishedListener() : finished(false), success(false) {}
+
+    void processFinished(Process & process, bool success) {
+      this->finished = true;
+      this->success = success;
+    }
+
+    bool finished;
+    bool success;
+  };
+}
+
+TEST(ProcessTest, StreamBufferCapture) {
+  StreamBuffer sb;
+  EXPECT_TRUE(sb.empty());
+  sb.setSource(makeSource(10));
+  EXPECT_TRUE(sb.readAvailable());
+  EXPECT_EQ(10u, sb.size());
+
+  SmallString<0> head;
+  EXPECT_EQ(4u, sb.copyTo(head, 4));
+  EXPECT_EQ("abcd", StringRef(head));
+
+  OStrStream strm;
+  sb.writeTo(strm);
+  sb.close();
+  EXPECT_EQ("abcdefghij", strm.str());
+  EXPECT_TRUE(sb.empty());
+}
+
+TEST(ProcessTest, StreamBufferSpill) {
+  size_t size = 3 * StreamBuffer::SPILL_THRESHOLD + 17;
+  StreamBuffer sb;
+  sb.setSource(makeSource(size));
+  EXPECT_TRUE(sb.readAvailable());
+  EXPECT_EQ(size, sb.size());
+
+  // Reading the head of a spilled buffer must not disturb the rest of it.
+  SmallString<0> head;
+  EXPECT_EQ(30u, sb.copyTo(head, 30));
+  EXPECT_EQ("abcdefghijklmnopqrstuvwxyzabcd", StringRef(head));
+
+  OStrStream strm;
+  sb.writeTo(strm);
+  sb.close();
+  StringRef text = strm.str();
+  ASSERT_EQ(size, text.size());
+  EXPECT_EQ('a', text[0]);
+  EXPECT_EQ(char('a' + (size - 1) % 26), text[size - 1]);
+  EXPECT_EQ(char('a' + (StreamBuffer::SPILL_THRESHOLD + 5) % 26),
+      text[StreamBuffer::SPILL_THRESHOLD + 5]);
+}
+
+TEST(ProcessTest, ResourceUsage) {
+  FinishedListener listener;
+  Process process(&listener);
+  StringRef args[] = { "-c", "i=0; while [ $i -lt 20000 ]; do i=$((i+1)); done" };
+  ASSERT_TRUE(process.begin("sh", args, "/tmp"));
+  while (!listener.finished) {
+    ASSERT_TRUE(Process::waitForProcessEvent());
+  }
+  EXPECT_TRUE(listener.success);
+
+  const ResourceUsage & usage = process.usage();
+  EXPECT_GT(usage.wallTime, 0u);
+#if HAVE_WAIT4 && HAVE_SYS_RESOURCE_H
+  EXPECT_GT(usage.userTime + usage.systemTime, 0u);
+  EXPECT_GT(usage.maxResident, 0u);
+#endif
+
+  // Times of sequential commands add up, but their memory doesn't.
+  ResourceUsage total;
+  total.add(usage);
+  total.add(usage);
+  EXPECT_EQ(2 * usage.wallTime, total.wallTime);
+  EXPECT_EQ(2 * usage.userTime, total.userTime);
+  EXPECT_EQ(usage.maxResident, total.maxResident);
+}
+
+TEST(ProcessTest, ScriptWithoutInterpreterLine) {
+  char tmpl[] = "/tmp/mint-process-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> script(tmpl);
+  path::combine(script, "script");
+  SmallString<128> output(tmpl);
+  path::combine(output, "output");
+  ASSERT_TRUE(path::writeFileContents(script, "echo \"$1\" > \"$2\"\n"));
+  ASSERT_EQ(0, chmod(std::string(script.data(), script.size()).c_str(), 0755));
+
+  // The kernel won't run a file without '#!', so it has to be handed to the shell.
+  FinishedListener listener;
+  Process process(&listener);
+  StringRef args[] = { "hello", output };
+  ASSERT_TRUE(process.begin(script, args, tmpl));
+  while (!listener.finished) {
+    ASSERT_TRUE(Process::waitForProcessEvent());
+  }
+  EXPECT_TRUE(listener.success);
+  SmallString<32> content;
+  EXPECT_TRUE(path::readFileContents(output, content));
+  EXPECT_EQ("hello\n", StringRef(content));
+
+  path::remove(script);
+  path::remove(output);
+  ::rmdir(tmpl);
+}
+
+}
@@ -6,6 +6,7 @@
 #include "mint/collections/SmallVector.h"
 #include "mint/graph/StringDict.h"
 #include "mint/graph/Literal.h"
+#include "mint/intrinsic/StringRegistry.h"
 #include "TestHelpers.h"
 
 #include <algorithm>
@@ -64,6 +65,28 @@ TEST_F(StringDictTest, InsertSameKeyTwice) {
   ASSERT_EQ(1u, st.size());
 }
 
+TEST_F(StringDictTest, InternedKeys) {
+  String * ident = String::createIdent("interned");
+  String * key = StringRegistry::intern(ident);
+  ASSERT_FALSE(ident->isInterned());
+  ASSERT_TRUE(key->isInterned());
+  ASSERT_EQ(key, StringRegistry::intern(String::createIdent("interned")));
+  ASSERT_EQ(key, StringRegistry::str("interned"));
+  ASSERT_EQ(ident->hash(), key->hash());
+
+  // Quoted strings are never replaced by an identifier.
+  String * quoted = String::create("interned");
+  ASSERT_EQ(quoted, StringRegistry::intern(quoted));
+
+  StringDict<Node> st;
+  st[key] = makeInt(1);
+  st[ident] = makeInt(2);
+  st[quoted] = makeInt(3);
+  ASSERT_EQ(1u, st.size());
+  ASSERT_TRUE(st.find_as(HashedStringRef("interned")) != st.end());
+  ASSERT_TRUE(st.find_as(HashedStringRef("internee")) == st.end());
+}
+
 TEST_F(StringDictTest, Iterate) {
   StringDict<Node> st;
   st[String::create("Hello")] = makeInt(1);
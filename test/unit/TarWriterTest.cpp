@@ -0,0 +1,99 @@
+/* ================================================================== *
+ * TarWriter unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/support/Path.h"
+#include "mint/support/TarWriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace mint {
+
+namespace {
+  /// Return the value of a numeric header field.
+  unsigned long headerNumber(const char * header, unsigned offset, unsigned size) {
+    return ::strtoul(std::string(header + offset, size).c_str(), NULL, 8);
+  }
+
+  /// Return the checksum of a header block, computed the same way as tar does.
+  unsigned long headerChecksum(const char * header) {
+    unsigned long sum = 0;
+    for (unsigned i = 0; i < 512; ++i) {
+      sum += (i >= 148 && i < 156) ? ' ' : (unsigned char) header[i];
+    }
+    return sum;
+  }
+}
+
+TEST(TarWriterTest, CompressionForPath) {
+  TarWriter::Compression compression = TarWriter::GZIP;
+  EXPECT_TRUE(TarWriter::compressionForPath("out/pkg.tar", compression));
+  EXPECT_EQ(TarWriter::NONE, compression);
+  EXPECT_FALSE(TarWriter::compressionForPath("out/pkg.tbz", compression));
+  EXPECT_FALSE(TarWriter::compressionForPath("out/pkg.zip", compression));
+#if HAVE_ZLIB_H
+  EXPECT_TRUE(TarWriter::compressionForPath("out/pkg.tar.gz", compression));
+  EXPECT_EQ(TarWriter::GZIP, compression);
+  EXPECT_TRUE(TarWriter::compressionForPath("out/pkg.tgz", compression));
+  EXPECT_EQ(TarWriter::GZIP, compression);
+#endif
+}
+
+TEST(TarWriterTest, WriteArchive) {
+  char tmpl[] = "/tmp/mint-tar-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> sourcePath(tmpl);
+  path::combine(sourcePath, "hello.txt");
+  SmallString<128> archivePath(tmpl);
+  path::combine(archivePath, "out.tar");
+  ASSERT_TRUE(path::writeFileContents(sourcePath, "hello\n"));
+
+  // A name too long for the ustar name and prefix fields.
+  std::string longName("pkg/");
+  longName.append(200, 'x');
+
+  TarWriter writer;
+  ASSERT_TRUE(writer.open(archivePath, TarWriter::NONE, 1000000000));
+  ASSERT_TRUE(writer.addDirectory("pkg"));
+  ASSERT_TRUE(writer.addFile("pkg/hello.txt", sourcePath));
+  ASSERT_TRUE(writer.addFile(StringRef(longName.data(), longName.size()), sourcePath));
+  ASSERT_TRUE(writer.close());
+
+  SmallString<0> data;
+  ASSERT_TRUE(path::readFileContents(archivePath, data));
+  ASSERT_EQ(0u, data.size() % 10240);
+  const char * header = data.data();
+
+  // Directory entry
+  EXPECT_EQ(0, ::strncmp(header + 257, "ustar", 5));
+  EXPECT_STREQ("pkg/", header);
+  EXPECT_EQ('5', header[156]);
+  EXPECT_EQ(0755u, headerNumber(header, 100, 8));
+  EXPECT_EQ(1000000000u, headerNumber(header, 136, 12));
+  EXPECT_EQ(headerChecksum(header), headerNumber(header, 148, 8));
+
+  // File entry, followed by its data padded to a whole block.
+  header += 512;
+  EXPECT_STREQ("pkg/hello.txt", header);
+  EXPECT_EQ('0', header[156]);
+  EXPECT_EQ(0644u, headerNumber(header, 100, 8));
+  EXPECT_EQ(6u, headerNumber(header, 124, 12));
+  EXPECT_EQ(headerChecksum(header), headerNumber(header, 148, 8));
+  EXPECT_EQ(0, ::memcmp(header + 512, "hello\n", 6));
+
+  // The long name is in a pax extended header before the entry.
+  header += 1024;
+  EXPECT_EQ('x', header[156]);
+  EXPECT_EQ(headerChecksum(header), headerNumber(header, 148, 8));
+  std::string pax(header + 512, headerNumber(header, 124, 12));
+  EXPECT_NE(std::string::npos, pax.find(" path=" + longName + "\n"));
+
+  path::remove(archivePath);
+  path::remove(sourcePath);
+  ::rmdir(tmpl);
+}
+
+}
@@ -0,0 +1,93 @@
+/* ================================================================== *
+ * TargetIndex unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/build/TargetIndex.h"
+#include "mint/support/Path.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace mint {
+
+namespace {
+  // 'app' links 'main.o', which 'main_o' compiles from 'main.c' and 'util.h'; 'app'
+  // also depends on 'lib', which compiles 'util.c', also using 'util.h'.
+  const char INDEX_TEXT[] =
+      "mint-target-graph 1\n"
+      "6 4 \n"
+      "/build/app\n"
+      "/build/main.o\n"
+      "/build/util.o\n"
+      "/src/main.c\n"
+      "/src/util.c\n"
+      "/src/util.h\n"
+      "2 1 1 1 2 1 0 app\n"
+      "0 2 1 4 5 2 lib\n"
+      "0 2 1 3 5 1 main_o\n"
+      "0 1 0 5 unused\n";
+}
+
+TEST(TargetIndexTest, ReadAndQuery) {
+  char tmpl[] = "/tmp/mint-index-XXXXXX";
+  ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+  SmallString<128> indexPath(tmpl);
+  path::combine(indexPath, "graph.cache");
+  ASSERT_TRUE(path::writeFileContents(indexPath, INDEX_TEXT));
+
+  TargetIndex index;
+  ASSERT_TRUE(index.read(indexPath));
+  ASSERT_EQ(4u, index.targetCount());
+  ASSERT_EQ(6u, index.fileCount());
+
+  TargetIndex::Index app = index.findTarget("app");
+  TargetIndex::Index lib = index.findTarget("lib");
+  TargetIndex::Index mainObj = index.findTarget("main_o");
+  ASSERT_EQ(0u, app);
+  ASSERT_EQ(1u, lib);
+  ASSERT_EQ(2u, mainObj);
+  EXPECT_EQ(TargetIndex::NOT_FOUND, index.findTarget("missing"));
+  EXPECT_EQ(TargetIndex::NOT_FOUND, index.findFile("/src/missing.c"));
+
+  // Who produces and who uses each file.
+  TargetIndex::Index mainO = index.findFile("/build/main.o");
+  ASSERT_NE(TargetIndex::NOT_FOUND, mainO);
+  ASSERT_EQ(1u, index.producers(mainO).size());
+  EXPECT_EQ(mainObj, index.producers(mainO)[0]);
+  ASSERT_EQ(1u, index.consumers(mainO).size());
+  EXPECT_EQ(app, index.consumers(mainO)[0]);
+  TargetIndex::Index header = index.findFile("/src/util.h");
+  ASSERT_EQ(3u, index.consumers(header).size());
+  EXPECT_TRUE(index.producers(header).empty());
+
+  SmallVector<TargetIndex::Index, 8> result;
+  TargetIndex::Index roots[] = { app };
+  index.dependencyClosure(roots, result);
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ(lib, result[0]);
+  EXPECT_EQ(mainObj, result[1]);
+
+  TargetIndex::Index libRoots[] = { lib };
+  index.dependentClosure(libRoots, result);
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ(app, result[0]);
+
+  // Writing the index out gives back what was read.
+  SmallString<0> written;
+  index.write(written);
+  EXPECT_EQ(StringRef(INDEX_TEXT), StringRef(written));
+
+  // A file that doesn't parse, or isn't in order, leaves the index empty.
+  ASSERT_TRUE(path::writeFileContents(indexPath, "mint-target-graph 1\n1 1 \n/a\n0 0 9 x\n"));
+  EXPECT_FALSE(index.read(indexPath));
+  EXPECT_EQ(0u, index.targetCount());
+  ASSERT_TRUE(path::writeFileContents(indexPath, "mint-target-graph 1\n2 0 \n/b\n/a\n"));
+  EXPECT_FALSE(index.read(indexPath));
+  EXPECT_EQ(0u, index.fileCount());
+
+  path::remove(indexPath);
+  ::rmdir(tmpl);
+}
+
+}
@@ -5,6 +5,8 @@
 #include "gtest/gtest.h"
 #include "mint/support/Wildcard.h"
 
+#include <string>
+
 namespace mint {
 
 bool doMatch(StringRef pattern, StringRef str) {
@@ -65,4 +67,73 @@ TEST(WildcardMatcherTest, StarWildcard) {
   EXPECT_FALSE(doMatch("abc*", "abbc"));
 }
 
+TEST(WildcardMatcherTest, MultipleStars) {
+  EXPECT_TRUE(doMatch("*_test_*.cpp", "lexer_test_main.cpp"));
+  EXPECT_TRUE(doMatch("*_test_*.cpp", "_test_.cpp"));
+  EXPECT_TRUE(doMatch("a*b*c", "aXbYbZc"));
+  EXPECT_TRUE(doMatch("a**c", "abc"));
+  EXPECT_FALSE(doMatch("*_test_*.cpp", "lexer_test.cpp"));
+  EXPECT_FALSE(doMatch("a*b*c", "aXcYb"));
+  EXPECT_TRUE(doMatch("a*ab", "aab"));
+  EXPECT_FALSE(doMatch("a*aa*a", "aaa"));
+
+  // A pattern that makes a backtracking matcher take exponential time.
+  std::string input(200, 'a');
+  EXPECT_FALSE(doMatch("*a*a*a*a*a*a*a*a*a*a*a*b", input));
+}
+
+TEST(WildcardMatcherTest, CharClass) {
+  EXPECT_TRUE(doMatch("[abc].h", "b.h"));
+  EXPECT_TRUE(doMatch("file[0-9].txt", "file7.txt"));
+  EXPECT_TRUE(doMatch("[!a-c]x", "dx"));
+  EXPECT_TRUE(doMatch("[^a-c]x", "dx"));
+  EXPECT_TRUE(doMatch("[]]", "]"));
+  EXPECT_TRUE(doMatch("*.[ch]", "main.c"));
+  EXPECT_FALSE(doMatch("[abc].h", "d.h"));
+  EXPECT_FALSE(doMatch("file[0-9].txt", "fileA.txt"));
+  EXPECT_FALSE(doMatch("[!a-c]x", "bx"));
+
+  // An unterminated bracket is literal.
+  EXPECT_TRUE(doMatch("a[b", "a[b"));
+  EXPECT_FALSE(doMatch("a[b", "ab"));
+}
+
+TEST(WildcardMatcherTest, Alternation) {
+  EXPECT_TRUE(doMatch("*.{cpp,h}", "a.cpp"));
+  EXPECT_TRUE(doMatch("*.{cpp,h}", "a.h"));
+  EXPECT_TRUE(doMatch("{lib,test}_*.{c,cc}", "test_x.cc"));
+  EXPECT_TRUE(doMatch("a{b,c{d,e}}f", "acef"));
+  EXPECT_TRUE(doMatch("a{,b}c", "ac"));
+  EXPECT_FALSE(doMatch("*.{cpp,h}", "a.c"));
+  EXPECT_FALSE(doMatch("a{b,c{d,e}}f", "acf"));
+
+  // An unterminated brace is literal.
+  EXPECT_TRUE(doMatch("a{b", "a{b"));
+}
+
+TEST(WildcardMatcherTest, Escape) {
+  EXPECT_TRUE(doMatch("a\\*", "a*"));
+  EXPECT_FALSE(doMatch("a\\*", "ab"));
+  EXPECT_TRUE(doMatch("\\{a,b\\}", "{a,b}"));
+}
+
+TEST(WildcardMatcherTest, Exclude) {
+  WildcardMatcher matcher("*.cpp");
+  matcher.exclude("*_test.cpp");
+  matcher.exclude("{old,tmp}_*");
+  EXPECT_TRUE(matcher.match("main.cpp"));
+  EXPECT_FALSE(matcher.match("main_test.cpp"));
+  EXPECT_FALSE(matcher.match("old_main.cpp"));
+  EXPECT_FALSE(matcher.match("tmp_main.cpp"));
+  EXPECT_FALSE(matcher.match("main.h"));
+}
+
+TEST(WildcardMatcherTest, HasWildcardChars) {
+  EXPECT_FALSE(WildcardMatcher::hasWildcardChars("main.cpp"));
+  EXPECT_TRUE(WildcardMatcher::hasWildcardChars("*.cpp"));
+  EXPECT_TRUE(WildcardMatcher::hasWildcardChars("ma?n.cpp"));
+  EXPECT_TRUE(WildcardMatcher::hasWildcardChars("main.[ch]"));
+  EXPECT_TRUE(WildcardMatcher::hasWildcardChars("main.{cpp,h}"));
+}
+
 }
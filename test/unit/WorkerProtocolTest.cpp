@@ -0,0 +1,154 @@
+/* ================================================================== *
+ * WorkerProtocol unit test
+ * ================================================================== */
+
+#include "gtest/gtest.h"
+#include "mint/build/WorkerProtocol.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mint {
+
+TEST(WorkerProtocolTest, EncodeDecode) {
+  MessageWriter writer(WORKER_RUN);
+  writer.putInt(42);
+  writer.putInt64(0x0123456789abcdefULL);
+  writer.putString("hello");
+  writer.putString("");
+  StringRef frame = writer.finish();
+
+  // Length prefix covers the type byte and the fields.
+  ASSERT_EQ(4u + 1u + 4u + 8u + 4u + 5u + 4u, frame.size());
+  EXPECT_EQ(char(WORKER_RUN), frame[4]);
+
+  MessageReader reader(frame.substr(5));
+  uint32_t i = 0;
+  uint64_t j = 0;
+  StringRef s1, s2;
+  EXPECT_TRUE(reader.getInt(i));
+  EXPECT_TRUE(reader.getInt64(j));
+  EXPECT_TRUE(reader.getString(s1));
+  EXPECT_TRUE(reader.getString(s2));
+  EXPECT_EQ(42u, i);
+  EXPECT_EQ(0x0123456789abcdefULL, j);
+  EXPECT_EQ("hello", s1);
+  EXPECT_TRUE(s2.empty());
+  EXPECT_TRUE(reader.ok());
+
+  // Reading past the end fails, and keeps failing.
+  EXPECT_FALSE(reader.getInt(i));
+  EXPECT_FALSE(reader.ok());
+}
+
+TEST(WorkerProtocolTest, TruncatedString) {
+  MessageWriter writer(WORKER_BLOB);
+  writer.putString("abcdef");
+  StringRef frame = writer.finish();
+
+  MessageReader reader(frame.substr(5, frame.size() - 7));
+  StringRef s;
+  EXPECT_FALSE(reader.getString(s));
+  EXPECT_FALSE(reader.ok());
+}
+
+TEST(WorkerProtocolTest, Digest) {
+  ContentDigest digest;
+  Blake3::hash("contents", 8, digest.bytes);
+  MessageWriter writer(WORKER_BLOB);
+  writer.putDigest(digest);
+  writer.putInt(7);
+  StringRef frame = writer.finish();
+  ASSERT_EQ(4u + 1u + Blake3::DIGEST_SIZE + 4u, frame.size());
+
+  MessageReader reader(frame.substr(5));
+  ContentDigest result;
+  uint32_t i = 0;
+  EXPECT_TRUE(reader.getDigest(result));
+  EXPECT_TRUE(reader.getInt(i));
+  EXPECT_TRUE(result == digest);
+  EXPECT_EQ(7u, i);
+
+  // A digest cut short is a truncated message.
+  MessageReader shortReader(frame.substr(5, 16));
+  EXPECT_FALSE(shortReader.getDigest(result));
+  EXPECT_FALSE(shortReader.ok());
+}
+
+TEST(WorkerProtocolTest, Connection) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  MessageConnection left(fds[0]);
+  MessageConnection right(fds[1]);
+
+  MessageWriter hello(WORKER_HELLO);
+  hello.putInt(WORKER_PROTOCOL_VERSION);
+  left.send(hello);
+  MessageWriter output(WORKER_OUTPUT);
+  output.putString("text");
+  left.send(output);
+  EXPECT_TRUE(left.hasOutput());
+  EXPECT_TRUE(left.flushOutput(true));
+  EXPECT_FALSE(left.hasOutput());
+
+  WorkerMessageType type;
+  StringRef body;
+  EXPECT_FALSE(right.nextMessage(type, body));
+  EXPECT_TRUE(right.readInput());
+
+  ASSERT_TRUE(right.nextMessage(type, body));
+  EXPECT_EQ(WORKER_HELLO, type);
+  uint32_t version;
+  EXPECT_TRUE(MessageReader(body).getInt(version));
+  EXPECT_EQ(WORKER_PROTOCOL_VERSION, version);
+
+  ASSERT_TRUE(right.nextMessage(type, body));
+  EXPECT_EQ(WORKER_OUTPUT, type);
+  StringRef text;
+  EXPECT_TRUE(MessageReader(body).getString(text));
+  EXPECT_EQ("text", text);
+  EXPECT_FALSE(right.nextMessage(type, body));
+
+  // Closing one end shows up as end of input on the other.
+  left.close();
+  EXPECT_FALSE(right.readInput());
+  right.close();
+}
+
+TEST(WorkerProtocolTest, BadFrame) {
+  WorkerMessageType type;
+  StringRef body;
+
+  // A frame without even a type byte is a protocol error, and so is everything after it.
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  MessageConnection empty(fds[1]);
+  MessageWriter hello(WORKER_HELLO);
+  StringRef frame = hello.finish();
+  const char emptyFrame[4] = { 0, 0, 0, 0 };
+  ASSERT_EQ(4, ::write(fds[0], emptyFrame, 4));
+  ASSERT_EQ(ssize_t(frame.size()), ::write(fds[0], frame.data(), frame.size()));
+  EXPECT_TRUE(empty.readInput());
+  EXPECT_FALSE(empty.failed());
+  EXPECT_FALSE(empty.nextMessage(type, body));
+  EXPECT_TRUE(empty.failed());
+  EXPECT_FALSE(empty.nextMessage(type, body));
+  ::close(fds[0]);
+  empty.close();
+
+  // An oversized frame is rejected as soon as its length arrives.
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  MessageConnection huge(fds[1]);
+  uint32_t length = uint32_t(WORKER_MAX_FRAME_SIZE + 1);
+  const char hugeFrame[5] = {
+    char(length >> 24), char(length >> 16), char(length >> 8), char(length), char(WORKER_RUN)
+  };
+  ASSERT_EQ(5, ::write(fds[0], hugeFrame, 5));
+  EXPECT_TRUE(huge.readInput());
+  EXPECT_FALSE(huge.nextMessage(type, body));
+  EXPECT_TRUE(huge.failed());
+  ::close(fds[0]);
+  huge.close();
+}
+
+}
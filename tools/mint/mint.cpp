@@ -2,6 +2,8 @@
  * mint tool
  * ================================================================== */
 
+#include "mint/build/Worker.h"
+
 #include "mint/project/BuildConfiguration.h"
 
 #include "mint/support/CommandLine.h"
@@ -13,6 +15,8 @@ using namespace mint;
 
 cl::OptionGroup global("global", "Global program options");
 cl::OptionGroup debugging("debug", "Options for debugging");
+cl::OptionGroup worker("worker", "Options for the 'worker' command");
+cl::OptionGroup query("query", "Options for the 'query' command");
 
 cl::Option<bool> help("help", cl::Group("global"), cl::Description("Display this message."));
 
@@ -26,11 +30,25 @@ void showHelp() {
   out() << "  config                  Run configuration tests and prepare targets for building.\n";
   out() << "  targets                 List all buildable targets.\n";
   out() << "  build [<target> ...]    Build the specified targets in the current project.\n";
-  out() << "  clean                   Delete output files of all targets.\n";
+  out() << "  clean [<target> ...]    Delete output files of all targets, or of the\n";
+  out() << "                          specified targets and their dependencies.\n";
+  out() << "  stats [<count>]         Show the targets that used the most time, memory\n";
+  out() << "                          and I/O when they were last built.\n";
+  out() << "  query <type> <name> ... Answer a question about the target graph, without\n";
+  out() << "                          evaluating the project if it hasn't changed. Types are:\n";
+  out() << "                          'deps' for every target a target depends on,\n";
+  out() << "                          'rdeps' for every target depending on a target or file,\n";
+  out() << "                          'outputs' for the files a target produces, and\n";
+  out() << "                          'owner' for the target producing or using a file.\n";
+  out() << "                          A file is relative to the current directory or,\n";
+  out() << "                          failing that, to the project's source directory.\n";
   out() << "  generate <builder-type> Generate build files for the specified build system.\n";
+  out() << "  worker [options...]     Run commands on behalf of builds started with --workers.\n";
   out() << "  help                    Display usage information.\n";
   out() << "  help [topic]            Show help on a specific topic or command.\n";
-  out() << "                          Topics are: 'global' for help on global options.\n";
+  out() << "                          Topics are: 'global' for help on global options,\n";
+  out() << "                          'worker' for help on worker options,\n";
+  out() << "                          'query' for help on query options.\n";
 }
 
 void parseInputParams(BuildConfiguration * bc, StringRef cwd, int argc, char *argv[]) {
@@ -96,6 +114,21 @@ void parseInputParams(BuildConfiguration * bc, StringRef cwd, int argc, char *ar
     } else if (arg == "targets") {
       foundCommand = true;
       bc->showTargets(makeArrayRef(ai, aiEnd));
+    } else if (arg == "stats") {
+      foundCommand = true;
+      bc->showStats(makeArrayRef(ai, aiEnd));
+    } else if (arg == "worker") {
+      foundCommand = true;
+      Worker server;
+      if (server.run(ai, aiEnd) != 0) {
+        exit(-1);
+      }
+      return;
+    } else if (arg == "query") {
+      foundCommand = true;
+      StringRef queryGroups[] = { "query" };
+      ai = cl::Parser::parse(queryGroups, ai, aiEnd);
+      bc->query(makeArrayRef(ai, aiEnd));
     } else if (arg == "dump") {
       foundCommand = true;
       bc->dumpTargets(makeArrayRef(ai, aiEnd));